@@ -25,10 +25,9 @@ SOFTWARE.
 #include "PolyVoxExample.h"
 
 #include "PolyVox/Density.h"
-#include "PolyVox/MarchingCubesSurfaceExtractor.h"
+#include "PolyVox/MarchingCubesLodSurfaceExtractor.h"
 #include "PolyVox/Mesh.h"
 #include "PolyVox/RawVolume.h"
-#include "PolyVox/VolumeResampler.h"
 
 #include <QApplication>
 
@@ -88,24 +87,30 @@ protected:
 		//smoothRegion<PagedVolume, Density8>(volData, volData.getEnclosingRegion());
 		//smoothRegion<PagedVolume, Density8>(volData, volData.getEnclosingRegion());
 
-		RawVolume<uint8_t> volDataLowLOD(PolyVox::Region(Vector3DInt32(0, 0, 0), Vector3DInt32(15, 31, 31)));
+		//Build lower resolution copies of the volume at 1/2 and 1/4 of the resolution
+		LodPyramid< RawVolume<uint8_t> > pyramid(&volData, volData.getEnclosingRegion(), 3);
 
-		VolumeResampler< RawVolume<uint8_t>, RawVolume<uint8_t> > volumeResampler(&volData, PolyVox::Region(Vector3DInt32(0, 0, 0), Vector3DInt32(31, 63, 63)), &volDataLowLOD, volDataLowLOD.getEnclosingRegion());
-		volumeResampler.execute();
+		//Choose the level of detail of each block, with the blocks nearest
+		//to the corner at (64, 0, 0) extracted at the full resolution.
+		LodOctree octree(volData.getEnclosingRegion(), 8, 3);
+		octree.update(Vector3DFloat(64.0f, 0.0f, 0.0f), 1.0f);
 
-		//Extract the surface
-		auto meshLowLOD = extractMarchingCubesMesh(&volDataLowLOD, volDataLowLOD.getEnclosingRegion());
-		// The returned mesh needs to be decoded to be appropriate for GPU rendering.
-		auto decodedMeshLowLOD = decodeMesh(meshLowLOD);
+		for (const LodBlock& block : octree.getBlocks())
+		{
+			//Extract the surface for this block. It joins up with the meshes of the neighbouring blocks.
+			auto mesh = extractMarchingCubesLodMesh(&pyramid, block);
+			if (mesh.getNoOfIndices() == 0)
+			{
+				continue;
+			}
 
-		//Extract the surface
-		auto meshHighLOD = extractMarchingCubesMesh(&volData, PolyVox::Region(Vector3DInt32(30, 0, 0), Vector3DInt32(63, 63, 63)));
-		// The returned mesh needs to be decoded to be appropriate for GPU rendering.
-		auto decodedMeshHighLOD = decodeMesh(meshHighLOD);
+			// The returned mesh needs to be decoded to be appropriate for GPU rendering.
+			auto decodedMesh = decodeMesh(mesh);
 
-		//Pass the surface to the OpenGL window
-		addMesh(decodedMeshHighLOD, Vector3DInt32(30, 0, 0));
-		addMesh(decodedMeshLowLOD, Vector3DInt32(0, 0, 0), 63.0f / 31.0f);
+			//The mesh is in the voxels of its level of detail, so it is scaled up to the full resolution.
+			const int32_t iScale = 1 << block.uLevel;
+			addMesh(decodedMesh, decodedMesh.getOffset() * iScale, static_cast<float>(iScale));
+		}
 
 		setCameraTransform(QVector3D(100.0f, 100.0f, 100.0f), -(PI / 4.0f), PI + (PI / 4.0f));
 	}
@@ -33,6 +33,10 @@
 #include "Raycast.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
 
 namespace PolyVox
 {
@@ -42,22 +46,54 @@ namespace PolyVox
 	 * Ambient occlusion
 	 */
 
+	template<typename VoxelType> class RawVolume;
+
+	/// The voxels outside of the given bounds are treated as transparent, and the ray is stopped as soon as it leaves them
+	/// (which it can't do without having entered them first). hasLeftBounds() then tells the two ways of stopping apart.
 	template<typename VolumeType, typename IsVoxelTransparentCallback>
 	class AmbientOcclusionCalculatorRaycastCallback
 	{
 	public:
-		AmbientOcclusionCalculatorRaycastCallback(IsVoxelTransparentCallback isVoxelTransparentCallback) : mIsVoxelTransparentCallback(isVoxelTransparentCallback)
+		AmbientOcclusionCalculatorRaycastCallback(IsVoxelTransparentCallback isVoxelTransparentCallback, const Region& regBounds = Region::MaxRegion())
+			: mIsVoxelTransparentCallback(isVoxelTransparentCallback)
+			, m_regBounds(regBounds)
+			, m_bEnteredBounds(false)
+			, m_bLeftBounds(false)
 		{
 		}
 
 		bool operator()(const typename VolumeType::Sampler& sampler)
 		{
+			if (!m_regBounds.containsPoint(sampler.getPosition()))
+			{
+				m_bLeftBounds = m_bEnteredBounds;
+				return !m_bLeftBounds;
+			}
+			m_bEnteredBounds = true;
+
 			auto sample = sampler.getVoxel();
 			bool func = mIsVoxelTransparentCallback(sample);
 			return func;
 		}
 
+		/// Prepares the callback for the next ray.
+		void reset(void)
+		{
+			m_bEnteredBounds = false;
+			m_bLeftBounds = false;
+		}
+
+		bool hasLeftBounds(void) const
+		{
+			return m_bLeftBounds;
+		}
+
 		IsVoxelTransparentCallback mIsVoxelTransparentCallback;
+
+	private:
+		Region m_regBounds;
+		bool m_bEnteredBounds;
+		bool m_bLeftBounds;
 	};
 
 	// NOTE: The callback needs to be a functor not a function. I haven't been
@@ -72,6 +108,10 @@ namespace PolyVox
 	/// Calculate the ambient occlusion for the volume
 	template<typename VolumeType, typename IsVoxelTransparentCallback>
 	void calculateAmbientOcclusion(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement, IsVoxelTransparentCallback isVoxelTransparentCallback);
+
+	/// Calculates the same ambient occlusion as calculateAmbientOcclusion(), but uses several threads to do so.
+	template<typename VolumeType, typename IsVoxelTransparentCallback>
+	void calculateAmbientOcclusionParallel(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement, IsVoxelTransparentCallback isVoxelTransparentCallback, uint32_t uNoOfThreads = 0);
 }
 
 #include "AmbientOcclusionCalculator.inl"
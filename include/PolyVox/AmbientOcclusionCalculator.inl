@@ -24,26 +24,21 @@
 
 namespace PolyVox
 {
-	/**
-	 * This function fills a 3D array with ambient occlusion values computed by raycasting through the volume.
-	 * This approach to ambient occlusion is only appropriate for relatvely small volumes, otherwise it will 
-	 * become very slow and consume a lot of memory. You will need to find a way to actually use the generated
-	 * ambient occlusion data, which might mean uploading it the the GPU as a volume texture or sampling on
-	 * the CPU using the vertex positions from your generated mesh.
-	 *
-	 * In practice we have not made much use of this implementation ourselves, so you may find it needs some
-	 * optimizations or improvements to be useful. It is likely that there are actually better approaches to
-	 * the ambient occlusion problem.
-	 *
-	 * \param volInput The volume to calculate the ambient occlusion for
-	 * \param[out] arrayResult The output of the calculator
-	 * \param region The region of the volume for which the occlusion should be calculated
-	 * \param fRayLength The length for each test ray
-	 * \param uNoOfSamplesPerOutputElement The number of samples to calculate the occlusion
-	 * \param isVoxelTransparentCallback A callback which takes a \a VoxelType and returns a \a bool whether the voxel is transparent
-	 */
-	template<typename VolumeType, typename IsVoxelTransparentCallback>
-	void calculateAmbientOcclusion(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement, IsVoxelTransparentCallback isVoxelTransparentCallback)
+	/// The region outside of which a volume only contains its border value (everywhere, for volumes which don't have a border).
+	template<typename VolumeType>
+	Region getAmbientOcclusionBounds(const VolumeType* /*volInput*/)
+	{
+		return Region::MaxRegion();
+	}
+
+	template<typename VoxelType>
+	Region getAmbientOcclusionBounds(const RawVolume<VoxelType>* volInput)
+	{
+		return volInput->getEnclosingRegion();
+	}
+
+	/// Checks that the region can be divided evenly between the elements of the array.
+	inline void validateAmbientOcclusionArray(Array<3, uint8_t>* arrayResult, const Region& region)
 	{
 		//Make sure that the size of the volume is an exact multiple of the size of the array.
 		if (region.getWidthInVoxels() % arrayResult->getDimension(0) != 0)
@@ -58,19 +53,17 @@ namespace PolyVox
 		{
 			POLYVOX_THROW(std::invalid_argument, "Volume width must be an exact multiple of array depth.");
 		}
+	}
 
-		uint16_t uRandomUnitVectorIndex = 0;
-		uint16_t uRandomVectorIndex = 0;
-		uint16_t uIndexIncreament;
-
+	/// Calculates the ambient occlusion for the slices of the array from uFirstSlice up to (but not including) uEndSlice, as
+	/// described for calculateAmbientOcclusion(). The results do not depend on how the array is divided into slices.
+	template<typename VolumeType, typename IsVoxelTransparentCallback>
+	void calculateAmbientOcclusionSlices(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement,
+		IsVoxelTransparentCallback isVoxelTransparentCallback, uint32_t uFirstSlice, uint32_t uEndSlice)
+	{
 		//Our initial indices. It doesn't matter exactly what we set here, but the code below makes 
 		//sure they are different for different regions which helps reduce tiling patterns in the results.
-		uRandomUnitVectorIndex += region.getLowerX() + region.getLowerY() + region.getLowerZ();
-		uRandomVectorIndex += region.getLowerX() + region.getLowerY() + region.getLowerZ();
-
-		//This value helps us jump around in the array a bit more, so the
-		//nth 'random' value isn't always followed by the n+1th 'random' value.
-		uIndexIncreament = 1;
+		const uint16_t uInitialRandomIndex = static_cast<uint16_t>(region.getLowerX() + region.getLowerY() + region.getLowerZ());
 
 		const int iRatioX = region.getWidthInVoxels() / arrayResult->getDimension(0);
 		const int iRatioY = region.getHeightInVoxels() / arrayResult->getDimension(1);
@@ -88,19 +81,36 @@ namespace PolyVox
 
 		const Vector3DFloat v3dOffset(0.5f, 0.5f, 0.5f);
 
-		//This loop iterates over the bottom-lower-left voxel in each of the cells in the output array
-		for (uint16_t z = region.getLowerZ(); z <= region.getUpperZ(); z += iRatioZ)
+		// A single sampler is used for all the rays. They stop at the first voxel which is not transparent,
+		// or as soon as they leave the volume (as it's transparent everywhere outside).
+		typename VolumeType::Sampler sampler(volInput);
+		AmbientOcclusionCalculatorRaycastCallback<VolumeType, IsVoxelTransparentCallback> ambientOcclusionCalculatorRaycastCallback(isVoxelTransparentCallback, getAmbientOcclusionBounds(volInput));
+		Vector3DInt32 v3dLastVoxel;
+		uint32_t uNoOfSteps;
+
+		//This loop iterates over the cells in the output array
+		for (uint32_t uCellZ = uFirstSlice; uCellZ < uEndSlice; uCellZ++)
 		{
-			for (uint16_t y = region.getLowerY(); y <= region.getUpperY(); y += iRatioY)
+			for (uint32_t uCellY = 0; uCellY < arrayResult->getDimension(1); uCellY++)
 			{
-				for (uint16_t x = region.getLowerX(); x <= region.getUpperX(); x += iRatioX)
+				for (uint32_t uCellX = 0; uCellX < arrayResult->getDimension(0); uCellX++)
 				{
-					//Compute a start position corresponding to 
-					//the centre of the cell in the output array.
-					Vector3DFloat v3dStart(x, y, z);
+					//Compute a start position corresponding to the centre of the cell
+					//in the output array, from its bottom-lower-left voxel.
+					Vector3DFloat v3dStart(region.getLowerX() + uCellX * iRatioX, region.getLowerY() + uCellY * iRatioY, region.getLowerZ() + uCellZ * iRatioZ);
 					v3dStart -= v3dOffset;
 					v3dStart += v3dHalfRatio;
 
+					//The indices into the random arrays step by an increasing amount for each sample, which helps us jump
+					//around in the arrays a bit more (so the nth 'random' value isn't always followed by the n+1th 'random'
+					//value). After k samples the increment is 1 + 2k and the indices have moved on by k^2 + k and k^2 + 2k,
+					//so each cell can work out where it starts. All of this is modulo 2^16, as the indices are 16 bit.
+					const uint32_t uCell = (uCellZ * arrayResult->getDimension(1) + uCellY) * arrayResult->getDimension(0) + uCellX;
+					const uint32_t uNoOfPreviousSamples = (uCell * uNoOfSamplesPerOutputElement) & 0xFFFF;
+					uint16_t uRandomVectorIndex = static_cast<uint16_t>(uInitialRandomIndex + uNoOfPreviousSamples * uNoOfPreviousSamples + uNoOfPreviousSamples);
+					uint16_t uRandomUnitVectorIndex = static_cast<uint16_t>(uInitialRandomIndex + uNoOfPreviousSamples * uNoOfPreviousSamples + 2 * uNoOfPreviousSamples);
+					uint16_t uIndexIncreament = static_cast<uint16_t>(1 + 2 * uNoOfPreviousSamples);
+
 					//Keep track of how many rays did not hit anything
 					uint8_t uVisibleDirections = 0;
 
@@ -115,12 +125,10 @@ namespace PolyVox
 						Vector3DFloat v3dRayDirection = randomUnitVectors[(uRandomUnitVectorIndex += (++uIndexIncreament)) % 1021]; //Different prime number.
 						v3dRayDirection *= fRayLength;
 
-						AmbientOcclusionCalculatorRaycastCallback<VolumeType, IsVoxelTransparentCallback> ambientOcclusionCalculatorRaycastCallback(isVoxelTransparentCallback);
-						RaycastResult result = raycastWithDirection(volInput, v3dRayStart, v3dRayDirection, ambientOcclusionCalculatorRaycastCallback);
+						ambientOcclusionCalculatorRaycastCallback.reset();
+						RaycastResult result = traceRay(sampler, v3dRayStart, v3dRayStart + v3dRayDirection, ambientOcclusionCalculatorRaycastCallback, v3dLastVoxel, uNoOfSteps);
 
-						// Note - The performance of this could actually be improved it we exited as soon
-						// as the ray left the volume. The raycast test has an example of how to do this.
-						if (result == RaycastResults::Completed)
+						if ((result == RaycastResults::Completed) || ambientOcclusionCalculatorRaycastCallback.hasLeftBounds())
 						{
 							++uVisibleDirections;
 						}
@@ -139,9 +147,110 @@ namespace PolyVox
 						POLYVOX_ASSERT((fVisibility >= 0.0f) && (fVisibility <= 1.0f), "Visibility value out of range.");
 					}
 
-					(*arrayResult)(z / iRatioZ, y / iRatioY, x / iRatioX) = static_cast<uint8_t>(255.0f * fVisibility);
+					(*arrayResult)(uCellZ, uCellY, uCellX) = static_cast<uint8_t>(255.0f * fVisibility);
 				}
 			}
 		}
 	}
+
+	/**
+	 * This function fills a 3D array with ambient occlusion values computed by raycasting through the volume.
+	 * This approach to ambient occlusion is only appropriate for relatvely small volumes, otherwise it will 
+	 * become very slow and consume a lot of memory. You will need to find a way to actually use the generated
+	 * ambient occlusion data, which might mean uploading it the the GPU as a volume texture or sampling on
+	 * the CPU using the vertex positions from your generated mesh.
+	 *
+	 * Each ray stops at the first voxel which is not transparent. Voxels outside of a RawVolume are treated as
+	 * transparent (whatever its border value), so rays also stop as soon as they leave the volume. For large
+	 * regions, calculateAmbientOcclusionParallel() calculates the same values using several threads.
+	 *
+	 * In practice we have not made much use of this implementation ourselves, so you may find it needs some
+	 * optimizations or improvements to be useful. It is likely that there are actually better approaches to
+	 * the ambient occlusion problem.
+	 *
+	 * \param volInput The volume to calculate the ambient occlusion for
+	 * \param[out] arrayResult The output of the calculator
+	 * \param region The region of the volume for which the occlusion should be calculated
+	 * \param fRayLength The length for each test ray
+	 * \param uNoOfSamplesPerOutputElement The number of samples to calculate the occlusion
+	 * \param isVoxelTransparentCallback A callback which takes a \a VoxelType and returns a \a bool whether the voxel is transparent
+	 */
+	template<typename VolumeType, typename IsVoxelTransparentCallback>
+	void calculateAmbientOcclusion(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement, IsVoxelTransparentCallback isVoxelTransparentCallback)
+	{
+		validateAmbientOcclusionArray(arrayResult, region);
+
+		calculateAmbientOcclusionSlices(volInput, arrayResult, region, fRayLength, uNoOfSamplesPerOutputElement, isVoxelTransparentCallback, 0, arrayResult->getDimension(2));
+	}
+
+	/**
+	 * The slices of the array (along the Z axis) are divided between the threads, which each take the next remaining
+	 * slice when they finish one. The results are identical to those of calculateAmbientOcclusion().
+	 *
+	 * The volume is read from several threads at once, so if it is a PagedVolume it must have concurrent access enabled
+	 * (see the threading section of the manual). Each thread uses its own copy of the callback.
+	 *
+	 * \param volInput The volume to calculate the ambient occlusion for
+	 * \param[out] arrayResult The output of the calculator
+	 * \param region The region of the volume for which the occlusion should be calculated
+	 * \param fRayLength The length for each test ray
+	 * \param uNoOfSamplesPerOutputElement The number of samples to calculate the occlusion
+	 * \param isVoxelTransparentCallback A callback which takes a \a VoxelType and returns a \a bool whether the voxel is transparent
+	 * \param uNoOfThreads The number of threads to use, or zero to use one per hardware thread
+	 */
+	template<typename VolumeType, typename IsVoxelTransparentCallback>
+	void calculateAmbientOcclusionParallel(VolumeType* volInput, Array<3, uint8_t>* arrayResult, const Region& region, float fRayLength, uint8_t uNoOfSamplesPerOutputElement, IsVoxelTransparentCallback isVoxelTransparentCallback, uint32_t uNoOfThreads)
+	{
+		validateAmbientOcclusionArray(arrayResult, region);
+
+		if (uNoOfThreads == 0)
+		{
+			uNoOfThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+		}
+
+		const uint32_t uNoOfSlices = arrayResult->getDimension(2);
+		uNoOfThreads = (std::min)(uNoOfThreads, uNoOfSlices);
+		if (uNoOfThreads <= 1)
+		{
+			calculateAmbientOcclusionSlices(volInput, arrayResult, region, fRayLength, uNoOfSamplesPerOutputElement, isVoxelTransparentCallback, 0, uNoOfSlices);
+			return;
+		}
+
+		// The threads take slices in order until there are none left. Exceptions are passed back to this thread.
+		std::atomic<uint32_t> uNextSlice(0);
+		std::vector<std::exception_ptr> vecExceptions(uNoOfThreads);
+		auto calculateSlices = [&](uint32_t uThread)
+		{
+			try
+			{
+				IsVoxelTransparentCallback threadCallback = isVoxelTransparentCallback;
+				for (uint32_t uSlice = uNextSlice++; uSlice < uNoOfSlices; uSlice = uNextSlice++)
+				{
+					calculateAmbientOcclusionSlices(volInput, arrayResult, region, fRayLength, uNoOfSamplesPerOutputElement, threadCallback, uSlice, uSlice + 1);
+				}
+			}
+			catch (...)
+			{
+				vecExceptions[uThread] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> vecThreads;
+		for (uint32_t uThread = 1; uThread < uNoOfThreads; uThread++)
+		{
+			vecThreads.push_back(std::thread(calculateSlices, uThread));
+		}
+		calculateSlices(0);
+		for (std::thread& thread : vecThreads)
+		{
+			thread.join();
+		}
+		for (const std::exception_ptr& pException : vecExceptions)
+		{
+			if (pException)
+			{
+				std::rethrow_exception(pException);
+			}
+		}
+	}
 }
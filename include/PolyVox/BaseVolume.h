@@ -27,8 +27,10 @@
 
 #include "Region.h"
 #include "Vector.h"
+#include "VolumeChangeTracker.h"
 
 #include <limits>
+#include <vector>
 
 namespace PolyVox
 {
@@ -118,6 +120,18 @@ namespace PolyVox
 		/// Sets the voxel at the position given by a 3D vector
 		void setVoxel(const Vector3DInt32& v3dPos, VoxelType tValue);
 
+		/// Determines whether all the voxels within the specified Region are known to have the same value.
+		bool isRegionUniform(const Region& region, VoxelType& tValue) const;
+		/// Gets bounds on the values of the voxels within the specified Region, if the volume keeps track of them.
+		bool getRegionValueRange(const Region& region, VoxelType& tMin, VoxelType& tMax) const;
+		/// Gets the side length of the blocks in which the volume keeps track of the values of its voxels, or zero if it doesn't.
+		uint32_t getValueRangeBlockSideLength(void) const;
+
+		/// Sets the tracker which is told about each voxel that is modified, or a null pointer to stop tracking changes.
+		void setChangeTracker(VolumeChangeTracker* pChangeTracker);
+		/// Gets the tracker which is told about each voxel that is modified, if there is one.
+		VolumeChangeTracker* getChangeTracker(void) const;
+
 		/// Calculates approximatly how many bytes of memory the volume is currently using.
 		uint32_t calculateSizeInBytes(void);
 
@@ -133,7 +147,26 @@ namespace PolyVox
 
 		/// Assignment operator
 		BaseVolume& operator=(const BaseVolume& rhs);
+
+		// Derived classes should pass every modification on to this, if it is set.
+		VolumeChangeTracker* m_pChangeTracker;
 	};
+
+	/// Copies the voxels in a Region of any volume into a buffer, so that algorithms can work on them without going through a Sampler.
+	template <typename VolumeType>
+	void gatherVoxels(VolumeType* volData, const Region& region, typename VolumeType::VoxelType* pVoxels);
+
+	/// Gives the number of reduced resolution copies of any volume which are kept in the form needed by a LodPyramid.
+	template <typename VolumeType>
+	uint32_t getNoOfSubsampledLevels(VolumeType* volData);
+
+	/// Copies the voxels in a Region of one of the copies counted by getNoOfSubsampledLevels() into a buffer.
+	template <typename VolumeType>
+	void gatherVoxelsAtSubsampledLevel(VolumeType* volData, uint32_t uLevel, const Region& region, typename VolumeType::VoxelType* pVoxels);
+
+	/// Passes each voxel in a Region of any volume through a function, and writes back those which it changes.
+	template <typename VolumeType, typename Function>
+	std::vector<Region> modifyVoxels(VolumeType* volData, const Region& region, Function func);
 }
 
 #include "BaseVolume.inl"
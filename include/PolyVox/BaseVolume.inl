@@ -31,6 +31,7 @@ namespace PolyVox
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
 	BaseVolume<VoxelType>::BaseVolume()
+		:m_pChangeTracker(nullptr)
 	{
 	}
 
@@ -118,6 +119,71 @@ namespace PolyVox
 		POLYVOX_THROW(not_implemented, "You should never call the base class version of this function.");
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// Volumes which can cheaply tell that a Region contains only a single value (such as the PagedVolume) provide their own
+	/// version of this function, which allows algorithms such as the surface extractors to skip over that Region. This version
+	/// always returns false, which is always a valid answer as the result only says whether the voxels are *known* to be uniform.
+	/// \param region The Region of voxels to check.
+	/// \param tValue Set to the value of the voxels if they all have the same value, otherwise left unchanged.
+	/// \return Whether all the voxels within the Region are known to have the same value.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool BaseVolume<VoxelType>::isRegionUniform(const Region& /*region*/, VoxelType& /*tValue*/) const
+	{
+		return false;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The RawVolume and PagedVolume keep track of the range of values in each of their blocks or chunks when the voxels are of a
+	/// primitive type, which lets algorithms such as the surface extractors skip over parts of the volume which cannot contain a
+	/// surface (for example, because they are entirely air or entirely rock). This version always returns false, and the volumes
+	/// which do keep track of the values may also return false (e.g. for other voxel types).
+	///
+	/// The bounds are not necessarily tight, as they cover the whole of every block or chunk which overlaps the Region.
+	/// \param region The Region of voxels to check.
+	/// \param tMin Set to a value which is less than or equal to all the voxels in the Region.
+	/// \param tMax Set to a value which is greater than or equal to all the voxels in the Region.
+	/// \return Whether the bounds were set.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool BaseVolume<VoxelType>::getRegionValueRange(const Region& /*region*/, VoxelType& /*tMin*/, VoxelType& /*tMax*/) const
+	{
+		return false;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Regions which are aligned to these blocks are the ones for which isRegionUniform() and getRegionValueRange() give the most
+	/// precise answers, so this is the granularity at which algorithms such as the Raycast can skip over empty space. This version
+	/// always returns zero, as the volume does not keep track of its values.
+	/// \return The side length of the blocks, or zero if the volume does not keep track of the values in them.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t BaseVolume<VoxelType>::getValueRangeBlockSideLength(void) const
+	{
+		return 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The RawVolume and the PagedVolume pass the position of every voxel which is written (whether through setVoxel() or
+	/// a Sampler) on to the tracker, so that the meshes affected by the changes can be found (see RemeshScheduler). The
+	/// volume does not take ownership of the tracker, which must remain valid until it is removed again.
+	/// \param pChangeTracker The tracker to use, or a null pointer to stop tracking changes.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void BaseVolume<VoxelType>::setChangeTracker(VolumeChangeTracker* pChangeTracker)
+	{
+		m_pChangeTracker = pChangeTracker;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The tracker which is told about each voxel that is modified, or a null pointer if there isn't one.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	VolumeChangeTracker* BaseVolume<VoxelType>::getChangeTracker(void) const
+	{
+		return m_pChangeTracker;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// 
 	////////////////////////////////////////////////////////////////////////////////
@@ -127,5 +193,103 @@ namespace PolyVox
 		POLYVOX_THROW(not_implemented, "You should never call the base class version of this function.");
 		return 0;
 	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The voxels are stored with x varying fastest, followed by y and then z (as in an Array), and the buffer must be large enough
+	/// to hold all of them. Voxels outside the volume are read in the same way as by a Sampler. This version works with any volume
+	/// by reading the voxels through a Sampler one row at a time, but there are overloads for the RawVolume and the PagedVolume
+	/// which copy them directly from the underlying data (see RawVolume::getVoxels() and PagedVolume::getVoxels()).
+	///
+	/// Algorithms which need to look at the neighbours of each voxel (such as the surface extractors) can ask for a Region which
+	/// is a little larger than the one they are processing, and then find the neighbours at fixed offsets within the buffer.
+	/// \param volData The volume to read the voxels from.
+	/// \param region The Region of voxels to read.
+	/// \param[out] pVoxels The buffer which receives the voxels.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	void gatherVoxels(VolumeType* volData, const Region& region, typename VolumeType::VoxelType* pVoxels)
+	{
+		typename VolumeType::Sampler sampler(volData);
+		for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		{
+			for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+			{
+				sampler.setPosition(region.getLowerX(), y, z);
+				for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+				{
+					*pVoxels = sampler.getVoxel();
+					pVoxels++;
+					sampler.movePositiveX();
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Level k of such a copy holds the voxel at (x, y, z) * 2^k of the volume at position (x, y, z), so that a LodPyramid can read
+	/// it instead of keeping a copy of its own. This version is for volumes which do not keep any, but the PagedVolume does when its
+	/// mip levels are kept with MipFilters::Subsample (see PagedVolume::setNoOfMipLevels()).
+	/// \param volData The volume to check.
+	/// \return The number of levels which are kept in addition to the volume itself.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	uint32_t getNoOfSubsampledLevels(VolumeType* /*volData*/)
+	{
+		return 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The voxels are laid out in the same way as by gatherVoxels(), which is what this version uses for level zero.
+	/// \param volData The volume to read the voxels from.
+	/// \param uLevel The level to read from, which must not be more than getNoOfSubsampledLevels().
+	/// \param region The Region of voxels to read, in the voxels of the level.
+	/// \param[out] pVoxels The buffer which receives the voxels.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	void gatherVoxelsAtSubsampledLevel(VolumeType* volData, uint32_t uLevel, const Region& region, typename VolumeType::VoxelType* pVoxels)
+	{
+		POLYVOX_THROW_IF(uLevel > getNoOfSubsampledLevels(volData), std::invalid_argument, "The volume does not keep the requested level.");
+		gatherVoxels(volData, region, pVoxels);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The function is called as <tt>func(x, y, z, tOldValue)</tt> for every voxel in the Region and returns the new value of the
+	/// voxel, so it can implement any kind of edit (see applyBrush() for some common ones). Only voxels whose value actually changes
+	/// are written, so the volume's change tracker (if any) is not told about the others. This version works with any volume by
+	/// calling getVoxel() and setVoxel(), and so the whole Region must be writable. There are overloads for the RawVolume and the
+	/// PagedVolume which work on the underlying data a chunk at a time (see RawVolume::modifyVoxels() and PagedVolume::modifyVoxels()).
+	/// \param volData The volume to modify.
+	/// \param region The Region of voxels to pass through the function.
+	/// \param func The function which computes the new value of each voxel.
+	/// \return Regions which together contain all of the voxels which were changed. This version returns at most one Region.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType, typename Function>
+	std::vector<Region> modifyVoxels(VolumeType* volData, const Region& region, Function func)
+	{
+		Region regChanged = Region::InvertedRegion();
+		for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		{
+			for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+			{
+				for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+				{
+					const typename VolumeType::VoxelType tOldValue = volData->getVoxel(x, y, z);
+					const typename VolumeType::VoxelType tNewValue = func(x, y, z, tOldValue);
+					if (tNewValue != tOldValue)
+					{
+						volData->setVoxel(x, y, z, tNewValue);
+						regChanged.accumulate(x, y, z);
+					}
+				}
+			}
+		}
+
+		std::vector<Region> vecChangedRegions;
+		if (regChanged.isValid())
+		{
+			vecChangedRegions.push_back(regChanged);
+		}
+		return vecChangedRegions;
+	}
 }
 
@@ -0,0 +1,133 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_Brush_H__
+#define __PolyVox_Brush_H__
+
+#include "BaseVolume.h"
+#include "Region.h"
+#include "Vector.h"
+
+#include <vector>
+
+namespace PolyVox
+{
+	/// A brush describes the shape of an edit which is applied to a volume with applyBrush(). PolyVox provides brushes for boxes,
+	/// spheres and cylinders, as well as one which takes an arbitrary signed distance function. Users can also write their own, as
+	/// a brush is simply a class which provides the following two functions:
+	///
+	/// \code
+	/// Region getEnclosingRegion(void) const; // Gets a Region which contains every voxel inside the brush.
+	/// bool containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const; // Determines whether a voxel is inside the brush.
+	/// \endcode
+	///
+	/// Voxels are considered to be inside a brush if their centre (i.e. their integer position) is inside it.
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/// A brush containing every voxel in a Region.
+	class BoxBrush
+	{
+	public:
+		/// Constructor
+		BoxBrush(const Region& region);
+
+		/// Gets a Region which contains every voxel inside the brush.
+		Region getEnclosingRegion(void) const;
+		/// Determines whether a voxel is inside the brush.
+		bool containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+
+	private:
+		Region m_region;
+	};
+
+	/// A brush containing the voxels within a given distance of a point.
+	class SphereBrush
+	{
+	public:
+		/// Constructor
+		SphereBrush(const Vector3DFloat& v3dCentre, float fRadius);
+
+		/// Gets a Region which contains every voxel inside the brush.
+		Region getEnclosingRegion(void) const;
+		/// Determines whether a voxel is inside the brush.
+		bool containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+
+	private:
+		Vector3DFloat m_v3dCentre;
+		float m_fRadius;
+	};
+
+	/// A brush containing the voxels within a given distance of a line segment, but not beyond either end of it. The segment
+	/// does not have to be aligned with the axes, so this can be used to dig tunnels in any direction.
+	class CylinderBrush
+	{
+	public:
+		/// Constructor
+		CylinderBrush(const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, float fRadius);
+
+		/// Gets a Region which contains every voxel inside the brush.
+		Region getEnclosingRegion(void) const;
+		/// Determines whether a voxel is inside the brush.
+		bool containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+
+	private:
+		Vector3DFloat m_v3dStart;
+		Vector3DFloat m_v3dEnd;
+		Vector3DFloat m_v3dAxis;
+		float m_fAxisLengthSquared;
+		float m_fRadius;
+	};
+
+	/// A brush defined by a signed distance function, which is called with the position of a voxel (as a Vector3DFloat) and
+	/// returns a value which is negative or zero for voxels inside the brush. As the function cannot be used to find the extents
+	/// of the brush these have to be given as well. Use makeSdfBrush() to create one from a lambda.
+	template <typename SignedDistanceFunction>
+	class SdfBrush
+	{
+	public:
+		/// Constructor
+		SdfBrush(const Region& regEnclosingRegion, SignedDistanceFunction funcDistance);
+
+		/// Gets a Region which contains every voxel inside the brush.
+		Region getEnclosingRegion(void) const;
+		/// Determines whether a voxel is inside the brush.
+		bool containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+
+	private:
+		Region m_regEnclosingRegion;
+		SignedDistanceFunction m_funcDistance;
+	};
+
+	/// Creates an SdfBrush, deducing the type of the signed distance function.
+	template <typename SignedDistanceFunction>
+	SdfBrush<SignedDistanceFunction> makeSdfBrush(const Region& regEnclosingRegion, SignedDistanceFunction funcDistance);
+
+	/// Sets every voxel inside a brush to the given value.
+	template <typename VolumeType, typename BrushType>
+	std::vector<Region> applyBrush(VolumeType* volData, const BrushType& brush, typename VolumeType::VoxelType tValue);
+}
+
+#include "Brush.inl"
+
+#endif //__PolyVox_Brush_H__
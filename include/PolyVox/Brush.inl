@@ -0,0 +1,175 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept> // For invalid_argument
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param region The Region containing the voxels which are inside the brush.
+	////////////////////////////////////////////////////////////////////////////////
+	inline BoxBrush::BoxBrush(const Region& region)
+		:m_region(region)
+	{
+	}
+
+	inline Region BoxBrush::getEnclosingRegion(void) const
+	{
+		return m_region;
+	}
+
+	inline bool BoxBrush::containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		return m_region.containsPoint(iXPos, iYPos, iZPos);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dCentre The centre of the sphere, which does not have to be at the centre of a voxel.
+	/// \param fRadius The radius of the sphere.
+	////////////////////////////////////////////////////////////////////////////////
+	inline SphereBrush::SphereBrush(const Vector3DFloat& v3dCentre, float fRadius)
+		:m_v3dCentre(v3dCentre)
+		,m_fRadius(fRadius)
+	{
+		POLYVOX_THROW_IF(fRadius < 0.0f, std::invalid_argument, "Sphere radius cannot be negative.");
+	}
+
+	inline Region SphereBrush::getEnclosingRegion(void) const
+	{
+		return Region(
+			static_cast<int32_t>(std::floor(m_v3dCentre.getX() - m_fRadius)),
+			static_cast<int32_t>(std::floor(m_v3dCentre.getY() - m_fRadius)),
+			static_cast<int32_t>(std::floor(m_v3dCentre.getZ() - m_fRadius)),
+			static_cast<int32_t>(std::ceil(m_v3dCentre.getX() + m_fRadius)),
+			static_cast<int32_t>(std::ceil(m_v3dCentre.getY() + m_fRadius)),
+			static_cast<int32_t>(std::ceil(m_v3dCentre.getZ() + m_fRadius)));
+	}
+
+	inline bool SphereBrush::containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		const Vector3DFloat v3dOffset = Vector3DFloat(static_cast<float>(iXPos), static_cast<float>(iYPos), static_cast<float>(iZPos)) - m_v3dCentre;
+		return v3dOffset.lengthSquared() <= m_fRadius * m_fRadius;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dStart The centre of one end of the cylinder.
+	/// \param v3dEnd The centre of the other end of the cylinder. This must be different to the start.
+	/// \param fRadius The radius of the cylinder.
+	////////////////////////////////////////////////////////////////////////////////
+	inline CylinderBrush::CylinderBrush(const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, float fRadius)
+		:m_v3dStart(v3dStart)
+		,m_v3dEnd(v3dEnd)
+		,m_v3dAxis(v3dEnd - v3dStart)
+		,m_fAxisLengthSquared(m_v3dAxis.lengthSquared())
+		,m_fRadius(fRadius)
+	{
+		POLYVOX_THROW_IF(m_fAxisLengthSquared == 0.0f, std::invalid_argument, "Cylinder start and end cannot be the same.");
+		POLYVOX_THROW_IF(fRadius < 0.0f, std::invalid_argument, "Cylinder radius cannot be negative.");
+	}
+
+	inline Region CylinderBrush::getEnclosingRegion(void) const
+	{
+		// This is the box around the spheres at each end of the cylinder. It is not tight unless the cylinder is aligned
+		// with one of the axes, but it is cheap to compute and always contains the whole cylinder.
+		return Region(
+			static_cast<int32_t>(std::floor((std::min)(m_v3dStart.getX(), m_v3dEnd.getX()) - m_fRadius)),
+			static_cast<int32_t>(std::floor((std::min)(m_v3dStart.getY(), m_v3dEnd.getY()) - m_fRadius)),
+			static_cast<int32_t>(std::floor((std::min)(m_v3dStart.getZ(), m_v3dEnd.getZ()) - m_fRadius)),
+			static_cast<int32_t>(std::ceil((std::max)(m_v3dStart.getX(), m_v3dEnd.getX()) + m_fRadius)),
+			static_cast<int32_t>(std::ceil((std::max)(m_v3dStart.getY(), m_v3dEnd.getY()) + m_fRadius)),
+			static_cast<int32_t>(std::ceil((std::max)(m_v3dStart.getZ(), m_v3dEnd.getZ()) + m_fRadius)));
+	}
+
+	inline bool CylinderBrush::containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		const Vector3DFloat v3dOffset = Vector3DFloat(static_cast<float>(iXPos), static_cast<float>(iYPos), static_cast<float>(iZPos)) - m_v3dStart;
+
+		// The projection of the offset onto the axis, scaled by the length of the axis.
+		const float fProjection = v3dOffset.dot(m_v3dAxis);
+		if ((fProjection < 0.0f) || (fProjection > m_fAxisLengthSquared))
+		{
+			return false;
+		}
+
+		// Pythagoras gives the squared distance from the axis.
+		return v3dOffset.lengthSquared() - (fProjection * fProjection) / m_fAxisLengthSquared <= m_fRadius * m_fRadius;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param regEnclosingRegion A Region which contains every voxel for which the function is negative or zero.
+	/// \param funcDistance The signed distance function.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename SignedDistanceFunction>
+	SdfBrush<SignedDistanceFunction>::SdfBrush(const Region& regEnclosingRegion, SignedDistanceFunction funcDistance)
+		:m_regEnclosingRegion(regEnclosingRegion)
+		,m_funcDistance(funcDistance)
+	{
+	}
+
+	template <typename SignedDistanceFunction>
+	Region SdfBrush<SignedDistanceFunction>::getEnclosingRegion(void) const
+	{
+		return m_regEnclosingRegion;
+	}
+
+	template <typename SignedDistanceFunction>
+	bool SdfBrush<SignedDistanceFunction>::containsPoint(int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		return m_funcDistance(Vector3DFloat(static_cast<float>(iXPos), static_cast<float>(iYPos), static_cast<float>(iZPos))) <= 0.0f;
+	}
+
+	template <typename SignedDistanceFunction>
+	SdfBrush<SignedDistanceFunction> makeSdfBrush(const Region& regEnclosingRegion, SignedDistanceFunction funcDistance)
+	{
+		return SdfBrush<SignedDistanceFunction>(regEnclosingRegion, funcDistance);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is the usual way of deforming terrain, e.g. by setting the voxels inside a SphereBrush to air to dig a hole, or to
+	/// rock to build something up. The edit is made with modifyVoxels(), so for the RawVolume and the PagedVolume the voxels are
+	/// written a chunk at a time rather than one by one. Other kinds of edit (such as only replacing voxels of a certain material)
+	/// can be made by calling modifyVoxels() directly, with a function which also checks whether the brush contains each voxel.
+	///
+	/// The returned Regions can be passed to a RemeshScheduler to find the meshes which need to be extracted again, though if the
+	/// volume has a VolumeChangeTracker then the changes will also have been recorded there.
+	/// \param volData The volume to modify.
+	/// \param brush The brush describing which voxels to modify.
+	/// \param tValue The value to write to the voxels inside the brush.
+	/// \return Regions which together contain all of the voxels which were changed (voxels which already had the given value are
+	/// not changed). For the PagedVolume there is one for each chunk which was changed.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType, typename BrushType>
+	std::vector<Region> applyBrush(VolumeType* volData, const BrushType& brush, typename VolumeType::VoxelType tValue)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+		return modifyVoxels(volData, brush.getEnclosingRegion(), [&brush, tValue](int32_t iXPos, int32_t iYPos, int32_t iZPos, VoxelType tOldValue)
+		{
+			return brush.containsPoint(iXPos, iYPos, iZPos) ? tValue : tOldValue;
+		});
+	}
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_BufferMesh_H__
+#define __PolyVox_BufferMesh_H__
+
+#include "Impl/PlatformDefinitions.h"
+
+#include "Mesh.h"
+#include "Vector.h"
+
+#include <cstdint>
+
+namespace PolyVox
+{
+	/// A mesh which writes its vertices and indices into buffers provided by the caller (such as memory mapped from a GPU vertex
+	/// and index buffer) rather than allocating any memory itself. It can be passed to any of the surface extractors in place of
+	/// a Mesh, and provides the same functions for reading the data back. The buffers must be large enough to hold the whole mesh,
+	/// and the required sizes can be found by first performing the extraction into a MeshCounter. An exception is thrown if either
+	/// buffer is too small, in which case the buffers hold only part of the mesh.
+	template <typename _VertexType, typename _IndexType = DefaultIndexType>
+	class BufferMesh
+	{
+	public:
+
+		typedef _VertexType VertexType;
+		typedef _IndexType IndexType;
+
+		BufferMesh();
+		BufferMesh(VertexType* pVertices, uint32_t uMaxNoOfVertices, IndexType* pIndices, uint32_t uMaxNoOfIndices);
+
+		void setBuffers(VertexType* pVertices, uint32_t uMaxNoOfVertices, IndexType* pIndices, uint32_t uMaxNoOfIndices);
+
+		IndexType getNoOfVertices(void) const;
+		const VertexType& getVertex(IndexType index) const;
+		const VertexType* getRawVertexData(void) const;
+
+		size_t getNoOfIndices(void) const;
+		IndexType getIndex(uint32_t index) const;
+		const IndexType* getRawIndexData(void) const;
+
+		const Vector3DInt32& getOffset(void) const;
+		void setOffset(const Vector3DInt32& offset);
+
+		IndexType addVertex(const VertexType& vertex);
+		void addTriangle(IndexType index0, IndexType index1, IndexType index2);
+
+		void clear(void);
+		bool isEmpty(void) const;
+
+	private:
+		VertexType* m_pVertices;
+		uint32_t m_uMaxNoOfVertices;
+		uint32_t m_uNoOfVertices;
+		IndexType* m_pIndices;
+		uint32_t m_uMaxNoOfIndices;
+		uint32_t m_uNoOfIndices;
+		Vector3DInt32 m_offset;
+	};
+
+	/// Counts the vertices and indices which a surface extractor generates, without storing them. This is the first pass of
+	/// extracting into a BufferMesh: once the sizes are known the buffers can be allocated (or mapped) and the extraction repeated
+	/// into them. As with Mesh an exception is thrown if there are more vertices than the index type can address.
+	template <typename _VertexType, typename _IndexType = DefaultIndexType>
+	class MeshCounter
+	{
+	public:
+
+		typedef _VertexType VertexType;
+		typedef _IndexType IndexType;
+
+		MeshCounter();
+
+		IndexType getNoOfVertices(void) const;
+		size_t getNoOfIndices(void) const;
+
+		const Vector3DInt32& getOffset(void) const;
+		void setOffset(const Vector3DInt32& offset);
+
+		IndexType addVertex(const VertexType& vertex);
+		void addTriangle(IndexType index0, IndexType index1, IndexType index2);
+
+		void clear(void);
+		bool isEmpty(void) const;
+
+	private:
+		uint32_t m_uNoOfVertices;
+		uint32_t m_uNoOfIndices;
+		Vector3DInt32 m_offset;
+	};
+}
+
+#include "BufferMesh.inl"
+
+#endif //__PolyVox_BufferMesh_H__
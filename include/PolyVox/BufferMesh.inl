@@ -0,0 +1,224 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include <limits>
+#include <stdexcept>
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// Creates a mesh without any buffers. setBuffers() must be called before anything is added to it.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VertexType, typename IndexType>
+	BufferMesh<VertexType, IndexType>::BufferMesh()
+		:m_pVertices(nullptr)
+		, m_uMaxNoOfVertices(0)
+		, m_uNoOfVertices(0)
+		, m_pIndices(nullptr)
+		, m_uMaxNoOfIndices(0)
+		, m_uNoOfIndices(0)
+	{
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param pVertices The buffer which receives the vertices.
+	/// \param uMaxNoOfVertices The number of vertices which fit in the vertex buffer.
+	/// \param pIndices The buffer which receives the indices.
+	/// \param uMaxNoOfIndices The number of indices which fit in the index buffer.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VertexType, typename IndexType>
+	BufferMesh<VertexType, IndexType>::BufferMesh(VertexType* pVertices, uint32_t uMaxNoOfVertices, IndexType* pIndices, uint32_t uMaxNoOfIndices)
+		:m_uNoOfVertices(0)
+		, m_uNoOfIndices(0)
+	{
+		setBuffers(pVertices, uMaxNoOfVertices, pIndices, uMaxNoOfIndices);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Replaces the buffers which the mesh writes into, for example when a new GPU buffer has been mapped for the next frame.
+	/// The mesh is cleared, and the previous buffers are left holding whatever was written to them.
+	/// \param pVertices The buffer which receives the vertices.
+	/// \param uMaxNoOfVertices The number of vertices which fit in the vertex buffer.
+	/// \param pIndices The buffer which receives the indices.
+	/// \param uMaxNoOfIndices The number of indices which fit in the index buffer.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VertexType, typename IndexType>
+	void BufferMesh<VertexType, IndexType>::setBuffers(VertexType* pVertices, uint32_t uMaxNoOfVertices, IndexType* pIndices, uint32_t uMaxNoOfIndices)
+	{
+		POLYVOX_THROW_IF((pVertices == nullptr) && (uMaxNoOfVertices > 0), std::invalid_argument, "Provided vertex buffer cannot be null");
+		POLYVOX_THROW_IF((pIndices == nullptr) && (uMaxNoOfIndices > 0), std::invalid_argument, "Provided index buffer cannot be null");
+
+		m_pVertices = pVertices;
+		m_uMaxNoOfVertices = uMaxNoOfVertices;
+		m_pIndices = pIndices;
+		m_uMaxNoOfIndices = uMaxNoOfIndices;
+		clear();
+	}
+
+	template <typename VertexType, typename IndexType>
+	IndexType BufferMesh<VertexType, IndexType>::getNoOfVertices(void) const
+	{
+		return static_cast<IndexType>(m_uNoOfVertices);
+	}
+
+	template <typename VertexType, typename IndexType>
+	const VertexType& BufferMesh<VertexType, IndexType>::getVertex(IndexType index) const
+	{
+		POLYVOX_ASSERT(index < m_uNoOfVertices, "Index points at an invalid vertex.");
+		return m_pVertices[index];
+	}
+
+	template <typename VertexType, typename IndexType>
+	const VertexType* BufferMesh<VertexType, IndexType>::getRawVertexData(void) const
+	{
+		return m_pVertices;
+	}
+
+	template <typename VertexType, typename IndexType>
+	size_t BufferMesh<VertexType, IndexType>::getNoOfIndices(void) const
+	{
+		return m_uNoOfIndices;
+	}
+
+	template <typename VertexType, typename IndexType>
+	IndexType BufferMesh<VertexType, IndexType>::getIndex(uint32_t index) const
+	{
+		POLYVOX_ASSERT(index < m_uNoOfIndices, "Index is beyond the end of the index buffer.");
+		return m_pIndices[index];
+	}
+
+	template <typename VertexType, typename IndexType>
+	const IndexType* BufferMesh<VertexType, IndexType>::getRawIndexData(void) const
+	{
+		return m_pIndices;
+	}
+
+	template <typename VertexType, typename IndexType>
+	const Vector3DInt32& BufferMesh<VertexType, IndexType>::getOffset(void) const
+	{
+		return m_offset;
+	}
+
+	template <typename VertexType, typename IndexType>
+	void BufferMesh<VertexType, IndexType>::setOffset(const Vector3DInt32& offset)
+	{
+		m_offset = offset;
+	}
+
+	template <typename VertexType, typename IndexType>
+	IndexType BufferMesh<VertexType, IndexType>::addVertex(const VertexType& vertex)
+	{
+		POLYVOX_THROW_IF(m_uNoOfVertices >= m_uMaxNoOfVertices, std::out_of_range, "The vertex buffer is too small for the mesh.");
+		POLYVOX_THROW_IF(m_uNoOfVertices >= std::numeric_limits<IndexType>::max(), std::out_of_range, "Mesh has more vertices that the chosen index type allows.");
+
+		m_pVertices[m_uNoOfVertices] = vertex;
+		return static_cast<IndexType>(m_uNoOfVertices++);
+	}
+
+	template <typename VertexType, typename IndexType>
+	void BufferMesh<VertexType, IndexType>::addTriangle(IndexType index0, IndexType index1, IndexType index2)
+	{
+		//Make sure the specified indices correspond to valid vertices.
+		POLYVOX_ASSERT(index0 < m_uNoOfVertices, "Index points at an invalid vertex.");
+		POLYVOX_ASSERT(index1 < m_uNoOfVertices, "Index points at an invalid vertex.");
+		POLYVOX_ASSERT(index2 < m_uNoOfVertices, "Index points at an invalid vertex.");
+		POLYVOX_THROW_IF(m_uMaxNoOfIndices - m_uNoOfIndices < 3, std::out_of_range, "The index buffer is too small for the mesh.");
+
+		m_pIndices[m_uNoOfIndices] = index0;
+		m_pIndices[m_uNoOfIndices + 1] = index1;
+		m_pIndices[m_uNoOfIndices + 2] = index2;
+		m_uNoOfIndices += 3;
+	}
+
+	template <typename VertexType, typename IndexType>
+	void BufferMesh<VertexType, IndexType>::clear(void)
+	{
+		m_uNoOfVertices = 0;
+		m_uNoOfIndices = 0;
+	}
+
+	template <typename VertexType, typename IndexType>
+	bool BufferMesh<VertexType, IndexType>::isEmpty(void) const
+	{
+		return (m_uNoOfVertices == 0) || (m_uNoOfIndices == 0);
+	}
+
+	template <typename VertexType, typename IndexType>
+	MeshCounter<VertexType, IndexType>::MeshCounter()
+		:m_uNoOfVertices(0)
+		, m_uNoOfIndices(0)
+	{
+	}
+
+	template <typename VertexType, typename IndexType>
+	IndexType MeshCounter<VertexType, IndexType>::getNoOfVertices(void) const
+	{
+		return static_cast<IndexType>(m_uNoOfVertices);
+	}
+
+	template <typename VertexType, typename IndexType>
+	size_t MeshCounter<VertexType, IndexType>::getNoOfIndices(void) const
+	{
+		return m_uNoOfIndices;
+	}
+
+	template <typename VertexType, typename IndexType>
+	const Vector3DInt32& MeshCounter<VertexType, IndexType>::getOffset(void) const
+	{
+		return m_offset;
+	}
+
+	template <typename VertexType, typename IndexType>
+	void MeshCounter<VertexType, IndexType>::setOffset(const Vector3DInt32& offset)
+	{
+		m_offset = offset;
+	}
+
+	template <typename VertexType, typename IndexType>
+	IndexType MeshCounter<VertexType, IndexType>::addVertex(const VertexType& /*vertex*/)
+	{
+		POLYVOX_THROW_IF(m_uNoOfVertices >= std::numeric_limits<IndexType>::max(), std::out_of_range, "Mesh has more vertices that the chosen index type allows.");
+
+		return static_cast<IndexType>(m_uNoOfVertices++);
+	}
+
+	template <typename VertexType, typename IndexType>
+	void MeshCounter<VertexType, IndexType>::addTriangle(IndexType /*index0*/, IndexType /*index1*/, IndexType /*index2*/)
+	{
+		m_uNoOfIndices += 3;
+	}
+
+	template <typename VertexType, typename IndexType>
+	void MeshCounter<VertexType, IndexType>::clear(void)
+	{
+		m_uNoOfVertices = 0;
+		m_uNoOfIndices = 0;
+	}
+
+	template <typename VertexType, typename IndexType>
+	bool MeshCounter<VertexType, IndexType>::isEmpty(void) const
+	{
+		return (m_uNoOfVertices == 0) || (m_uNoOfIndices == 0);
+	}
+}
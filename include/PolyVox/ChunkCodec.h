@@ -0,0 +1,292 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_ChunkCodec_H__
+#define __PolyVox_ChunkCodec_H__
+
+#include "Impl/PlatformDefinitions.h"
+
+#include "Config.h"
+
+#include "Impl/ErrorHandling.h"
+#include "Impl/RunLengthEncoding.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(POLYVOX_ZLIB_ENABLED)
+	#include <zlib.h>
+#endif
+
+#if defined(POLYVOX_LZ4_ENABLED)
+	#include <lz4.h>
+#endif
+
+namespace PolyVox
+{
+	/// Builds a codec identifier from four characters, so that it is readable when looking at a file.
+	inline uint32_t makeCodecId(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+			(static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+	}
+
+	/**
+	 * Compresses the voxels of a chunk when they are written out by a pager (see RegionFilePager and FilePager). You can derive from this class to
+	 * provide your own compression scheme, but note that a single codec may be used from several threads at once (if the volume
+	 * has concurrent access enabled) so encode() and decode() must not modify it.
+	 *
+	 * The voxels are passed to the codec in the order they are stored in the chunk, which is Morton order. This means that
+	 * consecutive voxels are usually close together in the volume, which most codecs can take advantage of.
+	 */
+	template <typename VoxelType>
+	class ChunkCodec
+	{
+	public:
+		/// Constructor
+		ChunkCodec() {};
+		/// Destructor
+		virtual ~ChunkCodec() {};
+
+		/// Identifies the codec in the data it writes, so that the data is never decoded by a different codec.
+		virtual uint32_t getId(void) const = 0;
+
+		/// Appends the encoded voxels to vecOutput.
+		virtual void encode(const VoxelType* pData, uint32_t uNoOfVoxels, std::vector<uint8_t>& vecOutput) const = 0;
+		/// Decodes exactly the given number of voxels, throwing std::invalid_argument if the input is not valid.
+		virtual void decode(const uint8_t* pInput, size_t uInputLength, VoxelType* pData, uint32_t uNoOfVoxels) const = 0;
+
+		/// Gets the largest amount of data which encode() can produce for the given number of voxels. Pagers use this to
+		/// reject damaged data before allocating memory for it.
+		virtual size_t getMaxEncodedSizeInBytes(uint32_t uNoOfVoxels) const = 0;
+	};
+
+	/**
+	 * Stores each run of identical voxels as the value and the length of the run. This is very fast, and works well
+	 * for volumes which contain large areas of the same material (such as the empty space above a terrain).
+	 */
+	template <typename VoxelType>
+	class RunLengthCodec : public ChunkCodec<VoxelType>
+	{
+	public:
+		virtual uint32_t getId(void) const
+		{
+			return makeCodecId('R', 'L', 'E', ' ');
+		}
+
+		virtual void encode(const VoxelType* pData, uint32_t uNoOfVoxels, std::vector<uint8_t>& vecOutput) const
+		{
+			std::vector<VoxelType> vecRunValues;
+			std::vector<uint16_t> vecRunLengths;
+			runLengthEncode(pData, uNoOfVoxels, vecRunValues, vecRunLengths);
+
+			// The number of runs, followed by all the values, followed by all the lengths.
+			const uint32_t uNoOfRuns = static_cast<uint32_t>(vecRunValues.size());
+			const size_t uStart = vecOutput.size();
+			vecOutput.resize(uStart + sizeof(uNoOfRuns) + uNoOfRuns * (sizeof(VoxelType) + sizeof(uint16_t)));
+			uint8_t* pOutput = &(vecOutput[uStart]);
+			std::memcpy(pOutput, &uNoOfRuns, sizeof(uNoOfRuns));
+			std::memcpy(pOutput + sizeof(uNoOfRuns), &(vecRunValues[0]), uNoOfRuns * sizeof(VoxelType));
+			std::memcpy(pOutput + sizeof(uNoOfRuns) + uNoOfRuns * sizeof(VoxelType), &(vecRunLengths[0]), uNoOfRuns * sizeof(uint16_t));
+		}
+
+		virtual void decode(const uint8_t* pInput, size_t uInputLength, VoxelType* pData, uint32_t uNoOfVoxels) const
+		{
+			uint32_t uNoOfRuns = 0;
+			POLYVOX_THROW_IF(uInputLength < sizeof(uNoOfRuns), std::invalid_argument, "Run length encoded data is too short.");
+			std::memcpy(&uNoOfRuns, pInput, sizeof(uNoOfRuns));
+			POLYVOX_THROW_IF((uNoOfRuns > uNoOfVoxels) || (uInputLength != sizeof(uNoOfRuns) + uNoOfRuns * (sizeof(VoxelType) + sizeof(uint16_t))),
+				std::invalid_argument, "Run length encoded data has the wrong size.");
+
+			std::vector<VoxelType> vecRunValues(uNoOfRuns);
+			std::vector<uint16_t> vecRunLengths(uNoOfRuns);
+			if (uNoOfRuns > 0)
+			{
+				std::memcpy(&(vecRunValues[0]), pInput + sizeof(uNoOfRuns), uNoOfRuns * sizeof(VoxelType));
+				std::memcpy(&(vecRunLengths[0]), pInput + sizeof(uNoOfRuns) + uNoOfRuns * sizeof(VoxelType), uNoOfRuns * sizeof(uint16_t));
+			}
+			runLengthDecode(vecRunValues, vecRunLengths, pData, uNoOfVoxels);
+		}
+
+		virtual size_t getMaxEncodedSizeInBytes(uint32_t uNoOfVoxels) const
+		{
+			// Every voxel may be a run of its own.
+			return sizeof(uint32_t) + static_cast<size_t>(uNoOfVoxels) * (sizeof(VoxelType) + sizeof(uint16_t));
+		}
+	};
+
+	/**
+	 * Stores the difference between each voxel and the previous one (in Morton order) and then run length encodes the
+	 * differences. Each byte of the voxels is handled separately (so the differences of the first byte of every voxel
+	 * are stored, followed by those of the second byte, etc). This is slower than the RunLengthCodec, but also compresses
+	 * data which varies smoothly (such as densities) and voxel types in which some fields change more often than others.
+	 */
+	template <typename VoxelType>
+	class DeltaCodec : public ChunkCodec<VoxelType>
+	{
+	public:
+		virtual uint32_t getId(void) const
+		{
+			return makeCodecId('D', 'L', 'T', 'A');
+		}
+
+		virtual void encode(const VoxelType* pData, uint32_t uNoOfVoxels, std::vector<uint8_t>& vecOutput) const
+		{
+			const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+			std::vector<uint8_t> vecDeltas(uNoOfVoxels * sizeof(VoxelType));
+			for (uint32_t uByte = 0; uByte < sizeof(VoxelType); uByte++)
+			{
+				uint8_t* pDeltas = &(vecDeltas[0]) + uByte * uNoOfVoxels;
+				uint8_t uPrevious = 0;
+				for (uint32_t uVoxel = 0; uVoxel < uNoOfVoxels; uVoxel++)
+				{
+					const uint8_t uCurrent = pBytes[uVoxel * sizeof(VoxelType) + uByte];
+					pDeltas[uVoxel] = static_cast<uint8_t>(uCurrent - uPrevious);
+					uPrevious = uCurrent;
+				}
+			}
+
+			packBitsEncode(&(vecDeltas[0]), vecDeltas.size(), vecOutput);
+		}
+
+		virtual void decode(const uint8_t* pInput, size_t uInputLength, VoxelType* pData, uint32_t uNoOfVoxels) const
+		{
+			std::vector<uint8_t> vecDeltas(uNoOfVoxels * sizeof(VoxelType));
+			packBitsDecode(pInput, uInputLength, &(vecDeltas[0]), vecDeltas.size());
+
+			uint8_t* pBytes = reinterpret_cast<uint8_t*>(pData);
+			for (uint32_t uByte = 0; uByte < sizeof(VoxelType); uByte++)
+			{
+				const uint8_t* pDeltas = &(vecDeltas[0]) + uByte * uNoOfVoxels;
+				uint8_t uPrevious = 0;
+				for (uint32_t uVoxel = 0; uVoxel < uNoOfVoxels; uVoxel++)
+				{
+					uPrevious = static_cast<uint8_t>(uPrevious + pDeltas[uVoxel]);
+					pBytes[uVoxel * sizeof(VoxelType) + uByte] = uPrevious;
+				}
+			}
+		}
+
+		virtual size_t getMaxEncodedSizeInBytes(uint32_t uNoOfVoxels) const
+		{
+			// The worst case for PackBits is a single byte which is not part of a run (taking two bytes) followed by a
+			// run of two bytes (also taking two bytes), so the output is never more than one and a half times as large.
+			const size_t uSizeInBytes = static_cast<size_t>(uNoOfVoxels) * sizeof(VoxelType);
+			return uSizeInBytes + uSizeInBytes / 2 + 2;
+		}
+	};
+
+#if defined(POLYVOX_ZLIB_ENABLED)
+	/**
+	 * Compresses the voxels with zlib. This is only available if POLYVOX_ZLIB_ENABLED is defined (see Config.h),
+	 * in which case your application must also link against zlib.
+	 */
+	template <typename VoxelType>
+	class ZlibCodec : public ChunkCodec<VoxelType>
+	{
+	public:
+		/// The compression level is passed to zlib, and ranges from 1 (fastest) to 9 (smallest).
+		ZlibCodec(int iCompressionLevel = Z_DEFAULT_COMPRESSION)
+			:m_iCompressionLevel(iCompressionLevel)
+		{
+		}
+
+		virtual uint32_t getId(void) const
+		{
+			return makeCodecId('Z', 'L', 'I', 'B');
+		}
+
+		virtual void encode(const VoxelType* pData, uint32_t uNoOfVoxels, std::vector<uint8_t>& vecOutput) const
+		{
+			const uLong uSourceLength = static_cast<uLong>(uNoOfVoxels * sizeof(VoxelType));
+			uLongf uEncodedLength = compressBound(uSourceLength);
+			const size_t uStart = vecOutput.size();
+			vecOutput.resize(uStart + uEncodedLength);
+
+			int iResult = compress2(&(vecOutput[uStart]), &uEncodedLength, reinterpret_cast<const Bytef*>(pData), uSourceLength, m_iCompressionLevel);
+			POLYVOX_THROW_IF(iResult != Z_OK, std::runtime_error, "zlib failed to compress chunk data.");
+			vecOutput.resize(uStart + uEncodedLength);
+		}
+
+		virtual void decode(const uint8_t* pInput, size_t uInputLength, VoxelType* pData, uint32_t uNoOfVoxels) const
+		{
+			uLongf uDecodedLength = static_cast<uLongf>(uNoOfVoxels * sizeof(VoxelType));
+			int iResult = uncompress(reinterpret_cast<Bytef*>(pData), &uDecodedLength, pInput, static_cast<uLong>(uInputLength));
+			POLYVOX_THROW_IF((iResult != Z_OK) || (uDecodedLength != uNoOfVoxels * sizeof(VoxelType)), std::invalid_argument, "zlib compressed data is invalid.");
+		}
+
+		virtual size_t getMaxEncodedSizeInBytes(uint32_t uNoOfVoxels) const
+		{
+			return compressBound(static_cast<uLong>(uNoOfVoxels * sizeof(VoxelType)));
+		}
+
+	private:
+		int m_iCompressionLevel;
+	};
+#endif
+
+#if defined(POLYVOX_LZ4_ENABLED)
+	/**
+	 * Compresses the voxels with LZ4, which is much faster than zlib but does not compress as well. This is only
+	 * available if POLYVOX_LZ4_ENABLED is defined (see Config.h), in which case your application must also link against LZ4.
+	 */
+	template <typename VoxelType>
+	class LZ4Codec : public ChunkCodec<VoxelType>
+	{
+	public:
+		virtual uint32_t getId(void) const
+		{
+			return makeCodecId('L', 'Z', '4', ' ');
+		}
+
+		virtual void encode(const VoxelType* pData, uint32_t uNoOfVoxels, std::vector<uint8_t>& vecOutput) const
+		{
+			const int iSourceLength = static_cast<int>(uNoOfVoxels * sizeof(VoxelType));
+			const size_t uStart = vecOutput.size();
+			vecOutput.resize(uStart + LZ4_compressBound(iSourceLength));
+
+			int iEncodedLength = LZ4_compress_default(reinterpret_cast<const char*>(pData), reinterpret_cast<char*>(&(vecOutput[uStart])),
+				iSourceLength, static_cast<int>(vecOutput.size() - uStart));
+			POLYVOX_THROW_IF(iEncodedLength <= 0, std::runtime_error, "LZ4 failed to compress chunk data.");
+			vecOutput.resize(uStart + iEncodedLength);
+		}
+
+		virtual void decode(const uint8_t* pInput, size_t uInputLength, VoxelType* pData, uint32_t uNoOfVoxels) const
+		{
+			const int iDecodedLength = static_cast<int>(uNoOfVoxels * sizeof(VoxelType));
+			int iResult = LZ4_decompress_safe(reinterpret_cast<const char*>(pInput), reinterpret_cast<char*>(pData), static_cast<int>(uInputLength), iDecodedLength);
+			POLYVOX_THROW_IF(iResult != iDecodedLength, std::invalid_argument, "LZ4 compressed data is invalid.");
+		}
+
+		virtual size_t getMaxEncodedSizeInBytes(uint32_t uNoOfVoxels) const
+		{
+			return LZ4_compressBound(static_cast<int>(uNoOfVoxels * sizeof(VoxelType)));
+		}
+	};
+#endif
+}
+
+#endif //__PolyVox_ChunkCodec_H__
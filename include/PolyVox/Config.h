@@ -35,4 +35,11 @@ SOFTWARE.
 //#define POLYVOX_ASSERTS_ENABLED
 #define POLYVOX_THROW_ENABLED
 
+// Enables the ZlibCodec and LZ4Codec (see ChunkCodec.h), which require linking against the corresponding libraries.
+//#define POLYVOX_ZLIB_ENABLED
+//#define POLYVOX_LZ4_ENABLED
+
+// Forces the scalar versions of the algorithms which have vectorised (SSE2/AVX2) implementations.
+//#define POLYVOX_SIMD_DISABLED
+
 #endif
@@ -30,6 +30,7 @@
 #include "Array.h"
 #include "BaseVolume.h" //For wrap modes... should move these?
 #include "DefaultIsQuadNeeded.h"
+#include "ExtractionContext.h"
 #include "Mesh.h"
 #include "Vertex.h"
 
@@ -38,14 +39,20 @@ namespace PolyVox
 	/// A specialised vertex format which encodes the data from the cubic extraction algorithm in a very 
 	/// compact way. You will probably want to use the decodeVertex() function to turn it into a regular
 	/// Vertex for rendering, but advanced users should also be able to decode it on the GPU (not tested).
-	template<typename _DataType>
+	///
+	/// The PositionComponentType determines how the position is encoded, and hence the largest region which
+	/// can be extracted into a mesh of these vertices. By default each component is a single byte, which allows
+	/// regions of up to 255 voxels along each axis. Using uint16_t instead allows up to 65535 voxels, at the cost
+	/// of three more bytes per vertex.
+	template<typename _DataType, typename _PositionComponentType = uint8_t>
 	struct  CubicVertex
 	{
 		typedef _DataType DataType;
+		typedef _PositionComponentType PositionComponentType;
 
-		/// Each component of the position is stored as a single unsigned byte.
+		/// Each component of the position is stored as an unsigned integer (a single byte by default).
 		/// The true position is found by offseting each component by 0.5f.
-		Vector3DUint8 encodedPosition;
+		Vector<3, PositionComponentType, int32_t> encodedPosition;
 
 		/// A copy of the data which was stored in the voxel which generated this vertex.
 		DataType data;
@@ -60,12 +67,12 @@ namespace PolyVox
 	inline Vector3DFloat decodePosition(const Vector3DUint8& encodedPosition);
 
 	/// Decodes a CubicVertex by converting it into a regular Vertex which can then be directly used for rendering.
-	template<typename DataType>
-	Vertex<DataType> decodeVertex(const CubicVertex<DataType>& cubicVertex);
+	template<typename DataType, typename PositionComponentType>
+	Vertex<DataType> decodeVertex(const CubicVertex<DataType, PositionComponentType>& cubicVertex);
 
 	/// Generates a cubic-style mesh from the voxel data.
 	template<typename VolumeType, typename MeshType, typename IsQuadNeeded = DefaultIsQuadNeeded<typename VolumeType::VoxelType> >
-	void extractCubicMeshCustom(VolumeType* volData, Region region, MeshType* result, IsQuadNeeded isQuadNeeded = IsQuadNeeded(), bool bMergeQuads = true);
+	void extractCubicMeshCustom(VolumeType* volData, Region region, MeshType* result, IsQuadNeeded isQuadNeeded = IsQuadNeeded(), bool bMergeQuads = true, ExtractionContext* pContext = nullptr);
 
 	/// Generates a cubic-style mesh from the voxel data, placing the result into a user-provided Mesh.
 	template<typename VolumeType, typename IsQuadNeeded = DefaultIsQuadNeeded<typename VolumeType::VoxelType> >
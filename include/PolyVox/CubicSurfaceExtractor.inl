@@ -23,20 +23,16 @@
 *******************************************************************************/
 
 #include "Impl/Timer.h"
+#include "Impl/Utility.h"
+#include "Impl/ValueRange.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
 
 namespace PolyVox
 {
-	// This constant defines the maximum number of quads which can share a vertex in a cubic style mesh.
-	//
-	// We try to avoid duplicate vertices by checking whether a vertex has already been added at a given position.
-	// However, it is possible that vertices have the same position but different materials. In this case, the
-	// vertices are not true duplicates and both must be added to the mesh. As far as I can tell, it is possible to have
-	// at most eight vertices with the same position but different materials. For example, this worst-case scenario
-	// happens when we have a 2x2x2 group of voxels, all with different materials and some/all partially transparent.
-	// The vertex position at the center of this group is then going to be used by all eight voxels all with different
-	// materials.
-	const uint32_t MaxVerticesPerPosition = 8;
-
 	////////////////////////////////////////////////////////////////////////////////
 	// Data structures
 	////////////////////////////////////////////////////////////////////////////////
@@ -52,24 +48,23 @@ namespace PolyVox
 		NoOfFaces
 	};
 
-	struct Quad
+	/// Records whether a quad is needed on one face of a voxel, and if so, what material it has. The faces which lie in
+	/// the same plane and point in the same direction are gathered into a mask of these entries, and then merged into
+	/// as few quads as possible (see mergeFacesGreedily()).
+	template<typename VoxelType>
+	struct QuadMaskEntry
 	{
-		Quad(uint32_t v0, uint32_t v1, uint32_t v2, uint32_t v3)
-		{
-			vertices[0] = v0;
-			vertices[1] = v1;
-			vertices[2] = v2;
-			vertices[3] = v3;
-		}
-
-		uint32_t vertices[4];
+		VoxelType material;
+		bool bQuadNeeded;
 	};
 
-	template<typename VolumeType>
-	struct IndexAndMaterial
+	/// A quad which has been produced by merging faces. The corners are packed positions (see packCornerPosition())
+	/// which are only turned into vertices once all the quads have been found.
+	template<typename VoxelType>
+	struct MergedQuad
 	{
-		int32_t iIndex;
-		typename VolumeType::VoxelType uMaterial;
+		uint64_t corners[4];
+		VoxelType material;
 	};
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -83,11 +78,21 @@ namespace PolyVox
 		return result;
 	}
 
-	template<typename DataType>
-	Vertex<DataType> decodeVertex(const CubicVertex<DataType>& cubicVertex)
+	// decodePosition() can't be overloaded for the wider encodings, as the Marching Cubes extractor
+	// already has a version of it for Vector3DUint16 (which uses a different encoding).
+	template<typename PositionComponentType>
+	Vector3DFloat decodeCubicPosition(const Vector<3, PositionComponentType, int32_t>& encodedPosition)
+	{
+		Vector3DFloat result(encodedPosition.getX(), encodedPosition.getY(), encodedPosition.getZ());
+		result -= 0.5f; // Apply the required offset
+		return result;
+	}
+
+	template<typename DataType, typename PositionComponentType>
+	Vertex<DataType> decodeVertex(const CubicVertex<DataType, PositionComponentType>& cubicVertex)
 	{
 		Vertex<DataType> result;
-		result.position = decodePosition(cubicVertex.encodedPosition);
+		result.position = decodeCubicPosition(cubicVertex.encodedPosition);
 		result.normal.setElements(0.0f, 0.0f, 0.0f); // Currently not calculated
 		result.data = cubicVertex.data; // Data is not encoded
 		return result;
@@ -97,106 +102,739 @@ namespace PolyVox
 	// Surface extraction
 	////////////////////////////////////////////////////////////////////////////////
 
-	template<typename MeshType>
-	bool mergeQuads(Quad& q1, Quad& q2, MeshType* m_meshCurrent)
+	inline uint64_t packCornerPosition(uint32_t uX, uint32_t uY, uint32_t uZ)
+	{
+		// The positions are relative to the region, and so fit in 16 bits each (see extractCubicMeshCustom()).
+		return static_cast<uint64_t>(uX) | (static_cast<uint64_t>(uY) << 16) | (static_cast<uint64_t>(uZ) << 32);
+	}
+
+	template<typename VoxelType>
+	void markQuadNeeded(QuadMaskEntry<VoxelType>& entry, const VoxelType& material)
+	{
+		entry.material = material;
+		entry.bQuadNeeded = true;
+	}
+
+	/// Adds a quad covering the faces from (u0, v0) up to (but not including) (u1, v1) in the given plane. The 'u' and 'v'
+	/// axes are y and z for faces pointing along x, x and z for faces pointing along y, and x and y for faces pointing along z.
+	template<typename VoxelType>
+	void addMergedQuad(FaceNames face, uint32_t uPlane, uint32_t u0, uint32_t v0, uint32_t u1, uint32_t v1, const VoxelType& material, std::vector< MergedQuad<VoxelType> >& vecQuads)
 	{
-		//All four vertices of a given quad have the same data,
-		//so just check that the first pair of vertices match.
-		if (m_meshCurrent->getVertex(q1.vertices[0]).data == m_meshCurrent->getVertex(q2.vertices[0]).data)
+		uint64_t corners[4];
+		switch (face)
 		{
-			//Now check whether quad 2 is adjacent to quad one by comparing vertices.
-			//Adjacent quads must share two vertices, and the second quad could be to the
-			//top, bottom, left, of right of the first one. This gives four combinations to test.
-			if ((q1.vertices[0] == q2.vertices[1]) && ((q1.vertices[3] == q2.vertices[2])))
+		case PositiveX:
+		case NegativeX:
+			corners[0] = packCornerPosition(uPlane, u0, v0);
+			corners[1] = packCornerPosition(uPlane, u0, v1);
+			corners[2] = packCornerPosition(uPlane, u1, v1);
+			corners[3] = packCornerPosition(uPlane, u1, v0);
+			break;
+		case PositiveY:
+		case NegativeY:
+			corners[0] = packCornerPosition(u0, uPlane, v0);
+			corners[1] = packCornerPosition(u1, uPlane, v0);
+			corners[2] = packCornerPosition(u1, uPlane, v1);
+			corners[3] = packCornerPosition(u0, uPlane, v1);
+			break;
+		default:
+			corners[0] = packCornerPosition(u0, v0, uPlane);
+			corners[1] = packCornerPosition(u0, v1, uPlane);
+			corners[2] = packCornerPosition(u1, v1, uPlane);
+			corners[3] = packCornerPosition(u1, v0, uPlane);
+			break;
+		}
+
+		// Quads on the positive faces are wound the other way, so that they face the other way.
+		MergedQuad<VoxelType> quad;
+		quad.corners[0] = corners[0];
+		quad.corners[1] = face < NegativeX ? corners[3] : corners[1];
+		quad.corners[2] = corners[2];
+		quad.corners[3] = face < NegativeX ? corners[1] : corners[3];
+		quad.material = material;
+		vecQuads.push_back(quad);
+	}
+
+	/// Merges the faces in a plane into quads using greedy meshing. Starting from each face which has not been used yet, a quad
+	/// is extended along the row for as long as the faces have the same material, and then on to the following rows for as long
+	/// as they match across the whole width of the quad. Each face ends up in exactly one quad, and the faces are removed from the
+	/// mask as they are used so that it is left empty for next time. If bMergeQuads is false then each face becomes its own quad.
+	template<typename VoxelType>
+	void mergeFacesGreedily(QuadMaskEntry<VoxelType>* pMask, uint32_t uWidth, uint32_t uHeight, bool bMergeQuads, FaceNames face, uint32_t uPlane, std::vector< MergedQuad<VoxelType> >& vecQuads)
+	{
+		for (uint32_t v = 0; v < uHeight; v++)
+		{
+			QuadMaskEntry<VoxelType>* pRow = pMask + v * uWidth;
+			uint32_t u = 0;
+			while (u < uWidth)
 			{
-				q1.vertices[0] = q2.vertices[0];
-				q1.vertices[3] = q2.vertices[3];
-				return true;
+				if (!pRow[u].bQuadNeeded)
+				{
+					u++;
+					continue;
+				}
+
+				const VoxelType material = pRow[u].material;
+				uint32_t uQuadWidth = 1;
+				uint32_t uQuadHeight = 1;
+				if (bMergeQuads)
+				{
+					while ((u + uQuadWidth < uWidth) && pRow[u + uQuadWidth].bQuadNeeded && (pRow[u + uQuadWidth].material == material))
+					{
+						uQuadWidth++;
+					}
+
+					while (v + uQuadHeight < uHeight)
+					{
+						const QuadMaskEntry<VoxelType>* pNextRow = pRow + uQuadHeight * uWidth + u;
+						uint32_t uMatching = 0;
+						while ((uMatching < uQuadWidth) && pNextRow[uMatching].bQuadNeeded && (pNextRow[uMatching].material == material))
+						{
+							uMatching++;
+						}
+
+						if (uMatching < uQuadWidth)
+						{
+							break;
+						}
+						uQuadHeight++;
+					}
+				}
+
+				for (uint32_t uQuadRow = 0; uQuadRow < uQuadHeight; uQuadRow++)
+				{
+					QuadMaskEntry<VoxelType>* pQuadRow = pRow + uQuadRow * uWidth + u;
+					for (uint32_t uQuadColumn = 0; uQuadColumn < uQuadWidth; uQuadColumn++)
+					{
+						pQuadRow[uQuadColumn].bQuadNeeded = false;
+					}
+				}
+
+				addMergedQuad(face, uPlane, u, v, u + uQuadWidth, v + uQuadHeight, material, vecQuads);
+				u += uQuadWidth;
+			}
+		}
+	}
+
+	/// Creates the vertices for the corners of the quads and adds the quads to the mesh. Quads which have a corner at the same
+	/// position and with the same material share a vertex. These are found by sorting the corners by position, and the order of
+	/// corners with the same position is preserved (so the resulting mesh does not depend on the sorting algorithm).
+	/// The scratch buffers which the cubic extractor keeps in an ExtractionContext.
+	namespace CubicBuffers
+	{
+		enum CubicBuffer
+		{
+			Quads,
+			SortedCorners,
+			Keys,
+			CornerVertices,
+			MaterialsAtPosition,
+			Masks, // One buffer for each face, starting from this id
+			Slice = Masks + NoOfFaces,
+			PreviousSlice,
+			RowBlockQuadsPossible,
+			Voxels,
+			SolidRows,
+			EmptyRows,
+			SolidColumns,
+			EmptyColumns,
+			FaceBits
+		};
+	}
+
+	template<typename VoxelType, typename MeshType>
+	void addMergedQuadsToMesh(const std::vector< MergedQuad<VoxelType> >& vecQuads, MeshType* result, ExtractionContext& context)
+	{
+		typedef typename MeshType::VertexType::PositionComponentType PositionComponentType;
+
+		// Each corner is sorted along with its index, so that corners at the same position stay in their original order. With the
+		// 8-bit encoding the position and index fit into a single 64-bit key, which is quite a bit faster to sort than a pair.
+		const uint32_t uNoOfCorners = static_cast<uint32_t>(vecQuads.size()) * 4;
+		std::vector<uint32_t>& vecSortedCorners = context.getBuffer<uint32_t>(CubicBuffers::SortedCorners);
+		vecSortedCorners.resize(uNoOfCorners);
+		if (sizeof(PositionComponentType) == 1)
+		{
+			std::vector<uint64_t>& vecKeys = context.getBuffer<uint64_t>(CubicBuffers::Keys);
+			vecKeys.resize(uNoOfCorners);
+			for (uint32_t uCorner = 0; uCorner < uNoOfCorners; uCorner++)
+			{
+				const uint64_t uPosition = vecQuads[uCorner / 4].corners[uCorner % 4];
+				const uint64_t uCompactPosition = (uPosition & 0xff) | ((uPosition >> 8) & 0xff00) | ((uPosition >> 16) & 0xff0000);
+				vecKeys[uCorner] = (uCompactPosition << 32) | uCorner;
+			}
+			std::sort(vecKeys.begin(), vecKeys.end());
+			for (uint32_t uSortedCorner = 0; uSortedCorner < uNoOfCorners; uSortedCorner++)
+			{
+				vecSortedCorners[uSortedCorner] = static_cast<uint32_t>(vecKeys[uSortedCorner] & 0xffffffff);
+			}
+		}
+		else
+		{
+			std::vector< std::pair<uint64_t, uint32_t> >& vecKeys = context.getBuffer< std::pair<uint64_t, uint32_t> >(CubicBuffers::Keys);
+			vecKeys.resize(uNoOfCorners);
+			for (uint32_t uCorner = 0; uCorner < uNoOfCorners; uCorner++)
+			{
+				vecKeys[uCorner] = std::make_pair(vecQuads[uCorner / 4].corners[uCorner % 4], uCorner);
+			}
+			std::sort(vecKeys.begin(), vecKeys.end());
+			for (uint32_t uSortedCorner = 0; uSortedCorner < uNoOfCorners; uSortedCorner++)
+			{
+				vecSortedCorners[uSortedCorner] = vecKeys[uSortedCorner].second;
 			}
-			else if ((q1.vertices[3] == q2.vertices[0]) && ((q1.vertices[2] == q2.vertices[1])))
+		}
+
+		// The vertices at a position are added one after another, so we keep track of their materials here rather than reading
+		// them back from the mesh. This means the mesh only needs to be able to add vertices and triangles (see MeshCounter).
+		std::vector<typename MeshType::IndexType>& vecCornerVertices = context.getBuffer<typename MeshType::IndexType>(CubicBuffers::CornerVertices);
+		std::vector<VoxelType>& vecMaterialsAtPosition = context.getBuffer<VoxelType>(CubicBuffers::MaterialsAtPosition);
+		vecCornerVertices.resize(uNoOfCorners);
+		vecMaterialsAtPosition.clear();
+		typename MeshType::IndexType uFirstVertexAtPosition = 0;
+		uint64_t uPreviousPosition = 0;
+		for (uint32_t uSortedCorner = 0; uSortedCorner < uNoOfCorners; uSortedCorner++)
+		{
+			const uint32_t uCorner = vecSortedCorners[uSortedCorner];
+			const uint64_t uPosition = vecQuads[uCorner / 4].corners[uCorner % 4];
+			const VoxelType& material = vecQuads[uCorner / 4].material;
+
+			if ((uSortedCorner == 0) || (uPosition != uPreviousPosition))
 			{
-				q1.vertices[3] = q2.vertices[3];
-				q1.vertices[2] = q2.vertices[2];
-				return true;
+				vecMaterialsAtPosition.clear();
 			}
-			else if ((q1.vertices[1] == q2.vertices[0]) && ((q1.vertices[2] == q2.vertices[3])))
+
+			// There are only a few different materials at any one position, so we just search them.
+			uint32_t uMaterial = 0;
+			while ((uMaterial < vecMaterialsAtPosition.size()) && !(vecMaterialsAtPosition[uMaterial] == material))
 			{
-				q1.vertices[1] = q2.vertices[1];
-				q1.vertices[2] = q2.vertices[2];
-				return true;
+				uMaterial++;
 			}
-			else if ((q1.vertices[0] == q2.vertices[3]) && ((q1.vertices[1] == q2.vertices[2])))
+
+			if (uMaterial == vecMaterialsAtPosition.size())
 			{
-				q1.vertices[0] = q2.vertices[0];
-				q1.vertices[1] = q2.vertices[1];
-				return true;
+				CubicVertex<VoxelType, PositionComponentType> cubicVertex;
+				cubicVertex.encodedPosition.setElements(static_cast<PositionComponentType>(uPosition & 0xffff),
+					static_cast<PositionComponentType>((uPosition >> 16) & 0xffff), static_cast<PositionComponentType>(uPosition >> 32));
+				cubicVertex.data = material;
+				const typename MeshType::IndexType uVertex = result->addVertex(cubicVertex);
+				if (uMaterial == 0)
+				{
+					uFirstVertexAtPosition = uVertex;
+				}
+				vecMaterialsAtPosition.push_back(material);
 			}
+
+			vecCornerVertices[uCorner] = static_cast<typename MeshType::IndexType>(uFirstVertexAtPosition + uMaterial);
+			uPreviousPosition = uPosition;
+		}
+
+		for (uint32_t uQuad = 0; uQuad < vecQuads.size(); uQuad++)
+		{
+			const typename MeshType::IndexType* pVertices = &(vecCornerVertices[uQuad * 4]);
+			result->addTriangle(pVertices[0], pVertices[1], pVertices[2]);
+			result->addTriangle(pVertices[0], pVertices[2], pVertices[3]);
+		}
+	}
+
+	/// The default IsQuadNeeded for primitive voxel types only places quads between voxels which are greater than zero and voxels which
+	/// are zero, so the range of values in a region (see BaseVolume::getRegionValueRange()) can tell us that no quads are needed there.
+	/// Other implementations of IsQuadNeeded can compare voxels however they like, so for them we have to assume that quads are possible.
+	template<typename VolumeType, typename IsQuadNeeded>
+	bool areQuadsPossible(VolumeType* /*volData*/, const Region& /*region*/, std::false_type)
+	{
+		return true;
+	}
+
+	template<typename VolumeType, typename IsQuadNeeded>
+	bool areQuadsPossible(VolumeType* volData, const Region& region, std::true_type)
+	{
+		typename VolumeType::VoxelType tMin;
+		typename VolumeType::VoxelType tMax;
+		if (!volData->getRegionValueRange(region, tMin, tMax))
+		{
+			return true;
 		}
 
-		//Quads cannot be merged.
-		return false;
+		const typename VolumeType::VoxelType tZero = 0;
+		return (tZero < tMax) && !(tZero < tMin);
+	}
+
+	template<typename VolumeType, typename IsQuadNeeded>
+	bool areQuadsPossible(VolumeType* volData, const Region& region)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+		return areQuadsPossible<VolumeType, IsQuadNeeded>(volData, region, std::integral_constant<bool,
+			std::is_same<IsQuadNeeded, DefaultIsQuadNeeded<VoxelType> >::value && HasValueRange<VoxelType>::value>());
 	}
 
-	template<typename MeshType>
-	bool performQuadMerging(std::list<Quad>& quads, MeshType* m_meshCurrent)
+	/// Finds the quads by comparing each voxel with its neighbours on the negative side using IsQuadNeeded, and then merges them.
+	template<typename VolumeType, typename IsQuadNeeded>
+	void findQuads(VolumeType* volData, const Region& region, IsQuadNeeded& isQuadNeeded, bool bMergeQuads, std::vector< MergedQuad<typename VolumeType::VoxelType> >& vecQuads, ExtractionContext& context, std::false_type)
 	{
-		bool bDidMerge = false;
-		for (typename std::list<Quad>::iterator outerIter = quads.begin(); outerIter != quads.end(); outerIter++)
+		typedef typename VolumeType::VoxelType VoxelType;
+		const uint32_t uWidth = region.getWidthInVoxels();
+		const uint32_t uHeight = region.getHeightInVoxels();
+		const uint32_t uDepth = region.getDepthInVoxels();
+
+		// The faces which are found are recorded in a mask for each direction. The faces pointing along z are merged at the end of
+		// each slice, so their masks only cover one slice, but those pointing along x and y are only merged once all the slices are
+		// done. Each plane is contiguous within the masks, with its 'u' axis (see addMergedQuad()) varying fastest.
+		QuadMaskEntry<VoxelType> emptyEntry;
+		emptyEntry.material = VoxelType();
+		emptyEntry.bQuadNeeded = false;
+		QuadMaskEntry<VoxelType>* pMasks[NoOfFaces];
+		for (uint32_t uFace = 0; uFace < NoOfFaces; uFace++)
 		{
-			typename std::list<Quad>::iterator innerIter = outerIter;
-			innerIter++;
-			while (innerIter != quads.end())
+			std::vector< QuadMaskEntry<VoxelType> >& vecMask = context.getBuffer< QuadMaskEntry<VoxelType> >(CubicBuffers::Masks + uFace);
+			const bool bAlongZ = (uFace == PositiveZ) || (uFace == NegativeZ);
+			vecMask.assign(uHeight * uWidth * (bAlongZ ? 1 : uDepth), emptyEntry);
+			pMasks[uFace] = vecMask.data();
+		}
+
+		// Each slice is copied into a buffer along with its neighbours on the negative side (see gatherVoxels()), so the voxel at
+		// (x, y) relative to the region is found at (x + 1, y + 1) in the buffer. The previous slice is kept for the neighbours along z.
+		const uint32_t uBufferWidth = uWidth + 1;
+		const uint32_t uBufferSliceSize = uBufferWidth * (uHeight + 1);
+		std::vector<VoxelType>& vecSlice = context.getBuffer<VoxelType>(CubicBuffers::Slice);
+		std::vector<VoxelType>& vecPreviousSlice = context.getBuffer<VoxelType>(CubicBuffers::PreviousSlice);
+		vecSlice.resize(uBufferSliceSize);
+		vecPreviousSlice.resize(uBufferSliceSize);
+		gatherVoxels(volData, Region(region.getLowerX() - 1, region.getLowerY() - 1, region.getLowerZ() - 1, region.getUpperX(), region.getUpperY(), region.getLowerZ() - 1), vecSlice.data());
+
+		// The rows are grouped into blocks covering a number of rows in each of a number of slices, and we ask the volume whether
+		// quads are possible in each block (see areQuadsPossible()). The results for the current group of slices are held here.
+		const int32_t iRowBlockSize = 8;
+		std::vector<bool>& vecRowBlockQuadsPossible = context.getBuffer<bool>(CubicBuffers::RowBlockQuadsPossible);
+		vecRowBlockQuadsPossible.assign((region.getHeightInVoxels() + iRowBlockSize - 1) / iRowBlockSize, true);
+
+		for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		{
+			uint32_t regZ = z - region.getLowerZ();
+
+			vecSlice.swap(vecPreviousSlice);
+			gatherVoxels(volData, Region(region.getLowerX() - 1, region.getLowerY() - 1, z, region.getUpperX(), region.getUpperY(), z), vecSlice.data());
+
+			if (regZ % iRowBlockSize == 0)
 			{
-				Quad& q1 = *outerIter;
-				Quad& q2 = *innerIter;
+				const int32_t iBlockUpperZ = (std::min)(z + iRowBlockSize - 1, region.getUpperZ());
+				for (uint32_t uBlock = 0; uBlock < vecRowBlockQuadsPossible.size(); uBlock++)
+				{
+					// Each voxel is compared with its neighbours on the negative side, so these are included.
+					const int32_t iBlockLowerY = region.getLowerY() + static_cast<int32_t>(uBlock) * iRowBlockSize;
+					const int32_t iBlockUpperY = (std::min)(iBlockLowerY + iRowBlockSize - 1, region.getUpperY());
+					vecRowBlockQuadsPossible[uBlock] = areQuadsPossible<VolumeType, IsQuadNeeded>(volData,
+						Region(region.getLowerX() - 1, iBlockLowerY - 1, z - 1, region.getUpperX(), iBlockUpperY, iBlockUpperZ));
+				}
+			}
 
-				bool result = mergeQuads(q1, q2, m_meshCurrent);
+			for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+			{
+				uint32_t regY = y - region.getLowerY();
 
-				if (result)
+				if (!vecRowBlockQuadsPossible[regY / iRowBlockSize])
 				{
-					bDidMerge = true;
-					innerIter = quads.erase(innerIter);
+					continue;
 				}
-				else
+
+				// These point at the neighbours on the negative side of the rows.
+				const VoxelType* pRow = &(vecSlice[(regY + 1) * uBufferWidth]);
+				const VoxelType* pPreviousRow = pRow - uBufferWidth;
+				const VoxelType* pPreviousSliceRow = &(vecPreviousSlice[(regY + 1) * uBufferWidth]);
+
+				for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
 				{
-					innerIter++;
+					uint32_t regX = x - region.getLowerX();
+
+					VoxelType material; //Filled in by callback
+					VoxelType currentVoxel = pRow[regX + 1];
+					VoxelType negXVoxel = pRow[regX];
+					VoxelType negYVoxel = pPreviousRow[regX + 1];
+					VoxelType negZVoxel = pPreviousSliceRow[regX + 1];
+
+					// X
+					const uint32_t uXMaskIndex = (regX * uDepth + regZ) * uHeight + regY;
+					if (isQuadNeeded(currentVoxel, negXVoxel, material))
+					{
+						markQuadNeeded(pMasks[NegativeX][uXMaskIndex], material);
+					}
+
+					if (isQuadNeeded(negXVoxel, currentVoxel, material))
+					{
+						markQuadNeeded(pMasks[PositiveX][uXMaskIndex], material);
+					}
+
+					// Y
+					const uint32_t uYMaskIndex = (regY * uDepth + regZ) * uWidth + regX;
+					if (isQuadNeeded(currentVoxel, negYVoxel, material))
+					{
+						markQuadNeeded(pMasks[NegativeY][uYMaskIndex], material);
+					}
+
+					if (isQuadNeeded(negYVoxel, currentVoxel, material))
+					{
+						markQuadNeeded(pMasks[PositiveY][uYMaskIndex], material);
+					}
+
+					// Z
+					const uint32_t uZMaskIndex = regY * uWidth + regX;
+					if (isQuadNeeded(currentVoxel, negZVoxel, material))
+					{
+						markQuadNeeded(pMasks[NegativeZ][uZMaskIndex], material);
+					}
+
+					if (isQuadNeeded(negZVoxel, currentVoxel, material))
+					{
+						markQuadNeeded(pMasks[PositiveZ][uZMaskIndex], material);
+					}
 				}
 			}
+
+			mergeFacesGreedily(pMasks[NegativeZ], uWidth, uHeight, bMergeQuads, NegativeZ, regZ, vecQuads);
+			mergeFacesGreedily(pMasks[PositiveZ], uWidth, uHeight, bMergeQuads, PositiveZ, regZ, vecQuads);
+		}
+
+		for (uint32_t regX = 0; regX < uWidth; regX++)
+		{
+			mergeFacesGreedily(pMasks[NegativeX] + regX * uDepth * uHeight, uHeight, uDepth, bMergeQuads, NegativeX, regX, vecQuads);
+			mergeFacesGreedily(pMasks[PositiveX] + regX * uDepth * uHeight, uHeight, uDepth, bMergeQuads, PositiveX, regX, vecQuads);
+		}
+
+		for (uint32_t regY = 0; regY < uHeight; regY++)
+		{
+			mergeFacesGreedily(pMasks[NegativeY] + regY * uDepth * uWidth, uWidth, uDepth, bMergeQuads, NegativeY, regY, vecQuads);
+			mergeFacesGreedily(pMasks[PositiveY] + regY * uDepth * uWidth, uWidth, uDepth, bMergeQuads, PositiveY, regY, vecQuads);
 		}
+	}
+
+	// Helpers for working with rows of faces which are packed into bitmasks, with bit (u % 64) of word (u / 64) representing face u.
 
-		return bDidMerge;
+	// Gets a mask of bits uFirst (inclusive) to uEnd (exclusive) of a single word.
+	inline uint64_t makeBitRangeMask(uint32_t uFirst, uint32_t uEnd)
+	{
+		const uint64_t uBelowEnd = (uEnd == 64) ? ~uint64_t(0) : ((uint64_t(1) << uEnd) - 1);
+		return uBelowEnd & ~((uint64_t(1) << uFirst) - 1);
 	}
 
-	template<typename VolumeType, typename MeshType>
-	int32_t addVertex(uint32_t uX, uint32_t uY, uint32_t uZ, typename VolumeType::VoxelType uMaterialIn, Array<3, IndexAndMaterial<VolumeType> >& existingVertices, MeshType* m_meshCurrent)
+	// Counts the number of consecutive bits which are set starting from (and including) bit uFirst.
+	inline uint32_t countSetBitsInRun(const uint64_t* pBits, uint32_t uNoOfWords, uint32_t uFirst)
 	{
-		for (uint32_t ct = 0; ct < MaxVerticesPerPosition; ct++)
+		uint32_t uCount = 0;
+		uint32_t uWord = uFirst / 64;
+		uint32_t uBit = uFirst % 64;
+		while (uWord < uNoOfWords)
 		{
-			IndexAndMaterial<VolumeType>& rEntry = existingVertices(uX, uY, ct);
+			// Shifting brings in zeros at the top, so the inverted bits are never all zero unless the whole word is set.
+			const uint64_t uUnsetBits = ~(pBits[uWord] >> uBit);
+			const uint32_t uRun = (uUnsetBits == 0) ? 64 : countTrailingZeros(uUnsetBits);
+			uCount += uRun;
+			if (uBit + uRun < 64)
+			{
+				break;
+			}
+			uWord++;
+			uBit = 0;
+		}
+		return uCount;
+	}
 
-			if (rEntry.iIndex == -1)
+	inline bool areAllBitsSet(const uint64_t* pBits, uint32_t uFirst, uint32_t uEnd)
+	{
+		for (uint32_t uWord = uFirst / 64; uWord * 64 < uEnd; uWord++)
+		{
+			const uint64_t uMask = makeBitRangeMask((std::max)(uFirst, uWord * 64) - uWord * 64, (std::min)(uEnd, uWord * 64 + 64) - uWord * 64);
+			if ((pBits[uWord] & uMask) != uMask)
 			{
-				//No vertices matched and we've now hit an empty space. Fill it by creating a vertex. The 0.5f offset is because vertices set between voxels in order to build cubes around them.
-				CubicVertex<typename VolumeType::VoxelType> cubicVertex;
-				cubicVertex.encodedPosition.setElements(static_cast<uint8_t>(uX), static_cast<uint8_t>(uY), static_cast<uint8_t>(uZ));
-				cubicVertex.data = uMaterialIn;
-				rEntry.iIndex = m_meshCurrent->addVertex(cubicVertex);
-				rEntry.uMaterial = uMaterialIn;
-
-				return rEntry.iIndex;
+				return false;
 			}
+		}
+		return true;
+	}
 
-			//If we have an existing vertex and the material matches then we can return it.
-			if (rEntry.uMaterial == uMaterialIn)
+	inline void clearBits(uint64_t* pBits, uint32_t uFirst, uint32_t uEnd)
+	{
+		for (uint32_t uWord = uFirst / 64; uWord * 64 < uEnd; uWord++)
+		{
+			pBits[uWord] &= ~makeBitRangeMask((std::max)(uFirst, uWord * 64) - uWord * 64, (std::min)(uEnd, uWord * 64 + 64) - uWord * 64);
+		}
+	}
+
+	// Transposes a 64x64 matrix of bits, where bit j of pRows[i] is the element in row i and column j. This works by swapping
+	// the off-diagonal blocks of each 2x2 arrangement of blocks, starting with 32x32 blocks and ending with single bits.
+	inline void transposeBits(uint64_t* pRows)
+	{
+		uint64_t uMask = 0x00000000FFFFFFFFull;
+		for (uint32_t uBlockSize = 32; uBlockSize != 0; uBlockSize >>= 1, uMask ^= (uMask << uBlockSize))
+		{
+			for (uint32_t uRow = 0; uRow < 64; uRow = (uRow + uBlockSize + 1) & ~uBlockSize)
 			{
-				return rEntry.iIndex;
+				const uint64_t uSwapped = ((pRows[uRow] >> uBlockSize) ^ pRows[uRow + uBlockSize]) & uMask;
+				pRows[uRow] ^= uSwapped << uBlockSize;
+				pRows[uRow + uBlockSize] ^= uSwapped;
 			}
 		}
+	}
+
+	/// Merges the faces in a plane into quads using greedy meshing, in the same way as mergeFacesGreedily() (and giving the same
+	/// quads) but with the faces given as a bitmask for each row. The start of each run of faces is found with countTrailingZeros()
+	/// and its length by counting the set bits which follow, while extending a quad on to the next row starts by checking that all
+	/// the corresponding bits are set. The material of the face at (u, v) is pMaterials[u * uMaterialStrideU + v * uMaterialStrideV],
+	/// and this is only checked for the faces which are present. The bitmask is cleared in the process.
+	template<typename VoxelType>
+	void mergeFaceBitsGreedily(uint64_t* pFaceBits, uint32_t uWordsPerRow, uint32_t uHeight, const VoxelType* pMaterials, uint32_t uMaterialStrideU, uint32_t uMaterialStrideV, bool bMergeQuads, FaceNames face, uint32_t uPlane, std::vector< MergedQuad<VoxelType> >& vecQuads)
+	{
+		for (uint32_t v = 0; v < uHeight; v++)
+		{
+			uint64_t* pRow = pFaceBits + v * uWordsPerRow;
+			for (uint32_t uWord = 0; uWord < uWordsPerRow; uWord++)
+			{
+				while (pRow[uWord] != 0)
+				{
+					const uint32_t u = uWord * 64 + countTrailingZeros(pRow[uWord]);
+					const VoxelType* pQuadMaterials = pMaterials + u * uMaterialStrideU + v * uMaterialStrideV;
+					const VoxelType material = *pQuadMaterials;
 
-		// If we exit the loop here then apparently all the slots were full but none of them matched.
-		// This shouldn't ever happen, so if it does it is probably a bug in PolyVox. Please report it to us!
-		POLYVOX_THROW(std::runtime_error, "All slots full but no matches during cubic surface extraction. This is probably a bug in PolyVox");
-		return -1; //Should never happen.
+					uint32_t uQuadWidth = 1;
+					uint32_t uQuadHeight = 1;
+					if (bMergeQuads)
+					{
+						const uint32_t uRunLength = countSetBitsInRun(pRow, uWordsPerRow, u);
+						while ((uQuadWidth < uRunLength) && (pQuadMaterials[uQuadWidth * uMaterialStrideU] == material))
+						{
+							uQuadWidth++;
+						}
+
+						// Most quads lie within a single word, in which case we only need one mask.
+						const bool bSingleWord = (u % 64) + uQuadWidth <= 64;
+						const uint64_t uQuadMask = bSingleWord ? makeBitRangeMask(u % 64, (u % 64) + uQuadWidth) : 0;
+						while (v + uQuadHeight < uHeight)
+						{
+							const uint64_t* pNextRow = pRow + uQuadHeight * uWordsPerRow;
+							if (bSingleWord ? ((pNextRow[uWord] & uQuadMask) != uQuadMask) : !areAllBitsSet(pNextRow, u, u + uQuadWidth))
+							{
+								break;
+							}
+
+							const VoxelType* pNextRowMaterials = pQuadMaterials + uQuadHeight * uMaterialStrideV;
+							uint32_t uMatching = 0;
+							while ((uMatching < uQuadWidth) && (pNextRowMaterials[uMatching * uMaterialStrideU] == material))
+							{
+								uMatching++;
+							}
+
+							if (uMatching < uQuadWidth)
+							{
+								break;
+							}
+							uQuadHeight++;
+						}
+					}
+
+					if ((u % 64) + uQuadWidth <= 64)
+					{
+						const uint64_t uQuadMask = makeBitRangeMask(u % 64, (u % 64) + uQuadWidth);
+						for (uint32_t uQuadRow = 0; uQuadRow < uQuadHeight; uQuadRow++)
+						{
+							pRow[uQuadRow * uWordsPerRow + uWord] &= ~uQuadMask;
+						}
+					}
+					else
+					{
+						for (uint32_t uQuadRow = 0; uQuadRow < uQuadHeight; uQuadRow++)
+						{
+							clearBits(pRow + uQuadRow * uWordsPerRow, u, u + uQuadWidth);
+						}
+					}
+
+					addMergedQuad(face, uPlane, u, v, u + uQuadWidth, v + uQuadHeight, material, vecQuads);
+				}
+			}
+		}
+	}
+
+	/// Finds the quads for DefaultIsQuadNeeded, for voxel types where this only depends on whether each voxel is solid or empty
+	/// (see HasBinaryOccupancy). The voxels are copied into a buffer and the solid and empty voxels are recorded in bitmasks, for each
+	/// row along x and each column along y. The faces for a whole row of a plane can then be found with a couple of bitwise operations
+	/// on 64 voxels at a time (e.g. 'solid & empty neighbour'), and are merged with mergeFaceBitsGreedily(). The result is exactly the
+	/// same as going through the voxels one at a time.
+	template<typename VolumeType, typename IsQuadNeeded>
+	void findQuads(VolumeType* volData, const Region& region, IsQuadNeeded& /*isQuadNeeded*/, bool bMergeQuads, std::vector< MergedQuad<typename VolumeType::VoxelType> >& vecQuads, ExtractionContext& context, std::true_type)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+		const uint32_t uWidth = region.getWidthInVoxels();
+		const uint32_t uHeight = region.getHeightInVoxels();
+		const uint32_t uDepth = region.getDepthInVoxels();
+
+		// The buffer also holds the neighbours on the negative side of the region, so the voxel at (x, y, z)
+		// relative to the region is found at (x + 1, y + 1, z + 1) in the buffer.
+		const uint32_t uBufferWidth = uWidth + 1;
+		const uint32_t uBufferHeight = uHeight + 1;
+		const uint32_t uBufferDepth = uDepth + 1;
+		const uint32_t uBufferSliceSize = uBufferWidth * uBufferHeight;
+		std::vector<VoxelType>& vecVoxels = context.getBuffer<VoxelType>(CubicBuffers::Voxels);
+		vecVoxels.resize(uBufferSliceSize * uBufferDepth);
+		gatherVoxels(volData, Region(region.getLowerCorner() - Vector3DInt32(1, 1, 1), region.getUpperCorner()), vecVoxels.data());
+
+		// Only the voxels inside the region are included in the bits, as the neighbours just make up another row or column.
+		// The rows are indexed by their position in the buffer, as are the columns (apart from those in the neighbouring slice,
+		// which are not needed).
+		const uint32_t uWordsPerRow = (uWidth + 63) / 64;
+		const uint32_t uWordsPerColumn = (uHeight + 63) / 64;
+		std::vector<uint64_t>& vecSolidRows = context.getBuffer<uint64_t>(CubicBuffers::SolidRows);
+		std::vector<uint64_t>& vecEmptyRows = context.getBuffer<uint64_t>(CubicBuffers::EmptyRows);
+		std::vector<uint64_t>& vecSolidColumns = context.getBuffer<uint64_t>(CubicBuffers::SolidColumns);
+		std::vector<uint64_t>& vecEmptyColumns = context.getBuffer<uint64_t>(CubicBuffers::EmptyColumns);
+		vecSolidRows.assign(uBufferDepth * uBufferHeight * uWordsPerRow, 0);
+		vecEmptyRows.assign(uBufferDepth * uBufferHeight * uWordsPerRow, 0);
+		vecSolidColumns.assign(uBufferDepth * uBufferWidth * uWordsPerColumn, 0);
+		vecEmptyColumns.assign(uBufferDepth * uBufferWidth * uWordsPerColumn, 0);
+		for (uint32_t uBufferZ = 0; uBufferZ < uBufferDepth; uBufferZ++)
+		{
+			for (uint32_t uBufferY = 0; uBufferY < uBufferHeight; uBufferY++)
+			{
+				// The first voxel of the row is the neighbour, which is only needed for the columns.
+				const VoxelType* pRow = &(vecVoxels[uBufferY * uBufferWidth + uBufferZ * uBufferSliceSize]);
+				if ((uBufferY > 0) && (uBufferZ > 0))
+				{
+					const uint32_t uColumnWord = (uBufferZ * uBufferWidth) * uWordsPerColumn + (uBufferY - 1) / 64;
+					vecSolidColumns[uColumnWord] |= uint64_t(DefaultIsQuadNeeded<VoxelType>::isSolid(pRow[0]) ? 1 : 0) << ((uBufferY - 1) % 64);
+					vecEmptyColumns[uColumnWord] |= uint64_t(DefaultIsQuadNeeded<VoxelType>::isEmpty(pRow[0]) ? 1 : 0) << ((uBufferY - 1) % 64);
+				}
+
+				uint64_t* pSolidRow = &(vecSolidRows[(uBufferZ * uBufferHeight + uBufferY) * uWordsPerRow]);
+				uint64_t* pEmptyRow = &(vecEmptyRows[(uBufferZ * uBufferHeight + uBufferY) * uWordsPerRow]);
+				for (uint32_t uWord = 0; uWord < uWordsPerRow; uWord++)
+				{
+					const VoxelType* pWordVoxels = pRow + 1 + uWord * 64;
+					const uint32_t uNoOfBits = (std::min)(uWidth - uWord * 64, 64u);
+					uint64_t uSolidBits = 0;
+					uint64_t uEmptyBits = 0;
+					for (uint32_t uBit = 0; uBit < uNoOfBits; uBit++)
+					{
+						uSolidBits |= uint64_t(DefaultIsQuadNeeded<VoxelType>::isSolid(pWordVoxels[uBit]) ? 1 : 0) << uBit;
+						uEmptyBits |= uint64_t(DefaultIsQuadNeeded<VoxelType>::isEmpty(pWordVoxels[uBit]) ? 1 : 0) << uBit;
+					}
+					pSolidRow[uWord] = uSolidBits;
+					pEmptyRow[uWord] = uEmptyBits;
+				}
+			}
+
+			// The rest of the columns are found by transposing the rows in blocks of 64x64 bits.
+			if (uBufferZ > 0)
+			{
+				uint64_t solidBlock[64];
+				uint64_t emptyBlock[64];
+				for (uint32_t uRowWord = 0; uRowWord < uWordsPerRow; uRowWord++)
+				{
+					for (uint32_t uColumnWord = 0; uColumnWord < uWordsPerColumn; uColumnWord++)
+					{
+						for (uint32_t uBit = 0; uBit < 64; uBit++)
+						{
+							const uint32_t uRegY = uColumnWord * 64 + uBit;
+							const uint32_t uRowIndex = (uBufferZ * uBufferHeight + uRegY + 1) * uWordsPerRow + uRowWord;
+							solidBlock[uBit] = (uRegY < uHeight) ? vecSolidRows[uRowIndex] : 0;
+							emptyBlock[uBit] = (uRegY < uHeight) ? vecEmptyRows[uRowIndex] : 0;
+						}
+
+						transposeBits(solidBlock);
+						transposeBits(emptyBlock);
+
+						const uint32_t uNoOfColumns = (std::min)(uWidth - uRowWord * 64, 64u);
+						for (uint32_t uBit = 0; uBit < uNoOfColumns; uBit++)
+						{
+							const uint32_t uColumnIndex = (uBufferZ * uBufferWidth + uRowWord * 64 + uBit + 1) * uWordsPerColumn + uColumnWord;
+							vecSolidColumns[uColumnIndex] = solidBlock[uBit];
+							vecEmptyColumns[uColumnIndex] = emptyBlock[uBit];
+						}
+					}
+				}
+			}
+		}
+
+		// The planes are processed in the same order as in the other version of findQuads(), so the quads are the same.
+		std::vector<uint64_t>& vecFaceBits = context.getBuffer<uint64_t>(CubicBuffers::FaceBits);
+		vecFaceBits.resize((std::max)(uHeight, uDepth) * (std::max)(uWordsPerRow, uWordsPerColumn));
+
+		// Faces pointing along z. The rows of these planes run along x, one for each y.
+		for (uint32_t regZ = 0; regZ < uDepth; regZ++)
+		{
+			const uint64_t* pSolidRows = &(vecSolidRows[((regZ + 1) * uBufferHeight + 1) * uWordsPerRow]);
+			const uint64_t* pEmptyRows = &(vecEmptyRows[((regZ + 1) * uBufferHeight + 1) * uWordsPerRow]);
+			const uint64_t* pPrevSolidRows = &(vecSolidRows[(regZ * uBufferHeight + 1) * uWordsPerRow]);
+			const uint64_t* pPrevEmptyRows = &(vecEmptyRows[(regZ * uBufferHeight + 1) * uWordsPerRow]);
+			const VoxelType* pMaterials = &(vecVoxels[1 + uBufferWidth + (regZ + 1) * uBufferSliceSize]);
+
+			for (uint32_t uWord = 0; uWord < uHeight * uWordsPerRow; uWord++)
+			{
+				vecFaceBits[uWord] = pSolidRows[uWord] & pPrevEmptyRows[uWord];
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerRow, uHeight, pMaterials, 1, uBufferWidth, bMergeQuads, NegativeZ, regZ, vecQuads);
+
+			for (uint32_t uWord = 0; uWord < uHeight * uWordsPerRow; uWord++)
+			{
+				vecFaceBits[uWord] = pEmptyRows[uWord] & pPrevSolidRows[uWord];
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerRow, uHeight, pMaterials - uBufferSliceSize, 1, uBufferWidth, bMergeQuads, PositiveZ, regZ, vecQuads);
+		}
+
+		// Faces pointing along x. The rows of these planes run along y, one for each z.
+		for (uint32_t regX = 0; regX < uWidth; regX++)
+		{
+			const VoxelType* pMaterials = &(vecVoxels[(regX + 1) + uBufferWidth + uBufferSliceSize]);
+
+			for (uint32_t regZ = 0; regZ < uDepth; regZ++)
+			{
+				const uint32_t uColumn = ((regZ + 1) * uBufferWidth + (regX + 1)) * uWordsPerColumn;
+				for (uint32_t uWord = 0; uWord < uWordsPerColumn; uWord++)
+				{
+					vecFaceBits[regZ * uWordsPerColumn + uWord] = vecSolidColumns[uColumn + uWord] & vecEmptyColumns[uColumn - uWordsPerColumn + uWord];
+				}
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerColumn, uDepth, pMaterials, uBufferWidth, uBufferSliceSize, bMergeQuads, NegativeX, regX, vecQuads);
+
+			for (uint32_t regZ = 0; regZ < uDepth; regZ++)
+			{
+				const uint32_t uColumn = ((regZ + 1) * uBufferWidth + (regX + 1)) * uWordsPerColumn;
+				for (uint32_t uWord = 0; uWord < uWordsPerColumn; uWord++)
+				{
+					vecFaceBits[regZ * uWordsPerColumn + uWord] = vecEmptyColumns[uColumn + uWord] & vecSolidColumns[uColumn - uWordsPerColumn + uWord];
+				}
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerColumn, uDepth, pMaterials - 1, uBufferWidth, uBufferSliceSize, bMergeQuads, PositiveX, regX, vecQuads);
+		}
+
+		// Faces pointing along y. The rows of these planes run along x, one for each z.
+		for (uint32_t regY = 0; regY < uHeight; regY++)
+		{
+			const VoxelType* pMaterials = &(vecVoxels[1 + (regY + 1) * uBufferWidth + uBufferSliceSize]);
+
+			for (uint32_t regZ = 0; regZ < uDepth; regZ++)
+			{
+				const uint32_t uRow = ((regZ + 1) * uBufferHeight + (regY + 1)) * uWordsPerRow;
+				for (uint32_t uWord = 0; uWord < uWordsPerRow; uWord++)
+				{
+					vecFaceBits[regZ * uWordsPerRow + uWord] = vecSolidRows[uRow + uWord] & vecEmptyRows[uRow - uWordsPerRow + uWord];
+				}
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerRow, uDepth, pMaterials, 1, uBufferSliceSize, bMergeQuads, NegativeY, regY, vecQuads);
+
+			for (uint32_t regZ = 0; regZ < uDepth; regZ++)
+			{
+				const uint32_t uRow = ((regZ + 1) * uBufferHeight + (regY + 1)) * uWordsPerRow;
+				for (uint32_t uWord = 0; uWord < uWordsPerRow; uWord++)
+				{
+					vecFaceBits[regZ * uWordsPerRow + uWord] = vecEmptyRows[uRow + uWord] & vecSolidRows[uRow - uWordsPerRow + uWord];
+				}
+			}
+			mergeFaceBitsGreedily(&(vecFaceBits[0]), uWordsPerRow, uDepth, pMaterials - uBufferWidth, 1, uBufferSliceSize, bMergeQuads, PositiveY, regY, vecQuads);
+		}
+	}
+
+	/// Uses the bitmask version of findQuads() when it gives the same result as calling IsQuadNeeded for each pair of voxels.
+	template<typename VolumeType, typename IsQuadNeeded>
+	void findQuads(VolumeType* volData, const Region& region, IsQuadNeeded& isQuadNeeded, bool bMergeQuads, std::vector< MergedQuad<typename VolumeType::VoxelType> >& vecQuads, ExtractionContext& context)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+		findQuads(volData, region, isQuadNeeded, bMergeQuads, vecQuads, context, std::integral_constant<bool,
+			std::is_same<IsQuadNeeded, DefaultIsQuadNeeded<VoxelType> >::value && HasBinaryOccupancy<VoxelType>::value>());
 	}
 
 	/// The CubicSurfaceExtractor creates a mesh in which each voxel appears to be rendered as a cube
@@ -236,7 +874,7 @@ namespace PolyVox
 	///
 	/// **Note:** *This behaviour has changed recently (September 2012). Earlier versions of PolyVox tried to be smart about this problem by looking beyond the region which was being processed, but this complicated the code and didn't work very well. Ultimatly we decided to simply stick with the convention outlined above.*
 	///
-	/// One of the practical implications of this is that when you modify a voxel *you may have to re-extract the mesh for regions other than region which actually contains the voxel you modified.* This happens when the voxel lies on the upper x,y or z face of a region. Assuming that you have some management code which can mark a region as needing re-extraction when a voxel changes, you should probably extend this to mark the regions of neighbouring voxels as invalid (this will have no effect when the voxel is well within a region, but will mark the neighbouring region as needing an update if the voxel lies on a region face).
+	/// One of the practical implications of this is that when you modify a voxel *you may have to re-extract the mesh for regions other than region which actually contains the voxel you modified.* This happens when the voxel lies on the upper x,y or z face of a region. Assuming that you have some management code which can mark a region as needing re-extraction when a voxel changes, you should probably extend this to mark the regions of neighbouring voxels as invalid (this will have no effect when the voxel is well within a region, but will mark the neighbouring region as needing an update if the voxel lies on a region face). The RemeshScheduler can do this for you, using the changes recorded by a VolumeChangeTracker.
 	///
 	/// Another scenario which sometimes results in confusion is when you wish to extract a region which corresponds to the whole volume, partcularly when solid voxels extend right to the edge of the volume.  
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -254,18 +892,28 @@ namespace PolyVox
 	///   1. It leaves the user in control of memory allocation and would allow them to implement e.g. a mesh pooling system.
 	///   2. The user-provided mesh could have a different index type (e.g. 16-bit indices) to reduce memory usage.
 	///   3. The user could provide a custom mesh class, e.g a thin wrapper around an openGL VBO to allow direct writing into this structure.
+	///      BufferMesh writes into any buffer in this way, and MeshCounter can be used to find the required size beforehand.
 	///
 	/// We don't provide a default MeshType here. If the user doesn't want to provide a MeshType then it probably makes
 	/// more sense to use the other variant of this function where the mesh is a return value rather than a parameter.
 	///
+	/// If bMergeQuads is true then neighbouring faces which lie in the same plane and have the same material are merged into larger quads
+	/// (see mergeFacesGreedily()). This greatly reduces the size of the mesh for most volumes, and usually makes the extraction faster too.
+	///
+	/// If an ExtractionContext is provided then the scratch memory used during the extraction is taken from it rather than being allocated
+	/// by each call, in the same way as for extractMarchingCubesMeshCustom().
+	///
 	/// Note: This function is called 'extractCubicMeshCustom' rather than 'extractCubicMesh' to avoid ambiguity when only three parameters
 	/// are provided (would the third parameter be a controller or a mesh?). It seems this can be fixed by using enable_if/static_assert to emulate concepts,
 	/// but this is relatively complex and I haven't done it yet. Could always add it later as another overload.
 	template<typename VolumeType, typename MeshType, typename IsQuadNeeded>
-	void extractCubicMeshCustom(VolumeType* volData, Region region, MeshType* result, IsQuadNeeded isQuadNeeded, bool bMergeQuads)
+	void extractCubicMeshCustom(VolumeType* volData, Region region, MeshType* result, IsQuadNeeded isQuadNeeded, bool bMergeQuads, ExtractionContext* pContext)
 	{
-		// This extractor has a limit as to how large the extracted region can be, because the vertex positions are encoded with a single byte per component.
-		int32_t maxReionDimensionInVoxels = 255;
+		// This extractor has a limit as to how large the extracted region can be, because of the way the vertex positions are encoded (see CubicVertex).
+		typedef typename MeshType::VertexType::PositionComponentType PositionComponentType;
+		static_assert(std::numeric_limits<PositionComponentType>::is_integer && !std::numeric_limits<PositionComponentType>::is_signed && (sizeof(PositionComponentType) <= 2),
+			"The vertex positions must be encoded as 8 or 16 bit unsigned integers.");
+		int32_t maxReionDimensionInVoxels = (std::numeric_limits<PositionComponentType>::max)();
 		POLYVOX_THROW_IF(region.getWidthInVoxels() > maxReionDimensionInVoxels, std::invalid_argument, "Requested extraction region exceeds maximum dimensions");
 		POLYVOX_THROW_IF(region.getHeightInVoxels() > maxReionDimensionInVoxels, std::invalid_argument, "Requested extraction region exceeds maximum dimensions");
 		POLYVOX_THROW_IF(region.getDepthInVoxels() > maxReionDimensionInVoxels, std::invalid_argument, "Requested extraction region exceeds maximum dimensions");
@@ -273,147 +921,27 @@ namespace PolyVox
 		Timer timer;
 		result->clear();
 
-		//Used to avoid creating duplicate vertices.
-		Array<3, IndexAndMaterial<VolumeType> > m_previousSliceVertices(region.getUpperX() - region.getLowerX() + 2, region.getUpperY() - region.getLowerY() + 2, MaxVerticesPerPosition);
-		Array<3, IndexAndMaterial<VolumeType> > m_currentSliceVertices(region.getUpperX() - region.getLowerX() + 2, region.getUpperY() - region.getLowerY() + 2, MaxVerticesPerPosition);
-
-		//During extraction we create a number of different lists of quads. All the 
-		//quads in a given list are in the same plane and facing in the same direction.
-		std::vector< std::list<Quad> > m_vecQuads[NoOfFaces];
-
-
-		memset(m_previousSliceVertices.getRawData(), 0xff, m_previousSliceVertices.getNoOfElements() * sizeof(IndexAndMaterial<VolumeType>));
-		memset(m_currentSliceVertices.getRawData(), 0xff, m_currentSliceVertices.getNoOfElements() * sizeof(IndexAndMaterial<VolumeType>));
-
-		m_vecQuads[NegativeX].resize(region.getUpperX() - region.getLowerX() + 2);
-		m_vecQuads[PositiveX].resize(region.getUpperX() - region.getLowerX() + 2);
-
-		m_vecQuads[NegativeY].resize(region.getUpperY() - region.getLowerY() + 2);
-		m_vecQuads[PositiveY].resize(region.getUpperY() - region.getLowerY() + 2);
-
-		m_vecQuads[NegativeZ].resize(region.getUpperZ() - region.getLowerZ() + 2);
-		m_vecQuads[PositiveZ].resize(region.getUpperZ() - region.getLowerZ() + 2);
-
-		typename VolumeType::Sampler volumeSampler(volData);
-
-		for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		// Quads are only placed between voxels with different values, so if the volume knows that the region is uniform
+		// then there is nothing to extract. Each voxel is also compared with its neighbours on the negative side, so
+		// these must be included in the check.
+		typename VolumeType::VoxelType tUniformValue;
+		const Region regionWithNeighbours(region.getLowerCorner() - Vector3DInt32(1, 1, 1), region.getUpperCorner());
+		if (volData->isRegionUniform(regionWithNeighbours, tUniformValue) || !areQuadsPossible<VolumeType, IsQuadNeeded>(volData, regionWithNeighbours))
 		{
-			uint32_t regZ = z - region.getLowerZ();
-
-			for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
-			{
-				uint32_t regY = y - region.getLowerY();
-
-				volumeSampler.setPosition(region.getLowerX(), y, z);
-
-				for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
-				{
-					uint32_t regX = x - region.getLowerX();
-
-					typename VolumeType::VoxelType material; //Filled in by callback
-					typename VolumeType::VoxelType currentVoxel = volumeSampler.getVoxel();
-					typename VolumeType::VoxelType negXVoxel = volumeSampler.peekVoxel1nx0py0pz();
-					typename VolumeType::VoxelType negYVoxel = volumeSampler.peekVoxel0px1ny0pz();
-					typename VolumeType::VoxelType negZVoxel = volumeSampler.peekVoxel0px0py1nz();
-
-					// X
-					if (isQuadNeeded(currentVoxel, negXVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX, regY, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v2 = addVertex(regX, regY + 1, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v3 = addVertex(regX, regY + 1, regZ, material, m_previousSliceVertices, result);
-
-						m_vecQuads[NegativeX][regX].push_back(Quad(v0, v1, v2, v3));
-					}
-
-					if (isQuadNeeded(negXVoxel, currentVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX, regY, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v2 = addVertex(regX, regY + 1, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v3 = addVertex(regX, regY + 1, regZ, material, m_previousSliceVertices, result);
-
-						m_vecQuads[PositiveX][regX].push_back(Quad(v0, v3, v2, v1));
-					}
-
-					// Y
-					if (isQuadNeeded(currentVoxel, negYVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX + 1, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v2 = addVertex(regX + 1, regY, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v3 = addVertex(regX, regY, regZ + 1, material, m_currentSliceVertices, result);
-
-						m_vecQuads[NegativeY][regY].push_back(Quad(v0, v1, v2, v3));
-					}
-
-					if (isQuadNeeded(negYVoxel, currentVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX + 1, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v2 = addVertex(regX + 1, regY, regZ + 1, material, m_currentSliceVertices, result);
-						uint32_t v3 = addVertex(regX, regY, regZ + 1, material, m_currentSliceVertices, result);
-
-						m_vecQuads[PositiveY][regY].push_back(Quad(v0, v3, v2, v1));
-					}
-
-					// Z
-					if (isQuadNeeded(currentVoxel, negZVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX, regY + 1, regZ, material, m_previousSliceVertices, result);
-						uint32_t v2 = addVertex(regX + 1, regY + 1, regZ, material, m_previousSliceVertices, result);
-						uint32_t v3 = addVertex(regX + 1, regY, regZ, material, m_previousSliceVertices, result);
-
-						m_vecQuads[NegativeZ][regZ].push_back(Quad(v0, v1, v2, v3));
-					}
-
-					if (isQuadNeeded(negZVoxel, currentVoxel, material))
-					{
-						uint32_t v0 = addVertex(regX, regY, regZ, material, m_previousSliceVertices, result);
-						uint32_t v1 = addVertex(regX, regY + 1, regZ, material, m_previousSliceVertices, result);
-						uint32_t v2 = addVertex(regX + 1, regY + 1, regZ, material, m_previousSliceVertices, result);
-						uint32_t v3 = addVertex(regX + 1, regY, regZ, material, m_previousSliceVertices, result);
-
-						m_vecQuads[PositiveZ][regZ].push_back(Quad(v0, v3, v2, v1));
-					}
-
-					volumeSampler.movePositiveX();
-				}
-			}
-
-			m_previousSliceVertices.swap(m_currentSliceVertices);
-			memset(m_currentSliceVertices.getRawData(), 0xff, m_currentSliceVertices.getNoOfElements() * sizeof(IndexAndMaterial<VolumeType>));
+			result->setOffset(region.getLowerCorner());
+			return;
 		}
 
-		for (uint32_t uFace = 0; uFace < NoOfFaces; uFace++)
-		{
-			std::vector< std::list<Quad> >& vecListQuads = m_vecQuads[uFace];
+		ExtractionContext localContext;
+		ExtractionContext& context = pContext ? *pContext : localContext;
 
-			for (uint32_t slice = 0; slice < vecListQuads.size(); slice++)
-			{
-				std::list<Quad>& listQuads = vecListQuads[slice];
-
-				if (bMergeQuads)
-				{
-					//Repeatedly call this function until it returns
-					//false to indicate nothing more can be done.
-					while (performQuadMerging(listQuads, result)){}
-				}
+		std::vector< MergedQuad<typename VolumeType::VoxelType> >& vecQuads = context.getBuffer< MergedQuad<typename VolumeType::VoxelType> >(CubicBuffers::Quads);
+		vecQuads.clear();
+		findQuads(volData, region, isQuadNeeded, bMergeQuads, vecQuads, context);
 
-				typename std::list<Quad>::iterator iterEnd = listQuads.end();
-				for (typename std::list<Quad>::iterator quadIter = listQuads.begin(); quadIter != iterEnd; quadIter++)
-				{
-					Quad& quad = *quadIter;
-					result->addTriangle(quad.vertices[0], quad.vertices[1], quad.vertices[2]);
-					result->addTriangle(quad.vertices[0], quad.vertices[2], quad.vertices[3]);
-				}
-			}
-		}
+		addMergedQuadsToMesh(vecQuads, result, context);
 
 		result->setOffset(region.getLowerCorner());
-		result->removeUnusedVertices();
 
 		POLYVOX_LOG_TRACE("Cubic surface extraction took ", timer.elapsedTimeInMilliSeconds(),
 			"ms (Region size = ", m_regSizeInVoxels.getWidthInVoxels(), "x", m_regSizeInVoxels.getHeightInVoxels(),
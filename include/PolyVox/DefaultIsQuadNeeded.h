@@ -28,6 +28,7 @@
 #include "Impl/PlatformDefinitions.h"
 
 #include <cstdint>
+#include <type_traits>
 
 namespace PolyVox
 {
@@ -46,7 +47,7 @@ namespace PolyVox
 	public:
 		bool operator()(VoxelType back, VoxelType front, VoxelType& materialToUse)
 		{
-			if ((back > 0) && (front == 0))
+			if (isSolid(back) && isEmpty(front))
 			{
 				materialToUse = static_cast<VoxelType>(back);
 				return true;
@@ -56,6 +57,26 @@ namespace PolyVox
 				return false;
 			}
 		}
+
+		/// Whether a voxel can be behind a quad.
+		static bool isSolid(VoxelType voxel)
+		{
+			return voxel > 0;
+		}
+
+		/// Whether a voxel can be in front of a quad.
+		static bool isEmpty(VoxelType voxel)
+		{
+			return voxel == 0;
+		}
+	};
+
+	/// Indicates that the DefaultIsQuadNeeded for a voxel type only depends on whether each voxel is solid or empty (see
+	/// DefaultIsQuadNeeded::isSolid() and isEmpty()), which allows the cubic surface extractor to process many voxels at once.
+	/// This is the case for integer voxel types, and specialisations of DefaultIsQuadNeeded should also specialise this.
+	template<typename VoxelType>
+	struct HasBinaryOccupancy : std::is_integral<VoxelType>
+	{
 	};
 }
 
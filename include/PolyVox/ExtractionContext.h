@@ -0,0 +1,120 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_ExtractionContext_H__
+#define __PolyVox_ExtractionContext_H__
+
+#include "Impl/PlatformDefinitions.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PolyVox
+{
+	/// Holds the scratch buffers which the surface extractors use while they are running, so that they can be reused by the next
+	/// extraction instead of being allocated again. Once a context has been used to extract a region, further extractions of regions
+	/// of the same size (or smaller) into a mesh which has been used before (see MeshPool) do not allocate any memory.
+	///
+	/// A context may be shared by extractCubicMeshCustom() and extractMarchingCubesMeshCustom(), and by volumes with different voxel
+	/// types, as each buffer is identified by its element type as well as by its id. It is not thread safe, so when extracting on
+	/// several threads each thread should have a context of its own. The buffers only ever grow, and releaseBuffers() can be used to
+	/// free them after extracting an unusually large region.
+	class ExtractionContext
+	{
+	public:
+		ExtractionContext();
+		ExtractionContext(const ExtractionContext&) = delete;
+		ExtractionContext& operator=(const ExtractionContext&) = delete;
+
+		/// Gets the buffer with the given element type and id, creating an empty one if it does not exist yet. The contents are
+		/// whatever the previous user left there, so the caller is expected to assign() or resize() it before use.
+		template <typename ElementType>
+		std::vector<ElementType>& getBuffer(uint32_t uBufferId);
+
+		void releaseBuffers(void);
+
+		uint32_t getNoOfBuffers(void) const;
+		size_t calculateSizeInBytes(void) const;
+
+	private:
+		// Each element type is identified by the address of its own static member, which avoids the need for RTTI.
+		template <typename ElementType>
+		struct BufferTypeTag
+		{
+			static const char uTag;
+		};
+
+		struct BufferBase
+		{
+			virtual ~BufferBase() {}
+			virtual size_t calculateSizeInBytes(void) const = 0;
+
+			const char* pTypeTag;
+			uint32_t uBufferId;
+		};
+
+		template <typename ElementType>
+		struct Buffer : public BufferBase
+		{
+			size_t calculateSizeInBytes(void) const { return vecElements.capacity() * sizeof(ElementType); }
+
+			std::vector<ElementType> vecElements;
+		};
+
+		std::vector< std::unique_ptr<BufferBase> > m_vecBuffers;
+	};
+
+	/// Keeps meshes which are no longer needed so that they can be handed out again, along with the memory they have already allocated.
+	/// This is intended for applications which repeatedly extract meshes (e.g. as the volume is edited, see RemeshScheduler) and then
+	/// throw away the previous mesh for the same block. Meshes are cleared when they are released, but keep their capacity.
+	///
+	/// Unlike the ExtractionContext the pool is thread safe, as meshes are often extracted on one thread and released on another
+	/// (for example once they have been uploaded to the GPU).
+	template <typename MeshType>
+	class MeshPool
+	{
+	public:
+		MeshPool(uint32_t uMaxNoOfFreeMeshes = 64);
+		MeshPool(const MeshPool&) = delete;
+		MeshPool& operator=(const MeshPool&) = delete;
+
+		std::unique_ptr<MeshType> acquireMesh(void);
+		void releaseMesh(std::unique_ptr<MeshType> pMesh);
+
+		void releaseFreeMeshes(void);
+
+		uint32_t getNoOfFreeMeshes(void) const;
+
+	private:
+		mutable std::mutex m_mutex;
+		std::vector< std::unique_ptr<MeshType> > m_vecFreeMeshes;
+		uint32_t m_uMaxNoOfFreeMeshes;
+	};
+}
+
+#include "ExtractionContext.inl"
+
+#endif //__PolyVox_ExtractionContext_H__
@@ -0,0 +1,160 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include <utility>
+
+namespace PolyVox
+{
+	template <typename ElementType>
+	const char ExtractionContext::BufferTypeTag<ElementType>::uTag = 0;
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Creates a context without any buffers. These are created by the first extraction which uses it.
+	////////////////////////////////////////////////////////////////////////////////
+	inline ExtractionContext::ExtractionContext()
+	{
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// There are only a few buffers in a context, so they are simply searched in order. A buffer with the same id but a different
+	/// element type is a different buffer.
+	/// \param uBufferId The id of the buffer, which only needs to be unique amongst the buffers with the same element type.
+	/// \return The buffer, which keeps its capacity between calls.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename ElementType>
+	std::vector<ElementType>& ExtractionContext::getBuffer(uint32_t uBufferId)
+	{
+		const char* pTypeTag = &BufferTypeTag<ElementType>::uTag;
+		for (const std::unique_ptr<BufferBase>& pBuffer : m_vecBuffers)
+		{
+			if ((pBuffer->pTypeTag == pTypeTag) && (pBuffer->uBufferId == uBufferId))
+			{
+				return static_cast<Buffer<ElementType>*>(pBuffer.get())->vecElements;
+			}
+		}
+
+		Buffer<ElementType>* pBuffer = new Buffer<ElementType>;
+		pBuffer->pTypeTag = pTypeTag;
+		pBuffer->uBufferId = uBufferId;
+		m_vecBuffers.push_back(std::unique_ptr<BufferBase>(pBuffer));
+		return pBuffer->vecElements;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Frees all of the buffers. The context can still be used afterwards, but the next extraction will allocate them again.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void ExtractionContext::releaseBuffers(void)
+	{
+		std::vector< std::unique_ptr<BufferBase> >().swap(m_vecBuffers);
+	}
+
+	inline uint32_t ExtractionContext::getNoOfBuffers(void) const
+	{
+		return static_cast<uint32_t>(m_vecBuffers.size());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The memory allocated for the buffers, which is based on their capacity rather than the size last used.
+	////////////////////////////////////////////////////////////////////////////////
+	inline size_t ExtractionContext::calculateSizeInBytes(void) const
+	{
+		size_t uSizeInBytes = sizeof(ExtractionContext) + m_vecBuffers.capacity() * sizeof(std::unique_ptr<BufferBase>);
+		for (const std::unique_ptr<BufferBase>& pBuffer : m_vecBuffers)
+		{
+			uSizeInBytes += pBuffer->calculateSizeInBytes();
+		}
+		return uSizeInBytes;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param uMaxNoOfFreeMeshes The number of released meshes which the pool keeps. Meshes released beyond this are destroyed.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename MeshType>
+	MeshPool<MeshType>::MeshPool(uint32_t uMaxNoOfFreeMeshes)
+		:m_uMaxNoOfFreeMeshes(uMaxNoOfFreeMeshes)
+	{
+		m_vecFreeMeshes.reserve(uMaxNoOfFreeMeshes);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return One of the free meshes if there are any, or a new mesh otherwise. In either case the mesh is empty.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename MeshType>
+	std::unique_ptr<MeshType> MeshPool<MeshType>::acquireMesh(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_vecFreeMeshes.empty())
+			{
+				std::unique_ptr<MeshType> pMesh = std::move(m_vecFreeMeshes.back());
+				m_vecFreeMeshes.pop_back();
+				return pMesh;
+			}
+		}
+
+		return std::unique_ptr<MeshType>(new MeshType);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Returns a mesh to the pool so that it can be handed out again by acquireMesh(). It does not need to have come from this pool.
+	/// \param pMesh The mesh, which is cleared before being added to the pool.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename MeshType>
+	void MeshPool<MeshType>::releaseMesh(std::unique_ptr<MeshType> pMesh)
+	{
+		if (!pMesh)
+		{
+			return;
+		}
+
+		// The mesh is cleared (and if necessary destroyed) outside of the lock.
+		pMesh->clear();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_vecFreeMeshes.size() < m_uMaxNoOfFreeMeshes)
+		{
+			m_vecFreeMeshes.push_back(std::move(pMesh));
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Destroys all of the free meshes, freeing their memory. Meshes which have been acquired are unaffected.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename MeshType>
+	void MeshPool<MeshType>::releaseFreeMeshes(void)
+	{
+		std::vector< std::unique_ptr<MeshType> > vecFreeMeshes;
+		vecFreeMeshes.reserve(m_uMaxNoOfFreeMeshes);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_vecFreeMeshes.swap(vecFreeMeshes);
+		}
+	}
+
+	template <typename MeshType>
+	uint32_t MeshPool<MeshType>::getNoOfFreeMeshes(void) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return static_cast<uint32_t>(m_vecFreeMeshes.size());
+	}
+}
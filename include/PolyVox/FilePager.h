@@ -27,14 +27,21 @@
 
 #include "Impl/PlatformDefinitions.h"
 
+#include "Impl/Utility.h"
+
+#include "ChunkCodec.h"
 #include "PagedVolume.h"
 #include "Region.h"
 
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <fstream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace PolyVox
@@ -43,18 +50,25 @@ namespace PolyVox
 	 * An implementation of Pager which stores voxels to files on disk. Each chunk is written
 	 * to a seperate file and you can specify the name of a folder where these will be stored.
 	 *
-	 * Note that no compression is performed (mostly to avoid dependancies) so for large
-	 * volumes you may want to consider this class as an example and create a custom version
-	 * with compression.
+	 * This class is intended for testing and as an example of writing a Pager. The files are given unique names
+	 * for each run and are deleted when the FilePager is destroyed, so nothing it writes survives the run. Use the
+	 * RegionFilePager to keep the volume's data between runs.
+	 *
+	 * The data is compressed by a ChunkCodec, which defaults to a RunLengthCodec. Each file starts with a header
+	 * recording the format version, the codec and a checksum of the compressed data, so that data which was written
+	 * by a different codec (or damaged) is detected rather than silently loaded into the volume.
+	 *
+	 * The FilePager can be used with a PagedVolume which has concurrent access enabled.
 	 */
 	template <typename VoxelType>
 	class FilePager : public PagedVolume<VoxelType>::Pager
 	{
 	public:
-		/// Constructor
-		FilePager(const std::string& strFolderName = ".")
+		/// Constructor. If a codec is provided then it must outlive the FilePager.
+		FilePager(const std::string& strFolderName = ".", ChunkCodec<VoxelType>* pCodec = nullptr)
 			:PagedVolume<VoxelType>::Pager()
 			, m_strFolderName(strFolderName)
+			, m_pCodec(pCodec ? pCodec : &m_defaultCodec)
 		{
 				// Add the trailing slash, assuming the user dind't already do it.
 				if ((m_strFolderName.back() != '/') && (m_strFolderName.back() != '\\'))
@@ -70,15 +84,15 @@ namespace PolyVox
 				m_strPostfix = ss.str();
 		}
 
-		/// Destructor
+		/// Destructor. This deletes all the files which have been written.
 		virtual ~FilePager()
 		{
-			for (std::vector<std::string>::iterator iter = m_vecCreatedFiles.begin(); iter < m_vecCreatedFiles.end(); iter++)
+			for (std::unordered_set<std::string>::iterator iter = m_setCreatedFiles.begin(); iter != m_setCreatedFiles.end(); iter++)
 			{
 				POLYVOX_LOG_WARNING_IF(std::remove(iter->c_str()) != 0, "Failed to delete '", *iter, "' when destroying FilePager");
 			}
 
-			m_vecCreatedFiles.clear();
+			m_setCreatedFiles.clear();
 		}
 
 		virtual void pageIn(const Region& region, typename PagedVolume<VoxelType>::Chunk* pChunk)
@@ -102,23 +116,38 @@ namespace PolyVox
 			{
 				POLYVOX_LOG_TRACE("Paging in data for ", region);
 
-				/*fseek(pFile, 0L, SEEK_END);
-				size_t fileSizeInBytes = ftell(pFile);
-				fseek(pFile, 0L, SEEK_SET);
-
-				uint8_t* buffer = new uint8_t[fileSizeInBytes];
-				fread(buffer, sizeof(uint8_t), fileSizeInBytes, pFile);
-				pChunk->setData(buffer, fileSizeInBytes);
-				delete[] buffer;*/
-
-				fread(pChunk->getData(), sizeof(uint8_t), pChunk->getDataSizeInBytes(), pFile);
-
-				if (ferror(pFile))
+				FileHeader header;
+				std::vector<uint8_t> vecEncodedData;
+				// The header is checked before its sizes are trusted.
+				bool bValid = (fread(&header, sizeof(header), 1, pFile) == 1) &&
+					(std::memcmp(header.acMagic, "PVCF", sizeof(header.acMagic)) == 0) && (header.uVersion == uFileVersion);
+				const bool bSameCodec = bValid && (header.uCodecId == m_pCodec->getId());
+				const bool bSameSize = bValid && (header.uDecodedSizeInBytes == pChunk->getDataSizeInBytes());
+				if (bValid && bSameCodec && bSameSize)
 				{
-					POLYVOX_THROW(std::runtime_error, "Error reading in chunk data, even though a file exists.");
+					// A damaged header could ask for up to 4Gb, so the size of the encoded data is checked against the rest
+					// of the file and against the most the codec can write for the chunk before any memory is allocated.
+					const long iDataStart = ftell(pFile);
+					bValid = (iDataStart >= 0) && (fseek(pFile, 0, SEEK_END) == 0);
+					const long iFileSize = bValid ? ftell(pFile) : -1;
+					bValid = bValid && (iFileSize >= iDataStart) && (header.uEncodedSizeInBytes <= static_cast<unsigned long>(iFileSize - iDataStart)) &&
+						(header.uEncodedSizeInBytes <= m_pCodec->getMaxEncodedSizeInBytes(pChunk->getDataSizeInBytes() / sizeof(VoxelType))) &&
+						(fseek(pFile, iDataStart, SEEK_SET) == 0);
+					if (bValid)
+					{
+						vecEncodedData.resize(header.uEncodedSizeInBytes);
+						bValid = (header.uEncodedSizeInBytes == 0) || (fread(&(vecEncodedData[0]), header.uEncodedSizeInBytes, 1, pFile) == 1);
+					}
 				}
 
 				fclose(pFile);
+
+				POLYVOX_THROW_IF(!bValid, std::runtime_error, "Error reading in chunk data for ", region, ", the file is damaged or has an unrecognised format.");
+				POLYVOX_THROW_IF(!bSameCodec, std::runtime_error, "Chunk data for ", region, " was written with a different codec.");
+				POLYVOX_THROW_IF(!bSameSize, std::runtime_error, "Chunk data for ", region, " has the wrong size.");
+				POLYVOX_THROW_IF(header.uChecksum != calculateChecksum(vecEncodedData.data(), vecEncodedData.size()), std::runtime_error, "Chunk data for ", region, " is corrupt.");
+
+				m_pCodec->decode(vecEncodedData.data(), vecEncodedData.size(), pChunk->getData(), pChunk->getDataSizeInBytes() / sizeof(VoxelType));
 			}
 			else
 			{
@@ -138,6 +167,18 @@ namespace PolyVox
 
 			POLYVOX_LOG_TRACE("Paging out data for ", region);
 
+			// Compress the data before opening the file, so that the file is open for as short a time as possible.
+			std::vector<uint8_t> vecEncodedData;
+			m_pCodec->encode(pChunk->getData(), pChunk->getDataSizeInBytes() / sizeof(VoxelType), vecEncodedData);
+
+			FileHeader header;
+			std::memcpy(header.acMagic, "PVCF", sizeof(header.acMagic));
+			header.uVersion = uFileVersion;
+			header.uCodecId = m_pCodec->getId();
+			header.uDecodedSizeInBytes = pChunk->getDataSizeInBytes();
+			header.uEncodedSizeInBytes = static_cast<uint32_t>(vecEncodedData.size());
+			header.uChecksum = calculateChecksum(vecEncodedData.data(), vecEncodedData.size());
+
 			std::stringstream ssFilename;
 			ssFilename << m_strFolderName << "/"
 				<< region.getLowerX() << "_" << region.getLowerY() << "_" << region.getLowerZ() << "_"
@@ -155,24 +196,44 @@ namespace PolyVox
 				POLYVOX_THROW(std::runtime_error, "Unable to open file to write out chunk data.");
 			}
 
-			//The file has been created, so add it to the list to delete on shutdown.
-			m_vecCreatedFiles.push_back(filename);
-
-			fwrite(pChunk->getData(), sizeof(uint8_t), pChunk->getDataSizeInBytes(), pFile);
-
-			if (ferror(pFile))
+			//The file has been created, so add it to the set to delete on shutdown. A chunk may be paged out many
+			//times (e.g. as it is evicted and paged in again), but each file only needs to be deleted once.
 			{
-				POLYVOX_THROW(std::runtime_error, "Error writing out chunk data.");
+				std::lock_guard<std::mutex> lock(m_mutexCreatedFiles);
+				m_setCreatedFiles.insert(filename);
 			}
 
+			fwrite(&header, sizeof(header), 1, pFile);
+			fwrite(vecEncodedData.data(), sizeof(uint8_t), vecEncodedData.size(), pFile);
+
+			const bool bError = ferror(pFile) != 0;
 			fclose(pFile);
+			POLYVOX_THROW_IF(bError, std::runtime_error, "Error writing out chunk data.");
 		}
 
 	protected:
+		static const uint32_t uFileVersion = 1;
+
+		// Written at the start of each file. The checksum is of the encoded data which follows it.
+		struct FileHeader
+		{
+			char acMagic[4];
+			uint32_t uVersion;
+			uint32_t uCodecId;
+			uint32_t uDecodedSizeInBytes;
+			uint32_t uEncodedSizeInBytes;
+			uint32_t uChecksum;
+		};
+
 		std::string m_strFolderName;
 		std::string m_strPostfix;
 
-		std::vector<std::string> m_vecCreatedFiles;
+		std::unordered_set<std::string> m_setCreatedFiles;
+		// Chunks may be paged out from several threads at once.
+		std::mutex m_mutexCreatedFiles;
+
+		RunLengthCodec<VoxelType> m_defaultCodec;
+		ChunkCodec<VoxelType>* m_pCodec;
 	};
 }
 
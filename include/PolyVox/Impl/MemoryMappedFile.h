@@ -0,0 +1,266 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_MemoryMappedFile_H__
+#define __PolyVox_MemoryMappedFile_H__
+
+#include "ErrorHandling.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace PolyVox
+{
+	// A file which is mapped into memory for reading and writing. This hides the differences between the
+	// Windows and POSIX APIs, and lets the file be resized (which on both platforms means mapping it again).
+	// Any pointer previously returned by getData() is invalidated when the file is resized or closed.
+	class MemoryMappedFile
+	{
+	public:
+		MemoryMappedFile()
+			:m_pData(nullptr)
+			, m_uSizeInBytes(0)
+#if defined(_WIN32)
+			, m_hFile(INVALID_HANDLE_VALUE)
+			, m_hMapping(NULL)
+#else
+			, m_iFile(-1)
+#endif
+		{
+		}
+
+		~MemoryMappedFile()
+		{
+			close();
+		}
+
+		// Returns false if the file does not exist and 'bCreate' is not set.
+		bool open(const std::string& strFilename, bool bCreate)
+		{
+			close();
+
+#if defined(_WIN32)
+			m_hFile = CreateFileA(strFilename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				bCreate ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (m_hFile == INVALID_HANDLE_VALUE)
+			{
+				POLYVOX_THROW_IF(bCreate || (GetLastError() != ERROR_FILE_NOT_FOUND), std::runtime_error, "Unable to open '", strFilename, "'.");
+				return false;
+			}
+
+			LARGE_INTEGER size;
+			POLYVOX_THROW_IF(!GetFileSizeEx(m_hFile, &size), std::runtime_error, "Unable to get the size of '", strFilename, "'.");
+			m_uSizeInBytes = static_cast<uint64_t>(size.QuadPart);
+#else
+			m_iFile = ::open(strFilename.c_str(), bCreate ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+			if (m_iFile == -1)
+			{
+				POLYVOX_THROW_IF(bCreate || (errno != ENOENT), std::runtime_error, "Unable to open '", strFilename, "'.");
+				return false;
+			}
+
+			struct stat fileStatus;
+			POLYVOX_THROW_IF(fstat(m_iFile, &fileStatus) != 0, std::runtime_error, "Unable to get the size of '", strFilename, "'.");
+			m_uSizeInBytes = static_cast<uint64_t>(fileStatus.st_size);
+#endif
+
+			map();
+			return true;
+		}
+
+		void close(void)
+		{
+			unmap();
+
+#if defined(_WIN32)
+			if (m_hFile != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(m_hFile);
+				m_hFile = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (m_iFile != -1)
+			{
+				::close(m_iFile);
+				m_iFile = -1;
+			}
+#endif
+
+			m_uSizeInBytes = 0;
+		}
+
+		bool isOpen(void) const
+		{
+#if defined(_WIN32)
+			return m_hFile != INVALID_HANDLE_VALUE;
+#else
+			return m_iFile != -1;
+#endif
+		}
+
+		uint8_t* getData(void) const
+		{
+			return m_pData;
+		}
+
+		uint64_t getSizeInBytes(void) const
+		{
+			return m_uSizeInBytes;
+		}
+
+		// Any new space is filled with zeros.
+		void resize(uint64_t uSizeInBytes)
+		{
+			POLYVOX_ASSERT(isOpen(), "Cannot resize a file which is not open.");
+
+			unmap();
+
+#if defined(_WIN32)
+			LARGE_INTEGER size;
+			size.QuadPart = static_cast<LONGLONG>(uSizeInBytes);
+			POLYVOX_THROW_IF(!SetFilePointerEx(m_hFile, size, NULL, FILE_BEGIN) || !SetEndOfFile(m_hFile), std::runtime_error, "Unable to resize file.");
+#else
+			POLYVOX_THROW_IF(ftruncate(m_iFile, static_cast<off_t>(uSizeInBytes)) != 0, std::runtime_error, "Unable to resize file.");
+#endif
+
+			m_uSizeInBytes = uSizeInBytes;
+			map();
+		}
+
+		// Blocks until the given part of the file has been written to disk.
+		void flush(uint64_t uOffset, uint64_t uSizeInBytes)
+		{
+			if ((!m_pData) || (uSizeInBytes == 0))
+			{
+				return;
+			}
+
+			POLYVOX_ASSERT(uOffset + uSizeInBytes <= m_uSizeInBytes, "Attempting to flush beyond the end of the file.");
+
+#if defined(_WIN32)
+			POLYVOX_THROW_IF(!FlushViewOfFile(m_pData + uOffset, static_cast<SIZE_T>(uSizeInBytes)) || !FlushFileBuffers(m_hFile),
+				std::runtime_error, "Unable to flush file.");
+#else
+			// The start of the range has to be aligned to a page boundary.
+			const uint64_t uPageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+			const uint64_t uAlignedOffset = uOffset - (uOffset % uPageSize);
+			POLYVOX_THROW_IF(msync(m_pData + uAlignedOffset, static_cast<size_t>(uOffset + uSizeInBytes - uAlignedOffset), MS_SYNC) != 0,
+				std::runtime_error, "Unable to flush file.");
+#endif
+		}
+
+		void flush(void)
+		{
+			flush(0, m_uSizeInBytes);
+		}
+
+		// Replaces one file with another, such that (on platforms which support it) a crash leaves one or the other in place.
+		static void replaceFile(const std::string& strSourceFilename, const std::string& strDestinationFilename)
+		{
+#if defined(_WIN32)
+			POLYVOX_THROW_IF(!MoveFileExA(strSourceFilename.c_str(), strDestinationFilename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH),
+				std::runtime_error, "Unable to replace '", strDestinationFilename, "'.");
+#else
+			POLYVOX_THROW_IF(std::rename(strSourceFilename.c_str(), strDestinationFilename.c_str()) != 0,
+				std::runtime_error, "Unable to replace '", strDestinationFilename, "'.");
+#endif
+		}
+
+	private:
+		// Not copyable, as it owns the file handles.
+		MemoryMappedFile(const MemoryMappedFile&);
+		MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+		void map(void)
+		{
+			// Empty files cannot be mapped.
+			if (m_uSizeInBytes == 0)
+			{
+				return;
+			}
+
+#if defined(_WIN32)
+			m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READWRITE, 0, 0, NULL);
+			POLYVOX_THROW_IF(m_hMapping == NULL, std::runtime_error, "Unable to map file into memory.");
+			m_pData = static_cast<uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+			POLYVOX_THROW_IF(m_pData == nullptr, std::runtime_error, "Unable to map file into memory.");
+#else
+			void* pData = mmap(nullptr, static_cast<size_t>(m_uSizeInBytes), PROT_READ | PROT_WRITE, MAP_SHARED, m_iFile, 0);
+			POLYVOX_THROW_IF(pData == MAP_FAILED, std::runtime_error, "Unable to map file into memory.");
+			m_pData = static_cast<uint8_t*>(pData);
+#endif
+		}
+
+		void unmap(void)
+		{
+#if defined(_WIN32)
+			if (m_pData)
+			{
+				UnmapViewOfFile(m_pData);
+			}
+			if (m_hMapping != NULL)
+			{
+				CloseHandle(m_hMapping);
+				m_hMapping = NULL;
+			}
+#else
+			if (m_pData)
+			{
+				munmap(m_pData, static_cast<size_t>(m_uSizeInBytes));
+			}
+#endif
+			m_pData = nullptr;
+		}
+
+		uint8_t* m_pData;
+		uint64_t m_uSizeInBytes;
+
+#if defined(_WIN32)
+		HANDLE m_hFile;
+		HANDLE m_hMapping;
+#else
+		int m_iFile;
+#endif
+	};
+}
+
+#endif //__PolyVox_MemoryMappedFile_H__
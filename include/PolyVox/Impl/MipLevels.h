@@ -0,0 +1,64 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_MipLevels_H__
+#define __PolyVox_MipLevels_H__
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace PolyVox
+{
+	// The PagedVolume can keep reduced resolution copies of its chunks (see PagedVolume::setNoOfMipLevels()), in which each voxel
+	// summarises a 2x2x2 block of the level below. When they are averaged (MipFilters::Average) primitive voxel types are averaged
+	// (with integers rounded to the nearest value), but other types may not support arithmetic and so just take the value of the
+	// first voxel in the block. Pass CanAverageVoxels<VoxelType>() as the tag.
+	template <typename VoxelType>
+	struct CanAverageVoxels : std::integral_constant<bool, std::is_arithmetic<VoxelType>::value>
+	{
+	};
+
+	// Combines the eight voxels of a 2x2x2 block, which are given in Morton order.
+	template <typename VoxelType>
+	VoxelType downsampleBlock(const VoxelType* pVoxels, std::true_type)
+	{
+		double dSum = 0.0;
+		for (uint32_t uIndex = 0; uIndex < 8; uIndex++)
+		{
+			dSum += static_cast<double>(pVoxels[uIndex]);
+		}
+
+		const double dAverage = dSum / 8.0;
+		return static_cast<VoxelType>(std::is_integral<VoxelType>::value ? std::floor(dAverage + 0.5) : dAverage);
+	}
+
+	template <typename VoxelType>
+	VoxelType downsampleBlock(const VoxelType* pVoxels, std::false_type)
+	{
+		return pVoxels[0];
+	}
+}
+
+#endif //__PolyVox_MipLevels_H__
@@ -0,0 +1,161 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_PaletteEncoding_H__
+#define __PolyVox_PaletteEncoding_H__
+
+#include "ErrorHandling.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace PolyVox
+{
+	// Palette encoding stores each distinct value once (in the palette) and replaces every element of the data with the
+	// position of its value in the palette. The positions are packed into bytes using 1, 2, 4 or 8 bits each, as required
+	// by the size of the palette, so at most 256 distinct values can be encoded. Unlike run length encoding, individual
+	// elements can be read and written without decoding the rest of the data. The size of the packed indices is passed
+	// around as a power of two (so 0 to 3) which lets the packing be done entirely with shifts and masks.
+	const uint32_t uMaxPaletteSize = 256;
+
+	// The smallest index size (as a power of two number of bits) which can address a palette of the given size.
+	inline uint8_t paletteIndexSizePower(uint32_t uPaletteSize)
+	{
+		POLYVOX_ASSERT(uPaletteSize <= uMaxPaletteSize, "Palette is too large to be indexed.");
+		return (uPaletteSize <= 2) ? 0 : (uPaletteSize <= 4) ? 1 : (uPaletteSize <= 16) ? 2 : 3;
+	}
+
+	// The number of bytes needed to store the given number of packed indices.
+	inline uint32_t paletteIndicesSizeInBytes(uint32_t uLength, uint8_t uIndexSizePower)
+	{
+		const uint32_t uIndicesPerBytePower = 3 - uIndexSizePower;
+		return (uLength + (1u << uIndicesPerBytePower) - 1) >> uIndicesPerBytePower;
+	}
+
+	inline uint32_t getPaletteIndex(const std::vector<uint8_t>& vecIndices, uint8_t uIndexSizePower, uint32_t uPosition)
+	{
+		const uint32_t uIndicesPerBytePower = 3 - uIndexSizePower;
+		const uint32_t uShift = (uPosition & ((1u << uIndicesPerBytePower) - 1)) << uIndexSizePower;
+		const uint32_t uMask = (1u << (1u << uIndexSizePower)) - 1;
+		return (vecIndices[uPosition >> uIndicesPerBytePower] >> uShift) & uMask;
+	}
+
+	inline void setPaletteIndex(std::vector<uint8_t>& vecIndices, uint8_t uIndexSizePower, uint32_t uPosition, uint32_t uIndex)
+	{
+		const uint32_t uIndicesPerBytePower = 3 - uIndexSizePower;
+		const uint32_t uShift = (uPosition & ((1u << uIndicesPerBytePower) - 1)) << uIndexSizePower;
+		const uint32_t uMask = (1u << (1u << uIndexSizePower)) - 1;
+		uint8_t& uByte = vecIndices[uPosition >> uIndicesPerBytePower];
+		uByte = static_cast<uint8_t>((uByte & ~(uMask << uShift)) | ((uIndex & uMask) << uShift));
+	}
+
+	// Repacks the indices using a larger number of bits each, so that a larger palette can be addressed.
+	inline void widenPaletteIndices(std::vector<uint8_t>& vecIndices, uint8_t& uIndexSizePower, uint8_t uNewIndexSizePower, uint32_t uLength)
+	{
+		POLYVOX_ASSERT(uNewIndexSizePower >= uIndexSizePower, "Palette indices can only be made wider.");
+		POLYVOX_ASSERT(uNewIndexSizePower <= 3, "Palette indices cannot be wider than a byte.");
+
+		std::vector<uint8_t> vecNewIndices(paletteIndicesSizeInBytes(uLength, uNewIndexSizePower));
+		for (uint32_t uPosition = 0; uPosition < uLength; uPosition++)
+		{
+			setPaletteIndex(vecNewIndices, uNewIndexSizePower, uPosition, getPaletteIndex(vecIndices, uIndexSizePower, uPosition));
+		}
+
+		vecNewIndices.swap(vecIndices);
+		uIndexSizePower = uNewIndexSizePower;
+	}
+
+	// Returns the size of the palette if the value is not in it.
+	template <typename DataType>
+	uint32_t findPaletteIndex(const std::vector<DataType>& vecPalette, const DataType& value)
+	{
+		uint32_t uIndex = 0;
+		while ((uIndex < vecPalette.size()) && !(vecPalette[uIndex] == value))
+		{
+			uIndex++;
+		}
+		return uIndex;
+	}
+
+	// Encodes the data if it contains few enough distinct values, and otherwise returns false and leaves the output unchanged.
+	// As with runLengthEncode() the vectors are sized exactly, as their capacity is used to measure memory usage.
+	template <typename DataType>
+	bool paletteEncode(const DataType* pData, uint32_t uLength, std::vector<DataType>& vecPalette, std::vector<uint8_t>& vecIndices, uint8_t& uIndexSizePower)
+	{
+		// Build the palette first so that we know how wide the indices need to be. Neighbouring elements often have
+		// the same value, so checking the previous one first avoids most of the searching through the palette.
+		std::vector<DataType> vecNewPalette;
+		uint32_t uPreviousIndex = 0;
+		for (uint32_t uPosition = 0; uPosition < uLength; uPosition++)
+		{
+			if ((uPosition > 0) && (vecNewPalette[uPreviousIndex] == pData[uPosition]))
+			{
+				continue;
+			}
+
+			uPreviousIndex = findPaletteIndex(vecNewPalette, pData[uPosition]);
+			if (uPreviousIndex == vecNewPalette.size())
+			{
+				if (vecNewPalette.size() == uMaxPaletteSize)
+				{
+					return false;
+				}
+				vecNewPalette.push_back(pData[uPosition]);
+			}
+		}
+
+		const uint8_t uNewIndexSizePower = paletteIndexSizePower(static_cast<uint32_t>(vecNewPalette.size()));
+		std::vector<uint8_t> vecNewIndices(paletteIndicesSizeInBytes(uLength, uNewIndexSizePower));
+		for (uint32_t uPosition = 0; uPosition < uLength; uPosition++)
+		{
+			if ((uPosition == 0) || !(vecNewPalette[uPreviousIndex] == pData[uPosition]))
+			{
+				uPreviousIndex = findPaletteIndex(vecNewPalette, pData[uPosition]);
+			}
+			setPaletteIndex(vecNewIndices, uNewIndexSizePower, uPosition, uPreviousIndex);
+		}
+
+		std::vector<DataType>(vecNewPalette.begin(), vecNewPalette.end()).swap(vecPalette);
+		vecNewIndices.swap(vecIndices);
+		uIndexSizePower = uNewIndexSizePower;
+		return true;
+	}
+
+	// Reverses paletteEncode(). The output must have space for exactly the amount of data which was encoded.
+	template <typename DataType>
+	void paletteDecode(const std::vector<DataType>& vecPalette, const std::vector<uint8_t>& vecIndices, uint8_t uIndexSizePower, DataType* pData, uint32_t uLength)
+	{
+		POLYVOX_THROW_IF(vecIndices.size() != paletteIndicesSizeInBytes(uLength, uIndexSizePower), std::invalid_argument, "Palette encoded data does not match the length of the output.");
+
+		for (uint32_t uPosition = 0; uPosition < uLength; uPosition++)
+		{
+			const uint32_t uIndex = getPaletteIndex(vecIndices, uIndexSizePower, uPosition);
+			POLYVOX_THROW_IF(uIndex >= vecPalette.size(), std::invalid_argument, "Palette encoded data refers to a value which is not in the palette.");
+			pData[uPosition] = vecPalette[uIndex];
+		}
+	}
+}
+
+#endif //__PolyVox_PaletteEncoding_H__
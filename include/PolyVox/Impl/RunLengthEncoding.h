@@ -0,0 +1,171 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_RunLengthEncoding_H__
+#define __PolyVox_RunLengthEncoding_H__
+
+#include "ErrorHandling.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace PolyVox
+{
+	// Counts the number of runs which runLengthEncode() would produce, so that the size of the encoded data can be found without encoding it.
+	template <typename DataType>
+	uint32_t countRuns(const DataType* pData, uint32_t uLength)
+	{
+		const uint32_t uMaxRunLength = (std::numeric_limits<uint16_t>::max)();
+
+		uint32_t uNoOfRuns = 0;
+		for (uint32_t uIndex = 0; uIndex < uLength; uNoOfRuns++)
+		{
+			const DataType& value = pData[uIndex];
+			const uint32_t uRunEnd = uIndex + (std::min)(uLength - uIndex, uMaxRunLength);
+			while ((uIndex < uRunEnd) && (pData[uIndex] == value))
+			{
+				uIndex++;
+			}
+		}
+
+		return uNoOfRuns;
+	}
+
+	// Compresses the data by replacing each run of identical values with a single value and the length of the run. The
+	// lengths are stored separately from the values so that no space is wasted on padding, and runs which are too long
+	// to fit in the length type are split. The vectors are sized exactly, as their capacity is used to measure memory usage.
+	template <typename DataType>
+	void runLengthEncode(const DataType* pData, uint32_t uLength, std::vector<DataType>& vecRunValues, std::vector<uint16_t>& vecRunLengths)
+	{
+		const uint32_t uMaxRunLength = (std::numeric_limits<uint16_t>::max)();
+
+		// Count the runs first so that we can allocate exactly the right amount of space.
+		const uint32_t uNoOfRuns = countRuns(pData, uLength);
+
+		std::vector<DataType>(uNoOfRuns).swap(vecRunValues);
+		std::vector<uint16_t>(uNoOfRuns).swap(vecRunLengths);
+
+		uint32_t uRun = 0;
+		for (uint32_t uIndex = 0; uIndex < uLength; uRun++)
+		{
+			const DataType& value = pData[uIndex];
+			const uint32_t uRunStart = uIndex;
+			const uint32_t uRunEnd = uIndex + (std::min)(uLength - uIndex, uMaxRunLength);
+			while ((uIndex < uRunEnd) && (pData[uIndex] == value))
+			{
+				uIndex++;
+			}
+
+			vecRunValues[uRun] = value;
+			vecRunLengths[uRun] = static_cast<uint16_t>(uIndex - uRunStart);
+		}
+	}
+
+	// Reverses runLengthEncode(). The output must have space for exactly the amount of data which was encoded.
+	template <typename DataType>
+	void runLengthDecode(const std::vector<DataType>& vecRunValues, const std::vector<uint16_t>& vecRunLengths, DataType* pData, uint32_t uLength)
+	{
+		POLYVOX_ASSERT(vecRunValues.size() == vecRunLengths.size(), "Every run must have both a value and a length.");
+
+		DataType* pEnd = pData + uLength;
+		for (size_t uRun = 0; uRun < vecRunValues.size(); uRun++)
+		{
+			POLYVOX_THROW_IF(pData + vecRunLengths[uRun] > pEnd, std::invalid_argument, "Run length encoded data is longer than the output.");
+			std::fill(pData, pData + vecRunLengths[uRun], vecRunValues[uRun]);
+			pData += vecRunLengths[uRun];
+		}
+		POLYVOX_THROW_IF(pData != pEnd, std::invalid_argument, "Run length encoded data is shorter than the output.");
+	}
+
+	// Run length encodes a sequence of bytes (the 'PackBits' scheme), for when the structure of the data is unknown. Each run of two
+	// or more identical bytes becomes a control byte of 128 + (length - 2) followed by the byte, while bytes which are not part of
+	// a run are gathered into groups of up to 128 which are stored as a control byte of (count - 1) followed by the bytes themselves.
+	inline void packBitsEncode(const uint8_t* pData, size_t uLength, std::vector<uint8_t>& vecOutput)
+	{
+		const size_t uMaxRunLength = 129;
+		const size_t uMaxLiteralLength = 128;
+
+		size_t uIndex = 0;
+		while (uIndex < uLength)
+		{
+			size_t uRunLength = 1;
+			while ((uIndex + uRunLength < uLength) && (uRunLength < uMaxRunLength) && (pData[uIndex + uRunLength] == pData[uIndex]))
+			{
+				uRunLength++;
+			}
+
+			if (uRunLength >= 2)
+			{
+				vecOutput.push_back(static_cast<uint8_t>(128 + uRunLength - 2));
+				vecOutput.push_back(pData[uIndex]);
+				uIndex += uRunLength;
+			}
+			else
+			{
+				// Stop at the start of the next run, which is encoded separately.
+				const size_t uLiteralStart = uIndex;
+				while ((uIndex < uLength) && (uIndex - uLiteralStart < uMaxLiteralLength) && !((uIndex + 1 < uLength) && (pData[uIndex + 1] == pData[uIndex])))
+				{
+					uIndex++;
+				}
+
+				vecOutput.push_back(static_cast<uint8_t>(uIndex - uLiteralStart - 1));
+				vecOutput.insert(vecOutput.end(), pData + uLiteralStart, pData + uIndex);
+			}
+		}
+	}
+
+	// Reverses packBitsEncode(). The output must have space for exactly the amount of data which was encoded.
+	inline void packBitsDecode(const uint8_t* pData, size_t uLength, uint8_t* pOutput, size_t uOutputLength)
+	{
+		const uint8_t* pEnd = pData + uLength;
+		uint8_t* pOutputEnd = pOutput + uOutputLength;
+		while (pData < pEnd)
+		{
+			const uint8_t uControl = *pData++;
+			if (uControl >= 128)
+			{
+				const size_t uRunLength = uControl - 126;
+				POLYVOX_THROW_IF((pData == pEnd) || (uRunLength > static_cast<size_t>(pOutputEnd - pOutput)), std::invalid_argument, "Run length encoded data is invalid.");
+				std::fill(pOutput, pOutput + uRunLength, *pData++);
+				pOutput += uRunLength;
+			}
+			else
+			{
+				const size_t uLiteralLength = uControl + 1;
+				POLYVOX_THROW_IF((uLiteralLength > static_cast<size_t>(pEnd - pData)) || (uLiteralLength > static_cast<size_t>(pOutputEnd - pOutput)), std::invalid_argument, "Run length encoded data is invalid.");
+				std::memcpy(pOutput, pData, uLiteralLength);
+				pData += uLiteralLength;
+				pOutput += uLiteralLength;
+			}
+		}
+		POLYVOX_THROW_IF(pOutput != pOutputEnd, std::invalid_argument, "Run length encoded data is shorter than the output.");
+	}
+}
+
+#endif //__PolyVox_RunLengthEncoding_H__
@@ -0,0 +1,408 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_ThresholdClassification_H__
+#define __PolyVox_ThresholdClassification_H__
+
+#include "../Config.h"
+
+#include <cstdint>
+
+// The vectorised paths are only available on x86 processors. SSE2 is part of the baseline for x64 (and is assumed if the
+// compiler has been told it can use it) while AVX2 is compiled separately and only used if the processor supports it.
+#if !defined(POLYVOX_SIMD_DISABLED) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+	#define POLYVOX_SSE2_AVAILABLE
+	#include <emmintrin.h>
+
+	#if defined(_MSC_VER)
+		#define POLYVOX_AVX2_AVAILABLE
+		#define POLYVOX_TARGET_AVX2
+		#include <immintrin.h>
+		#include <intrin.h>
+	#elif defined(__GNUC__)
+		#define POLYVOX_AVX2_AVAILABLE
+		#define POLYVOX_TARGET_AVX2 __attribute__((target("avx2")))
+		#include <immintrin.h>
+	#endif
+#endif
+
+namespace PolyVox
+{
+	namespace SimdLevels
+	{
+		enum SimdLevel
+		{
+			Scalar,
+			SSE2,
+			AVX2
+		};
+	}
+	typedef SimdLevels::SimdLevel SimdLevel;
+
+	// Threshold classification compares a run of densities against a threshold and packs the results into a bitmask, with bit
+	// (i % 32) of word (i / 32) being set if element i is below the threshold. This is the first step of computing Marching
+	// Cubes cell indices, and doing it for a whole row at once means that it can be vectorised for the common density types.
+
+	// The number of 32-bit words needed to hold the classification of the given number of elements.
+	inline uint32_t classificationSizeInWords(uint32_t uCount)
+	{
+		return (uCount + 31) / 32;
+	}
+
+	inline uint32_t countSetBits(uint32_t uWord)
+	{
+		uWord = uWord - ((uWord >> 1) & 0x55555555);
+		uWord = (uWord & 0x33333333) + ((uWord >> 2) & 0x33333333);
+		return (((uWord + (uWord >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+	}
+
+	// Determines the best instruction set which is supported by both the build and the processor we are running on.
+	inline SimdLevel getSupportedSimdLevel(void)
+	{
+#if defined(POLYVOX_AVX2_AVAILABLE)
+	#if defined(_MSC_VER)
+		int cpuInfo[4];
+		__cpuid(cpuInfo, 0);
+		if (cpuInfo[0] >= 7)
+		{
+			// AVX2 also needs the operating system to save the upper halves of the registers.
+			__cpuid(cpuInfo, 1);
+			const bool bOSXSave = (cpuInfo[2] & (1 << 27)) != 0;
+			const bool bAVX = (cpuInfo[2] & (1 << 28)) != 0;
+			if (bOSXSave && bAVX && ((_xgetbv(0) & 6) == 6))
+			{
+				__cpuidex(cpuInfo, 7, 0);
+				if (cpuInfo[1] & (1 << 5))
+				{
+					return SimdLevels::AVX2;
+				}
+			}
+		}
+	#else
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return SimdLevels::AVX2;
+		}
+	#endif
+#endif
+
+#if defined(POLYVOX_SSE2_AVAILABLE)
+		return SimdLevels::SSE2;
+#else
+		return SimdLevels::Scalar;
+#endif
+	}
+
+	// Handles any elements which don't fill a complete word, as well as any types which don't have a vectorised version.
+	template <typename DensityType>
+	uint32_t classifyBelowThresholdScalar(const DensityType* pDensities, uint32_t uFirst, uint32_t uCount, DensityType tThreshold, uint32_t* pMask)
+	{
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = uFirst / 32; uWord < classificationSizeInWords(uCount); uWord++)
+		{
+			const uint32_t uEnd = (uCount < (uWord + 1) * 32) ? uCount : (uWord + 1) * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uElement = uWord * 32; uElement < uEnd; uElement++)
+			{
+				if (pDensities[uElement] < tThreshold)
+				{
+					uBits |= 1u << (uElement & 31);
+				}
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+#if defined(POLYVOX_SSE2_AVAILABLE)
+	inline uint32_t classifyBelowThresholdSSE2(const float* pDensities, uint32_t uCount, float fThreshold, uint32_t* pMask)
+	{
+		const __m128 threshold = _mm_set1_ps(fThreshold);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const float* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 8; uGroup++)
+			{
+				const __m128 below = _mm_cmplt_ps(_mm_loadu_ps(pSource + uGroup * 4), threshold);
+				uBits |= static_cast<uint32_t>(_mm_movemask_ps(below)) << (uGroup * 4);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	inline uint32_t classifyBelowThresholdSSE2(const int32_t* pDensities, uint32_t uCount, int32_t iThreshold, uint32_t* pMask)
+	{
+		const __m128i threshold = _mm_set1_epi32(iThreshold);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const int32_t* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 8; uGroup++)
+			{
+				const __m128i below = _mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + uGroup * 4)), threshold);
+				uBits |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(below))) << (uGroup * 4);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	// SSE2 (and AVX2) can only compare signed 8 and 16 bit integers, so unsigned ones are moved into the signed range by
+	// flipping their top bit (the bias), which keeps them in the same order. The bias is zero for the signed types.
+	template <typename DensityType>
+	uint32_t classifyBelowThresholdSSE2Int8(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, int8_t iBias, uint32_t* pMask)
+	{
+		const __m128i bias = _mm_set1_epi8(iBias);
+		const __m128i threshold = _mm_xor_si128(_mm_set1_epi8(static_cast<int8_t>(tThreshold)), bias);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const DensityType* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 2; uGroup++)
+			{
+				const __m128i densities = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + uGroup * 16)), bias);
+				uBits |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(densities, threshold))) << (uGroup * 16);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	template <typename DensityType>
+	uint32_t classifyBelowThresholdSSE2Int16(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, int16_t iBias, uint32_t* pMask)
+	{
+		const __m128i bias = _mm_set1_epi16(iBias);
+		const __m128i threshold = _mm_xor_si128(_mm_set1_epi16(static_cast<int16_t>(tThreshold)), bias);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const DensityType* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 2; uGroup++)
+			{
+				// The results of two comparisons are packed into one byte each (saturation keeps them as 0 or -1).
+				const __m128i densitiesLow = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + uGroup * 16)), bias);
+				const __m128i densitiesHigh = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + uGroup * 16 + 8)), bias);
+				const __m128i below = _mm_packs_epi16(_mm_cmplt_epi16(densitiesLow, threshold), _mm_cmplt_epi16(densitiesHigh, threshold));
+				uBits |= static_cast<uint32_t>(_mm_movemask_epi8(below)) << (uGroup * 16);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	inline uint32_t classifyBelowThresholdSSE2(const int8_t* pDensities, uint32_t uCount, int8_t iThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdSSE2Int8(pDensities, uCount, iThreshold, 0, pMask);
+	}
+
+	inline uint32_t classifyBelowThresholdSSE2(const uint8_t* pDensities, uint32_t uCount, uint8_t uThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdSSE2Int8(pDensities, uCount, uThreshold, static_cast<int8_t>(0x80), pMask);
+	}
+
+	inline uint32_t classifyBelowThresholdSSE2(const int16_t* pDensities, uint32_t uCount, int16_t iThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdSSE2Int16(pDensities, uCount, iThreshold, 0, pMask);
+	}
+
+	inline uint32_t classifyBelowThresholdSSE2(const uint16_t* pDensities, uint32_t uCount, uint16_t uThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdSSE2Int16(pDensities, uCount, uThreshold, static_cast<int16_t>(0x8000), pMask);
+	}
+#endif
+
+#if defined(POLYVOX_AVX2_AVAILABLE)
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const float* pDensities, uint32_t uCount, float fThreshold, uint32_t* pMask)
+	{
+		const __m256 threshold = _mm256_set1_ps(fThreshold);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const float* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 4; uGroup++)
+			{
+				const __m256 below = _mm256_cmp_ps(_mm256_loadu_ps(pSource + uGroup * 8), threshold, _CMP_LT_OQ);
+				uBits |= static_cast<uint32_t>(_mm256_movemask_ps(below)) << (uGroup * 8);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const int32_t* pDensities, uint32_t uCount, int32_t iThreshold, uint32_t* pMask)
+	{
+		const __m256i threshold = _mm256_set1_epi32(iThreshold);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const int32_t* pSource = pDensities + uWord * 32;
+			uint32_t uBits = 0;
+			for (uint32_t uGroup = 0; uGroup < 4; uGroup++)
+			{
+				const __m256i below = _mm256_cmpgt_epi32(threshold, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + uGroup * 8)));
+				uBits |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(below))) << (uGroup * 8);
+			}
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	// See classifyBelowThresholdSSE2Int8() for the bias.
+	template <typename DensityType>
+	POLYVOX_TARGET_AVX2 uint32_t classifyBelowThresholdAVX2Int8(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, int8_t iBias, uint32_t* pMask)
+	{
+		const __m256i bias = _mm256_set1_epi8(iBias);
+		const __m256i threshold = _mm256_xor_si256(_mm256_set1_epi8(static_cast<int8_t>(tThreshold)), bias);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const __m256i densities = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pDensities + uWord * 32)), bias);
+			const uint32_t uBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(threshold, densities)));
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	template <typename DensityType>
+	POLYVOX_TARGET_AVX2 uint32_t classifyBelowThresholdAVX2Int16(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, int16_t iBias, uint32_t* pMask)
+	{
+		const __m256i bias = _mm256_set1_epi16(iBias);
+		const __m256i threshold = _mm256_xor_si256(_mm256_set1_epi16(static_cast<int16_t>(tThreshold)), bias);
+		uint32_t uNoOfBelow = 0;
+		for (uint32_t uWord = 0; uWord < uCount / 32; uWord++)
+		{
+			const DensityType* pSource = pDensities + uWord * 32;
+			const __m256i densitiesLow = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource)), bias);
+			const __m256i densitiesHigh = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 16)), bias);
+
+			// Packing works within each 128-bit lane, so the middle two quarters of the result have to be swapped back.
+			const __m256i below = _mm256_packs_epi16(_mm256_cmpgt_epi16(threshold, densitiesLow), _mm256_cmpgt_epi16(threshold, densitiesHigh));
+			const uint32_t uBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_permute4x64_epi64(below, 0xD8)));
+			pMask[uWord] = uBits;
+			uNoOfBelow += countSetBits(uBits);
+		}
+		return uNoOfBelow;
+	}
+
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const int8_t* pDensities, uint32_t uCount, int8_t iThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdAVX2Int8(pDensities, uCount, iThreshold, 0, pMask);
+	}
+
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const uint8_t* pDensities, uint32_t uCount, uint8_t uThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdAVX2Int8(pDensities, uCount, uThreshold, static_cast<int8_t>(0x80), pMask);
+	}
+
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const int16_t* pDensities, uint32_t uCount, int16_t iThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdAVX2Int16(pDensities, uCount, iThreshold, 0, pMask);
+	}
+
+	POLYVOX_TARGET_AVX2 inline uint32_t classifyBelowThresholdAVX2(const uint16_t* pDensities, uint32_t uCount, uint16_t uThreshold, uint32_t* pMask)
+	{
+		return classifyBelowThresholdAVX2Int16(pDensities, uCount, uThreshold, static_cast<int16_t>(0x8000), pMask);
+	}
+#endif
+
+	// Classifies uCount densities against the threshold (see above) and returns the number which are below it. The caller can
+	// use this to spot runs which are entirely above or below the threshold, as these cannot contain any part of the surface.
+	template <typename DensityType>
+	uint32_t classifyBelowThreshold(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, uint32_t* pMask, SimdLevel /*eSimdLevel*/)
+	{
+		return classifyBelowThresholdScalar(pDensities, 0, uCount, tThreshold, pMask);
+	}
+
+	// Vectorised versions for the density types which the instruction sets support directly (with a bias for the unsigned ones).
+	template <typename DensityType>
+	uint32_t classifyBelowThresholdVectorised(const DensityType* pDensities, uint32_t uCount, DensityType tThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		uint32_t uNoOfBelow = 0;
+		switch (eSimdLevel)
+		{
+#if defined(POLYVOX_AVX2_AVAILABLE)
+		case SimdLevels::AVX2:
+			uNoOfBelow = classifyBelowThresholdAVX2(pDensities, uCount, tThreshold, pMask);
+			break;
+#endif
+#if defined(POLYVOX_SSE2_AVAILABLE)
+		case SimdLevels::SSE2:
+			uNoOfBelow = classifyBelowThresholdSSE2(pDensities, uCount, tThreshold, pMask);
+			break;
+#endif
+		default:
+			return classifyBelowThresholdScalar(pDensities, 0, uCount, tThreshold, pMask);
+		}
+
+		// The vectorised versions only process complete words.
+		return uNoOfBelow + classifyBelowThresholdScalar(pDensities, uCount - (uCount % 32), uCount, tThreshold, pMask);
+	}
+
+	inline uint32_t classifyBelowThreshold(const float* pDensities, uint32_t uCount, float fThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, fThreshold, pMask, eSimdLevel);
+	}
+
+	inline uint32_t classifyBelowThreshold(const int32_t* pDensities, uint32_t uCount, int32_t iThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, iThreshold, pMask, eSimdLevel);
+	}
+
+	inline uint32_t classifyBelowThreshold(const int16_t* pDensities, uint32_t uCount, int16_t iThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, iThreshold, pMask, eSimdLevel);
+	}
+
+	inline uint32_t classifyBelowThreshold(const uint16_t* pDensities, uint32_t uCount, uint16_t uThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, uThreshold, pMask, eSimdLevel);
+	}
+
+	inline uint32_t classifyBelowThreshold(const int8_t* pDensities, uint32_t uCount, int8_t iThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, iThreshold, pMask, eSimdLevel);
+	}
+
+	inline uint32_t classifyBelowThreshold(const uint8_t* pDensities, uint32_t uCount, uint8_t uThreshold, uint32_t* pMask, SimdLevel eSimdLevel)
+	{
+		return classifyBelowThresholdVectorised(pDensities, uCount, uThreshold, pMask, eSimdLevel);
+	}
+}
+
+#endif //__PolyVox_ThresholdClassification_H__
@@ -25,10 +25,16 @@
 #ifndef __PolyVox_Utility_H__
 #define __PolyVox_Utility_H__
 
+#include "ErrorHandling.h"
 #include "PlatformDefinitions.h"
 
+#include <cstddef>
 #include <cstdint>
 
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
 namespace PolyVox
 {
 	inline bool isPowerOf2(uint32_t uInput)
@@ -84,6 +90,47 @@ namespace PolyVox
 		return (r >= 0.0) ? static_cast<int32_t>(r + 0.5f) : static_cast<int32_t>(r - 0.5f);
 	}
 
+	// Gets the index of the lowest bit which is set. The input must not be zero.
+	inline uint32_t countTrailingZeros(uint64_t uInput)
+	{
+		POLYVOX_ASSERT(uInput != 0, "Cannot count the trailing zeros of zero.");
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long uIndex;
+		_BitScanForward64(&uIndex, uInput);
+		return uIndex;
+#elif defined(_MSC_VER)
+		unsigned long uIndex;
+		if (_BitScanForward(&uIndex, static_cast<unsigned long>(uInput)))
+		{
+			return uIndex;
+		}
+		_BitScanForward(&uIndex, static_cast<unsigned long>(uInput >> 32));
+		return uIndex + 32;
+#elif defined(__GNUC__)
+		return static_cast<uint32_t>(__builtin_ctzll(uInput));
+#else
+		uint32_t uIndex = 0;
+		while ((uInput & 1) == 0)
+		{
+			uInput >>= 1;
+			uIndex++;
+		}
+		return uIndex;
+#endif
+	}
+
+	// A simple (FNV-1a) checksum, for detecting data which has been corrupted on disk.
+	inline uint32_t calculateChecksum(const void* pData, size_t uSizeInBytes)
+	{
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		uint32_t uChecksum = 2166136261u;
+		for (size_t uIndex = 0; uIndex < uSizeInBytes; uIndex++)
+		{
+			uChecksum = (uChecksum ^ pBytes[uIndex]) * 16777619u;
+		}
+		return uChecksum;
+	}
+
 	template <typename Type>
 	inline Type clamp(const Type& value, const Type& low, const Type& high)
 	{
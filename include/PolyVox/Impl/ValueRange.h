@@ -0,0 +1,78 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_ValueRange_H__
+#define __PolyVox_ValueRange_H__
+
+#include <cstdint>
+#include <type_traits>
+
+namespace PolyVox
+{
+	// The volumes keep track of the range of values in each of their blocks or chunks (see BaseVolume::getRegionValueRange()),
+	// but this needs the voxel type to have an ordering. Only the primitive types are supported, and the functions below do
+	// nothing for other voxel types so that the volumes can call them regardless. Pass HasValueRange<VoxelType>() as the tag.
+	template <typename VoxelType>
+	struct HasValueRange : std::integral_constant<bool, std::is_arithmetic<VoxelType>::value>
+	{
+	};
+
+	// Widens the range to include the given value.
+	template <typename VoxelType>
+	void expandValueRange(const VoxelType& tValue, VoxelType& tMin, VoxelType& tMax, std::true_type)
+	{
+		if (tValue < tMin)
+		{
+			tMin = tValue;
+		}
+		if (tMax < tValue)
+		{
+			tMax = tValue;
+		}
+	}
+
+	template <typename VoxelType>
+	void expandValueRange(const VoxelType& /*tValue*/, VoxelType& /*tMin*/, VoxelType& /*tMax*/, std::false_type)
+	{
+	}
+
+	// Sets the range to exactly cover the given data, which must contain at least one value.
+	template <typename VoxelType>
+	void computeValueRange(const VoxelType* pData, uint32_t uLength, VoxelType& tMin, VoxelType& tMax, std::true_type)
+	{
+		tMin = pData[0];
+		tMax = pData[0];
+		for (uint32_t uIndex = 1; uIndex < uLength; uIndex++)
+		{
+			expandValueRange(pData[uIndex], tMin, tMax, std::true_type());
+		}
+	}
+
+	template <typename VoxelType>
+	void computeValueRange(const VoxelType* /*pData*/, uint32_t /*uLength*/, VoxelType& /*tMin*/, VoxelType& /*tMax*/, std::false_type)
+	{
+	}
+}
+
+#endif //__PolyVox_ValueRange_H__
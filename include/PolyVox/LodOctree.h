@@ -0,0 +1,112 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_LodOctree_H__
+#define __PolyVox_LodOctree_H__
+
+#include "Region.h"
+#include "Vector.h"
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace PolyVox
+{
+	/// A block of the volume which is meshed at one level of detail, as chosen by a LodOctree.
+	struct LodBlock
+	{
+		/// The Region of the block, in the voxels of its level of the LodPyramid. Neighbouring blocks share the voxels on their
+		/// faces, so the region passed to the extractor does not need to be extended.
+		Region region;
+
+		/// The level of detail of the block, where level zero is the full resolution and each level has half the resolution of
+		/// the one before.
+		uint32_t uLevel;
+
+		/// Records which of the 26 neighbouring blocks (sharing a face, an edge or a corner with this one) are at a lower level
+		/// of detail, using the bits given by lodNeighbourBit(). The extractor uses this to join the mesh to theirs.
+		uint32_t uCoarserNeighbours;
+	};
+
+	/// Gets the bit which represents the neighbouring block in the given direction in LodBlock::uCoarserNeighbours.
+	uint32_t lodNeighbourBit(int32_t iXDir, int32_t iYDir, int32_t iZDir);
+
+	/// Chooses the level of detail at which each part of a volume should be meshed, based on the distance from the viewer.
+	///
+	/// The Region is covered by a grid of blocks at the lowest level of detail, each of which can be split into eight blocks at the
+	/// next level, and so on down to the full resolution. A block is split if the viewer is closer to it than a given multiple of its
+	/// size, so the blocks near the viewer are meshed at the full resolution and those further away are meshed at 1/2, 1/4, 1/8...
+	/// of the resolution. Every block has the same number of voxels at its own level of detail, so the cost of meshing a block is
+	/// roughly the same whatever its level.
+	///
+	/// After splitting, blocks are also split until no block is next to one which is more than one level of detail higher. This is
+	/// needed for the meshes to join up, and extractMarchingCubesLodMesh() uses the neighbours which are recorded for each block
+	/// (see LodBlock) to do so. The levels of the blocks correspond to the levels of a LodPyramid, which should therefore have at
+	/// least as many levels as the octree.
+	class LodOctree
+	{
+	public:
+		/// Constructor for creating an octree. The block side length must be a power of two.
+		LodOctree(const Region& region, uint16_t uBlockSideLength = 32, uint32_t uNoOfLevels = 4);
+
+		/// Chooses the level of detail of each block for a viewer at the given position.
+		void update(const Vector3DFloat& v3dViewerPosition, float fSplitDistance = 2.0f);
+
+		/// Gets the blocks chosen by the last call to update().
+		const std::vector<LodBlock>& getBlocks(void) const;
+
+		/// Gets the Region which the octree covers.
+		const Region& getRegion(void) const;
+		/// Gets the side length of the blocks, in the voxels of their own level.
+		uint16_t getBlockSideLength(void) const;
+		/// Gets the number of levels of detail.
+		uint32_t getNoOfLevels(void) const;
+
+	private:
+		// Adds the blocks which cover the given node to m_vecBlocks, without filling in their neighbours.
+		void addBlocks(uint32_t uLevel, const Vector3DInt32& v3dNode);
+		// Finds the block containing the given voxel, returning false if it is outside the octree.
+		bool findBlock(const Vector3DInt32& v3dPos, uint32_t& uLevel, Vector3DInt32& v3dNode) const;
+		// Splits the given node if it is close enough to the viewer, along with its children.
+		void splitNearViewer(uint32_t uLevel, const Vector3DInt32& v3dNode, const Vector3DFloat& v3dViewerPosition, float fSplitDistance);
+
+		Region m_regRegion;
+		uint16_t m_uBlockSideLength;
+		uint8_t m_uBlockSideLengthPower;
+		uint32_t m_uNoOfLevels;
+
+		// The nodes at the lowest level of detail, in units of nodes.
+		Region m_regTopNodes;
+
+		// The nodes which have been split at each level, in units of nodes at that level.
+		std::vector< std::unordered_set<Vector3DInt32> > m_vecSplitNodes;
+
+		std::vector<LodBlock> m_vecBlocks;
+	};
+}
+
+#include "LodOctree.inl"
+
+#endif //__PolyVox_LodOctree_H__
@@ -0,0 +1,248 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+#include "Impl/Utility.h"
+
+#include <algorithm>
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param iXDir The direction of the neighbour along the \a x axis (-1, 0 or +1).
+	/// \param iYDir The direction of the neighbour along the \a y axis (-1, 0 or +1).
+	/// \param iZDir The direction of the neighbour along the \a z axis (-1, 0 or +1).
+	/// \return The bit for the neighbour, so for example lodNeighbourBit(1, 0, 0) is the block beyond the upper \a x face.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint32_t lodNeighbourBit(int32_t iXDir, int32_t iYDir, int32_t iZDir)
+	{
+		POLYVOX_ASSERT((iXDir >= -1) && (iXDir <= 1) && (iYDir >= -1) && (iYDir <= 1) && (iZDir >= -1) && (iZDir <= 1), "Invalid direction");
+		return 1u << ((iXDir + 1) + (iYDir + 1) * 3 + (iZDir + 1) * 9);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param region The Region of the volume to be covered by blocks.
+	/// \param uBlockSideLength The side length of the blocks, in the voxels of their own level. This should be less than 256 so that
+	/// the positions of the vertices can be encoded (see MarchingCubesVertex).
+	/// \param uNoOfLevels The number of levels of detail, including the full resolution.
+	////////////////////////////////////////////////////////////////////////////////
+	inline LodOctree::LodOctree(const Region& region, uint16_t uBlockSideLength, uint32_t uNoOfLevels)
+		:m_regRegion(region)
+		, m_uBlockSideLength(uBlockSideLength)
+		, m_uBlockSideLengthPower(0)
+		, m_uNoOfLevels(uNoOfLevels)
+		, m_vecSplitNodes(uNoOfLevels)
+	{
+		POLYVOX_THROW_IF(!region.isValid(), std::invalid_argument, "Region must be valid");
+		POLYVOX_THROW_IF((m_uBlockSideLength < 2) || (m_uBlockSideLength > 128), std::invalid_argument, "Block side length must be between 2 and 128.");
+		POLYVOX_THROW_IF(!isPowerOf2(m_uBlockSideLength), std::invalid_argument, "Block side length must be a power of two.");
+		POLYVOX_THROW_IF((uNoOfLevels == 0) || (uNoOfLevels > 16), std::invalid_argument, "Number of levels must be between 1 and 16");
+
+		m_uBlockSideLengthPower = logBase2(m_uBlockSideLength);
+
+		// The cells of the Region (which lie between its voxels) are covered, so a Region from (0, 0, 0) to (64, 64, 64) only needs
+		// one block of 64 voxels (and its upper faces are shared with the blocks beyond it, which are not needed).
+		const int32_t iTopPower = m_uBlockSideLengthPower + uNoOfLevels - 1;
+		m_regTopNodes = Region(region.getLowerX() >> iTopPower, region.getLowerY() >> iTopPower, region.getLowerZ() >> iTopPower,
+			(std::max)(region.getUpperX() - 1, region.getLowerX()) >> iTopPower,
+			(std::max)(region.getUpperY() - 1, region.getLowerY()) >> iTopPower,
+			(std::max)(region.getUpperZ() - 1, region.getLowerZ()) >> iTopPower);
+
+		update(Vector3DFloat(static_cast<float>(region.getLowerX()), static_cast<float>(region.getLowerY()), static_cast<float>(region.getLowerZ())), 0.0f);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Each block is split if the distance from the viewer to the nearest point of the block is less than the split distance
+	/// multiplied by the size of the block (in the voxels of the full resolution). Blocks are then split further until each of them
+	/// is at most one level of detail lower than its neighbours.
+	/// \param v3dViewerPosition The position of the viewer, in the voxels of the full resolution.
+	/// \param fSplitDistance How far away from the viewer blocks should be split, as a multiple of their size. Larger values give
+	/// more blocks at the higher levels of detail, and zero gives all the blocks at the lowest level of detail.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void LodOctree::update(const Vector3DFloat& v3dViewerPosition, float fSplitDistance)
+	{
+		for (auto iter = m_vecSplitNodes.begin(); iter != m_vecSplitNodes.end(); iter++)
+		{
+			iter->clear();
+		}
+
+		const uint32_t uTopLevel = m_uNoOfLevels - 1;
+		for (int32_t z = m_regTopNodes.getLowerZ(); z <= m_regTopNodes.getUpperZ(); z++)
+		{
+			for (int32_t y = m_regTopNodes.getLowerY(); y <= m_regTopNodes.getUpperY(); y++)
+			{
+				for (int32_t x = m_regTopNodes.getLowerX(); x <= m_regTopNodes.getUpperX(); x++)
+				{
+					splitNearViewer(uTopLevel, Vector3DInt32(x, y, z), v3dViewerPosition, fSplitDistance);
+				}
+			}
+		}
+
+		// Any block which is next to a block more than one level higher is split, which may in turn require its neighbours to be
+		// split. Each pass looks at the neighbours of every block, and is repeated until no more blocks need to be split.
+		bool bSplitAny = true;
+		while (bSplitAny)
+		{
+			bSplitAny = false;
+			m_vecBlocks.clear();
+			for (int32_t z = m_regTopNodes.getLowerZ(); z <= m_regTopNodes.getUpperZ(); z++)
+			{
+				for (int32_t y = m_regTopNodes.getLowerY(); y <= m_regTopNodes.getUpperY(); y++)
+				{
+					for (int32_t x = m_regTopNodes.getLowerX(); x <= m_regTopNodes.getUpperX(); x++)
+					{
+						addBlocks(uTopLevel, Vector3DInt32(x, y, z));
+					}
+				}
+			}
+
+			for (auto iter = m_vecBlocks.begin(); iter != m_vecBlocks.end(); iter++)
+			{
+				// Any voxel of the neighbouring block at the same level is within the block which covers it, if that is larger.
+				const int32_t iNodeSize = static_cast<int32_t>(m_uBlockSideLength) << iter->uLevel;
+				const Vector3DInt32 v3dLowerCorner = iter->region.getLowerCorner() * static_cast<int32_t>(1 << iter->uLevel);
+				for (int32_t iZDir = -1; iZDir <= 1; iZDir++)
+				{
+					for (int32_t iYDir = -1; iYDir <= 1; iYDir++)
+					{
+						for (int32_t iXDir = -1; iXDir <= 1; iXDir++)
+						{
+							uint32_t uNeighbourLevel;
+							Vector3DInt32 v3dNeighbourNode;
+							if (((iXDir != 0) || (iYDir != 0) || (iZDir != 0)) &&
+								findBlock(v3dLowerCorner + Vector3DInt32(iXDir, iYDir, iZDir) * iNodeSize, uNeighbourLevel, v3dNeighbourNode))
+							{
+								if (uNeighbourLevel > iter->uLevel + 1)
+								{
+									m_vecSplitNodes[uNeighbourLevel].insert(v3dNeighbourNode);
+									bSplitAny = true;
+								}
+								else if (uNeighbourLevel > iter->uLevel)
+								{
+									iter->uCoarserNeighbours |= lodNeighbourBit(iXDir, iYDir, iZDir);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The blocks which cover the Region, in no particular order.
+	////////////////////////////////////////////////////////////////////////////////
+	inline const std::vector<LodBlock>& LodOctree::getBlocks(void) const
+	{
+		return m_vecBlocks;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The Region which the octree covers.
+	////////////////////////////////////////////////////////////////////////////////
+	inline const Region& LodOctree::getRegion(void) const
+	{
+		return m_regRegion;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The side length of the blocks, in the voxels of their own level.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint16_t LodOctree::getBlockSideLength(void) const
+	{
+		return m_uBlockSideLength;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of levels of detail, including the full resolution.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint32_t LodOctree::getNoOfLevels(void) const
+	{
+		return m_uNoOfLevels;
+	}
+
+	inline void LodOctree::addBlocks(uint32_t uLevel, const Vector3DInt32& v3dNode)
+	{
+		if ((uLevel > 0) && (m_vecSplitNodes[uLevel].find(v3dNode) != m_vecSplitNodes[uLevel].end()))
+		{
+			for (int32_t iChild = 0; iChild < 8; iChild++)
+			{
+				addBlocks(uLevel - 1, v3dNode * 2 + Vector3DInt32(iChild & 1, (iChild >> 1) & 1, (iChild >> 2) & 1));
+			}
+		}
+		else
+		{
+			LodBlock block;
+			const Vector3DInt32 v3dLowerCorner = v3dNode * static_cast<int32_t>(m_uBlockSideLength);
+			block.region = Region(v3dLowerCorner, v3dLowerCorner + Vector3DInt32(m_uBlockSideLength, m_uBlockSideLength, m_uBlockSideLength));
+			block.uLevel = uLevel;
+			block.uCoarserNeighbours = 0;
+			m_vecBlocks.push_back(block);
+		}
+	}
+
+	inline bool LodOctree::findBlock(const Vector3DInt32& v3dPos, uint32_t& uLevel, Vector3DInt32& v3dNode) const
+	{
+		uLevel = m_uNoOfLevels - 1;
+		int32_t iPower = m_uBlockSideLengthPower + uLevel;
+		v3dNode = Vector3DInt32(v3dPos.getX() >> iPower, v3dPos.getY() >> iPower, v3dPos.getZ() >> iPower);
+		if (!m_regTopNodes.containsPoint(v3dNode))
+		{
+			return false;
+		}
+
+		while ((uLevel > 0) && (m_vecSplitNodes[uLevel].find(v3dNode) != m_vecSplitNodes[uLevel].end()))
+		{
+			uLevel--;
+			iPower--;
+			v3dNode = Vector3DInt32(v3dPos.getX() >> iPower, v3dPos.getY() >> iPower, v3dPos.getZ() >> iPower);
+		}
+		return true;
+	}
+
+	inline void LodOctree::splitNearViewer(uint32_t uLevel, const Vector3DInt32& v3dNode, const Vector3DFloat& v3dViewerPosition, float fSplitDistance)
+	{
+		if (uLevel == 0)
+		{
+			return;
+		}
+
+		// The distance from the viewer to the nearest point of the node, which is zero if the viewer is inside it.
+		const float fNodeSize = static_cast<float>(static_cast<int32_t>(m_uBlockSideLength) << uLevel);
+		const Vector3DFloat v3dLowerCorner(v3dNode.getX() * fNodeSize, v3dNode.getY() * fNodeSize, v3dNode.getZ() * fNodeSize);
+		const Vector3DFloat v3dUpperCorner = v3dLowerCorner + Vector3DFloat(fNodeSize, fNodeSize, fNodeSize);
+		const Vector3DFloat v3dNearest((std::min)((std::max)(v3dViewerPosition.getX(), v3dLowerCorner.getX()), v3dUpperCorner.getX()),
+			(std::min)((std::max)(v3dViewerPosition.getY(), v3dLowerCorner.getY()), v3dUpperCorner.getY()),
+			(std::min)((std::max)(v3dViewerPosition.getZ(), v3dLowerCorner.getZ()), v3dUpperCorner.getZ()));
+
+		if ((v3dNearest - v3dViewerPosition).length() < fSplitDistance * fNodeSize)
+		{
+			m_vecSplitNodes[uLevel].insert(v3dNode);
+			for (int32_t iChild = 0; iChild < 8; iChild++)
+			{
+				splitNearViewer(uLevel - 1, v3dNode * 2 + Vector3DInt32(iChild & 1, (iChild >> 1) & 1, (iChild >> 2) & 1), v3dViewerPosition, fSplitDistance);
+			}
+		}
+	}
+}
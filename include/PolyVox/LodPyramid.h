@@ -0,0 +1,103 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_LodPyramid_H__
+#define __PolyVox_LodPyramid_H__
+
+#include "RawVolume.h"
+#include "Region.h"
+#include "Vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PolyVox
+{
+	/// Holds a volume at a number of levels of detail, for extracting distant parts of it with fewer vertices.
+	///
+	/// Level zero is the volume itself, and each of the other levels has half the resolution of the one before. The voxel at position
+	/// (x, y, z) of level k is the voxel at (x, y, z) * 2^k of the volume, so the voxels of each level are a subset of those of the
+	/// level before rather than an average of them. This keeps the surface at a lower level of detail close to that at a higher level
+	/// of detail (and keeps the voxels valid for any voxel type), and it is what allows extractMarchingCubesLodMesh() to join meshes
+	/// at different levels without cracks.
+	///
+	/// The volume itself is read directly, so it must outlive the pyramid. So are any of the lower levels which the volume keeps
+	/// itself (see getNoOfSubsampledLevels()), which for a PagedVolume means its mip levels when they are kept with MipFilters::Subsample.
+	/// These are the authoritative levels of detail and are kept up to date by the volume, but its averaged mip levels (the default)
+	/// are not suitable for level of detail extraction and are not used. The volume must keep its levels in the same way for as long
+	/// as the pyramid exists.
+	///
+	/// The other lower levels are copied into a RawVolume each when the pyramid is constructed, and only cover the given Region (scaled
+	/// down and rounded outwards). If the volume is modified afterwards then update() must be called with the Region which was changed,
+	/// e.g. with the changes from a VolumeChangeTracker.
+	template <typename _VolumeType>
+	class LodPyramid
+	{
+	public:
+		typedef _VolumeType VolumeType;
+		typedef typename VolumeType::VoxelType VoxelType;
+
+		/// Constructor for creating a pyramid with the given number of levels (including the volume itself).
+		LodPyramid(VolumeType* volData, const Region& region, uint32_t uNoOfLevels);
+
+		/// Gets the volume which forms level zero of the pyramid.
+		VolumeType* getVolume(void) const;
+		/// Gets the Region of the volume which the pyramid was constructed for.
+		const Region& getRegion(void) const;
+		/// Gets the number of levels in the pyramid, including the volume itself.
+		uint32_t getNoOfLevels(void) const;
+		/// Gets the number of levels which are read from the volume, including the volume itself.
+		uint32_t getNoOfLevelsInVolume(void) const;
+		/// Gets the Region which the given level covers, in the voxels of that level.
+		Region getRegionAtLevel(uint32_t uLevel) const;
+
+		/// Gets a voxel of the given level.
+		VoxelType getVoxelAtLevel(uint32_t uLevel, int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+		/// Gets a voxel of the given level.
+		VoxelType getVoxelAtLevel(uint32_t uLevel, const Vector3DInt32& v3dPos) const;
+		/// Copies the voxels of the given level which are within the specified Region into a buffer.
+		void gatherVoxelsAtLevel(uint32_t uLevel, const Region& region, VoxelType* pVoxels) const;
+
+		/// Copies the voxels within the given Region of the volume into the lower levels again after they have been modified.
+		void update(const Region& regChanged);
+
+	private:
+		// Copies the voxels within the given Region of a level (in the voxels of that level) from the volume.
+		void updateLevel(uint32_t uLevel, const Region& region);
+
+		VolumeType* m_pVolume;
+		Region m_regRegion;
+		uint32_t m_uNoOfLevels;
+		uint32_t m_uNoOfLevelsInVolume;
+
+		// The levels other than the volume itself, so level k is found at index k - 1. Those which are read from the volume are null.
+		std::vector< std::unique_ptr< RawVolume<VoxelType> > > m_vecLevels;
+	};
+}
+
+#include "LodPyramid.inl"
+
+#endif //__PolyVox_LodPyramid_H__
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param volData The volume which forms level zero of the pyramid. It is read to build the other levels.
+	/// \param region The Region of the volume which the other levels should cover.
+	/// \param uNoOfLevels The number of levels in the pyramid, including the volume itself.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	LodPyramid<VolumeType>::LodPyramid(VolumeType* volData, const Region& region, uint32_t uNoOfLevels)
+		:m_pVolume(volData)
+		, m_regRegion(region)
+		, m_uNoOfLevels(uNoOfLevels)
+		, m_uNoOfLevelsInVolume(1)
+	{
+		POLYVOX_THROW_IF(volData == nullptr, std::invalid_argument, "Provided volume cannot be null");
+		POLYVOX_THROW_IF(!region.isValid(), std::invalid_argument, "Region must be valid");
+		POLYVOX_THROW_IF((uNoOfLevels == 0) || (uNoOfLevels > 16), std::invalid_argument, "Number of levels must be between 1 and 16");
+
+		m_uNoOfLevelsInVolume = (std::min)(getNoOfSubsampledLevels(volData) + 1, uNoOfLevels);
+		for (uint32_t uLevel = 1; uLevel < uNoOfLevels; uLevel++)
+		{
+			if (uLevel < m_uNoOfLevelsInVolume)
+			{
+				m_vecLevels.push_back(std::unique_ptr< RawVolume<VoxelType> >());
+			}
+			else
+			{
+				m_vecLevels.push_back(std::unique_ptr< RawVolume<VoxelType> >(new RawVolume<VoxelType>(getRegionAtLevel(uLevel))));
+				updateLevel(uLevel, getRegionAtLevel(uLevel));
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The volume which forms level zero of the pyramid.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	VolumeType* LodPyramid<VolumeType>::getVolume(void) const
+	{
+		return m_pVolume;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The Region of the volume which the pyramid was constructed for.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	const Region& LodPyramid<VolumeType>::getRegion(void) const
+	{
+		return m_regRegion;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of levels in the pyramid, including the volume itself.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	uint32_t LodPyramid<VolumeType>::getNoOfLevels(void) const
+	{
+		return m_uNoOfLevels;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of levels which are read from the volume rather than copied, including the volume itself.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	uint32_t LodPyramid<VolumeType>::getNoOfLevelsInVolume(void) const
+	{
+		return m_uNoOfLevelsInVolume;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The Region of the pyramid is scaled down and rounded outwards, so for example a Region from (0, 0, 0) to (63, 63, 63)
+	/// covers the voxels from (0, 0, 0) to (32, 32, 32) at level one. This means that a block at a lower level of detail which
+	/// contains the upper faces of the Region has the voxels it needs.
+	/// \param uLevel The level of the pyramid.
+	/// \return The Region covered by the level, in the voxels of that level.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	Region LodPyramid<VolumeType>::getRegionAtLevel(uint32_t uLevel) const
+	{
+		POLYVOX_THROW_IF(uLevel >= getNoOfLevels(), std::out_of_range, "Level is not in the pyramid");
+
+		const int32_t iLevel = static_cast<int32_t>(uLevel);
+		return Region(m_regRegion.getLowerX() >> iLevel, m_regRegion.getLowerY() >> iLevel, m_regRegion.getLowerZ() >> iLevel,
+			-((-m_regRegion.getUpperX()) >> iLevel), -((-m_regRegion.getUpperY()) >> iLevel), -((-m_regRegion.getUpperZ()) >> iLevel));
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Positions outside the Region of a level which is not read from the volume give the default value of the voxel type.
+	/// \param uLevel The level of the pyramid.
+	/// \param iXPos The \a x position of the voxel, in the voxels of the level.
+	/// \param iYPos The \a y position of the voxel, in the voxels of the level.
+	/// \param iZPos The \a z position of the voxel, in the voxels of the level.
+	/// \return The voxel value.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	typename LodPyramid<VolumeType>::VoxelType LodPyramid<VolumeType>::getVoxelAtLevel(uint32_t uLevel, int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		POLYVOX_THROW_IF(uLevel >= getNoOfLevels(), std::out_of_range, "Level is not in the pyramid");
+
+		if (uLevel == 0)
+		{
+			return m_pVolume->getVoxel(iXPos, iYPos, iZPos);
+		}
+		if (uLevel < m_uNoOfLevelsInVolume)
+		{
+			VoxelType tValue;
+			gatherVoxelsAtSubsampledLevel(m_pVolume, uLevel, Region(iXPos, iYPos, iZPos, iXPos, iYPos, iZPos), &tValue);
+			return tValue;
+		}
+		return m_vecLevels[uLevel - 1]->getVoxel(iXPos, iYPos, iZPos);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param uLevel The level of the pyramid.
+	/// \param v3dPos The 3D position of the voxel, in the voxels of the level.
+	/// \return The voxel value.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	typename LodPyramid<VolumeType>::VoxelType LodPyramid<VolumeType>::getVoxelAtLevel(uint32_t uLevel, const Vector3DInt32& v3dPos) const
+	{
+		return getVoxelAtLevel(uLevel, v3dPos.getX(), v3dPos.getY(), v3dPos.getZ());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is the equivalent of gatherVoxels() for a level of the pyramid, and the voxels are laid out in the same way.
+	/// \param uLevel The level of the pyramid.
+	/// \param region The Region of voxels to copy, in the voxels of the level.
+	/// \param pVoxels The buffer to copy the voxels into, which must be large enough to hold all of them.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	void LodPyramid<VolumeType>::gatherVoxelsAtLevel(uint32_t uLevel, const Region& region, VoxelType* pVoxels) const
+	{
+		POLYVOX_THROW_IF(uLevel >= getNoOfLevels(), std::out_of_range, "Level is not in the pyramid");
+
+		if (uLevel < m_uNoOfLevelsInVolume)
+		{
+			gatherVoxelsAtSubsampledLevel(m_pVolume, uLevel, region, pVoxels);
+		}
+		else
+		{
+			gatherVoxels(m_vecLevels[uLevel - 1].get(), region, pVoxels);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Only the voxels of each level which correspond to voxels within the Region are copied again, so updating the pyramid after
+	/// a small edit is cheap. The levels which are read from the volume are kept up to date by the volume itself.
+	/// \param regChanged The Region of the volume which has been modified.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VolumeType>
+	void LodPyramid<VolumeType>::update(const Region& regChanged)
+	{
+		for (uint32_t uLevel = m_uNoOfLevelsInVolume; uLevel < getNoOfLevels(); uLevel++)
+		{
+			// The voxels of the level whose positions in the volume are within the changed Region (which is rounded inwards).
+			const int32_t iLevel = static_cast<int32_t>(uLevel);
+			Region regLevel(-((-regChanged.getLowerX()) >> iLevel), -((-regChanged.getLowerY()) >> iLevel), -((-regChanged.getLowerZ()) >> iLevel),
+				regChanged.getUpperX() >> iLevel, regChanged.getUpperY() >> iLevel, regChanged.getUpperZ() >> iLevel);
+			regLevel.cropTo(getRegionAtLevel(uLevel));
+			if (regLevel.isValid())
+			{
+				updateLevel(uLevel, regLevel);
+			}
+		}
+	}
+
+	template <typename VolumeType>
+	void LodPyramid<VolumeType>::updateLevel(uint32_t uLevel, const Region& region)
+	{
+		// The volume is read a slice at a time, and the voxels of the level are picked out of each slice.
+		const int32_t iScale = 1 << uLevel;
+		const int32_t iSliceWidth = (region.getWidthInVoxels() - 1) * iScale + 1;
+		const int32_t iSliceHeight = (region.getHeightInVoxels() - 1) * iScale + 1;
+		std::vector<VoxelType> vecSlice(static_cast<size_t>(iSliceWidth) * static_cast<size_t>(iSliceHeight));
+
+		for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		{
+			gatherVoxels(m_pVolume, Region(region.getLowerX() * iScale, region.getLowerY() * iScale, z * iScale,
+				region.getUpperX() * iScale, region.getUpperY() * iScale, z * iScale), vecSlice.data());
+
+			const Region regSlice(region.getLowerX(), region.getLowerY(), z, region.getUpperX(), region.getUpperY(), z);
+			m_vecLevels[uLevel - 1]->modifyVoxels(regSlice, [&](int32_t x, int32_t y, int32_t /*z*/, VoxelType /*tOld*/)
+			{
+				return vecSlice[(y - region.getLowerY()) * iScale * iSliceWidth + (x - region.getLowerX()) * iScale];
+			});
+		}
+	}
+}
@@ -24,6 +24,8 @@
 
 #include "PolyVox/RawVolume.h" // Currently used by exectureSAT() method - should be replaced by PagedVolume or a template parameter?
 
+#include <vector>
+
 namespace PolyVox
 {
 	/**
@@ -57,67 +59,58 @@ namespace PolyVox
 	template< typename SrcVolumeType, typename DstVolumeType, typename AccumulationType>
 	void LowPassFilter<SrcVolumeType, DstVolumeType, AccumulationType>::execute()
 	{
-		int32_t iSrcMinX = m_regSrc.getLowerX();
-		int32_t iSrcMinY = m_regSrc.getLowerY();
-		int32_t iSrcMinZ = m_regSrc.getLowerZ();
-
-		int32_t iSrcMaxX = m_regSrc.getUpperX();
-		int32_t iSrcMaxY = m_regSrc.getUpperY();
-		int32_t iSrcMaxZ = m_regSrc.getUpperZ();
-
-		int32_t iDstMinX = m_regDst.getLowerX();
-		int32_t iDstMinY = m_regDst.getLowerY();
-		int32_t iDstMinZ = m_regDst.getLowerZ();
-
-		//int32_t iDstMaxX = m_regDst.getUpperX();
-		//int32_t iDstMaxY = m_regDst.getUpperY();
-		//int32_t iDstMaxZ = m_regDst.getUpperZ();
+		typedef typename SrcVolumeType::VoxelType SrcVoxelType;
 
-		typename SrcVolumeType::Sampler srcSampler(m_pVolSrc);
+		// The source region is processed in blocks, each of which is copied into a buffer along with the voxels around it (see
+		// gatherVoxels()) so that the neighbours of each voxel are at fixed offsets. The blocks are aligned to multiples of their
+		// size, which is the default chunk size of the PagedVolume, so that they do not needlessly overlap several chunks.
+		const int32_t iBlockSideLength = 32;
+		const int32_t iBufferSideLength = iBlockSideLength + 2;
+		std::vector<SrcVoxelType> vecVoxels(iBufferSideLength * iBufferSideLength * iBufferSideLength);
 
-		for (int32_t iSrcZ = iSrcMinZ, iDstZ = iDstMinZ; iSrcZ <= iSrcMaxZ; iSrcZ++, iDstZ++)
+		for (int32_t iBlockZ = m_regSrc.getLowerZ() & ~(iBlockSideLength - 1); iBlockZ <= m_regSrc.getUpperZ(); iBlockZ += iBlockSideLength)
 		{
-			for (int32_t iSrcY = iSrcMinY, iDstY = iDstMinY; iSrcY <= iSrcMaxY; iSrcY++, iDstY++)
+			for (int32_t iBlockY = m_regSrc.getLowerY() & ~(iBlockSideLength - 1); iBlockY <= m_regSrc.getUpperY(); iBlockY += iBlockSideLength)
 			{
-				for (int32_t iSrcX = iSrcMinX, iDstX = iDstMinX; iSrcX <= iSrcMaxX; iSrcX++, iDstX++)
+				for (int32_t iBlockX = m_regSrc.getLowerX() & ~(iBlockSideLength - 1); iBlockX <= m_regSrc.getUpperX(); iBlockX += iBlockSideLength)
 				{
-					AccumulationType tSrcVoxel(0);
-					srcSampler.setPosition(iSrcX, iSrcY, iSrcZ);
-
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1ny1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1ny0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1ny1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx0py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx0py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx0py1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1nx1py1pz());
-
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1ny1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1ny0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1ny1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px0py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px0py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px0py1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel0px1py1pz());
-
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1ny1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1ny0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1ny1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px0py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px0py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px0py1pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1py1nz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1py0pz());
-					tSrcVoxel += static_cast<AccumulationType>(srcSampler.peekVoxel1px1py1pz());
-
-					tSrcVoxel /= 27;
-
-					//tSrcVoxel.setDensity(uDensity);
-					m_pVolDst->setVoxel(iSrcX, iSrcY, iSrcZ, static_cast<typename DstVolumeType::VoxelType>(tSrcVoxel));
+					Region regBlock(iBlockX, iBlockY, iBlockZ, iBlockX + iBlockSideLength - 1, iBlockY + iBlockSideLength - 1, iBlockZ + iBlockSideLength - 1);
+					regBlock.cropTo(m_regSrc);
+
+					Region regBuffer = regBlock;
+					regBuffer.grow(1);
+					gatherVoxels(m_pVolSrc, regBuffer, vecVoxels.data());
+					const int32_t iBufferWidth = regBuffer.getWidthInVoxels();
+					const int32_t iBufferSliceSize = iBufferWidth * regBuffer.getHeightInVoxels();
+
+					for (int32_t iSrcZ = regBlock.getLowerZ(); iSrcZ <= regBlock.getUpperZ(); iSrcZ++)
+					{
+						for (int32_t iSrcY = regBlock.getLowerY(); iSrcY <= regBlock.getUpperY(); iSrcY++)
+						{
+							const SrcVoxelType* pSrcVoxel = &(vecVoxels[(regBlock.getLowerX() - regBuffer.getLowerX()) + (iSrcY - regBuffer.getLowerY()) * iBufferWidth + (iSrcZ - regBuffer.getLowerZ()) * iBufferSliceSize]);
+							for (int32_t iSrcX = regBlock.getLowerX(); iSrcX <= regBlock.getUpperX(); iSrcX++, pSrcVoxel++)
+							{
+								AccumulationType tSrcVoxel(0);
+
+								// The neighbours are added in the same order as they used to be peeked from a Sampler.
+								for (int32_t iOffsetX = -1; iOffsetX <= 1; iOffsetX++)
+								{
+									for (int32_t iOffsetY = -1; iOffsetY <= 1; iOffsetY++)
+									{
+										for (int32_t iOffsetZ = -1; iOffsetZ <= 1; iOffsetZ++)
+										{
+											tSrcVoxel += static_cast<AccumulationType>(pSrcVoxel[iOffsetX + iOffsetY * iBufferWidth + iOffsetZ * iBufferSliceSize]);
+										}
+									}
+								}
+
+								tSrcVoxel /= 27;
+
+								//tSrcVoxel.setDensity(uDensity);
+								m_pVolDst->setVoxel(iSrcX, iSrcY, iSrcZ, static_cast<typename DstVolumeType::VoxelType>(tSrcVoxel));
+							}
+						}
+					}
 				}
 			}
 		}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_MarchingCubesLodSurfaceExtractor_H__
+#define __PolyVox_MarchingCubesLodSurfaceExtractor_H__
+
+#include "LodOctree.h"
+#include "LodPyramid.h"
+#include "MarchingCubesSurfaceExtractor.h"
+
+namespace PolyVox
+{
+	/// Generates a mesh for a block chosen by a LodOctree, using the Marching Cubes algorithm at the level of detail of the block.
+	///
+	/// A mesh extracted from a level of a LodPyramid does not normally join up with the mesh of a neighbouring block at the next level,
+	/// because the surface of the lower resolution block only passes through its own voxels on the face between them. Where it is next
+	/// to a block at a lower level of detail (see LodBlock::uCoarserNeighbours), this function adjusts the mesh of the higher resolution
+	/// block so that it matches on the shared face:
+	///
+	///   - The voxels on the shared face, edge or corner are replaced by interpolating the voxels of the next level. The surface of the
+	///     block then crosses the edges of the lower resolution voxels at the same places as that of its neighbour, and neighbouring
+	///     blocks at the same level (which make the same replacement) still match each other.
+	///   - Within each square of four lower resolution voxels on a shared face, the vertices which are not on its edges are moved onto
+	///     the line along which the surface of the neighbouring block crosses it.
+	///
+	/// This has the same purpose as the transition cells of the Transvoxel algorithm, but works with the existing Marching Cubes tables,
+	/// and the neighbouring block at the lower level of detail is extracted normally. As with the regular Marching Cubes algorithm there
+	/// can still be small holes where the surface crosses a face in one of the ambiguous configurations.
+	///
+	/// The resulting vertices are in the voxels of the level of the block, and the offset of the mesh is the lower corner of its
+	/// region, so both must be multiplied by 2^level to position the mesh in the volume.
+	template< typename VolumeType, typename ControllerType = DefaultMarchingCubesController<typename VolumeType::VoxelType> >
+	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesLodMesh(LodPyramid<VolumeType>* pyramid, const LodBlock& block, ControllerType controller = ControllerType());
+
+	/// Generates a mesh for a block chosen by a LodOctree, placing the result into a user-provided Mesh.
+	template< typename VolumeType, typename MeshType, typename ControllerType = DefaultMarchingCubesController<typename VolumeType::VoxelType> >
+	void extractMarchingCubesLodMeshCustom(LodPyramid<VolumeType>* pyramid, const LodBlock& block, MeshType* result, ControllerType controller = ControllerType());
+}
+
+#include "MarchingCubesLodSurfaceExtractor.inl"
+
+#endif //__PolyVox_MarchingCubesLodSurfaceExtractor_H__
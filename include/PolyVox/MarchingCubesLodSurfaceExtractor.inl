@@ -0,0 +1,367 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+#include "Impl/Timer.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace PolyVox
+{
+	/// This is probably the version of the level of detail extraction which you will want to use initially, in the same way as
+	/// extractMarchingCubesMesh().
+	template< typename VolumeType, typename ControllerType >
+	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesLodMesh(LodPyramid<VolumeType>* pyramid, const LodBlock& block, ControllerType controller)
+	{
+		Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > result;
+		extractMarchingCubesLodMeshCustom<VolumeType, Mesh<MarchingCubesVertex<typename VolumeType::VoxelType>, DefaultIndexType > >(pyramid, block, &result, controller);
+		return result;
+	}
+
+	/// The block does not have to come from a LodOctree, but if it has any coarser neighbours then the corners of its region must be
+	/// even (as they are for the blocks of an octree) so that its faces lie on the voxels of the next level. Blocks at the full
+	/// resolution with no coarser neighbours give the same mesh as extractMarchingCubesMesh() for the same region (though the
+	/// vertices may be in a different order).
+	template< typename VolumeType, typename MeshType, typename ControllerType >
+	void extractMarchingCubesLodMeshCustom(LodPyramid<VolumeType>* pyramid, const LodBlock& block, MeshType* result, ControllerType controller)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+
+		const Region& region = block.region;
+		const bool bHasCoarserNeighbours = (block.uCoarserNeighbours != 0);
+
+		// Validate parameters
+		POLYVOX_THROW_IF(pyramid == nullptr, std::invalid_argument, "Provided pyramid cannot be null");
+		POLYVOX_THROW_IF(result == nullptr, std::invalid_argument, "Provided mesh cannot be null");
+		POLYVOX_THROW_IF(block.uLevel >= pyramid->getNoOfLevels(), std::invalid_argument, "The level of the block is not in the pyramid");
+		POLYVOX_THROW_IF(bHasCoarserNeighbours && (block.uLevel + 1 >= pyramid->getNoOfLevels()), std::invalid_argument,
+			"The pyramid has no level for the coarser neighbours of the block");
+		POLYVOX_THROW_IF(bHasCoarserNeighbours && (((region.getLowerX() | region.getLowerY() | region.getLowerZ() |
+			region.getUpperX() | region.getUpperY() | region.getUpperZ()) & 1) != 0), std::invalid_argument,
+			"The corners of a block with coarser neighbours must be even");
+
+		// For profiling this function
+		Timer timer;
+
+		result->clear();
+
+		const int32_t iWidth = region.getWidthInVoxels();
+		const int32_t iHeight = region.getHeightInVoxels();
+		const int32_t iDepth = region.getDepthInVoxels();
+
+		// The voxels of the block are copied into a buffer along with the layer of voxels around it, which is needed for the normals.
+		// The voxel at (x, y, z) relative to the region is found at (x + 1, y + 1, z + 1) in the buffer.
+		const int32_t iRowLength = iWidth + 2;
+		const int32_t iSliceSize = iRowLength * (iHeight + 2);
+		std::vector<VoxelType> vecVoxels(static_cast<size_t>(iSliceSize) * static_cast<size_t>(iDepth + 2));
+		pyramid->gatherVoxelsAtLevel(block.uLevel, Region(region.getLowerCorner() - Vector3DInt32(1, 1, 1), region.getUpperCorner() + Vector3DInt32(1, 1, 1)), vecVoxels.data());
+		auto getIndex = [&](int32_t x, int32_t y, int32_t z)
+		{
+			return (z + 1) * iSliceSize + (y + 1) * iRowLength + (x + 1);
+		};
+
+		std::vector<float> vecDensities(vecVoxels.size());
+		for (size_t uIndex = 0; uIndex < vecVoxels.size(); uIndex++)
+		{
+			vecDensities[uIndex] = static_cast<float>(controller.convertToDensity(vecVoxels[uIndex]));
+		}
+
+		// The voxels which the block shares with a neighbour at the next level are replaced by interpolating the voxels of that level,
+		// which means averaging the two or four voxels around them (those with even positions are the same as at the next level).
+		if (bHasCoarserNeighbours)
+		{
+			const Region regCoarse(region.getLowerX() / 2, region.getLowerY() / 2, region.getLowerZ() / 2, region.getUpperX() / 2, region.getUpperY() / 2, region.getUpperZ() / 2);
+			const int32_t iCoarseWidth = regCoarse.getWidthInVoxels();
+			const int32_t iCoarseHeight = regCoarse.getHeightInVoxels();
+			std::vector<VoxelType> vecCoarseVoxels(static_cast<size_t>(iCoarseWidth) * static_cast<size_t>(iCoarseHeight) * static_cast<size_t>(regCoarse.getDepthInVoxels()));
+			pyramid->gatherVoxelsAtLevel(block.uLevel + 1, regCoarse, vecCoarseVoxels.data());
+			auto getCoarseDensity = [&](int32_t x, int32_t y, int32_t z)
+			{
+				return static_cast<float>(controller.convertToDensity(vecCoarseVoxels[(z * iCoarseHeight + y) * iCoarseWidth + x]));
+			};
+
+			for (int32_t z = 0; z < iDepth; z++)
+			{
+				const int32_t iZDir = (z == 0) ? -1 : ((z == iDepth - 1) ? 1 : 0);
+				for (int32_t y = 0; y < iHeight; y++)
+				{
+					const int32_t iYDir = (y == 0) ? -1 : ((y == iHeight - 1) ? 1 : 0);
+
+					// Only the voxels on the faces of the block are shared, so in the middle of the block just the ends of the row are.
+					const int32_t iXStep = ((iYDir == 0) && (iZDir == 0)) ? (std::max)(iWidth - 1, 1) : 1;
+					for (int32_t x = 0; x < iWidth; x += iXStep)
+					{
+						const int32_t iXDir = (x == 0) ? -1 : ((x == iWidth - 1) ? 1 : 0);
+
+						// A voxel on an edge or corner of the block is shared with the blocks beyond each of the faces which meet there
+						// as well as the one beyond the edge or corner itself.
+						bool bShared = false;
+						for (int32_t iDirs = 1; iDirs < 8; iDirs++)
+						{
+							const int32_t iX = (iDirs & 1) ? iXDir : 0;
+							const int32_t iY = (iDirs & 2) ? iYDir : 0;
+							const int32_t iZ = (iDirs & 4) ? iZDir : 0;
+							if (((iX != 0) || (iY != 0) || (iZ != 0)) && (block.uCoarserNeighbours & lodNeighbourBit(iX, iY, iZ)))
+							{
+								bShared = true;
+							}
+						}
+
+						if (bShared)
+						{
+							float fDensity = 0.0f;
+							for (int32_t iCorner = 0; iCorner < 8; iCorner++)
+							{
+								fDensity += getCoarseDensity((x + (iCorner & 1)) / 2, (y + ((iCorner >> 1) & 1)) / 2, (z + (iCorner >> 2)) / 2);
+							}
+							vecDensities[getIndex(x, y, z)] = fDensity * 0.125f;
+						}
+					}
+				}
+			}
+		}
+
+		const float fThreshold = static_cast<float>(controller.getThreshold());
+
+		// Nothing needs to be done if all the voxels of the block are on the same side of the threshold.
+		uint32_t uNoOfBelow = 0;
+		for (int32_t z = 0; z < iDepth; z++)
+		{
+			for (int32_t y = 0; y < iHeight; y++)
+			{
+				for (int32_t x = 0; x < iWidth; x++)
+				{
+					uNoOfBelow += (vecDensities[getIndex(x, y, z)] < fThreshold) ? 1 : 0;
+				}
+			}
+		}
+
+		if ((uNoOfBelow != 0) && (uNoOfBelow != static_cast<uint32_t>(iWidth * iHeight * iDepth)))
+		{
+			auto computeGradient = [&](int32_t iIndex)
+			{
+				return Vector3DFloat(vecDensities[iIndex - 1] - vecDensities[iIndex + 1],
+					vecDensities[iIndex - iRowLength] - vecDensities[iIndex + iRowLength],
+					vecDensities[iIndex - iSliceSize] - vecDensities[iIndex + iSliceSize]);
+			};
+
+			// Moves a vertex on a face shared with a block at the next level onto the line along which the surface of that block crosses
+			// the square of four of its voxels around the vertex. The square lies in the plane of the given axes.
+			auto moveOntoCoarserSurface = [&](Vector3DFloat& v3dPosition, const Vector3DInt32& v3dSquareLowerCorner, uint32_t uAxisA, uint32_t uAxisB)
+			{
+				// The corners of the square in order around it, and where the surface crosses each of its sides.
+				Vector3DFloat av3dCrossings[4];
+				bool abCrossed[4];
+				bool abBelow[4];
+				float afDensities[4];
+				Vector3DInt32 av3dCorners[4];
+				for (int32_t iCorner = 0; iCorner < 4; iCorner++)
+				{
+					av3dCorners[iCorner] = v3dSquareLowerCorner;
+					av3dCorners[iCorner].setElement(uAxisA, v3dSquareLowerCorner.getElement(uAxisA) + (((iCorner == 1) || (iCorner == 2)) ? 2 : 0));
+					av3dCorners[iCorner].setElement(uAxisB, v3dSquareLowerCorner.getElement(uAxisB) + ((iCorner >= 2) ? 2 : 0));
+					afDensities[iCorner] = vecDensities[getIndex(av3dCorners[iCorner].getX(), av3dCorners[iCorner].getY(), av3dCorners[iCorner].getZ())];
+					abBelow[iCorner] = afDensities[iCorner] < fThreshold;
+				}
+
+				uint32_t uNoOfCrossings = 0;
+				for (int32_t iSide = 0; iSide < 4; iSide++)
+				{
+					const int32_t iNext = (iSide + 1) & 3;
+					abCrossed[iSide] = (abBelow[iSide] != abBelow[iNext]);
+					if (abCrossed[iSide])
+					{
+						const float fInterp = (fThreshold - afDensities[iSide]) / (afDensities[iNext] - afDensities[iSide]);
+						const Vector3DFloat v3dStart(static_cast<float>(av3dCorners[iSide].getX()), static_cast<float>(av3dCorners[iSide].getY()), static_cast<float>(av3dCorners[iSide].getZ()));
+						const Vector3DFloat v3dEnd(static_cast<float>(av3dCorners[iNext].getX()), static_cast<float>(av3dCorners[iNext].getY()), static_cast<float>(av3dCorners[iNext].getZ()));
+						av3dCrossings[iSide] = v3dStart + (v3dEnd - v3dStart) * fInterp;
+						uNoOfCrossings++;
+					}
+				}
+
+				// Each line cuts off the corner between two crossed sides. If all four sides are crossed then the corners which are
+				// connected are decided by the middle of the square, which is the average of the corners.
+				int32_t aiLineStarts[2];
+				uint32_t uNoOfLines = 0;
+				if (uNoOfCrossings == 2)
+				{
+					for (int32_t iSide = 0; iSide < 4; iSide++)
+					{
+						if (abCrossed[iSide] && (uNoOfLines == 0))
+						{
+							aiLineStarts[uNoOfLines++] = iSide;
+						}
+					}
+				}
+				else if (uNoOfCrossings == 4)
+				{
+					const float fMiddle = (afDensities[0] + afDensities[1] + afDensities[2] + afDensities[3]) * 0.25f;
+					const int32_t iFirstCutOffCorner = ((fMiddle < fThreshold) == abBelow[0]) ? 1 : 0;
+					aiLineStarts[uNoOfLines++] = (iFirstCutOffCorner + 3) & 3;
+					aiLineStarts[uNoOfLines++] = (iFirstCutOffCorner + 1) & 3;
+				}
+
+				float fNearestDistanceSquared = (std::numeric_limits<float>::max)();
+				Vector3DFloat v3dNearest = v3dPosition;
+				for (uint32_t uLine = 0; uLine < uNoOfLines; uLine++)
+				{
+					// The line runs between the crossing on the side where it starts and the next crossed side.
+					int32_t iEnd = (aiLineStarts[uLine] + 1) & 3;
+					while (!abCrossed[iEnd])
+					{
+						iEnd = (iEnd + 1) & 3;
+					}
+
+					const Vector3DFloat& v3dStart = av3dCrossings[aiLineStarts[uLine]];
+					const Vector3DFloat v3dLine = av3dCrossings[iEnd] - v3dStart;
+					const float fLengthSquared = v3dLine.lengthSquared();
+					const float fAlong = (fLengthSquared > 0.0f) ? (std::min)((std::max)((v3dPosition - v3dStart).dot(v3dLine) / fLengthSquared, 0.0f), 1.0f) : 0.0f;
+					const Vector3DFloat v3dOnLine = v3dStart + v3dLine * fAlong;
+					const float fDistanceSquared = (v3dOnLine - v3dPosition).lengthSquared();
+					if (fDistanceSquared < fNearestDistanceSquared)
+					{
+						fNearestDistanceSquared = fDistanceSquared;
+						v3dNearest = v3dOnLine;
+					}
+				}
+				v3dPosition = v3dNearest;
+			};
+
+			// A vertex lies on the edge between two voxels, so it is only created the first time a cell uses the edge.
+			std::vector<int32_t> vecEdgeVertices(static_cast<size_t>(iWidth) * static_cast<size_t>(iHeight) * static_cast<size_t>(iDepth) * 3, -1);
+			auto getEdgeVertex = [&](int32_t x, int32_t y, int32_t z, uint32_t uAxis) -> uint32_t
+			{
+				int32_t& iVertex = vecEdgeVertices[(((z * iHeight) + y) * iWidth + x) * 3 + uAxis];
+				if (iVertex == -1)
+				{
+					const int32_t iIndex0 = getIndex(x, y, z);
+					const int32_t iIndex1 = iIndex0 + ((uAxis == 0) ? 1 : ((uAxis == 1) ? iRowLength : iSliceSize));
+					const float fInterp = (fThreshold - vecDensities[iIndex0]) / (vecDensities[iIndex1] - vecDensities[iIndex0]);
+
+					// Compute the position
+					Vector3DFloat v3dPosition(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+					v3dPosition.setElement(uAxis, v3dPosition.getElement(uAxis) + fInterp);
+
+					// A vertex on a face shared with a block at the next level needs to be moved if it is on one of the lines between the
+					// voxels of that level (i.e. its position along the remaining axis is odd).
+					if (bHasCoarserNeighbours)
+					{
+						const Vector3DInt32 v3dVoxel(x, y, z);
+						for (uint32_t uFaceAxis = 0; uFaceAxis < 3; uFaceAxis++)
+						{
+							const uint32_t uOtherAxis = 3 - uFaceAxis - uAxis;
+							const int32_t iFaceSize = (uFaceAxis == 0) ? iWidth : ((uFaceAxis == 1) ? iHeight : iDepth);
+							const int32_t iFacePos = v3dVoxel.getElement(uFaceAxis);
+							if ((uFaceAxis != uAxis) && ((iFacePos == 0) || (iFacePos == iFaceSize - 1)) && ((v3dVoxel.getElement(uOtherAxis) & 1) != 0))
+							{
+								Vector3DInt32 v3dFaceDir(0, 0, 0);
+								v3dFaceDir.setElement(uFaceAxis, (iFacePos == 0) ? -1 : 1);
+								if (block.uCoarserNeighbours & lodNeighbourBit(v3dFaceDir.getX(), v3dFaceDir.getY(), v3dFaceDir.getZ()))
+								{
+									Vector3DInt32 v3dSquareLowerCorner = v3dVoxel;
+									v3dSquareLowerCorner.setElement(uAxis, v3dVoxel.getElement(uAxis) & ~1);
+									v3dSquareLowerCorner.setElement(uOtherAxis, v3dVoxel.getElement(uOtherAxis) - 1);
+									moveOntoCoarserSurface(v3dPosition, v3dSquareLowerCorner, uAxis, uOtherAxis);
+								}
+							}
+						}
+					}
+
+					// Compute the normal
+					Vector3DFloat v3dNormal = (computeGradient(iIndex1) * fInterp) + (computeGradient(iIndex0) * (1 - fInterp));
+
+					// The gradient for a voxel can be zero (e.g. solid voxel surrounded by empty ones) and so
+					// the interpolated normal can also be zero (e.g. a grid of alternating solid and empty voxels).
+					if (v3dNormal.lengthSquared() > 0.000001f)
+					{
+						v3dNormal.normalise();
+					}
+
+					MarchingCubesVertex<VoxelType> surfaceVertex;
+					surfaceVertex.encodedPosition = Vector3DUint16(static_cast<uint16_t>(v3dPosition.getX() * 256.0f), static_cast<uint16_t>(v3dPosition.getY() * 256.0f), static_cast<uint16_t>(v3dPosition.getZ() * 256.0f));
+					surfaceVertex.encodedNormal = encodeNormal(v3dNormal);
+
+					// Allow the controller to decide how the material should be derived from the voxels.
+					surfaceVertex.data = controller.blendMaterials(vecVoxels[iIndex0], vecVoxels[iIndex1], fInterp);
+
+					iVertex = static_cast<int32_t>(result->addVertex(surfaceVertex));
+				}
+				return static_cast<uint32_t>(iVertex);
+			};
+
+			// The voxel at the start of each edge of a cell (relative to its lower corner) and the axis along which the edge lies, in
+			// the order used by the Marching Cubes tables.
+			static const int8_t edgeStarts[12][4] =
+			{
+				{ 0, 0, 0, 0 }, { 1, 0, 0, 1 }, { 0, 1, 0, 0 }, { 0, 0, 0, 1 },
+				{ 0, 0, 1, 0 }, { 1, 0, 1, 1 }, { 0, 1, 1, 0 }, { 0, 0, 1, 1 },
+				{ 0, 0, 0, 2 }, { 1, 0, 0, 2 }, { 1, 1, 0, 2 }, { 0, 1, 0, 2 }
+			};
+
+			for (int32_t z = 0; z < iDepth - 1; z++)
+			{
+				for (int32_t y = 0; y < iHeight - 1; y++)
+				{
+					for (int32_t x = 0; x < iWidth - 1; x++)
+					{
+						// Each bit of the cell index specifies whether a given corner of the cell is below the threshold, in the same
+						// order as extractMarchingCubesMesh() uses.
+						uint8_t uCellIndex = 0;
+						for (int32_t iCorner = 0; iCorner < 8; iCorner++)
+						{
+							if (vecDensities[getIndex(x + (iCorner & 1), y + ((iCorner >> 1) & 1), z + (iCorner >> 2))] < fThreshold)
+							{
+								uCellIndex |= static_cast<uint8_t>(1 << iCorner);
+							}
+						}
+
+						if (edgeTable[uCellIndex] == 0)
+						{
+							continue;
+						}
+
+						for (int i = 0; triTable[uCellIndex][i] != -1; i += 3)
+						{
+							uint32_t auIndices[3];
+							for (int j = 0; j < 3; j++)
+							{
+								const int8_t* pEdgeStart = edgeStarts[triTable[uCellIndex][i + j]];
+								auIndices[j] = getEdgeVertex(x + pEdgeStart[0], y + pEdgeStart[1], z + pEdgeStart[2], static_cast<uint32_t>(pEdgeStart[3]));
+							}
+							result->addTriangle(auIndices[0], auIndices[1], auIndices[2]);
+						}
+					}
+				}
+			}
+		}
+
+		result->setOffset(region.getLowerCorner());
+
+		POLYVOX_LOG_TRACE("Marching cubes level of detail extraction took ", timer.elapsedTimeInMilliSeconds(),
+			"ms (Region size = ", region.getWidthInVoxels(), "x", region.getHeightInVoxels(),
+			"x", region.getDepthInVoxels(), ", level ", block.uLevel, ")");
+	}
+}
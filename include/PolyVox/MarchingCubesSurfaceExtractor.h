@@ -30,6 +30,7 @@
 
 #include "Array.h"
 #include "DefaultMarchingCubesController.h"
+#include "ExtractionContext.h"
 #include "Mesh.h"
 #include "Vertex.h"
 
@@ -70,7 +71,15 @@ namespace PolyVox
 
 	/// Generates a mesh from the voxel data using the Marching Cubes algorithm, placing the result into a user-provided Mesh.
 	template< typename VolumeType, typename MeshType, typename ControllerType = DefaultMarchingCubesController<typename VolumeType::VoxelType> >
-	void extractMarchingCubesMeshCustom(VolumeType* volData, Region region, MeshType* result, ControllerType controller = ControllerType());
+	void extractMarchingCubesMeshCustom(VolumeType* volData, Region region, MeshType* result, ControllerType controller = ControllerType(), ExtractionContext* pContext = nullptr);
+
+	/// Generates the same mesh as extractMarchingCubesMesh(), but uses several threads to do so.
+	template< typename VolumeType, typename ControllerType = DefaultMarchingCubesController<typename VolumeType::VoxelType> >
+	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesMeshParallel(VolumeType* volData, Region region, uint32_t uNoOfThreads = 0, ControllerType controller = ControllerType());
+
+	/// Generates the same mesh as extractMarchingCubesMeshCustom(), but uses several threads to do so.
+	template< typename VolumeType, typename MeshType, typename ControllerType = DefaultMarchingCubesController<typename VolumeType::VoxelType> >
+	void extractMarchingCubesMeshParallelCustom(VolumeType* volData, Region region, MeshType* result, uint32_t uNoOfThreads = 0, ControllerType controller = ControllerType());
 }
 
 #include "MarchingCubesSurfaceExtractor.inl"
@@ -22,8 +22,18 @@
 * SOFTWARE.
 *******************************************************************************/
 
+#include "Impl/ThresholdClassification.h"
+#include "Impl/ValueRange.h"
 #include "Impl/Timer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
 namespace PolyVox
 {
 	////////////////////////////////////////////////////////////////////////////////
@@ -147,6 +157,28 @@ namespace PolyVox
 			);
 	}
 
+	/// The same as the other version, but for a voxel which has been copied into a buffer along with its neighbours. The neighbouring
+	/// slices can be held separately from the voxel's own slice, but the rows within each slice must be the given distance apart.
+	template< typename VoxelType, typename ControllerType>
+	Vector3DFloat computeCentralDifferenceGradient(const VoxelType* pPreviousSlice, const VoxelType* pSlice, const VoxelType* pNextSlice, uint32_t uIndex, uint32_t uRowLength, ControllerType& controller)
+	{
+		float voxel1nx = static_cast<float>(controller.convertToDensity(pSlice[uIndex - 1]));
+		float voxel1px = static_cast<float>(controller.convertToDensity(pSlice[uIndex + 1]));
+
+		float voxel1ny = static_cast<float>(controller.convertToDensity(pSlice[uIndex - uRowLength]));
+		float voxel1py = static_cast<float>(controller.convertToDensity(pSlice[uIndex + uRowLength]));
+
+		float voxel1nz = static_cast<float>(controller.convertToDensity(pPreviousSlice[uIndex]));
+		float voxel1pz = static_cast<float>(controller.convertToDensity(pNextSlice[uIndex]));
+
+		return Vector3DFloat
+			(
+			voxel1nx - voxel1px,
+			voxel1ny - voxel1py,
+			voxel1nz - voxel1pz
+			);
+	}
+
 	// This 'sobel' version of gradient estimation provides better (smoother) normals than the central difference version.
 	// Even with the 16-bit normal encoding it does seem to make a difference, so is probably worth keeping. However, there
 	// is no way to call it at the moment beyond modifying the main Marching Cubes function below to call this function
@@ -242,79 +274,251 @@ namespace PolyVox
 	// Surface extraction
 	////////////////////////////////////////////////////////////////////////////////
 
-	/// This is probably the version of Marching Cubes extraction which you will want to use initially, at least
-	/// until you determine you have a need for the extra functionality provied by extractMarchingCubesMeshCustom().
+	/// The default controller for primitive voxel types uses the voxel values as densities, so the range of values in a region
+	/// (see BaseVolume::getRegionValueRange()) can tell us that it is entirely above or below the threshold and so cannot contain
+	/// any of the surface. Other controllers can convert voxels to densities however they like, so this never applies to them.
 	template< typename VolumeType, typename ControllerType >
-	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesMesh(VolumeType* volData, Region region, ControllerType controller)
+	bool isRegionOnOneSideOfThreshold(VolumeType* /*volData*/, const Region& /*region*/, ControllerType& /*controller*/, bool& /*bBelow*/, std::false_type)
 	{
-		Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > result;
-		extractMarchingCubesMeshCustom<VolumeType, Mesh<MarchingCubesVertex<typename VolumeType::VoxelType>, DefaultIndexType > >(volData, region, &result, controller);
-		return result;
+		return false;
 	}
 
-	/// This version of the function performs the extraction into a user-provided mesh rather than allocating a mesh automatically.
-	/// There are a few reasons why this might be useful to more advanced users:
-	///
-	///   1. It leaves the user in control of memory allocation and would allow them to implement e.g. a mesh pooling system.
-	///   2. The user-provided mesh could have a different index type (e.g. 16-bit indices) to reduce memory usage.
-	///   3. The user could provide a custom mesh class, e.g a thin wrapper around an OpenGL VBO to allow direct writing into this structure.
-	///
-	/// We don't provide a default MeshType here. If the user doesn't want to provide a MeshType then it probably makes
-	/// more sense to use the other variant of this function where the mesh is a return value rather than a parameter.
-	///
-	/// Note: This function is called 'extractMarchingCubesMeshCustom' rather than 'extractMarchingCubesMesh' to avoid ambiguity when only three parameters
-	/// are provided (would the third parameter be a controller or a mesh?). It seems this can be fixed by using enable_if/static_assert to emulate concepts,
-	/// but this is relatively complex and I haven't done it yet. Could always add it later as another overload.
-	template< typename VolumeType, typename MeshType, typename ControllerType >
-	void extractMarchingCubesMeshCustom(VolumeType* volData, Region region, MeshType* result, ControllerType controller)
+	template< typename VolumeType, typename ControllerType >
+	bool isRegionOnOneSideOfThreshold(VolumeType* volData, const Region& region, ControllerType& controller, bool& bBelow, std::true_type)
 	{
-		// Validate parameters
-		POLYVOX_THROW_IF(volData == nullptr, std::invalid_argument, "Provided volume cannot be null");
-		POLYVOX_THROW_IF(result == nullptr, std::invalid_argument, "Provided mesh cannot be null");
+		typename VolumeType::VoxelType tMin;
+		typename VolumeType::VoxelType tMax;
+		if (!volData->getRegionValueRange(region, tMin, tMax))
+		{
+			return false;
+		}
 
-		// For profiling this function
-		Timer timer;
+		const typename ControllerType::DensityType tThreshold = controller.getThreshold();
+		if (tMax < tThreshold)
+		{
+			bBelow = true;
+			return true;
+		}
+		if (!(tMin < tThreshold))
+		{
+			bBelow = false;
+			return true;
+		}
+		return false;
+	}
 
-		// Performance note: Profiling indicates that simply adding vertices and indices to the std::vector is one 
-		// of the bottlenecks when generating the mesh. Reserving space in advance helps here but is wasteful in the 
-		// common case that no/few vertices are generated. Maybe it's worth reserving a couple of thousand or so?
-		// Alternatively, maybe the docs should suggest the user reserves some space in the mesh they pass in?
-		result->clear();
+	template< typename VolumeType, typename ControllerType >
+	bool isRegionOnOneSideOfThreshold(VolumeType* volData, const Region& region, ControllerType& controller, bool& bBelow)
+	{
+		typedef typename VolumeType::VoxelType VoxelType;
+		return isRegionOnOneSideOfThreshold(volData, region, controller, bBelow, std::integral_constant<bool,
+			std::is_same<ControllerType, DefaultMarchingCubesController<VoxelType> >::value && HasValueRange<VoxelType>::value>());
+	}
 
+	/// The scratch buffers which extractMarchingCubesSlices() keeps in an ExtractionContext.
+	namespace MarchingCubesBuffers
+	{
+		enum MarchingCubesBuffer
+		{
+			RowDensities,
+			RowBelowThreshold,
+			RowStates,
+			PreviousRowStates,
+			RowBlockStates,
+			PreviousRowCellIndices,
+			PreviousSliceCellIndices,
+			Indices,
+			PreviousIndices,
+			Slices // Four buffers, starting from this id
+		};
+	}
+
+	/// Performs the extraction for the slices of the region from uFirstSlice up to (but not including) uEndSlice, adding the vertices
+	/// and triangles to the mesh. Vertex positions are still relative to the lower corner of the whole region. As with the first slice
+	/// of the region, the first slice processed here only generates those vertices which lie within it, and no triangles. When using
+	/// this to split up the region the first slice should therefore overlap with the last slice of the previous part.
+	///
+	/// If pFirstSliceIndices and pLastSliceIndices are provided then they receive the indices of the vertices which were generated
+	/// on the X and Y edges of the first and last slices respectively. Edges without a vertex are given an index of -1.
+	///
+	/// All of the scratch buffers are taken from the context, so they are only allocated if they are larger than last time.
+	template< typename VolumeType, typename MeshType, typename ControllerType >
+	void extractMarchingCubesSlices(VolumeType* volData, const Region& region, uint32_t uFirstSlice, uint32_t uEndSlice, MeshType* result, ControllerType& controller,
+		ExtractionContext& context, Array<2, Vector3DInt32>* pFirstSliceIndices = nullptr, Array<2, Vector3DInt32>* pLastSliceIndices = nullptr)
+	{
 		// Store some commonly used values for performance and convienience
 		const uint32_t uRegionWidthInVoxels = region.getWidthInVoxels();
 		const uint32_t uRegionHeightInVoxels = region.getHeightInVoxels();
-		const uint32_t uRegionDepthInVoxels = region.getDepthInVoxels();
 
 		typename ControllerType::DensityType tThreshold = controller.getThreshold();
 
+		// Before its cells are processed each row of voxels is converted to densities and classified against the threshold in
+		// one go, which allows the comparisons to be vectorised for the common density types (see ThresholdClassification.h).
+		const SimdLevel eSimdLevel = getSupportedSimdLevel();
+		std::vector<typename ControllerType::DensityType>& vecRowDensities = context.getBuffer<typename ControllerType::DensityType>(MarchingCubesBuffers::RowDensities);
+		std::vector<uint32_t>& vecRowBelowThreshold = context.getBuffer<uint32_t>(MarchingCubesBuffers::RowBelowThreshold);
+		vecRowDensities.resize(uRegionWidthInVoxels);
+		vecRowBelowThreshold.resize(classificationSizeInWords(uRegionWidthInVoxels));
+
+		// For each row of the current and previous slice this records whether every cell in the row is entirely above (0) or
+		// entirely below (255) the threshold. Such rows contain none of the surface, and they allow the following rows to be
+		// skipped if their voxels are also all on the same side of the threshold.
+		const uint16_t uMixedRow = 256;
+		std::vector<uint16_t>& vecRowStates = context.getBuffer<uint16_t>(MarchingCubesBuffers::RowStates);
+		std::vector<uint16_t>& vecPreviousRowStates = context.getBuffer<uint16_t>(MarchingCubesBuffers::PreviousRowStates);
+		vecRowStates.assign(uRegionHeightInVoxels, uMixedRow);
+		vecPreviousRowStates.assign(uRegionHeightInVoxels, uMixedRow);
+
+		// If the voxels of a row are all on the same side of the threshold, and so are the cells of the previous row and of the
+		// same row in the previous slice, then every cell in the row has the same index and none of them contain the surface.
+		auto canSkipRow = [&](uint16_t uRowState, uint32_t uYRegSpace, uint32_t uZRegSpace)
+		{
+			return (uRowState != uMixedRow) && (uYRegSpace > 0) && (uZRegSpace > uFirstSlice) &&
+				(vecRowStates[uYRegSpace - 1] == uRowState) && (vecPreviousRowStates[uYRegSpace] == uRowState);
+		};
+
+		// The volume may also be able to tell us that blocks of rows are entirely above or below the threshold, in which case
+		// we don't need to classify their voxels (see isRegionOnOneSideOfThreshold()). Each block covers a number of rows in
+		// each of a number of slices, and the states of the blocks for the current group of slices are held here. If all the
+		// blocks of the group have the same state then so does the whole of each of its slices. Such a slice is skipped without
+		// even being read if the slice before it has the same state, as then none of its cells can contain the surface.
+		const uint32_t uRowBlockSize = 8;
+		std::vector<uint16_t>& vecRowBlockStates = context.getBuffer<uint16_t>(MarchingCubesBuffers::RowBlockStates);
+		vecRowBlockStates.assign((uRegionHeightInVoxels + uRowBlockSize - 1) / uRowBlockSize, uMixedRow);
+		uint16_t uGroupState = uMixedRow;
+		uint16_t uPreviousSliceState = uMixedRow;
+
 		// A naive implemetation of Marching Cubes might sample the eight corner voxels of every cell to determine the cell index. 
 		// However, when processing the cells sequentially we cn observe that many of the voxels are shared with previous adjacent 
 		// cells, and so we can obtain these by careful bit-shifting. These variables keep track of previous cells for this purpose.
 		// We don't clear the arrays because the algorithm ensures that we only read from elements we have previously written to.
+		// The element at (x, y) of each slice sized array is found at (y * width + x).
+		const uint32_t uNoOfSliceElements = uRegionWidthInVoxels * uRegionHeightInVoxels;
 		uint8_t uPreviousCellIndex = 0;
-		Array1DUint8 pPreviousRowCellIndices(uRegionWidthInVoxels);
-		Array2DUint8 pPreviousSliceCellIndices(uRegionWidthInVoxels, uRegionHeightInVoxels);
+		std::vector<uint8_t>& vecPreviousRowCellIndices = context.getBuffer<uint8_t>(MarchingCubesBuffers::PreviousRowCellIndices);
+		std::vector<uint8_t>& vecPreviousSliceCellIndices = context.getBuffer<uint8_t>(MarchingCubesBuffers::PreviousSliceCellIndices);
+		vecPreviousRowCellIndices.resize(uRegionWidthInVoxels);
+		vecPreviousSliceCellIndices.resize(uNoOfSliceElements);
+		uint8_t* pPreviousRowCellIndices = vecPreviousRowCellIndices.data();
+		uint8_t* pPreviousSliceCellIndices = vecPreviousSliceCellIndices.data();
 
 		// A given vertex may be shared by multiple triangles, so we need to keep track of the indices into the vertex array.
 		// We don't clear the arrays because the algorithm ensures that we only read from elements we have previously written to.
-		Array<2, Vector3DInt32> pIndices(uRegionWidthInVoxels, uRegionHeightInVoxels);
-		Array<2, Vector3DInt32> pPreviousIndices(uRegionWidthInVoxels, uRegionHeightInVoxels);
-
-		// A sampler pointing at the beginning of the region, which gets incremented to always point at the beginning of a slice.
-		typename VolumeType::Sampler startOfSlice(volData);
-		startOfSlice.setPosition(region.getLowerX(), region.getLowerY(), region.getLowerZ());
+		std::vector<Vector3DInt32>& vecIndices = context.getBuffer<Vector3DInt32>(MarchingCubesBuffers::Indices);
+		std::vector<Vector3DInt32>& vecPreviousIndices = context.getBuffer<Vector3DInt32>(MarchingCubesBuffers::PreviousIndices);
+		vecIndices.resize(uNoOfSliceElements);
+		vecPreviousIndices.resize(uNoOfSliceElements);
+		Vector3DInt32* pIndices = vecIndices.data();
+		Vector3DInt32* pPreviousIndices = vecPreviousIndices.data();
+
+		// The caller can only tell which edges had vertices if the other edges are marked.
+		if (pFirstSliceIndices || pLastSliceIndices)
+		{
+			std::fill(pIndices, pIndices + uNoOfSliceElements, Vector3DInt32(-1, -1, -1));
+			std::fill(pPreviousIndices, pPreviousIndices + uNoOfSliceElements, Vector3DInt32(-1, -1, -1));
+		}
 
-		for (uint32_t uZRegSpace = 0; uZRegSpace < uRegionDepthInVoxels; uZRegSpace++)
+		// Rather than reading the voxels through a Sampler, each slice is copied into a buffer along with the voxels around it (see
+		// gatherVoxels()), so the voxel at (x, y) relative to the region is found at (x + 1, y + 1) in the buffer. The normals need
+		// the slices on either side, and the vertices on the edges along z need the previous slice and those on either side of it,
+		// so the last four slices are kept. The buffer for a slice is chosen by the last two bits of its position in the region.
+		// Slices are only gathered once they are needed, so those around the slices which are skipped are never read at all.
+		const uint32_t uBufferWidth = uRegionWidthInVoxels + 2;
+		std::vector<typename VolumeType::VoxelType>* vecSlices[4];
+		int32_t aiGatheredSlices[4];
+		for (uint32_t uSlice = 0; uSlice < 4; uSlice++)
+		{
+			vecSlices[uSlice] = &(context.getBuffer<typename VolumeType::VoxelType>(MarchingCubesBuffers::Slices + uSlice));
+			aiGatheredSlices[uSlice] = (std::numeric_limits<int32_t>::min)();
+		}
+		auto gatherSlice = [&](int32_t iZRegSpace)
+		{
+			if (aiGatheredSlices[iZRegSpace & 3] == iZRegSpace)
+			{
+				return;
+			}
+			std::vector<typename VolumeType::VoxelType>& vecSlice = *(vecSlices[iZRegSpace & 3]);
+			vecSlice.resize(uBufferWidth * (uRegionHeightInVoxels + 2));
+			const int32_t iZ = region.getLowerZ() + iZRegSpace;
+			gatherVoxels(volData, Region(region.getLowerX() - 1, region.getLowerY() - 1, iZ, region.getUpperX() + 1, region.getUpperY() + 1, iZ), vecSlice.data());
+			aiGatheredSlices[iZRegSpace & 3] = iZRegSpace;
+		};
+
+		for (uint32_t uZRegSpace = uFirstSlice; uZRegSpace < uEndSlice; uZRegSpace++)
 		{
-			// A sampler pointing at the beginning of the slice, which gets incremented to always point at the beginning of a row.
-			typename VolumeType::Sampler startOfRow = startOfSlice;
+			if ((uZRegSpace - uFirstSlice) % uRowBlockSize == 0)
+			{
+				const int32_t iBlockLowerZ = region.getLowerZ() + static_cast<int32_t>(uZRegSpace);
+				const int32_t iBlockUpperZ = region.getLowerZ() + static_cast<int32_t>((std::min)(uZRegSpace + uRowBlockSize, uEndSlice)) - 1;
+				for (uint32_t uBlock = 0; uBlock < vecRowBlockStates.size(); uBlock++)
+				{
+					const int32_t iBlockLowerY = region.getLowerY() + static_cast<int32_t>(uBlock * uRowBlockSize);
+					const int32_t iBlockUpperY = (std::min)(iBlockLowerY + static_cast<int32_t>(uRowBlockSize) - 1, region.getUpperY());
+					bool bBelow = false;
+					const bool bKnown = isRegionOnOneSideOfThreshold(volData, Region(region.getLowerX(), iBlockLowerY, iBlockLowerZ, region.getUpperX(), iBlockUpperY, iBlockUpperZ), controller, bBelow);
+					vecRowBlockStates[uBlock] = bKnown ? (bBelow ? 255 : 0) : uMixedRow;
+				}
+				uGroupState = (std::count(vecRowBlockStates.begin(), vecRowBlockStates.end(), vecRowBlockStates[0]) == static_cast<std::ptrdiff_t>(vecRowBlockStates.size())) ? vecRowBlockStates[0] : uMixedRow;
+			}
+
+			// The first slice only generates vertices on the edges within it, so it can be skipped on its own. Every cell of a skipped
+			// slice has the same index, and the vertices which were not generated keep the indices they had before (as for skipped rows).
+			const bool bSkipSlice = (uGroupState != uMixedRow) && ((uZRegSpace == uFirstSlice) || (uPreviousSliceState == uGroupState));
+			uPreviousSliceState = uGroupState;
+			if (bSkipSlice)
+			{
+				const uint8_t uCellIndex = static_cast<uint8_t>(uGroupState);
+				uPreviousCellIndex = uCellIndex;
+				std::fill(pPreviousRowCellIndices, pPreviousRowCellIndices + uRegionWidthInVoxels, uCellIndex);
+				std::fill(pPreviousSliceCellIndices, pPreviousSliceCellIndices + uNoOfSliceElements, uCellIndex);
+				std::fill(vecPreviousRowStates.begin(), vecPreviousRowStates.end(), uGroupState);
+				if ((uZRegSpace == uFirstSlice) && pFirstSliceIndices)
+				{
+					std::copy(pIndices, pIndices + uNoOfSliceElements, pFirstSliceIndices->getRawData());
+				}
+				std::swap(pIndices, pPreviousIndices);
+				continue;
+			}
+
+			if (uZRegSpace > uFirstSlice)
+			{
+				gatherSlice(static_cast<int32_t>(uZRegSpace) - 2);
+			}
+			gatherSlice(static_cast<int32_t>(uZRegSpace) - 1);
+			gatherSlice(static_cast<int32_t>(uZRegSpace));
+			gatherSlice(static_cast<int32_t>(uZRegSpace) + 1);
+			const typename VolumeType::VoxelType* pSecondPreviousSlice = vecSlices[(uZRegSpace - 2) & 3]->data();
+			const typename VolumeType::VoxelType* pPreviousSlice = vecSlices[(uZRegSpace - 1) & 3]->data();
+			const typename VolumeType::VoxelType* pSlice = vecSlices[uZRegSpace & 3]->data();
+			const typename VolumeType::VoxelType* pNextSlice = vecSlices[(uZRegSpace + 1) & 3]->data();
 
 			for (uint32_t uYRegSpace = 0; uYRegSpace < uRegionHeightInVoxels; uYRegSpace++)
 			{
-				// Copying a sampler which is already pointing at the correct location seems (slightly) faster than
-				// calling setPosition(). Therefore we make use of 'startOfRow' and 'startOfSlice' to reset the sampler.
-				typename VolumeType::Sampler sampler = startOfRow;
+				// The index in the slice buffers of the voxel at the beginning of the row.
+				const uint32_t uRowIndex = (uYRegSpace + 1) * uBufferWidth + 1;
+
+				uint16_t uRowState = vecRowBlockStates[uYRegSpace / uRowBlockSize];
+				if (!canSkipRow(uRowState, uYRegSpace, uZRegSpace))
+				{
+					const typename VolumeType::VoxelType* pRow = pSlice + uRowIndex;
+					for (uint32_t uXRegSpace = 0; uXRegSpace < uRegionWidthInVoxels; uXRegSpace++)
+					{
+						vecRowDensities[uXRegSpace] = controller.convertToDensity(pRow[uXRegSpace]);
+					}
+
+					const uint32_t uNoOfBelow = classifyBelowThreshold(vecRowDensities.data(), uRegionWidthInVoxels, tThreshold, vecRowBelowThreshold.data(), eSimdLevel);
+					uRowState = (uNoOfBelow == 0) ? 0 : ((uNoOfBelow == uRegionWidthInVoxels) ? 255 : uMixedRow);
+				}
+
+				if (canSkipRow(uRowState, uYRegSpace, uZRegSpace))
+				{
+					const uint8_t uCellIndex = static_cast<uint8_t>(uRowState);
+					uPreviousCellIndex = uCellIndex;
+					std::fill(pPreviousRowCellIndices, pPreviousRowCellIndices + uRegionWidthInVoxels, uCellIndex);
+					std::fill(pPreviousSliceCellIndices + uYRegSpace * uRegionWidthInVoxels, pPreviousSliceCellIndices + (uYRegSpace + 1) * uRegionWidthInVoxels, uCellIndex);
+					vecRowStates[uYRegSpace] = uRowState;
+					continue;
+				}
 
 				for (uint32_t uXRegSpace = 0; uXRegSpace < uRegionWidthInVoxels; uXRegSpace++)
 				{
@@ -333,13 +537,13 @@ namespace PolyVox
 
 					// Four bits of our cube index are obtained by looking at the cube index for
 					// the previous slice and copying four of those bits into their new positions.
-					uint8_t uPreviousCellIndexZ = pPreviousSliceCellIndices(uXRegSpace, uYRegSpace);
+					uint8_t uPreviousCellIndexZ = pPreviousSliceCellIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace];
 					uPreviousCellIndexZ >>= 4;
 					uCellIndex |= uPreviousCellIndexZ;
 
 					// Two bits of our cube index are obtained by looking at the cube index for
 					// the previous row and copying two of those bits into their new positions.
-					uint8_t uPreviousCellIndexY = pPreviousRowCellIndices(uXRegSpace);
+					uint8_t uPreviousCellIndexY = pPreviousRowCellIndices[uXRegSpace];
 					uPreviousCellIndexY &= 204; //204 = 128+64+8+4
 					uPreviousCellIndexY >>= 2;
 					uCellIndex |= uPreviousCellIndexY;
@@ -351,15 +555,19 @@ namespace PolyVox
 					UPreviousCellIndexX >>= 1;
 					uCellIndex |= UPreviousCellIndexX;
 
-					// The last bit of our cube index is obtained by looking
-					// at the relevant voxel and comparing it to the threshold
-					typename VolumeType::VoxelType v111 = sampler.getVoxel();
-					if (controller.convertToDensity(v111) < tThreshold) uCellIndex |= 128;
+					// The last bit of our cube index is obtained from the
+					// classification of the relevant voxel against the threshold
+					if (vecRowBelowThreshold[uXRegSpace / 32] & (1u << (uXRegSpace & 31))) uCellIndex |= 128;
 
 					// The current value becomes the previous value, ready for the next iteration.
 					uPreviousCellIndex = uCellIndex;
-					pPreviousRowCellIndices(uXRegSpace) = uCellIndex;
-					pPreviousSliceCellIndices(uXRegSpace, uYRegSpace) = uCellIndex;
+					pPreviousRowCellIndices[uXRegSpace] = uCellIndex;
+					pPreviousSliceCellIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace] = uCellIndex;
+
+					if (uCellIndex != uRowState)
+					{
+						uRowState = uMixedRow;
+					}
 
 					// 12 bits of uEdge determine whether a vertex is placed on each of the 12 edges of the cell.
 					uint16_t uEdge = edgeTable[uCellIndex];
@@ -381,20 +589,21 @@ namespace PolyVox
 					// calls). For now we will leave it as-is, until we have more information from real-world profiling.
 					if (uEdge != 0)
 					{
-						auto v111Density = controller.convertToDensity(v111);
+						const uint32_t uIndex = uRowIndex + uXRegSpace;
+						typename VolumeType::VoxelType v111 = pSlice[uIndex];
+						auto v111Density = vecRowDensities[uXRegSpace];
 
 						// Performance note: Computing normals is one of the bottlencks in the mesh generation process. The
 						// central difference approach actually samples the same voxel more than once as we call it on two
 						// adjacent voxels. Perhaps we could expand this and eliminate dupicates in the future. Alternatively, 
 						// we could compute vertex normals from adjacent face normals instead of via central differencing, 
 						// but not for vertices on the edge of the region (as this causes visual discontinities).
-						const Vector3DFloat n111 = computeCentralDifferenceGradient(sampler, controller);
+						const Vector3DFloat n111 = computeCentralDifferenceGradient(pPreviousSlice, pSlice, pNextSlice, uIndex, uBufferWidth, controller);
 
 						/* Find the vertices where the surface intersects the cube */
 						if ((uEdge & 64) && (uXRegSpace > 0))
 						{
-							sampler.moveNegativeX();
-							typename VolumeType::VoxelType v011 = sampler.getVoxel();
+							typename VolumeType::VoxelType v011 = pSlice[uIndex - 1];
 							auto v011Density = controller.convertToDensity(v011);
 							const float fInterp = static_cast<float>(tThreshold - v011Density) / static_cast<float>(v111Density - v011Density);
 
@@ -402,7 +611,7 @@ namespace PolyVox
 							const Vector3DFloat v3dPosition(static_cast<float>(uXRegSpace - 1) + fInterp, static_cast<float>(uYRegSpace), static_cast<float>(uZRegSpace));
 
 							// Compute the normal
-							const Vector3DFloat n011 = computeCentralDifferenceGradient(sampler, controller);
+							const Vector3DFloat n011 = computeCentralDifferenceGradient(pPreviousSlice, pSlice, pNextSlice, uIndex - 1, uBufferWidth, controller);
 							Vector3DFloat v3dNormal = (n111*fInterp) + (n011*(1 - fInterp));
 
 							// The gradient for a voxel can be zero (e.g. solid voxel surrounded by empty ones) and so
@@ -422,14 +631,11 @@ namespace PolyVox
 							surfaceVertex.data = uMaterial;
 
 							const uint32_t uLastVertexIndex = result->addVertex(surfaceVertex);
-							pIndices(uXRegSpace, uYRegSpace).setX(uLastVertexIndex);
-
-							sampler.movePositiveX();
+							pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].setX(uLastVertexIndex);
 						}
 						if ((uEdge & 32) && (uYRegSpace > 0))
 						{
-							sampler.moveNegativeY();
-							typename VolumeType::VoxelType v101 = sampler.getVoxel();
+							typename VolumeType::VoxelType v101 = pSlice[uIndex - uBufferWidth];
 							auto v101Density = controller.convertToDensity(v101);
 							const float fInterp = static_cast<float>(tThreshold - v101Density) / static_cast<float>(v111Density - v101Density);
 
@@ -437,7 +643,7 @@ namespace PolyVox
 							const Vector3DFloat v3dPosition(static_cast<float>(uXRegSpace), static_cast<float>(uYRegSpace - 1) + fInterp, static_cast<float>(uZRegSpace));
 
 							// Compute the normal
-							const Vector3DFloat n101 = computeCentralDifferenceGradient(sampler, controller);
+							const Vector3DFloat n101 = computeCentralDifferenceGradient(pPreviousSlice, pSlice, pNextSlice, uIndex - uBufferWidth, uBufferWidth, controller);
 							Vector3DFloat v3dNormal = (n111*fInterp) + (n101*(1 - fInterp));
 
 							// The gradient for a voxel can be zero (e.g. solid voxel surrounded by empty ones) and so
@@ -457,14 +663,11 @@ namespace PolyVox
 							surfaceVertex.data = uMaterial;
 
 							uint32_t uLastVertexIndex = result->addVertex(surfaceVertex);
-							pIndices(uXRegSpace, uYRegSpace).setY(uLastVertexIndex);
-
-							sampler.movePositiveY();
+							pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].setY(uLastVertexIndex);
 						}
-						if ((uEdge & 1024) && (uZRegSpace > 0))
+						if ((uEdge & 1024) && (uZRegSpace > uFirstSlice))
 						{
-							sampler.moveNegativeZ();
-							typename VolumeType::VoxelType v110 = sampler.getVoxel();
+							typename VolumeType::VoxelType v110 = pPreviousSlice[uIndex];
 							auto v110Density = controller.convertToDensity(v110);
 							const float fInterp = static_cast<float>(tThreshold - v110Density) / static_cast<float>(v111Density - v110Density);
 
@@ -472,7 +675,7 @@ namespace PolyVox
 							const Vector3DFloat v3dPosition(static_cast<float>(uXRegSpace), static_cast<float>(uYRegSpace), static_cast<float>(uZRegSpace - 1) + fInterp);
 
 							// Compute the normal
-							const Vector3DFloat n110 = computeCentralDifferenceGradient(sampler, controller);
+							const Vector3DFloat n110 = computeCentralDifferenceGradient(pSecondPreviousSlice, pPreviousSlice, pSlice, uIndex, uBufferWidth, controller);
 							Vector3DFloat v3dNormal = (n111*fInterp) + (n110*(1 - fInterp));
 
 							// The gradient for a voxel can be zero (e.g. solid voxel surrounded by empty ones) and so
@@ -492,14 +695,12 @@ namespace PolyVox
 							surfaceVertex.data = uMaterial;
 
 							const uint32_t uLastVertexIndex = result->addVertex(surfaceVertex);
-							pIndices(uXRegSpace, uYRegSpace).setZ(uLastVertexIndex);
-
-							sampler.movePositiveZ();
+							pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].setZ(uLastVertexIndex);
 						}
 
 						// Now output the indices. For the first row, column or slice there aren't
 						// any (the region size in cells is one less than the region size in voxels)
-						if ((uXRegSpace != 0) && (uYRegSpace != 0) && (uZRegSpace != 0))
+						if ((uXRegSpace != 0) && (uYRegSpace != 0) && (uZRegSpace != uFirstSlice))
 						{
 
 							int32_t indlist[12];
@@ -507,51 +708,51 @@ namespace PolyVox
 							/* Find the vertices where the surface intersects the cube */
 							if (uEdge & 1)
 							{
-								indlist[0] = pPreviousIndices(uXRegSpace, uYRegSpace - 1).getX();
+								indlist[0] = pPreviousIndices[(uYRegSpace - 1) * uRegionWidthInVoxels + uXRegSpace].getX();
 							}
 							if (uEdge & 2)
 							{
-								indlist[1] = pPreviousIndices(uXRegSpace, uYRegSpace).getY();
+								indlist[1] = pPreviousIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].getY();
 							}
 							if (uEdge & 4)
 							{
-								indlist[2] = pPreviousIndices(uXRegSpace, uYRegSpace).getX();
+								indlist[2] = pPreviousIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].getX();
 							}
 							if (uEdge & 8)
 							{
-								indlist[3] = pPreviousIndices(uXRegSpace - 1, uYRegSpace).getY();
+								indlist[3] = pPreviousIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace - 1].getY();
 							}
 							if (uEdge & 16)
 							{
-								indlist[4] = pIndices(uXRegSpace, uYRegSpace - 1).getX();
+								indlist[4] = pIndices[(uYRegSpace - 1) * uRegionWidthInVoxels + uXRegSpace].getX();
 							}
 							if (uEdge & 32)
 							{
-								indlist[5] = pIndices(uXRegSpace, uYRegSpace).getY();
+								indlist[5] = pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].getY();
 							}
 							if (uEdge & 64)
 							{
-								indlist[6] = pIndices(uXRegSpace, uYRegSpace).getX();
+								indlist[6] = pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].getX();
 							}
 							if (uEdge & 128)
 							{
-								indlist[7] = pIndices(uXRegSpace - 1, uYRegSpace).getY();
+								indlist[7] = pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace - 1].getY();
 							}
 							if (uEdge & 256)
 							{
-								indlist[8] = pIndices(uXRegSpace - 1, uYRegSpace - 1).getZ();
+								indlist[8] = pIndices[(uYRegSpace - 1) * uRegionWidthInVoxels + uXRegSpace - 1].getZ();
 							}
 							if (uEdge & 512)
 							{
-								indlist[9] = pIndices(uXRegSpace, uYRegSpace - 1).getZ();
+								indlist[9] = pIndices[(uYRegSpace - 1) * uRegionWidthInVoxels + uXRegSpace].getZ();
 							}
 							if (uEdge & 1024)
 							{
-								indlist[10] = pIndices(uXRegSpace, uYRegSpace).getZ();
+								indlist[10] = pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace].getZ();
 							}
 							if (uEdge & 2048)
 							{
-								indlist[11] = pIndices(uXRegSpace - 1, uYRegSpace).getZ();
+								indlist[11] = pIndices[uYRegSpace * uRegionWidthInVoxels + uXRegSpace - 1].getZ();
 							}
 
 							for (int i = 0; triTable[uCellIndex][i] != -1; i += 3)
@@ -567,19 +768,261 @@ namespace PolyVox
 							} // For each triangle
 						}
 					} // For each cell
-					sampler.movePositiveX();
 				} // For X
-				startOfRow.movePositiveY();
+				vecRowStates[uYRegSpace] = uRowState;
 			} // For Y
-			startOfSlice.movePositiveZ();
+			vecRowStates.swap(vecPreviousRowStates);
 
-			pIndices.swap(pPreviousIndices);
+			if ((uZRegSpace == uFirstSlice) && pFirstSliceIndices)
+			{
+				std::copy(pIndices, pIndices + uNoOfSliceElements, pFirstSliceIndices->getRawData());
+			}
+
+			std::swap(pIndices, pPreviousIndices);
 		} // For Z
 
+		if (pLastSliceIndices)
+		{
+			std::copy(pPreviousIndices, pPreviousIndices + uNoOfSliceElements, pLastSliceIndices->getRawData());
+		}
+	}
+
+	/// This is probably the version of Marching Cubes extraction which you will want to use initially, at least
+	/// until you determine you have a need for the extra functionality provied by extractMarchingCubesMeshCustom().
+	template< typename VolumeType, typename ControllerType >
+	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesMesh(VolumeType* volData, Region region, ControllerType controller)
+	{
+		Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > result;
+		extractMarchingCubesMeshCustom<VolumeType, Mesh<MarchingCubesVertex<typename VolumeType::VoxelType>, DefaultIndexType > >(volData, region, &result, controller);
+		return result;
+	}
+
+	/// This version of the function performs the extraction into a user-provided mesh rather than allocating a mesh automatically.
+	/// There are a few reasons why this might be useful to more advanced users:
+	///
+	///   1. It leaves the user in control of memory allocation and would allow them to implement e.g. a mesh pooling system.
+	///   2. The user-provided mesh could have a different index type (e.g. 16-bit indices) to reduce memory usage.
+	///   3. The user could provide a custom mesh class, e.g a thin wrapper around an OpenGL VBO to allow direct writing into this structure.
+	///      BufferMesh writes into any buffer in this way, and MeshCounter can be used to find the required size beforehand.
+	///
+	/// We don't provide a default MeshType here. If the user doesn't want to provide a MeshType then it probably makes
+	/// more sense to use the other variant of this function where the mesh is a return value rather than a parameter.
+	///
+	/// The scratch memory needed during the extraction is normally allocated by each call. If an ExtractionContext is provided
+	/// then it is taken from there instead, so that repeatedly extracting regions of the same size into meshes which have
+	/// been used before (see MeshPool) does not allocate any memory once the first extraction has been performed.
+	///
+	/// Note: This function is called 'extractMarchingCubesMeshCustom' rather than 'extractMarchingCubesMesh' to avoid ambiguity when only three parameters
+	/// are provided (would the third parameter be a controller or a mesh?). It seems this can be fixed by using enable_if/static_assert to emulate concepts,
+	/// but this is relatively complex and I haven't done it yet. Could always add it later as another overload.
+	template< typename VolumeType, typename MeshType, typename ControllerType >
+	void extractMarchingCubesMeshCustom(VolumeType* volData, Region region, MeshType* result, ControllerType controller, ExtractionContext* pContext)
+	{
+		// Validate parameters
+		POLYVOX_THROW_IF(volData == nullptr, std::invalid_argument, "Provided volume cannot be null");
+		POLYVOX_THROW_IF(result == nullptr, std::invalid_argument, "Provided mesh cannot be null");
+
+		// For profiling this function
+		Timer timer;
+
+		// Performance note: Profiling indicates that simply adding vertices and indices to the std::vector is one 
+		// of the bottlenecks when generating the mesh. Clearing the mesh keeps its memory, so users who extract
+		// meshes repeatedly should reuse the same mesh (or write straight into their own buffers with BufferMesh).
+		result->clear();
+
+		// A surface can only pass between voxels with different values, so if the volume knows that the region
+		// is uniform (or is entirely above or below the threshold) then there is nothing to extract.
+		typename VolumeType::VoxelType tUniformValue;
+		bool bBelow;
+		if (!volData->isRegionUniform(region, tUniformValue) && !isRegionOnOneSideOfThreshold(volData, region, controller, bBelow))
+		{
+			if (pContext)
+			{
+				extractMarchingCubesSlices(volData, region, 0, region.getDepthInVoxels(), result, controller, *pContext);
+			}
+			else
+			{
+				ExtractionContext context;
+				extractMarchingCubesSlices(volData, region, 0, region.getDepthInVoxels(), result, controller, context);
+			}
+		}
+
 		result->setOffset(region.getLowerCorner());
 
 		POLYVOX_LOG_TRACE("Marching cubes surface extraction took ", timer.elapsedTimeInMilliSeconds(),
 			"ms (Region size = ", region.getWidthInVoxels(), "x", region.getHeightInVoxels(),
 			"x", region.getDepthInVoxels(), ")");
 	}
+
+	/// Performs the same extraction as extractMarchingCubesMesh(), but splits the region into slabs along the Z axis and extracts them
+	/// on several threads. The result is identical to that of the single-threaded version. The volume must be safe to read from several
+	/// threads at once, which means a PagedVolume must have concurrent access enabled. If uNoOfThreads is zero then one thread is used
+	/// for each hardware thread.
+	template< typename VolumeType, typename ControllerType >
+	Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > extractMarchingCubesMeshParallel(VolumeType* volData, Region region, uint32_t uNoOfThreads, ControllerType controller)
+	{
+		Mesh<MarchingCubesVertex<typename VolumeType::VoxelType> > result;
+		extractMarchingCubesMeshParallelCustom<VolumeType, Mesh<MarchingCubesVertex<typename VolumeType::VoxelType>, DefaultIndexType > >(volData, region, &result, uNoOfThreads, controller);
+		return result;
+	}
+
+	/// Multithreaded version of extractMarchingCubesMeshCustom() (see extractMarchingCubesMeshParallel()). Each slab is extracted into a
+	/// temporary mesh, and these are then appended to the result in order. The first slice of each slab (other than the first) is shared with
+	/// the previous slab, so the vertices on it are generated twice. These duplicates are discarded and the triangles which use them are
+	/// redirected to the vertices generated by the previous slab, which gives exactly the same vertices and triangles as a single thread.
+	template< typename VolumeType, typename MeshType, typename ControllerType >
+	void extractMarchingCubesMeshParallelCustom(VolumeType* volData, Region region, MeshType* result, uint32_t uNoOfThreads, ControllerType controller)
+	{
+		// Validate parameters
+		POLYVOX_THROW_IF(volData == nullptr, std::invalid_argument, "Provided volume cannot be null");
+		POLYVOX_THROW_IF(result == nullptr, std::invalid_argument, "Provided mesh cannot be null");
+
+		if (uNoOfThreads == 0)
+		{
+			uNoOfThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+		}
+
+		// Each slab (other than the first) also processes the last slice of the previous one, so very thin slabs would waste a lot
+		// of time. Using more slabs than threads balances the load when some parts of the region contain more of the surface.
+		const uint32_t uMinSlabDepth = 16;
+		const uint32_t uRegionDepthInVoxels = region.getDepthInVoxels();
+		const uint32_t uNoOfSlabs = (std::min)(uNoOfThreads * 4, (std::max)(uRegionDepthInVoxels / uMinSlabDepth, 1u));
+		if ((uNoOfThreads == 1) || (uNoOfSlabs == 1))
+		{
+			extractMarchingCubesMeshCustom(volData, region, result, controller);
+			return;
+		}
+
+		// For profiling this function
+		Timer timer;
+
+		result->clear();
+
+		typename VolumeType::VoxelType tUniformValue;
+		bool bBelow;
+		if (volData->isRegionUniform(region, tUniformValue) || isRegionOnOneSideOfThreshold(volData, region, controller, bBelow))
+		{
+			result->setOffset(region.getLowerCorner());
+			return;
+		}
+
+		typedef Mesh<typename MeshType::VertexType, uint32_t> SlabMeshType;
+		std::vector<SlabMeshType> vecSlabMeshes(uNoOfSlabs);
+		std::vector< std::unique_ptr< Array<2, Vector3DInt32> > > vecFirstSliceIndices(uNoOfSlabs);
+		std::vector< std::unique_ptr< Array<2, Vector3DInt32> > > vecLastSliceIndices(uNoOfSlabs);
+		for (uint32_t uSlab = 0; uSlab < uNoOfSlabs; uSlab++)
+		{
+			vecFirstSliceIndices[uSlab].reset(new Array<2, Vector3DInt32>(region.getWidthInVoxels(), region.getHeightInVoxels()));
+			vecLastSliceIndices[uSlab].reset(new Array<2, Vector3DInt32>(region.getWidthInVoxels(), region.getHeightInVoxels()));
+		}
+
+		// The threads take slabs in order until there are none left. Exceptions are passed back to this thread.
+		std::atomic<uint32_t> uNextSlab(0);
+		std::vector<std::exception_ptr> vecExceptions(uNoOfThreads);
+		auto extractSlabs = [&](uint32_t uThread)
+		{
+			try
+			{
+				// Each thread has its own copy of the controller, in case it is not thread safe, and reuses its scratch buffers for all its slabs.
+				ControllerType threadController = controller;
+				ExtractionContext context;
+				for (uint32_t uSlab = uNextSlab++; uSlab < uNoOfSlabs; uSlab = uNextSlab++)
+				{
+					const uint32_t uFirstSlice = (uSlab == 0) ? 0 : (uRegionDepthInVoxels * uSlab / uNoOfSlabs) - 1;
+					const uint32_t uEndSlice = uRegionDepthInVoxels * (uSlab + 1) / uNoOfSlabs;
+					extractMarchingCubesSlices(volData, region, uFirstSlice, uEndSlice, &(vecSlabMeshes[uSlab]), threadController, context,
+						vecFirstSliceIndices[uSlab].get(), vecLastSliceIndices[uSlab].get());
+				}
+			}
+			catch (...)
+			{
+				vecExceptions[uThread] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> vecThreads;
+		for (uint32_t uThread = 1; uThread < uNoOfThreads; uThread++)
+		{
+			vecThreads.push_back(std::thread(extractSlabs, uThread));
+		}
+		extractSlabs(0);
+		for (std::thread& thread : vecThreads)
+		{
+			thread.join();
+		}
+		for (const std::exception_ptr& pException : vecExceptions)
+		{
+			if (pException)
+			{
+				std::rethrow_exception(pException);
+			}
+		}
+
+		// Join the slabs together. The vertices on the first slice of each slab were generated first, and so have the lowest indices.
+		// These are mapped to the vertices in the last slice of the previous slab (which are never on its first slice), while the
+		// remaining vertices follow on from those already in the result.
+		const uint32_t uNoOfSliceElements = region.getWidthInVoxels() * region.getHeightInVoxels();
+		std::vector<uint32_t> vecIndexMap;
+		uint32_t uNextBaseIndex = 0;
+		uint32_t uPreviousBaseIndex = 0;
+		uint32_t uPreviousNoOfFirstSliceVertices = 0;
+		for (uint32_t uSlab = 0; uSlab < uNoOfSlabs; uSlab++)
+		{
+			const SlabMeshType& slabMesh = vecSlabMeshes[uSlab];
+			const uint32_t uBaseIndex = uNextBaseIndex;
+
+			uint32_t uNoOfFirstSliceVertices = 0;
+			if (uSlab > 0)
+			{
+				const Vector3DInt32* pFirstSliceIndices = vecFirstSliceIndices[uSlab]->getRawData();
+				for (uint32_t uElement = 0; uElement < uNoOfSliceElements; uElement++)
+				{
+					uNoOfFirstSliceVertices += (pFirstSliceIndices[uElement].getX() != -1) ? 1 : 0;
+					uNoOfFirstSliceVertices += (pFirstSliceIndices[uElement].getY() != -1) ? 1 : 0;
+				}
+			}
+
+			vecIndexMap.resize(slabMesh.getNoOfVertices());
+			if (uSlab > 0)
+			{
+				const Vector3DInt32* pFirstSliceIndices = vecFirstSliceIndices[uSlab]->getRawData();
+				const Vector3DInt32* pLastSliceIndices = vecLastSliceIndices[uSlab - 1]->getRawData();
+				for (uint32_t uElement = 0; uElement < uNoOfSliceElements; uElement++)
+				{
+					const Vector3DInt32& v3dFirst = pFirstSliceIndices[uElement];
+					const Vector3DInt32& v3dLast = pLastSliceIndices[uElement];
+					POLYVOX_ASSERT(((v3dFirst.getX() == -1) || (v3dLast.getX() != -1)) && ((v3dFirst.getY() == -1) || (v3dLast.getY() != -1)),
+						"Slabs disagree about the vertices on their shared slice.");
+					if (v3dFirst.getX() != -1)
+					{
+						vecIndexMap[v3dFirst.getX()] = uPreviousBaseIndex + v3dLast.getX() - uPreviousNoOfFirstSliceVertices;
+					}
+					if (v3dFirst.getY() != -1)
+					{
+						vecIndexMap[v3dFirst.getY()] = uPreviousBaseIndex + v3dLast.getY() - uPreviousNoOfFirstSliceVertices;
+					}
+				}
+			}
+
+			for (uint32_t uVertex = uNoOfFirstSliceVertices; uVertex < slabMesh.getNoOfVertices(); uVertex++)
+			{
+				vecIndexMap[uVertex] = static_cast<uint32_t>(result->addVertex(slabMesh.getVertex(uVertex)));
+			}
+
+			for (uint32_t uIndex = 0; uIndex < slabMesh.getNoOfIndices(); uIndex += 3)
+			{
+				result->addTriangle(vecIndexMap[slabMesh.getIndex(uIndex)], vecIndexMap[slabMesh.getIndex(uIndex + 1)], vecIndexMap[slabMesh.getIndex(uIndex + 2)]);
+			}
+
+			uNextBaseIndex = uBaseIndex + slabMesh.getNoOfVertices() - uNoOfFirstSliceVertices;
+			uPreviousBaseIndex = uBaseIndex;
+			uPreviousNoOfFirstSliceVertices = uNoOfFirstSliceVertices;
+		}
+
+		result->setOffset(region.getLowerCorner());
+
+		POLYVOX_LOG_TRACE("Parallel marching cubes surface extraction took ", timer.elapsedTimeInMilliSeconds(),
+			"ms (Region size = ", region.getWidthInVoxels(), "x", region.getHeightInVoxels(),
+			"x", region.getDepthInVoxels(), ", ", uNoOfThreads, " threads)");
+	}
 }
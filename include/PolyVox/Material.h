@@ -78,7 +78,7 @@ namespace PolyVox
 	public:
 		bool operator()(Material<Type> back, Material<Type> front, Material<Type>& materialToUse)
 		{
-			if ((back.getMaterial() > 0) && (front.getMaterial() == 0))
+			if (isSolid(back) && isEmpty(front))
 			{
 				materialToUse = back;
 				return true;
@@ -88,6 +88,21 @@ namespace PolyVox
 				return false;
 			}
 		}
+
+		static bool isSolid(Material<Type> voxel)
+		{
+			return voxel.getMaterial() > 0;
+		}
+
+		static bool isEmpty(Material<Type> voxel)
+		{
+			return voxel.getMaterial() == 0;
+		}
+	};
+
+	template<typename Type>
+	struct HasBinaryOccupancy< Material<Type> > : std::true_type
+	{
 	};
 }
 
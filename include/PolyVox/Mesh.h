@@ -42,6 +42,14 @@ namespace PolyVox
 	/// A simple and general-purpose mesh class to represent the data returned by the surface extraction functions.
 	/// It supports different vertex types (which will vary depending on the surface extractor used and the contents
 	/// of the volume) and both 16-bit and 32 bit indices.
+	///
+	/// Clearing a mesh keeps the memory which it has allocated, so a mesh which is reused for each extraction (by passing it to
+	/// functions such as extractMarchingCubesMeshCustom() rather than having a new mesh returned) stops allocating memory once
+	/// it has grown large enough. reserve() can also be used to allocate the memory up front.
+	///
+	/// The surface extractors can also write into other mesh classes. These only need to provide the VertexType and IndexType
+	/// typedefs along with clear(), addVertex(), addTriangle() and setOffset(), where addVertex() returns the index of the
+	/// new vertex. MeshCounter and BufferMesh use this to extract a mesh directly into memory provided by the caller.
 	typedef uint32_t DefaultIndexType;
 	template <typename _VertexType, typename _IndexType = DefaultIndexType>
 	class Mesh
@@ -70,6 +78,7 @@ namespace PolyVox
 
 		void clear(void);
 		bool isEmpty(void) const;
+		void reserve(IndexType uNoOfVertices, size_t uNoOfIndices);
 		void removeUnusedVertices(void);
 
 	private:
@@ -118,6 +118,15 @@ namespace PolyVox
 		return (getNoOfVertices() == 0) || (getNoOfIndices() == 0);
 	}
 
+	/// Allocates enough memory for the given number of vertices and indices, so that they can be added without any further
+	/// allocation. The memory is kept when the mesh is cleared.
+	template <typename VertexType, typename IndexType>
+	void Mesh<VertexType, IndexType>::reserve(IndexType uNoOfVertices, size_t uNoOfIndices)
+	{
+		m_vecVertices.reserve(uNoOfVertices);
+		m_vecIndices.reserve(uNoOfIndices);
+	}
+
 	template <typename VertexType, typename IndexType>
 	void Mesh<VertexType, IndexType>::removeUnusedVertices(void)
 	{
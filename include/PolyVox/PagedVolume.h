@@ -29,6 +29,10 @@
 #include "Region.h"
 #include "Vector.h"
 
+#include "Impl/ValueRange.h"
+
+#include <atomic>
+#include <condition_variable>
 #include <limits>
 #include <cstdlib> //For abort()
 #include <cstring> //For memcpy
@@ -36,11 +40,27 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <stdexcept> //For invalid_argument
+#include <thread>
 #include <vector>
 
 namespace PolyVox
 {
+	namespace MipFilters
+	{
+		/**
+		 * How each voxel of a mip level of a PagedVolume is computed from the 2x2x2 block of voxels below it.
+		 */
+		enum MipFilter
+		{
+			Average, ///< The average of the eight voxels, or the first of them for voxel types which cannot be averaged
+			Subsample ///< The voxel at the lower corner of the block, as the levels of a LodPyramid are defined
+		};
+	}
+	typedef MipFilters::MipFilter MipFilter;
+
 	/// This class provide a volume implementation which avoids storing all the data in memory at all times. Instead it breaks the volume
 	/// down into a set of chunks and moves these into and out of memory on demand. This means it is much more memory efficient than the
 	/// RawVolume, but may also be slower and is more complicated We encourage uses to work with RawVolume initially, and then switch to
@@ -53,6 +73,38 @@ namespace PolyVox
 	///
 	/// A consequence of this paging approach is that (unlike the RawVolume) the PagedVolume does not need to have a predefined size. After
 	/// the volume has been created you can begin acessing voxels anywhere in space and the required data will be created automatically.
+	///
+	/// By default the PagedVolume is not thread safe. If you need to access a single volume from several threads (e.g. a number of surface
+	/// extraction threads and an editing thread) then you can enable concurrent access when constructing it. The chunks are then spread
+	/// across a number of independently locked shards, each Sampler keeps its own record of the chunk it is working with rather than sharing
+	/// the volume's, and chunks which are in use by a Sampler are never evicted. Note that the rules for accessing a single voxel from several
+	/// threads are still the same as for the RawVolume - see the threading section of the manual for details.
+	///
+	/// A volume with concurrent access enabled can also be given a number of paging threads. These service requests made through
+	/// prefetchAsync() and also take over the eviction (and hence writing back) of chunks, so that the threads accessing the volume are
+	/// not stalled by the Pager. tryGetVoxel() and isRegionResident() can then be used to work with whatever data is currently in memory.
+	///
+	/// By default every chunk in memory is stored uncompressed. Calling setMaxNumberOfUncompressedChunks() with a lower value than
+	/// the memory limit allows means that the least recently used chunks are instead compressed, and only paged out once the memory
+	/// limit is reached. Compressed chunks are decompressed as soon as they are accessed. Voxel data usually compresses well, so this
+	/// allows many more chunks to be kept in memory at the cost of some extra processing. Chunks which contain few distinct values are
+	/// compressed by storing a palette of those values along with a small (1, 2, 4 or 8 bit) index into it for each voxel. Such chunks
+	/// can be read and written through getVoxel() and setVoxel() without decompressing them, but are decompressed when used by a Sampler.
+	///
+	/// Chunks in which every voxel has the same value (such as those above or far below the terrain) share a single copy of their
+	/// data, and only get their own copy once a different value is written to them. The Pager can also identify such chunks without
+	/// paging them in at all, and isRegionUniform() allows the surface extractors to skip over them entirely. For primitive voxel
+	/// types each chunk also keeps track of the range of its values (see getRegionValueRange()), which allows the surface extractors
+	/// to skip chunks which are entirely air or entirely rock even if they are not uniform.
+	///
+	/// The volume can also keep a number of mip levels (reduced resolution copies) of each chunk, which are enabled by calling
+	/// setNoOfMipLevels(). Each voxel of level k covers 2^k voxels along each axis and is by default the average of the eight voxels
+	/// below it (other than for non-primitive voxel types, which just take the first of them). Writing a voxel only records which part
+	/// of its chunk has changed, and the affected parts of the levels are recomputed the next time getVoxelAtLevel() or getVoxelsAtLevel()
+	/// reads from that chunk. Algorithms which only need coarse data (such as long distance raycasts or ambient occlusion) can therefore
+	/// read it directly instead of resampling the volume. Level of detail extraction needs the levels to be subsampled rather than
+	/// averaged so that the meshes of different levels join up, and a LodPyramid reads the levels of the volume when they are kept
+	/// with MipFilters::Subsample (otherwise it keeps its own copies).
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
 	class PagedVolume : public BaseVolume<VoxelType>
@@ -68,9 +120,16 @@ namespace PolyVox
 			friend class PagedVolume;
 
 		public:
-			Chunk(Vector3DInt32 v3dPosition, uint16_t uSideLength, Pager* pPager = nullptr);
+			Chunk(Vector3DInt32 v3dPosition, uint16_t uSideLength, Pager* pPager = nullptr, VoxelType* pSharedData = nullptr);
 			~Chunk();
 
+			/// Returns a null pointer if the chunk is compressed. A chunk is never compressed while it is being paged in or out. Note
+			/// that setVoxel() can still be used on a chunk which is palette compressed (see isPaletteCompressed()), but getVoxel()
+			/// requires the data to be uncompressed.
+			/// If every voxel in the chunk has the same value then the data may be shared with other chunks, in which case it
+			/// must not be modified. This is never the case while the chunk is being paged in. Once the chunk has been paged in
+			/// the data should only be modified through setVoxel(), which keeps track of whether the range of its values (see
+			/// PagedVolume::getRegionValueRange()) is out of date.
 			VoxelType* getData(void) const;
 			uint32_t getDataSizeInBytes(void) const;
 
@@ -83,6 +142,9 @@ namespace PolyVox
 			void changeLinearOrderingToMorton(void);
 			void changeMortonOrderingToLinear(void);
 
+			/// Determines whether the voxels are stored as indices into a palette of the values present in the chunk.
+			bool isPaletteCompressed(void) const;
+
 		private:
 			/// Private copy constructor to prevent accisdental copying
 			Chunk(const Chunk& /*rhs*/) {};
@@ -93,6 +155,11 @@ namespace PolyVox
 			// This is updated by the PagedVolume and used to discard the least recently used chunks.
 			uint32_t m_uChunkLastAccessed;
 
+			// The PagedVolume links its chunks into lists ordered by when they were last accessed, so
+			// that it can find the least recently used chunk without searching through all of them.
+			Chunk* m_pNewerChunk;
+			Chunk* m_pOlderChunk;
+
 			// This is so we can tell whether a uncompressed chunk has to be recompressed and whether
 			// a compressed chunk has to be paged back to disk, or whether they can just be discarded.
 			bool m_bDataModified;
@@ -100,7 +167,59 @@ namespace PolyVox
 			uint32_t calculateSizeInBytes(void);
 			static uint32_t calculateSizeInBytes(uint32_t uSideLength);
 
+			// Gives the pager a chance to store the data if it has been modified since it was paged in.
+			void pageOutIfModified(void);
+
+			bool isCompressed(void) const;
+			void compress(void);
+			void decompress(void);
+
+			// Reads a voxel from a chunk which may be palette compressed. getVoxel() only handles uncompressed data, so
+			// that reading from an uncompressed chunk does not have to check for a palette.
+			VoxelType getVoxelAllowingPalette(uint32_t uXPos, uint32_t uYPos, uint32_t uZPos) const;
+			VoxelType getPaletteVoxel(uint32_t uIndex) const;
+
+			bool isUsingSharedData(void) const;
+			bool isUniform(VoxelType& tValue) const;
+			void shareData(VoxelType* pSharedData);
+			void unshareData(void);
+
+			// Recomputes m_tMinValue and m_tMaxValue. For palette compressed chunks this uses the values in the palette, which
+			// may include some that are no longer used.
+			void updateValueRange(void);
+
+			// Bounds on the values in the chunk (see PagedVolume::getRegionValueRange()). Writing a voxel just marks them as
+			// out of date, and they are recomputed the next time they are needed or when the chunk is compressed.
+			VoxelType m_tMinValue;
+			VoxelType m_tMaxValue;
+			bool m_bValueRangeOutOfDate;
+
+			// Brings the reduced resolution copies of the chunk (see PagedVolume::setNoOfMipLevels()) up to date, rebuilding them
+			// completely if the number of levels has changed. Chunks which share their data have no need for them. The volume
+			// releases the levels of every chunk when the filter changes, so the chunk does not need to keep track of it.
+			bool areMipLevelsOutOfDate(uint32_t uNoOfMipLevels) const;
+			void updateMipLevels(uint32_t uNoOfMipLevels, MipFilter eMipFilter);
+			void releaseMipLevels(void);
+			VoxelType getVoxelAtLevel(uint32_t uLevel, uint32_t uXPos, uint32_t uYPos, uint32_t uZPos) const;
+
+			// Levels 1 to m_uNoOfMipLevels are stored one after another, each of them in Morton order so that the eight voxels
+			// which make up a voxel of the next level are adjacent. Writing a voxel adds it to m_regMipLevelsOutOfDate (which is
+			// in chunk-local coordinates) and only the voxels of each level which cover that region are recomputed.
+			std::vector<VoxelType> m_vecMipLevels;
+			Region m_regMipLevelsOutOfDate;
+			uint8_t m_uNoOfMipLevels;
+
+			// When the chunk is uncompressed the voxels are held in m_tData, otherwise it is a null pointer and the voxels
+			// are held either as runs of identical values (see Impl/RunLengthEncoding.h) or as indices into a palette (see
+			// Impl/PaletteEncoding.h). If every voxel has the same value then m_tData may instead point at a buffer owned by
+			// the volume.
 			VoxelType* m_tData;
+			bool m_bDataShared;
+			std::vector<VoxelType> m_vecRunValues;
+			std::vector<uint16_t> m_vecRunLengths;
+			std::vector<VoxelType> m_vecPalette;
+			std::vector<uint8_t> m_vecPaletteIndices;
+			uint8_t m_uPaletteIndexSizePower;
 			uint16_t m_uSideLength;
 			uint8_t m_uSideLengthPower;
 			Pager* m_pPager;
@@ -113,6 +232,9 @@ namespace PolyVox
 		* Users can override this class and provide an instance of the derived class to the PagedVolume constructor. This derived class
 		* could then perform tasks such as compression and decompression of the data, and read/writing it to a file, database, network,
 		* or other storage as appropriate. See FilePager for a simple example of such a derived class.
+		*
+		* If the PagedVolume has concurrent access enabled then pageIn() and pageOut() may be called from several threads at once (though
+		* never for the same chunk at the same time), so the derived class must be safe to use in this way.
 		*/
 		class Pager
 		{
@@ -124,6 +246,10 @@ namespace PolyVox
 
 			virtual void pageIn(const Region& region, Chunk* pChunk) = 0;
 			virtual void pageOut(const Region& region, Chunk* pChunk) = 0;
+
+			/// Called before a chunk is paged in. If the pager can cheaply tell that every voxel in the region has the same
+			/// value (e.g. it is above the terrain) then it can return true and set tValue, and pageIn() is not called.
+			virtual bool isRegionUniform(const Region& /*region*/, VoxelType& /*tValue*/) { return false; }
 		};
 
 		//There seems to be some descrepency between Visual Studio and GCC about how the following class should be declared.
@@ -189,6 +315,9 @@ namespace PolyVox
 			inline VoxelType peekVoxel1px1py1pz(void) const;
 
 		private:
+			// Used when a peek falls outside of the current chunk.
+			VoxelType peekVoxelOutsideChunk(int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+
 			//Other current position information
 			VoxelType* mCurrentVoxel;
 
@@ -200,13 +329,25 @@ namespace PolyVox
 			// We could provide one manually, but it's currently unused so there is no real test for if it works. I'm putting
 			// together a new release at the moment so I'd rathern not make 'risky' changes.
 			uint16_t m_uChunkSideLengthMinusOne;
+
+			// When the volume allows concurrent access the sampler cannot use the volume's last accessed chunk (which is shared between
+			// threads) so it keeps track of its own chunks instead. Holding these references also prevents the chunks being evicted.
+			std::shared_ptr<Chunk> m_pCurrentChunk;
+			int32_t m_iCurrentChunkX;
+			int32_t m_iCurrentChunkY;
+			int32_t m_iCurrentChunkZ;
+
+			mutable std::shared_ptr<Chunk> m_pPeekedChunk;
+			mutable int32_t m_iPeekedChunkX;
+			mutable int32_t m_iPeekedChunkY;
+			mutable int32_t m_iPeekedChunkZ;
 		};
 
 #endif // SWIG
 
 	public:
 		/// Constructor for creating a fixed size volume.
-		PagedVolume(Pager* pPager, uint32_t uTargetMemoryUsageInBytes = 256 * 1024 * 1024, uint16_t uChunkSideLength = 32);
+		PagedVolume(Pager* pPager, uint32_t uTargetMemoryUsageInBytes = 256 * 1024 * 1024, uint16_t uChunkSideLength = 32, bool bConcurrentAccess = false, uint32_t uNoOfPagingThreads = 0);
 		/// Destructor
 		~PagedVolume();
 
@@ -214,20 +355,66 @@ namespace PolyVox
 		VoxelType getVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos) const;
 		/// Gets a voxel at the position given by a 3D vector
 		VoxelType getVoxel(const Vector3DInt32& v3dPos) const;
+		/// Copies the voxels within the specified Region into a buffer
+		void getVoxels(const Region& region, VoxelType* pVoxels) const;
+
+		/// Gets a voxel from the given mip level at the position given by <tt>x,y,z</tt> coordinates
+		VoxelType getVoxelAtLevel(uint32_t uLevel, int32_t iXPos, int32_t iYPos, int32_t iZPos) const;
+		/// Gets a voxel from the given mip level at the position given by a 3D vector
+		VoxelType getVoxelAtLevel(uint32_t uLevel, const Vector3DInt32& v3dPos) const;
+		/// Copies the voxels of the given mip level within the specified Region into a buffer
+		void getVoxelsAtLevel(uint32_t uLevel, const Region& region, VoxelType* pVoxels) const;
 
 		/// Sets the voxel at the position given by <tt>x,y,z</tt> coordinates
 		void setVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos, VoxelType tValue);
 		/// Sets the voxel at the position given by a 3D vector
 		void setVoxel(const Vector3DInt32& v3dPos, VoxelType tValue);
+		/// Passes each voxel within the specified Region through a function, and writes back those which it changes
+		template <typename Function>
+		std::vector<Region> modifyVoxels(const Region& region, Function func);
+
+		/// Gets a voxel at the position given by <tt>x,y,z</tt> coordinates, but only if it is already in memory
+		bool tryGetVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos, VoxelType& tValue) const;
+		/// Gets a voxel at the position given by a 3D vector, but only if it is already in memory
+		bool tryGetVoxel(const Vector3DInt32& v3dPos, VoxelType& tValue) const;
+		/// Determines whether all the voxels within the specified Region are currently in memory.
+		bool isRegionResident(const Region& region) const;
+		/// Determines whether all the voxels within the specified Region are known to have the same value.
+		bool isRegionUniform(const Region& region, VoxelType& tValue) const;
+		/// Gets bounds on the values of the voxels within the specified Region.
+		bool getRegionValueRange(const Region& region, VoxelType& tMin, VoxelType& tMax) const;
+		/// Gets the side length of the chunks, which are the blocks in which the volume keeps track of the values of its voxels.
+		uint32_t getValueRangeBlockSideLength(void) const;
 
 		/// Tries to ensure that the voxels within the specified Region are loaded into memory.
 		void prefetch(Region regPrefetch);
+		/// Asks the paging threads to load the voxels within the specified Region into memory, without waiting for them to do so.
+		void prefetchAsync(Region regPrefetch, float fPriority = 0.0f);
+		/// Discards any asynchronous prefetch requests which the paging threads have not yet started on.
+		void cancelAsyncPrefetches(void);
+		/// Waits until the paging threads have serviced all outstanding asynchronous prefetch requests.
+		void waitForAsyncPrefetches(void);
 		/// Removes all voxels from memory
 		void flushAll();
 
+		/// Sets how many of the chunks in memory may be uncompressed
+		void setMaxNumberOfUncompressedChunks(uint32_t uMaxNumberOfUncompressedChunks);
+
+		/// Sets how many mip levels are kept for each chunk, and how they are computed
+		void setNoOfMipLevels(uint32_t uNoOfMipLevels, MipFilter eMipFilter = MipFilters::Average);
+		/// Gets how many mip levels are kept for each chunk
+		uint32_t getNoOfMipLevels(void) const;
+		/// Gets how the mip levels are computed
+		MipFilter getMipFilter(void) const;
+
 		/// Calculates approximatly how many bytes of memory the volume is currently using.
 		uint32_t calculateSizeInBytes(void);
 
+		/// Determines whether the volume can safely be accessed from several threads at once.
+		bool isConcurrentAccessEnabled(void) const;
+		/// Determines whether the volume has its own threads for paging data in and out.
+		bool isAsyncPagingEnabled(void) const;
+
 	protected:
 		/// Copy constructor
 		PagedVolume(const PagedVolume& rhs);
@@ -237,7 +424,48 @@ namespace PolyVox
 
 	private:
 		bool canReuseLastAccessedChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const;
-		Chunk* getChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ) const;
+		Chunk* getChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ, bool bDecompress = true) const;
+
+		// These are safe to use in concurrent mode, and the returned reference prevents the chunk from being evicted.
+		std::shared_ptr<Chunk> acquireChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const;
+
+		// In concurrent mode the caller must hold the lock on the shard containing the given chunk. Palette compressed chunks
+		// are only decompressed when accessed if 'bDecompress' is set, as otherwise the caller can use them as they are.
+		struct Shard;
+		struct ChunkList;
+		static uint32_t hashChunkPosition(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ);
+		Shard& getShard(uint32_t uHash) const;
+		std::unique_lock<std::mutex> lockShard(Shard& shard) const;
+		std::unique_lock<std::mutex> lockShardForChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash) const;
+		bool isChunkBeingPaged(const Shard& shard, int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const;
+		uint32_t findChunkIndex(const Shard& shard, int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash) const;
+		std::shared_ptr<Chunk>& findOrCreateChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash, bool bDecompress = true) const;
+		std::shared_ptr<Chunk>& insertChunk(Shard& shard, uint32_t uHash, std::shared_ptr<Chunk> pChunk) const;
+		void resizeShard(Shard& shard, uint32_t uNewSize) const;
+		void removeChunk(Shard& shard, uint32_t uIndex) const;
+		void touchChunk(Shard& shard, Chunk* pChunk, bool bDecompress = true) const;
+		void compressChunk(Shard& shard, Chunk* pChunk) const;
+		std::shared_ptr<Chunk> createChunk(const Vector3DInt32& v3dChunkPos) const;
+		void unshareChunkData(Shard& shard, std::shared_ptr<Chunk>& pChunk) const;
+		void setVoxelInChunk(Shard& shard, std::shared_ptr<Chunk>& pChunk, uint16_t uXPos, uint16_t uYPos, uint16_t uZPos, VoxelType tValue) const;
+		// Updates (or with 'bRelease' discards) the mip levels of a chunk, adjusting the memory usage if it is compressed.
+		void updateMipLevelsInChunk(Chunk* pChunk, bool bRelease = false) const;
+		VoxelType* getUniformData(VoxelType tValue) const;
+		ChunkList& getChunkList(Shard& shard, const Chunk* pChunk) const;
+		void linkChunk(ChunkList& list, Chunk* pChunk) const;
+		void unlinkChunk(ChunkList& list, Chunk* pChunk) const;
+		uint32_t findEvictionCandidate(const Shard& shard, const ChunkList& list) const;
+		uint32_t findShardWithOldestChunk(bool bCompressed, uint32_t& uOldestChunkTimestamp) const;
+		uint32_t nextTimestamp(void) const;
+		uint32_t calculateMemoryUsageInBytes(void) const;
+		bool isOverMemoryLimits(void) const;
+		void evictExcessChunks(void) const;
+		void removeExcessChunks(void) const;
+
+		// Used by the paging threads.
+		void runPagingThread(void);
+		void pageInChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const;
+		void stopPagingThreads(void);
 
 		// Storing these properties individually has proved to be faster than keeping
 		// them in a Vector3DInt32 as it avoids constructions and comparison overheads.
@@ -248,27 +476,140 @@ namespace PolyVox
 		mutable int32_t m_v3dLastAccessedChunkZ = 0;
 		mutable Chunk* m_pLastAccessedChunk = nullptr;
 
-		mutable uint32_t m_uTimestamper = 0;
+		mutable std::atomic<uint32_t> m_uTimestamper;
 
+		// The memory usage of the volume, maintained as chunks are added, removed, compressed and decompressed. Chunks which
+		// share their data are counted with the compressed ones. The limit on the memory usage is expressed as the number of
+		// uncompressed chunks which would fit in it.
+		mutable std::atomic<uint32_t> m_uNoOfUncompressedChunks;
+		mutable std::atomic<uint32_t> m_uCompressedChunkSizeInBytes;
+		mutable std::atomic<uint32_t> m_uNoOfUniformDataBuffers;
 		uint32_t m_uChunkCountLimit = 0;
+		uint32_t m_uUncompressedChunkCountLimit = 0;
+		static const uint32_t uMinPracticalNoOfChunks = 32; // Enough to make sure a chunks and it's neighbours can be loaded, with a few to spare.
+
+		// Chunks in which every voxel has the same value share a buffer filled with that value, rather than each having their
+		// own copy. There is one buffer per value and they are kept until the volume is destroyed, so the number is limited and
+		// any further uniform chunks are stored as normal. This is declared before the shards so that it outlives the chunks.
+		static const uint32_t uMaxNoOfUniformDataBuffers = 16;
+		mutable std::vector< std::pair< VoxelType, std::unique_ptr<VoxelType[]> > > m_vecUniformDataBuffers;
+		mutable std::mutex m_mutexUniformDataBuffers;
+
+		// Chunks are stored in a number of shards, each of which has its own lock. A chunk only ever lives in the shard given by
+		// its hash, so in concurrent mode threads working on different chunks seldom contend. Within a shard the chunks are stored
+		// in an open-addressing hash table with linear probing. Removed chunks leave a 'tombstone' behind so that a search can stop
+		// as soon as it reaches an empty slot, meaning that a search for a chunk which is not present is as fast as one which is.
+		// The table is kept at most half full (counting tombstones) and grows as required, so the number of chunks is limited
+		// only by the target memory usage.
+		struct Slot
+		{
+			// Copied from the chunk so that probing does not need to access the chunk itself.
+			int32_t iChunkX = 0;
+			int32_t iChunkY = 0;
+			int32_t iChunkZ = 0;
+			bool bTombstone = false;
+			std::shared_ptr<Chunk> pChunk;
+		};
 
-		// Chunks are stored in the following array which is used as a hash-table. Conventional wisdom is that such a hash-table
-		// should not be more than half full to avoid conflicts, and a practical chunk size seems to be 64^3. With this configuration
-		// there can be up to 32768*64^3 = 8 gigavoxels (with each voxel perhaps being many bytes). This should effectively make use 
-		// of even high end machines. Of course, the user can choose to limit the memory usage in which case much less of the chunk 
-		// array will actually be used. None-the-less, we have chosen to use a fixed size array (rather than a vector) as it appears to 
-		// be slightly faster (probably due to the extra pointer indirection in a vector?) and the actual size of this array should
-		// just be 1Mb or so.
-		static const uint32_t uChunkArraySize = 65536;
-		mutable std::unique_ptr< Chunk > m_arrayChunks[uChunkArraySize];
+		static const uint32_t uNoOfShards = 16;
+		static const uint32_t uShardSelectionShift = 28; // Use the top four bits of the hash to select the shard.
+		static const uint32_t uInitialShardSize = 64; // Must be a power of two.
+		static const uint32_t uInvalidIndex = 0xFFFFFFFF;
+		struct ChunkList
+		{
+			Chunk* pNewestChunk = nullptr;
+			Chunk* pOldestChunk = nullptr;
+		};
+		struct Shard
+		{
+			std::mutex mutex;
+
+			// Chunks which are being paged in or out without the lock being held (so they are not in the table). Any thread
+			// which needs one of these chunks waits on the condition variable until it is finished with. There can be at most
+			// one of these per thread, so a vector is sufficient.
+			std::vector<Vector3DInt32> vecChunksBeingPaged;
+			std::condition_variable condChunkPaged;
+
+			std::vector<Slot> vecSlots;
+			uint32_t uNoOfChunks = 0;
+			uint32_t uNoOfTombstones = 0;
+
+			// The chunks in this shard, ordered by when they were last accessed. Chunks are moved between the lists as they are
+			// compressed and decompressed, and chunks which share their data are kept with the compressed ones.
+			ChunkList listUncompressedChunks;
+			ChunkList listCompressedChunks;
+		};
+		mutable Shard m_arrayShards[uNoOfShards];
+		bool m_bConcurrentAccess = false;
+
+		// Marks a chunk as being paged for as long as it exists. See Shard::vecChunksBeingPaged.
+		class ChunkPagingGuard
+		{
+		public:
+			// The caller must hold the lock on the shard when creating the guard, but not when destroying it.
+			ChunkPagingGuard(const PagedVolume* pVolume, Shard& shard, const Vector3DInt32& v3dChunkPos);
+			~ChunkPagingGuard();
+
+		private:
+			const PagedVolume* m_pVolume;
+			Shard& m_shard;
+			Vector3DInt32 m_v3dChunkPos;
+		};
+
+		// Asynchronous prefetch requests are serviced in order of priority, and then in the order they were made.
+		struct PrefetchRequest
+		{
+			int32_t iChunkX;
+			int32_t iChunkY;
+			int32_t iChunkZ;
+			float fPriority;
+			uint32_t uSequenceNo;
+
+			// Used by the priority queue, which gives the 'largest' element first.
+			bool operator<(const PrefetchRequest& rhs) const
+			{
+				return (fPriority != rhs.fPriority) ? (fPriority > rhs.fPriority) : (uSequenceNo > rhs.uSequenceNo);
+			}
+		};
+
+		// The state of the paging threads is protected by its own mutex, which is never held at the same time as a shard lock.
+		std::vector<std::thread> m_vecPagingThreads;
+		std::priority_queue<PrefetchRequest> m_queuePrefetchRequests;
+		uint32_t m_uNextPrefetchSequenceNo = 0;
+		uint32_t m_uNoOfActivePrefetches = 0;
+		bool m_bStopPaging = false;
+		mutable std::atomic<bool> m_bEvictionRequested;
+		mutable std::mutex m_mutexPaging;
+		mutable std::condition_variable m_condPagingWork;
+		std::condition_variable m_condPagingIdle;
 
 		// The size of the chunks
 		uint16_t m_uChunkSideLength;
 		uint8_t m_uChunkSideLengthPower;
 		int32_t m_iChunkMask;
 
+		// The number of mip levels kept for each chunk, which can be at most m_uChunkSideLengthPower, and how they are computed.
+		uint32_t m_uNoOfMipLevels = 0;
+		MipFilter m_eMipFilter = MipFilters::Average;
+
 		Pager* m_pPager = nullptr;
 	};
+
+	/// Copies the voxels using PagedVolume::getVoxels().
+	template <typename VoxelType>
+	void gatherVoxels(PagedVolume<VoxelType>* volData, const Region& region, VoxelType* pVoxels);
+
+	/// Gives the number of mip levels of the PagedVolume if they are kept with MipFilters::Subsample.
+	template <typename VoxelType>
+	uint32_t getNoOfSubsampledLevels(PagedVolume<VoxelType>* volData);
+
+	/// Copies the voxels of a mip level using PagedVolume::getVoxelsAtLevel().
+	template <typename VoxelType>
+	void gatherVoxelsAtSubsampledLevel(PagedVolume<VoxelType>* volData, uint32_t uLevel, const Region& region, VoxelType* pVoxels);
+
+	/// Modifies the voxels using PagedVolume::modifyVoxels().
+	template <typename VoxelType, typename Function>
+	std::vector<Region> modifyVoxels(PagedVolume<VoxelType>* volData, const Region& region, Function func);
 }
 
 #include "PagedVolume.inl"
@@ -23,26 +23,40 @@
 *******************************************************************************/
 
 #include "Impl/ErrorHandling.h"
+#include "Impl/Morton.h"
 
 #include <algorithm>
 #include <limits>
 
 namespace PolyVox
 {
+	// Required as the constant is passed by reference to std::min() and std::max().
+	template <typename VoxelType>
+	const uint32_t PagedVolume<VoxelType>::uMinPracticalNoOfChunks;
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// This constructor creates a volume with a fixed size which is specified as a parameter. By default this constructor will not enable paging but you can override this if desired. If you do wish to enable paging then you are required to provide the call back function (see the other PagedVolume constructor).
 	/// \param pPager Called by PolyVox to load and unload data on demand.
 	/// \param uTargetMemoryUsageInBytes The upper limit to how much memory this PagedVolume should aim to use.
 	/// \param uChunkSideLength The size of the chunks making up the volume. Small chunks will compress/decompress faster, but there will also be more of them meaning voxel access could be slower.
+	/// \param bConcurrentAccess Allows the volume to be accessed from several threads at once. This adds some locking overhead to chunk lookups so it is disabled by default.
+	/// \param uNoOfPagingThreads The number of threads to create for asynchronous paging. This requires concurrent access to be enabled, and if it is zero then all paging is done by the threads accessing the volume.
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	PagedVolume<VoxelType>::PagedVolume(Pager* pPager, uint32_t uTargetMemoryUsageInBytes, uint16_t uChunkSideLength)
+	PagedVolume<VoxelType>::PagedVolume(Pager* pPager, uint32_t uTargetMemoryUsageInBytes, uint16_t uChunkSideLength, bool bConcurrentAccess, uint32_t uNoOfPagingThreads)
 		:BaseVolume<VoxelType>()
+		, m_uTimestamper(0)
+		, m_uNoOfUncompressedChunks(0)
+		, m_uCompressedChunkSizeInBytes(0)
+		, m_uNoOfUniformDataBuffers(0)
+		, m_bConcurrentAccess(bConcurrentAccess)
+		, m_bEvictionRequested(false)
 		, m_uChunkSideLength(uChunkSideLength)
 		, m_pPager(pPager)
 	{
 			// Validation of parameters
 			POLYVOX_THROW_IF(!pPager, std::invalid_argument, "You must provide a valid pager when constructing a PagedVolume");
+			POLYVOX_THROW_IF((uNoOfPagingThreads > 0) && (!bConcurrentAccess), std::invalid_argument, "Asynchronous paging requires concurrent access to be enabled.");
 			POLYVOX_THROW_IF(uTargetMemoryUsageInBytes < 1 * 1024 * 1024, std::invalid_argument, "Target memory usage is too small to be practical");
 			POLYVOX_THROW_IF(m_uChunkSideLength == 0, std::invalid_argument, "Chunk side length cannot be zero.");
 			POLYVOX_THROW_IF(m_uChunkSideLength > 256, std::invalid_argument, "Chunk size is too large to be practical.");
@@ -57,17 +71,28 @@ namespace PolyVox
 			uint32_t uChunkSizeInBytes = PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(m_uChunkSideLength);
 			m_uChunkCountLimit = uTargetMemoryUsageInBytes / uChunkSizeInBytes;
 
-			// Enforce sensible limits on the number of chunks.
-			const uint32_t uMinPracticalNoOfChunks = 32; // Enough to make sure a chunks and it's neighbours can be loaded, with a few to spare.
-			const uint32_t uMaxPracticalNoOfChunks = uChunkArraySize / 2; // A hash table should only become half-full to avoid too many clashes.
+			// Enforce a sensible lower limit on the number of chunks. There is no upper limit as the chunk table grows as required.
 			POLYVOX_LOG_WARNING_IF(m_uChunkCountLimit < uMinPracticalNoOfChunks, "Requested memory usage limit of ",
 				uTargetMemoryUsageInBytes / (1024 * 1024), "Mb is too low and cannot be adhered to.");
 			m_uChunkCountLimit = (std::max)(m_uChunkCountLimit, uMinPracticalNoOfChunks);
-			m_uChunkCountLimit = (std::min)(m_uChunkCountLimit, uMaxPracticalNoOfChunks);
+
+			// No chunks are compressed unless the user asks for them to be.
+			m_uUncompressedChunkCountLimit = m_uChunkCountLimit;
+
+			for (uint32_t uShard = 0; uShard < uNoOfShards; uShard++)
+			{
+				m_arrayShards[uShard].vecSlots.resize(uInitialShardSize);
+			}
 
 			// Inform the user about the chosen memory configuration.
 			POLYVOX_LOG_DEBUG("Memory usage limit for volume now set to ", (m_uChunkCountLimit * uChunkSizeInBytes) / (1024 * 1024),
 				"Mb (", m_uChunkCountLimit, " chunks of ", uChunkSizeInBytes / 1024, "Kb each).");
+
+			// The paging threads are started last, once the volume is ready for them to use.
+			for (uint32_t ct = 0; ct < uNoOfPagingThreads; ct++)
+			{
+				m_vecPagingThreads.push_back(std::thread(&PagedVolume<VoxelType>::runPagingThread, this));
+			}
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -85,10 +110,12 @@ namespace PolyVox
 
 	////////////////////////////////////////////////////////////////////////////////
 	/// Destroys the volume The destructor will call flushAll() to ensure that a paging volume has the chance to save it's data via the dataOverflowHandler() if desired.
+	/// Any asynchronous prefetch requests which have not yet been serviced are discarded.
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
 	PagedVolume<VoxelType>::~PagedVolume()
 	{
+		stopPagingThreads();
 		flushAll();
 	}
 
@@ -124,9 +151,22 @@ namespace PolyVox
 		const uint16_t yOffset = static_cast<uint16_t>(uYPos & m_iChunkMask);
 		const uint16_t zOffset = static_cast<uint16_t>(uZPos & m_iChunkMask);
 
-		auto pChunk = canReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? m_pLastAccessedChunk : getChunk(chunkX, chunkY, chunkZ);
+		if (m_bConcurrentAccess)
+		{
+			// The last accessed chunk is shared between threads so we can't use it here. Instead we read the voxel while
+			// holding the lock on the shard, which also means the chunk cannot be evicted until we have finished with it.
+			const uint32_t uHash = hashChunkPosition(chunkX, chunkY, chunkZ);
+			std::unique_lock<std::mutex> lock = lockShardForChunk(chunkX, chunkY, chunkZ, uHash);
+			VoxelType tValue = findOrCreateChunk(chunkX, chunkY, chunkZ, uHash, false)->getVoxelAllowingPalette(xOffset, yOffset, zOffset);
+			lock.unlock();
+
+			evictExcessChunks();
+			return tValue;
+		}
+
+		auto pChunk = canReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? m_pLastAccessedChunk : getChunk(chunkX, chunkY, chunkZ, false);
 
-		return pChunk->getVoxel(xOffset, yOffset, zOffset);
+		return pChunk->getVoxelAllowingPalette(xOffset, yOffset, zOffset);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -141,6 +181,210 @@ namespace PolyVox
 		return getVoxel(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ());
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// The voxels are stored with x varying fastest, followed by y and then z. Rather than looking up the chunk for every voxel
+	/// (as a Sampler has to do) the Region is split up by chunk, and each chunk is looked up once and its part of the Region copied
+	/// in one go. Chunks which are sharing their data (see the class description) are simply filled with their value, and those
+	/// which are palette compressed are read without decompressing them. Any chunks which are not in memory are paged in.
+	/// \param region The Region of voxels to copy.
+	/// \param[out] pVoxels The buffer which receives the voxels. It must be large enough to hold the whole Region.
+	/// \sa gatherVoxels()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::getVoxels(const Region& region, VoxelType* pVoxels) const
+	{
+		const uint32_t uWidth = region.getWidthInVoxels();
+		const uint32_t uHeight = region.getHeightInVoxels();
+
+		for (int32_t z = region.getLowerZ() >> m_uChunkSideLengthPower; z <= (region.getUpperZ() >> m_uChunkSideLengthPower); z++)
+		{
+			for (int32_t y = region.getLowerY() >> m_uChunkSideLengthPower; y <= (region.getUpperY() >> m_uChunkSideLengthPower); y++)
+			{
+				for (int32_t x = region.getLowerX() >> m_uChunkSideLengthPower; x <= (region.getUpperX() >> m_uChunkSideLengthPower); x++)
+				{
+					// The part of the Region which is inside this chunk.
+					Region chunkRegion(x << m_uChunkSideLengthPower, y << m_uChunkSideLengthPower, z << m_uChunkSideLengthPower,
+						((x + 1) << m_uChunkSideLengthPower) - 1, ((y + 1) << m_uChunkSideLengthPower) - 1, ((z + 1) << m_uChunkSideLengthPower) - 1);
+					chunkRegion.cropTo(region);
+
+					{
+						const uint32_t uHash = hashChunkPosition(x, y, z);
+						std::unique_lock<std::mutex> lock = lockShardForChunk(x, y, z, uHash);
+						const Chunk* pChunk = findOrCreateChunk(x, y, z, uHash, false).get();
+
+						for (int32_t iZPos = chunkRegion.getLowerZ(); iZPos <= chunkRegion.getUpperZ(); iZPos++)
+						{
+							for (int32_t iYPos = chunkRegion.getLowerY(); iYPos <= chunkRegion.getUpperY(); iYPos++)
+							{
+								VoxelType* pDst = pVoxels +
+									(chunkRegion.getLowerX() - region.getLowerX()) +
+									(iYPos - region.getLowerY()) * uWidth +
+									(iZPos - region.getLowerZ()) * uWidth * uHeight;
+								const uint16_t uYOffset = static_cast<uint16_t>(iYPos & m_iChunkMask);
+								const uint16_t uZOffset = static_cast<uint16_t>(iZPos & m_iChunkMask);
+
+								if (pChunk->isUsingSharedData())
+								{
+									std::fill(pDst, pDst + chunkRegion.getWidthInVoxels(), pChunk->m_tData[0]);
+								}
+								else if (pChunk->m_tData)
+								{
+									// The data is in Morton order, so the y and z parts of the index are the same along the row.
+									const uint32_t uRowIndex = morton256_y[uYOffset] | morton256_z[uZOffset];
+									for (int32_t iXPos = chunkRegion.getLowerX(); iXPos <= chunkRegion.getUpperX(); iXPos++)
+									{
+										*pDst = pChunk->m_tData[uRowIndex | morton256_x[iXPos & m_iChunkMask]];
+										pDst++;
+									}
+								}
+								else
+								{
+									for (int32_t iXPos = chunkRegion.getLowerX(); iXPos <= chunkRegion.getUpperX(); iXPos++)
+									{
+										*pDst = pChunk->getVoxelAllowingPalette(static_cast<uint16_t>(iXPos & m_iChunkMask), uYOffset, uZOffset);
+										pDst++;
+									}
+								}
+							}
+						}
+					}
+
+					evictExcessChunks();
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The position is given in the coordinates of the mip level, so the voxel which is returned covers the voxels of the volume
+	/// from <tt>(x,y,z) * 2^uLevel</tt> to <tt>(x,y,z) * 2^uLevel + 2^uLevel - 1</tt>. Level zero is the volume itself. If the chunk
+	/// containing the voxel has been modified since its mip levels were last read then the affected parts of them are recomputed.
+	/// \param uLevel The mip level to read from, which must not be more than getNoOfMipLevels().
+	/// \param iXPos The \c x position of the voxel within the mip level
+	/// \param iYPos The \c y position of the voxel within the mip level
+	/// \param iZPos The \c z position of the voxel within the mip level
+	/// \return The voxel value
+	/// \sa setNoOfMipLevels()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::getVoxelAtLevel(uint32_t uLevel, int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		POLYVOX_THROW_IF(uLevel > m_uNoOfMipLevels, std::invalid_argument, "The volume does not have the requested mip level.");
+
+		if (uLevel == 0)
+		{
+			return getVoxel(iXPos, iYPos, iZPos);
+		}
+
+		// A chunk covers fewer voxels of each successive level.
+		const uint32_t uLevelChunkSideLengthPower = m_uChunkSideLengthPower - uLevel;
+		const int32_t iLevelChunkMask = m_iChunkMask >> uLevel;
+
+		const int32_t chunkX = iXPos >> uLevelChunkSideLengthPower;
+		const int32_t chunkY = iYPos >> uLevelChunkSideLengthPower;
+		const int32_t chunkZ = iZPos >> uLevelChunkSideLengthPower;
+
+		const uint16_t xOffset = static_cast<uint16_t>(iXPos & iLevelChunkMask);
+		const uint16_t yOffset = static_cast<uint16_t>(iYPos & iLevelChunkMask);
+		const uint16_t zOffset = static_cast<uint16_t>(iZPos & iLevelChunkMask);
+
+		if (m_bConcurrentAccess)
+		{
+			// As with getVoxel(), the mip levels are updated and read while holding the lock on the shard.
+			const uint32_t uHash = hashChunkPosition(chunkX, chunkY, chunkZ);
+			std::unique_lock<std::mutex> lock = lockShardForChunk(chunkX, chunkY, chunkZ, uHash);
+			Chunk* pChunk = findOrCreateChunk(chunkX, chunkY, chunkZ, uHash, false).get();
+			updateMipLevelsInChunk(pChunk);
+			VoxelType tValue = pChunk->getVoxelAtLevel(uLevel, xOffset, yOffset, zOffset);
+			lock.unlock();
+
+			evictExcessChunks();
+			return tValue;
+		}
+
+		auto pChunk = canReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? m_pLastAccessedChunk : getChunk(chunkX, chunkY, chunkZ, false);
+		updateMipLevelsInChunk(pChunk);
+
+		return pChunk->getVoxelAtLevel(uLevel, xOffset, yOffset, zOffset);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param uLevel The mip level to read from, which must not be more than getNoOfMipLevels().
+	/// \param v3dPos The 3D position of the voxel within the mip level
+	/// \return The voxel value
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::getVoxelAtLevel(uint32_t uLevel, const Vector3DInt32& v3dPos) const
+	{
+		return getVoxelAtLevel(uLevel, v3dPos.getX(), v3dPos.getY(), v3dPos.getZ());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is the equivalent of getVoxels() for a mip level, and the Region is given in the coordinates of that level (see
+	/// getVoxelAtLevel()). Each chunk is looked up (and has its mip levels brought up to date) only once.
+	/// \param uLevel The mip level to read from, which must not be more than getNoOfMipLevels().
+	/// \param region The Region of voxels to copy, in the coordinates of the mip level.
+	/// \param[out] pVoxels The buffer which receives the voxels. It must be large enough to hold the whole Region.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::getVoxelsAtLevel(uint32_t uLevel, const Region& region, VoxelType* pVoxels) const
+	{
+		POLYVOX_THROW_IF(uLevel > m_uNoOfMipLevels, std::invalid_argument, "The volume does not have the requested mip level.");
+
+		if (uLevel == 0)
+		{
+			getVoxels(region, pVoxels);
+			return;
+		}
+
+		const uint32_t uLevelChunkSideLengthPower = m_uChunkSideLengthPower - uLevel;
+		const int32_t iLevelChunkMask = m_iChunkMask >> uLevel;
+		const uint32_t uWidth = region.getWidthInVoxels();
+		const uint32_t uHeight = region.getHeightInVoxels();
+
+		for (int32_t z = region.getLowerZ() >> uLevelChunkSideLengthPower; z <= (region.getUpperZ() >> uLevelChunkSideLengthPower); z++)
+		{
+			for (int32_t y = region.getLowerY() >> uLevelChunkSideLengthPower; y <= (region.getUpperY() >> uLevelChunkSideLengthPower); y++)
+			{
+				for (int32_t x = region.getLowerX() >> uLevelChunkSideLengthPower; x <= (region.getUpperX() >> uLevelChunkSideLengthPower); x++)
+				{
+					// The part of the Region which is inside this chunk.
+					Region chunkRegion(x << uLevelChunkSideLengthPower, y << uLevelChunkSideLengthPower, z << uLevelChunkSideLengthPower,
+						((x + 1) << uLevelChunkSideLengthPower) - 1, ((y + 1) << uLevelChunkSideLengthPower) - 1, ((z + 1) << uLevelChunkSideLengthPower) - 1);
+					chunkRegion.cropTo(region);
+
+					{
+						const uint32_t uHash = hashChunkPosition(x, y, z);
+						std::unique_lock<std::mutex> lock = lockShardForChunk(x, y, z, uHash);
+						Chunk* pChunk = findOrCreateChunk(x, y, z, uHash, false).get();
+						updateMipLevelsInChunk(pChunk);
+
+						for (int32_t iZPos = chunkRegion.getLowerZ(); iZPos <= chunkRegion.getUpperZ(); iZPos++)
+						{
+							for (int32_t iYPos = chunkRegion.getLowerY(); iYPos <= chunkRegion.getUpperY(); iYPos++)
+							{
+								VoxelType* pDst = pVoxels +
+									(chunkRegion.getLowerX() - region.getLowerX()) +
+									(iYPos - region.getLowerY()) * uWidth +
+									(iZPos - region.getLowerZ()) * uWidth * uHeight;
+								const uint16_t uYOffset = static_cast<uint16_t>(iYPos & iLevelChunkMask);
+								const uint16_t uZOffset = static_cast<uint16_t>(iZPos & iLevelChunkMask);
+
+								for (int32_t iXPos = chunkRegion.getLowerX(); iXPos <= chunkRegion.getUpperX(); iXPos++)
+								{
+									*pDst = pChunk->getVoxelAtLevel(uLevel, static_cast<uint16_t>(iXPos & iLevelChunkMask), uYOffset, uZOffset);
+									pDst++;
+								}
+							}
+						}
+					}
+
+					evictExcessChunks();
+				}
+			}
+		}
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// \param uXPos the \c x position of the voxel
 	/// \param uYPos the \c y position of the voxel
@@ -157,9 +401,49 @@ namespace PolyVox
 		const uint16_t yOffset = static_cast<uint16_t>(uYPos - (chunkY << m_uChunkSideLengthPower));
 		const uint16_t zOffset = static_cast<uint16_t>(uZPos - (chunkZ << m_uChunkSideLengthPower));
 
-		auto pChunk = canReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? m_pLastAccessedChunk : getChunk(chunkX, chunkY, chunkZ);
+		// The change tracker is only notified once the new value has been written (so that anything which responds to the
+		// change is guaranteed to see it), and only if the value really changes.
+		if (m_bConcurrentAccess)
+		{
+			// See getVoxel(). Holding the lock also ensures that the write cannot be lost by the chunk being
+			// paged out by another thread while we are still modifying it.
+			const uint32_t uHash = hashChunkPosition(chunkX, chunkY, chunkZ);
+			std::unique_lock<std::mutex> lock = lockShardForChunk(chunkX, chunkY, chunkZ, uHash);
+			std::shared_ptr<Chunk>& pSlotChunk = findOrCreateChunk(chunkX, chunkY, chunkZ, uHash, false);
+			const VoxelType tOldValue = pSlotChunk->getVoxelAllowingPalette(xOffset, yOffset, zOffset);
+			setVoxelInChunk(getShard(uHash), pSlotChunk, xOffset, yOffset, zOffset, tValue);
+			lock.unlock();
+
+			if (this->m_pChangeTracker && (tOldValue != tValue))
+			{
+				this->m_pChangeTracker->voxelChanged(uXPos, uYPos, uZPos);
+			}
+
+			evictExcessChunks();
+			return;
+		}
+
+		auto pChunk = canReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? m_pLastAccessedChunk : getChunk(chunkX, chunkY, chunkZ, false);
+		const VoxelType tOldValue = pChunk->getVoxelAllowingPalette(xOffset, yOffset, zOffset);
 
-		pChunk->setVoxel(xOffset, yOffset, zOffset, tValue);
+		// Chunks which are compressed or share their data need some extra work (see setVoxelInChunk()).
+		if ((!pChunk->m_tData) || pChunk->isUsingSharedData())
+		{
+			const uint32_t uHash = hashChunkPosition(chunkX, chunkY, chunkZ);
+			Shard& shard = getShard(uHash);
+			std::shared_ptr<Chunk>& pSlotChunk = shard.vecSlots[findChunkIndex(shard, chunkX, chunkY, chunkZ, uHash)].pChunk;
+			setVoxelInChunk(shard, pSlotChunk, xOffset, yOffset, zOffset, tValue);
+			m_pLastAccessedChunk = pSlotChunk.get();
+		}
+		else
+		{
+			pChunk->setVoxel(xOffset, yOffset, zOffset, tValue);
+		}
+
+		if (this->m_pChangeTracker && (tOldValue != tValue))
+		{
+			this->m_pChangeTracker->voxelChanged(uXPos, uYPos, uZPos);
+		}
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -173,190 +457,1328 @@ namespace PolyVox
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
-	/// Note that if the memory usage limit is not large enough to support the region this function will only load part of the region. In this case it is undefined which parts will actually be loaded. If all the voxels in the given region are already loaded, this function will not do anything. Other voxels might be unloaded to make space for the new voxels.
-	/// \param regPrefetch The Region of voxels to prefetch into memory.
+	/// The function is called as <tt>func(x, y, z, tOldValue)</tt> and returns the new value of the voxel. As with getVoxels(), the
+	/// Region is split up by chunk and each chunk is looked up (and locked, if concurrent access is enabled) only once, rather than
+	/// for every voxel as setVoxel() has to do. Voxels whose value does not change are not written, so chunks which share their
+	/// data only get their own copy (and chunks are only marked as needing to be paged out) if the function really changes them.
+	///
+	/// The function is called while the chunk is locked, so it must not access the volume itself. An edit which depends on the
+	/// neighbours of each voxel (such as smoothing) should read them with gatherVoxels() first.
+	/// \param region The Region of voxels to pass through the function.
+	/// \param func The function which computes the new value of each voxel.
+	/// \return For each chunk in which voxels were changed, the Region bounding those voxels.
+	/// \sa modifyVoxels(VolumeType*, const Region&, Function)
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	void PagedVolume<VoxelType>::prefetch(Region regPrefetch)
+	template <typename Function>
+	std::vector<Region> PagedVolume<VoxelType>::modifyVoxels(const Region& region, Function func)
 	{
-		// Convert the start and end positions into chunk space coordinates
-		Vector3DInt32 v3dStart;
-		for (int i = 0; i < 3; i++)
-		{
-			v3dStart.setElement(i, regPrefetch.getLowerCorner().getElement(i) >> m_uChunkSideLengthPower);
-		}
-
-		Vector3DInt32 v3dEnd;
-		for (int i = 0; i < 3; i++)
+		// Chunks are replaced by a copy when they stop sharing their data (see unshareChunkData()), so the last accessed chunk
+		// could be left pointing at one which has been deleted.
+		if (!m_bConcurrentAccess)
 		{
-			v3dEnd.setElement(i, regPrefetch.getUpperCorner().getElement(i) >> m_uChunkSideLengthPower);
+			m_pLastAccessedChunk = nullptr;
 		}
 
-		// Ensure we don't page in more chunks than the volume can hold.
-		Region region(v3dStart, v3dEnd);
-		uint32_t uNoOfChunks = static_cast<uint32_t>(region.getWidthInVoxels() * region.getHeightInVoxels() * region.getDepthInVoxels());
-		POLYVOX_LOG_WARNING_IF(uNoOfChunks > m_uChunkCountLimit, "Attempting to prefetch more than the maximum number of chunks (this will cause thrashing).");
-		uNoOfChunks = (std::min)(uNoOfChunks, m_uChunkCountLimit);
-
-		// Loops over the specified positions and touch the corresponding chunks.
-		for (int32_t x = v3dStart.getX(); x <= v3dEnd.getX(); x++)
+		std::vector<Region> vecChangedRegions;
+		for (int32_t z = region.getLowerZ() >> m_uChunkSideLengthPower; z <= (region.getUpperZ() >> m_uChunkSideLengthPower); z++)
 		{
-			for (int32_t y = v3dStart.getY(); y <= v3dEnd.getY(); y++)
+			for (int32_t y = region.getLowerY() >> m_uChunkSideLengthPower; y <= (region.getUpperY() >> m_uChunkSideLengthPower); y++)
 			{
-				for (int32_t z = v3dStart.getZ(); z <= v3dEnd.getZ(); z++)
+				for (int32_t x = region.getLowerX() >> m_uChunkSideLengthPower; x <= (region.getUpperX() >> m_uChunkSideLengthPower); x++)
 				{
-					getChunk(x, y, z);
+					// The part of the Region which is inside this chunk.
+					Region chunkRegion(x << m_uChunkSideLengthPower, y << m_uChunkSideLengthPower, z << m_uChunkSideLengthPower,
+						((x + 1) << m_uChunkSideLengthPower) - 1, ((y + 1) << m_uChunkSideLengthPower) - 1, ((z + 1) << m_uChunkSideLengthPower) - 1);
+					chunkRegion.cropTo(region);
+
+					Region regChanged = Region::InvertedRegion();
+					{
+						const uint32_t uHash = hashChunkPosition(x, y, z);
+						Shard& shard = getShard(uHash);
+						std::unique_lock<std::mutex> lock = lockShardForChunk(x, y, z, uHash);
+						std::shared_ptr<Chunk>& pChunk = findOrCreateChunk(x, y, z, uHash, false);
+
+						for (int32_t iZPos = chunkRegion.getLowerZ(); iZPos <= chunkRegion.getUpperZ(); iZPos++)
+						{
+							for (int32_t iYPos = chunkRegion.getLowerY(); iYPos <= chunkRegion.getUpperY(); iYPos++)
+							{
+								const uint16_t uYOffset = static_cast<uint16_t>(iYPos & m_iChunkMask);
+								const uint16_t uZOffset = static_cast<uint16_t>(iZPos & m_iChunkMask);
+
+								if (pChunk->m_tData && !pChunk->isUsingSharedData())
+								{
+									// The data is in Morton order, so the y and z parts of the index are the same along the row.
+									const uint32_t uRowIndex = morton256_y[uYOffset] | morton256_z[uZOffset];
+									for (int32_t iXPos = chunkRegion.getLowerX(); iXPos <= chunkRegion.getUpperX(); iXPos++)
+									{
+										VoxelType& tVoxel = pChunk->m_tData[uRowIndex | morton256_x[iXPos & m_iChunkMask]];
+										const VoxelType tNewValue = func(iXPos, iYPos, iZPos, tVoxel);
+										if (tNewValue != tVoxel)
+										{
+											tVoxel = tNewValue;
+											regChanged.accumulate(iXPos, iYPos, iZPos);
+										}
+									}
+								}
+								else
+								{
+									// Chunks which share their data or are palette compressed go through setVoxelInChunk(), which may leave
+									// them uncompressed. In that case the remaining rows are written directly.
+									for (int32_t iXPos = chunkRegion.getLowerX(); iXPos <= chunkRegion.getUpperX(); iXPos++)
+									{
+										const uint16_t uXOffset = static_cast<uint16_t>(iXPos & m_iChunkMask);
+										const VoxelType tOldValue = pChunk->getVoxelAllowingPalette(uXOffset, uYOffset, uZOffset);
+										const VoxelType tNewValue = func(iXPos, iYPos, iZPos, tOldValue);
+										if (tNewValue != tOldValue)
+										{
+											setVoxelInChunk(shard, pChunk, uXOffset, uYOffset, uZOffset, tNewValue);
+											regChanged.accumulate(iXPos, iYPos, iZPos);
+										}
+									}
+								}
+							}
+						}
+
+						// The voxels written directly to the data bypass Chunk::setVoxel(), which would otherwise do this.
+						if (regChanged.isValid())
+						{
+							Region regChangedInChunk = regChanged;
+							regChangedInChunk.shift(-(x << m_uChunkSideLengthPower), -(y << m_uChunkSideLengthPower), -(z << m_uChunkSideLengthPower));
+
+							pChunk->m_bDataModified = true;
+							pChunk->m_bValueRangeOutOfDate = true;
+							pChunk->m_regMipLevelsOutOfDate.accumulate(regChangedInChunk);
+						}
+					}
+
+					evictExcessChunks();
+
+					if (regChanged.isValid())
+					{
+						if (this->m_pChangeTracker)
+						{
+							this->m_pChangeTracker->regionChanged(regChanged);
+						}
+						vecChangedRegions.push_back(regChanged);
+					}
 				}
 			}
 		}
+
+		return vecChangedRegions;
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
-	/// Removes all voxels from memory, and calls dataOverflowHandler() to ensure the application has a chance to store the data.
+	/// Unlike getVoxel(), this function never pages in any data. It is intended for use alongside prefetchAsync() by threads
+	/// which should not be stalled by the Pager, such as a rendering thread.
+	/// \param uXPos The \c x position of the voxel
+	/// \param uYPos The \c y position of the voxel
+	/// \param uZPos The \c z position of the voxel
+	/// \param tValue Set to the voxel value if the voxel is in memory, otherwise left unchanged.
+	/// \return Whether the voxel was in memory.
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	void PagedVolume<VoxelType>::flushAll()
+	bool PagedVolume<VoxelType>::tryGetVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos, VoxelType& tValue) const
 	{
-		// Clear this pointer as all chunks are about to be removed.
-		m_pLastAccessedChunk = nullptr;
+		const int32_t chunkX = uXPos >> m_uChunkSideLengthPower;
+		const int32_t chunkY = uYPos >> m_uChunkSideLengthPower;
+		const int32_t chunkZ = uZPos >> m_uChunkSideLengthPower;
 
-		// Erase all the most recently used chunks.
-		for (uint32_t uIndex = 0; uIndex < uChunkArraySize; uIndex++)
+		const uint16_t xOffset = static_cast<uint16_t>(uXPos & m_iChunkMask);
+		const uint16_t yOffset = static_cast<uint16_t>(uYPos & m_iChunkMask);
+		const uint16_t zOffset = static_cast<uint16_t>(uZPos & m_iChunkMask);
+
+		const uint32_t uHash = hashChunkPosition(chunkX, chunkY, chunkZ);
+		Shard& shard = getShard(uHash);
+		std::unique_lock<std::mutex> lock = lockShard(shard);
+		const uint32_t uIndex = findChunkIndex(shard, chunkX, chunkY, chunkZ, uHash);
+		if (uIndex == uInvalidIndex)
 		{
-			m_arrayChunks[uIndex] = nullptr;
+			return false;
 		}
+
+		Chunk* pChunk = shard.vecSlots[uIndex].pChunk.get();
+		touchChunk(shard, pChunk, false);
+		tValue = pChunk->getVoxelAllowingPalette(xOffset, yOffset, zOffset);
+		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dPos The 3D position of the voxel
+	/// \param tValue Set to the voxel value if the voxel is in memory, otherwise left unchanged.
+	/// \return Whether the voxel was in memory.
+	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	bool PagedVolume<VoxelType>::canReuseLastAccessedChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const
+	bool PagedVolume<VoxelType>::tryGetVoxel(const Vector3DInt32& v3dPos, VoxelType& tValue) const
 	{
-		return ((iChunkX == m_v3dLastAccessedChunkX) &&
-			(iChunkY == m_v3dLastAccessedChunkY) &&
-			(iChunkZ == m_v3dLastAccessedChunkZ) &&
-			(m_pLastAccessedChunk));
+		return tryGetVoxel(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ(), tValue);
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// Note that in concurrent mode the result can be out of date by the time it is returned, as chunks may be paged
+	/// in or out by other threads at any time.
+	/// \param region The Region of voxels to check.
+	/// \return Whether all the chunks overlapping the Region are currently in memory.
+	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	typename PagedVolume<VoxelType>::Chunk* PagedVolume<VoxelType>::getChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ) const
+	bool PagedVolume<VoxelType>::isRegionResident(const Region& region) const
 	{
-		Chunk* pChunk = nullptr;
-
-		// We generate a 16-bit hash here and assume this matches the range available in the chunk
-		// array. The assert here is just to make sure we take care if change this in the future.
-		static_assert(uChunkArraySize == 65536, "Chunk array size has changed, check if the hash calculation needs updating.");
-		// Extract the lower five bits from each position component.
-		const uint32_t uChunkXLowerBits = static_cast<uint32_t>(uChunkX & 0x1F);
-		const uint32_t uChunkYLowerBits = static_cast<uint32_t>(uChunkY & 0x1F);
-		const uint32_t uChunkZLowerBits = static_cast<uint32_t>(uChunkZ & 0x1F);
-		// Combine then to form a 15-bit hash of the position. Also shift by one to spread the values out in the whole 16-bit space.
-		const uint32_t iPosisionHash = (((uChunkXLowerBits)) | ((uChunkYLowerBits) << 5) | ((uChunkZLowerBits) << 10) << 1);
-
-		// Starting at the position indicated by the hash, and then search through the whole array looking for a chunk with the correct
-		// position. In most cases we expect to find it in the first place we look. Note that this algorithm is slow in the case that
-		// the chunk is not found because the whole array has to be searched, but in this case we are going to have to page the data in
-		// from an external source which is likely to be slow anyway.
-		uint32_t iIndex = iPosisionHash;
-		do
+		for (int32_t x = region.getLowerX() >> m_uChunkSideLengthPower; x <= (region.getUpperX() >> m_uChunkSideLengthPower); x++)
 		{
-			if (m_arrayChunks[iIndex])
+			for (int32_t y = region.getLowerY() >> m_uChunkSideLengthPower; y <= (region.getUpperY() >> m_uChunkSideLengthPower); y++)
 			{
-				Vector3DInt32& entryPos = m_arrayChunks[iIndex]->m_v3dChunkSpacePosition;
-				if (entryPos.getX() == uChunkX && entryPos.getY() == uChunkY && entryPos.getZ() == uChunkZ)
+				for (int32_t z = region.getLowerZ() >> m_uChunkSideLengthPower; z <= (region.getUpperZ() >> m_uChunkSideLengthPower); z++)
 				{
-					pChunk = m_arrayChunks[iIndex].get();
-					pChunk->m_uChunkLastAccessed = ++m_uTimestamper;
-					break;
+					const uint32_t uHash = hashChunkPosition(x, y, z);
+					Shard& shard = getShard(uHash);
+					std::unique_lock<std::mutex> lock = lockShard(shard);
+					if (findChunkIndex(shard, x, y, z, uHash) == uInvalidIndex)
+					{
+						return false;
+					}
 				}
 			}
+		}
 
-			iIndex++;
-			iIndex %= uChunkArraySize;
-		} while (iIndex != iPosisionHash); // Keep searching until we get back to our start position.
+		return true;
+	}
 
-		// If we still haven't found the chunk then it's time to create a new one and page it in from disk.
-		if (!pChunk)
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is intended to let surface extractors and similar algorithms skip over empty space without visiting each voxel. Only
+	/// chunks which are sharing their data (see the class description) are recognised as uniform, so the result can be false
+	/// even though all the voxels do have the same value. Any chunks overlapping the Region which are not in memory are paged in.
+	/// \param region The Region of voxels to check.
+	/// \param tValue Set to the value of the voxels if they all have the same value, otherwise left unchanged.
+	/// \return Whether all the voxels within the Region are known to have the same value.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::isRegionUniform(const Region& region, VoxelType& tValue) const
+	{
+		bool bFoundValue = false;
+		VoxelType tFoundValue = VoxelType();
+		for (int32_t z = region.getLowerZ() >> m_uChunkSideLengthPower; z <= (region.getUpperZ() >> m_uChunkSideLengthPower); z++)
 		{
-			// The chunk was not found so we will create a new one.
-			Vector3DInt32 v3dChunkPos(uChunkX, uChunkY, uChunkZ);
-			pChunk = new PagedVolume<VoxelType>::Chunk(v3dChunkPos, m_uChunkSideLength, m_pPager);
-			pChunk->m_uChunkLastAccessed = ++m_uTimestamper; // Important, as we may soon delete the oldest chunk
-
-			// Store the chunk at the appropriate place in out chunk array. Ideally this place is
-			// given by the hash, otherwise we do a linear search for the next available location
-			// We always expect to find a free place because we aim to keep the array only half full.
-			uint32_t iIndex = iPosisionHash;
-			bool bInsertedSucessfully = false;
-			do
+			for (int32_t y = region.getLowerY() >> m_uChunkSideLengthPower; y <= (region.getUpperY() >> m_uChunkSideLengthPower); y++)
 			{
-				if (m_arrayChunks[iIndex] == nullptr)
+				for (int32_t x = region.getLowerX() >> m_uChunkSideLengthPower; x <= (region.getUpperX() >> m_uChunkSideLengthPower); x++)
 				{
-					m_arrayChunks[iIndex] = std::move(std::unique_ptr< Chunk >(pChunk));
-					bInsertedSucessfully = true;
-					break;
+					{
+						const uint32_t uHash = hashChunkPosition(x, y, z);
+						std::unique_lock<std::mutex> lock = lockShardForChunk(x, y, z, uHash);
+						const Chunk* pChunk = findOrCreateChunk(x, y, z, uHash, false).get();
+						if (!pChunk->isUsingSharedData() || (bFoundValue && !(pChunk->m_tData[0] == tFoundValue)))
+						{
+							return false;
+						}
+
+						tFoundValue = pChunk->m_tData[0];
+						bFoundValue = true;
+					}
+
+					evictExcessChunks();
 				}
+			}
+		}
+
+		tValue = tFoundValue;
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Each chunk keeps track of the range of its values, but only for primitive voxel types (for other types this function returns
+	/// false). The bounds cover the whole of every chunk overlapping the Region, and may also be a little wider than necessary for
+	/// chunks which are palette compressed. Any of these chunks which are not in memory are paged in, though as with isRegionUniform()
+	/// those which the Pager reports as being uniform do not need to be.
+	/// \param region The Region of voxels to check.
+	/// \param tMin Set to a value which is less than or equal to all the voxels in the Region.
+	/// \param tMax Set to a value which is greater than or equal to all the voxels in the Region.
+	/// \return Whether the bounds were set.
+	/// \sa BaseVolume::getRegionValueRange()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::getRegionValueRange(const Region& region, VoxelType& tMin, VoxelType& tMax) const
+	{
+		if (!HasValueRange<VoxelType>::value)
+		{
+			return false;
+		}
 
-				iIndex++;
-				iIndex %= uChunkArraySize;
-			} while (iIndex != iPosisionHash); // Keep searching until we get back to our start position.
-
-			// This should never really happen unless we are failing to keep our number of active chunks
-			// significantly under the target amount. Perhaps if chunks are 'pinned' for threading purposes?
-			POLYVOX_THROW_IF(!bInsertedSucessfully, std::logic_error, "No space in chunk array for new chunk.");
-
-			// As we have added a chunk we may have exceeded our target chunk limit. Search through the array to
-			// determine how many chunks we have, as well as finding the oldest timestamp. Note that this is potentially
-			// wasteful and we may instead wish to track how many chunks we have and/or delete a chunk at random (or
-			// just check e.g. 10 and delete the oldest of those) but we'll see if this is a bottleneck first. Paging
-			// the data in is probably more expensive.
-			uint32_t uChunkCount = 0;
-			uint32_t uOldestChunkIndex = 0;
-			uint32_t uOldestChunkTimestamp = std::numeric_limits<uint32_t>::max();
-			for (uint32_t uIndex = 0; uIndex < uChunkArraySize; uIndex++)
-			{
-				if (m_arrayChunks[uIndex])
+		bool bFoundValue = false;
+		VoxelType tFoundMin = VoxelType();
+		VoxelType tFoundMax = VoxelType();
+		for (int32_t z = region.getLowerZ() >> m_uChunkSideLengthPower; z <= (region.getUpperZ() >> m_uChunkSideLengthPower); z++)
+		{
+			for (int32_t y = region.getLowerY() >> m_uChunkSideLengthPower; y <= (region.getUpperY() >> m_uChunkSideLengthPower); y++)
+			{
+				for (int32_t x = region.getLowerX() >> m_uChunkSideLengthPower; x <= (region.getUpperX() >> m_uChunkSideLengthPower); x++)
 				{
-					uChunkCount++;
-					if (m_arrayChunks[uIndex]->m_uChunkLastAccessed < uOldestChunkTimestamp)
 					{
-						uOldestChunkTimestamp = m_arrayChunks[uIndex]->m_uChunkLastAccessed;
-						uOldestChunkIndex = uIndex;
+						const uint32_t uHash = hashChunkPosition(x, y, z);
+						std::unique_lock<std::mutex> lock = lockShardForChunk(x, y, z, uHash);
+						Chunk* pChunk = findOrCreateChunk(x, y, z, uHash, false).get();
+						if (pChunk->m_bValueRangeOutOfDate)
+						{
+							pChunk->updateValueRange();
+						}
+
+						if (!bFoundValue)
+						{
+							tFoundMin = pChunk->m_tMinValue;
+							tFoundMax = pChunk->m_tMaxValue;
+							bFoundValue = true;
+						}
+						expandValueRange(pChunk->m_tMinValue, tFoundMin, tFoundMax, HasValueRange<VoxelType>());
+						expandValueRange(pChunk->m_tMaxValue, tFoundMin, tFoundMax, HasValueRange<VoxelType>());
 					}
+
+					evictExcessChunks();
 				}
 			}
+		}
 
-			// Check if we have too many chunks, and delete the oldest if so.
-			if (uChunkCount > m_uChunkCountLimit)
-			{
-				m_arrayChunks[uOldestChunkIndex] = nullptr;
-			}
+		tMin = tFoundMin;
+		tMax = tFoundMax;
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The volume keeps track of the values in each chunk, so this is the chunk side length which was passed to the constructor.
+	/// For voxel types which are not primitive only isRegionUniform() makes use of this, as getRegionValueRange() returns false.
+	/// \return The side length of the chunks.
+	/// \sa BaseVolume::getValueRangeBlockSideLength()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::getValueRangeBlockSideLength(void) const
+	{
+		return m_uChunkSideLength;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Note that if the memory usage limit is not large enough to support the region this function will only load part of the region. In this case it is undefined which parts will actually be loaded. If all the voxels in the given region are already loaded, this function will not do anything. Other voxels might be unloaded to make space for the new voxels.
+	/// \param regPrefetch The Region of voxels to prefetch into memory.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::prefetch(Region regPrefetch)
+	{
+		// Convert the start and end positions into chunk space coordinates
+		Vector3DInt32 v3dStart;
+		for (int i = 0; i < 3; i++)
+		{
+			v3dStart.setElement(i, regPrefetch.getLowerCorner().getElement(i) >> m_uChunkSideLengthPower);
 		}
 
-		m_pLastAccessedChunk = pChunk;
-		m_v3dLastAccessedChunkX = uChunkX;
-		m_v3dLastAccessedChunkY = uChunkY;
-		m_v3dLastAccessedChunkZ = uChunkZ;
+		Vector3DInt32 v3dEnd;
+		for (int i = 0; i < 3; i++)
+		{
+			v3dEnd.setElement(i, regPrefetch.getUpperCorner().getElement(i) >> m_uChunkSideLengthPower);
+		}
 
-		return pChunk;
+		// Warn if we are asked to page in more chunks than the volume can hold.
+		Region region(v3dStart, v3dEnd);
+		const uint32_t uNoOfChunks = static_cast<uint32_t>(region.getWidthInVoxels() * region.getHeightInVoxels() * region.getDepthInVoxels());
+		POLYVOX_LOG_WARNING_IF(uNoOfChunks > m_uChunkCountLimit, "Attempting to prefetch more than the maximum number of chunks (this will cause thrashing).");
+
+		// Loops over the specified positions and touch the corresponding chunks.
+		for (int32_t x = v3dStart.getX(); x <= v3dEnd.getX(); x++)
+		{
+			for (int32_t y = v3dStart.getY(); y <= v3dEnd.getY(); y++)
+			{
+				for (int32_t z = v3dStart.getZ(); z <= v3dEnd.getZ(); z++)
+				{
+					acquireChunk(x, y, z);
+				}
+			}
+		}
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
-	/// Calculate the memory usage of the volume.
+	/// The request is serviced by the paging threads, and requests with a lower priority value are serviced first (so the distance
+	/// from the viewer is a natural choice). Use tryGetVoxel() or isRegionResident() to find out what has been loaded so far. As with
+	/// prefetch(), the memory usage limit is still respected so loading more than will fit causes some chunks to be evicted again.
+	///
+	/// If the volume does not have any paging threads then this function simply calls prefetch().
+	/// \param regPrefetch The Region of voxels to prefetch into memory.
+	/// \param fPriority The priority of the request.
 	////////////////////////////////////////////////////////////////////////////////
 	template <typename VoxelType>
-	uint32_t PagedVolume<VoxelType>::calculateSizeInBytes(void)
+	void PagedVolume<VoxelType>::prefetchAsync(Region regPrefetch, float fPriority)
 	{
-		uint32_t uChunkCount = 0;
-		for (uint32_t uIndex = 0; uIndex < uChunkArraySize; uIndex++)
+		if (m_vecPagingThreads.empty())
+		{
+			prefetch(regPrefetch);
+			return;
+		}
+
+		// Convert the start and end positions into chunk space coordinates
+		Vector3DInt32 v3dStart;
+		Vector3DInt32 v3dEnd;
+		for (int i = 0; i < 3; i++)
+		{
+			v3dStart.setElement(i, regPrefetch.getLowerCorner().getElement(i) >> m_uChunkSideLengthPower);
+			v3dEnd.setElement(i, regPrefetch.getUpperCorner().getElement(i) >> m_uChunkSideLengthPower);
+		}
+
+		Region region(v3dStart, v3dEnd);
+		POLYVOX_LOG_WARNING_IF(static_cast<uint32_t>(region.getWidthInVoxels() * region.getHeightInVoxels() * region.getDepthInVoxels()) > m_uChunkCountLimit,
+			"Attempting to prefetch more than the maximum number of chunks (this will cause thrashing).");
+
+		std::lock_guard<std::mutex> lock(m_mutexPaging);
+		for (int32_t x = v3dStart.getX(); x <= v3dEnd.getX(); x++)
 		{
-			if (m_arrayChunks[uIndex])
+			for (int32_t y = v3dStart.getY(); y <= v3dEnd.getY(); y++)
 			{
-				uChunkCount++;
+				for (int32_t z = v3dStart.getZ(); z <= v3dEnd.getZ(); z++)
+				{
+					PrefetchRequest request = { x, y, z, fPriority, m_uNextPrefetchSequenceNo++ };
+					m_queuePrefetchRequests.push(request);
+				}
 			}
 		}
+		m_condPagingWork.notify_all();
+	}
 
-		// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
-		// allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
-		return PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(m_uChunkSideLength) * uChunkCount;
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is useful when the viewer has moved and the outstanding requests are no longer relevant. Any chunks which
+	/// are already being paged in are unaffected.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::cancelAsyncPrefetches(void)
+	{
+		std::lock_guard<std::mutex> lock(m_mutexPaging);
+		m_queuePrefetchRequests = std::priority_queue<PrefetchRequest>();
+		if (m_uNoOfActivePrefetches == 0)
+		{
+			m_condPagingIdle.notify_all();
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Returns immediately if the volume does not have any paging threads.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::waitForAsyncPrefetches(void)
+	{
+		std::unique_lock<std::mutex> lock(m_mutexPaging);
+		m_condPagingIdle.wait(lock, [this] { return m_vecPagingThreads.empty() || (m_queuePrefetchRequests.empty() && (m_uNoOfActivePrefetches == 0)); });
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Removes all voxels from memory, and calls dataOverflowHandler() to ensure the application has a chance to store the data.
+	///
+	/// In concurrent mode any chunks which are still in use by a Sampler are written back and removed from the volume, but
+	/// their memory is only released once the Sampler has finished with them. Chunks which are being paged in by the paging
+	/// threads may still be added afterwards, so call cancelAsyncPrefetches() and waitForAsyncPrefetches() first if necessary.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::flushAll()
+	{
+		// Clear this pointer as all chunks are about to be removed.
+		m_pLastAccessedChunk = nullptr;
+
+		// Erase all the most recently used chunks.
+		for (uint32_t uShard = 0; uShard < uNoOfShards; uShard++)
+		{
+			Shard& shard = m_arrayShards[uShard];
+			std::unique_lock<std::mutex> lock = lockShard(shard);
+			for (uint32_t uIndex = 0; uIndex < shard.vecSlots.size(); uIndex++)
+			{
+				if (shard.vecSlots[uIndex].pChunk)
+				{
+					// A chunk which is still referenced by a Sampler will outlive its place in the table, so we page
+					// it out now rather than when it is deleted. Otherwise it could be paged back in before its data
+					// had been written out.
+					std::shared_ptr<Chunk> pChunk = shard.vecSlots[uIndex].pChunk;
+					removeChunk(shard, uIndex);
+					pChunk->pageOutIfModified();
+				}
+			}
+
+			// Start again with an empty table, as it would otherwise be full of tombstones.
+			resizeShard(shard, uInitialShardSize);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return Whether the volume was constructed with support for concurrent access.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::isConcurrentAccessEnabled(void) const
+	{
+		return m_bConcurrentAccess;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return Whether the volume was constructed with any paging threads.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::isAsyncPagingEnabled(void) const
+	{
+		return !m_vecPagingThreads.empty();
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::canReuseLastAccessedChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const
+	{
+		return ((iChunkX == m_v3dLastAccessedChunkX) &&
+			(iChunkY == m_v3dLastAccessedChunkY) &&
+			(iChunkZ == m_v3dLastAccessedChunkZ) &&
+			(m_pLastAccessedChunk));
+	}
+
+	template <typename VoxelType>
+	typename PagedVolume<VoxelType>::Chunk* PagedVolume<VoxelType>::getChunk(int32_t uChunkX, int32_t uChunkY, int32_t uChunkZ, bool bDecompress) const
+	{
+		POLYVOX_ASSERT(!m_bConcurrentAccess, "The last accessed chunk cannot be used when concurrent access is enabled.");
+
+		Chunk* pChunk = findOrCreateChunk(uChunkX, uChunkY, uChunkZ, hashChunkPosition(uChunkX, uChunkY, uChunkZ), bDecompress).get();
+
+		// As we may have added a chunk we may also have exceeded our target chunk limit. The chunk we just
+		// found has the most recent timestamp so it will not be the one which gets removed.
+		evictExcessChunks();
+
+		m_pLastAccessedChunk = pChunk;
+		m_v3dLastAccessedChunkX = uChunkX;
+		m_v3dLastAccessedChunkY = uChunkY;
+		m_v3dLastAccessedChunkZ = uChunkZ;
+
+		return pChunk;
+	}
+
+	template <typename VoxelType>
+	std::shared_ptr<typename PagedVolume<VoxelType>::Chunk> PagedVolume<VoxelType>::acquireChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const
+	{
+		const uint32_t uHash = hashChunkPosition(iChunkX, iChunkY, iChunkZ);
+		std::unique_lock<std::mutex> lock = lockShardForChunk(iChunkX, iChunkY, iChunkZ, uHash);
+		std::shared_ptr<Chunk> pChunk = findOrCreateChunk(iChunkX, iChunkY, iChunkZ, uHash);
+		if (lock.owns_lock())
+		{
+			// The lock is empty if concurrent access is disabled.
+			lock.unlock();
+		}
+
+		// The reference we are holding means the chunk we just found cannot be evicted.
+		evictExcessChunks();
+
+		return pChunk;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::hashChunkPosition(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ)
+	{
+		// All bits of each coordinate contribute to the hash. The multiplication by large primes is the usual spatial
+		// hash (Teschner et al, 'Optimized Spatial Hashing for Collision Detection of Deformable Objects') and the final
+		// mixing step (from MurmurHash3) ensures that both the high bits (used to select the shard) and the low bits
+		// (used to select the slot) are well distributed.
+		uint32_t uHash = (static_cast<uint32_t>(iChunkX) * 73856093u) ^ (static_cast<uint32_t>(iChunkY) * 19349663u) ^ (static_cast<uint32_t>(iChunkZ) * 83492791u);
+		uHash ^= uHash >> 16;
+		uHash *= 0x85ebca6bu;
+		uHash ^= uHash >> 13;
+		uHash *= 0xc2b2ae35u;
+		uHash ^= uHash >> 16;
+		return uHash;
+	}
+
+	template <typename VoxelType>
+	typename PagedVolume<VoxelType>::Shard& PagedVolume<VoxelType>::getShard(uint32_t uHash) const
+	{
+		static_assert(uNoOfShards == (1u << (32 - uShardSelectionShift)), "Number of shards does not match the bits used to select them.");
+		return m_arrayShards[uHash >> uShardSelectionShift];
+	}
+
+	template <typename VoxelType>
+	std::unique_lock<std::mutex> PagedVolume<VoxelType>::lockShard(Shard& shard) const
+	{
+		// Locking is skipped entirely if concurrent access has not been requested.
+		return m_bConcurrentAccess ? std::unique_lock<std::mutex>(shard.mutex) : std::unique_lock<std::mutex>();
+	}
+
+	template <typename VoxelType>
+	std::unique_lock<std::mutex> PagedVolume<VoxelType>::lockShardForChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash) const
+	{
+		Shard& shard = getShard(uHash);
+		std::unique_lock<std::mutex> lock = lockShard(shard);
+
+		// If another thread is currently paging the chunk then we wait for it to finish. Otherwise we could page the chunk
+		// in a second time, possibly while its data is still being written out.
+		while (isChunkBeingPaged(shard, iChunkX, iChunkY, iChunkZ))
+		{
+			shard.condChunkPaged.wait(lock);
+		}
+
+		return lock;
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::isChunkBeingPaged(const Shard& shard, int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const
+	{
+		for (const Vector3DInt32& v3dPos : shard.vecChunksBeingPaged)
+		{
+			if (v3dPos.getX() == iChunkX && v3dPos.getY() == iChunkY && v3dPos.getZ() == iChunkZ)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::findChunkIndex(const Shard& shard, int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash) const
+	{
+		// Starting at the position indicated by the hash, search through the table looking for a chunk with the correct position.
+		// In most cases we expect to find it in the first place we look. The table always contains some empty slots (which are
+		// not tombstones) and a chunk is never stored beyond one of these, so we can stop searching as soon as we reach one.
+		const uint32_t uMask = static_cast<uint32_t>(shard.vecSlots.size()) - 1;
+		for (uint32_t uIndex = uHash & uMask;; uIndex = (uIndex + 1) & uMask)
+		{
+			const Slot& slot = shard.vecSlots[uIndex];
+			if (slot.pChunk)
+			{
+				if (slot.iChunkX == iChunkX && slot.iChunkY == iChunkY && slot.iChunkZ == iChunkZ)
+				{
+					return uIndex;
+				}
+			}
+			else if (!slot.bTombstone)
+			{
+				return uInvalidIndex;
+			}
+		}
+	}
+
+	template <typename VoxelType>
+	std::shared_ptr<typename PagedVolume<VoxelType>::Chunk>& PagedVolume<VoxelType>::findOrCreateChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ, uint32_t uHash, bool bDecompress) const
+	{
+		Shard& shard = getShard(uHash);
+
+		uint32_t uIndex = findChunkIndex(shard, iChunkX, iChunkY, iChunkZ, uHash);
+		if (uIndex != uInvalidIndex)
+		{
+			touchChunk(shard, shard.vecSlots[uIndex].pChunk.get(), bDecompress);
+			return shard.vecSlots[uIndex].pChunk;
+		}
+
+		// The chunk was not found so we will create a new one and page it in. We do this before modifying
+		// the table so that the table is left unchanged if the pager throws an exception.
+		return insertChunk(shard, uHash, createChunk(Vector3DInt32(iChunkX, iChunkY, iChunkZ)));
+	}
+
+	template <typename VoxelType>
+	std::shared_ptr<typename PagedVolume<VoxelType>::Chunk>& PagedVolume<VoxelType>::insertChunk(Shard& shard, uint32_t uHash, std::shared_ptr<Chunk> pChunk) const
+	{
+		pChunk->m_uChunkLastAccessed = nextTimestamp(); // Important, as we may soon delete the oldest chunk
+
+		// Make sure the table will not become more than half full. If most of the used slots are tombstones then
+		// rebuilding the table at its current size is enough to remove them, otherwise we double its size.
+		const uint32_t uNoOfSlots = static_cast<uint32_t>(shard.vecSlots.size());
+		if ((shard.uNoOfChunks + shard.uNoOfTombstones + 1) * 2 > uNoOfSlots)
+		{
+			resizeShard(shard, ((shard.uNoOfChunks + 1) * 4 > uNoOfSlots) ? uNoOfSlots * 2 : uNoOfSlots);
+		}
+
+		// Store the chunk in the first empty slot or tombstone, starting from the position indicated by the hash.
+		const uint32_t uMask = static_cast<uint32_t>(shard.vecSlots.size()) - 1;
+		uint32_t uIndex = uHash & uMask;
+		while (shard.vecSlots[uIndex].pChunk)
+		{
+			uIndex = (uIndex + 1) & uMask;
+		}
+
+		Slot& slot = shard.vecSlots[uIndex];
+		if (slot.bTombstone)
+		{
+			slot.bTombstone = false;
+			shard.uNoOfTombstones--;
+		}
+		slot.iChunkX = pChunk->m_v3dChunkSpacePosition.getX();
+		slot.iChunkY = pChunk->m_v3dChunkSpacePosition.getY();
+		slot.iChunkZ = pChunk->m_v3dChunkSpacePosition.getZ();
+		slot.pChunk = std::move(pChunk);
+
+		Chunk* pInsertedChunk = slot.pChunk.get();
+		linkChunk(getChunkList(shard, pInsertedChunk), pInsertedChunk);
+		if (pInsertedChunk->isUsingSharedData())
+		{
+			m_uCompressedChunkSizeInBytes += pInsertedChunk->calculateSizeInBytes();
+		}
+		else
+		{
+			m_uNoOfUncompressedChunks++;
+		}
+		shard.uNoOfChunks++;
+		return slot.pChunk;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::resizeShard(Shard& shard, uint32_t uNewSize) const
+	{
+		POLYVOX_ASSERT(isPowerOf2(uNewSize), "Shard size must be a power of two.");
+		POLYVOX_ASSERT(uNewSize > shard.uNoOfChunks, "Shard is too small to hold its chunks.");
+
+		std::vector<Slot> vecOldSlots(uNewSize);
+		vecOldSlots.swap(shard.vecSlots);
+		shard.uNoOfTombstones = 0;
+
+		// Reinsert the chunks. There are no tombstones in the new table so we just need to find empty slots.
+		const uint32_t uMask = uNewSize - 1;
+		for (Slot& oldSlot : vecOldSlots)
+		{
+			if (oldSlot.pChunk)
+			{
+				uint32_t uIndex = hashChunkPosition(oldSlot.iChunkX, oldSlot.iChunkY, oldSlot.iChunkZ) & uMask;
+				while (shard.vecSlots[uIndex].pChunk)
+				{
+					uIndex = (uIndex + 1) & uMask;
+				}
+				shard.vecSlots[uIndex] = std::move(oldSlot);
+			}
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::removeChunk(Shard& shard, uint32_t uIndex) const
+	{
+		Slot& slot = shard.vecSlots[uIndex];
+		Chunk* pChunk = slot.pChunk.get();
+		unlinkChunk(getChunkList(shard, pChunk), pChunk);
+		if (pChunk->isCompressed() || pChunk->isUsingSharedData())
+		{
+			m_uCompressedChunkSizeInBytes -= pChunk->calculateSizeInBytes();
+		}
+		else
+		{
+			m_uNoOfUncompressedChunks--;
+		}
+		if (!m_bConcurrentAccess && (pChunk == m_pLastAccessedChunk))
+		{
+			m_pLastAccessedChunk = nullptr;
+		}
+		slot.pChunk = nullptr;
+		slot.bTombstone = true;
+		shard.uNoOfChunks--;
+		shard.uNoOfTombstones++;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::touchChunk(Shard& shard, Chunk* pChunk, bool bDecompress) const
+	{
+		// Move the chunk to the front of the list to record that it has just been used.
+		pChunk->m_uChunkLastAccessed = nextTimestamp();
+		if (pChunk->isCompressed() && (bDecompress || !pChunk->isPaletteCompressed()))
+		{
+			// The chunk is about to be accessed so it has to be decompressed.
+			const uint32_t uCompressedSizeInBytes = pChunk->calculateSizeInBytes();
+			pChunk->decompress();
+			unlinkChunk(shard.listCompressedChunks, pChunk);
+			linkChunk(shard.listUncompressedChunks, pChunk);
+			m_uCompressedChunkSizeInBytes -= uCompressedSizeInBytes;
+			m_uNoOfUncompressedChunks++;
+		}
+		else
+		{
+			// Chunks which share their data or are palette compressed can be accessed as they are, so stay with the compressed chunks.
+			ChunkList& list = getChunkList(shard, pChunk);
+			if (list.pNewestChunk != pChunk)
+			{
+				unlinkChunk(list, pChunk);
+				linkChunk(list, pChunk);
+			}
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::compressChunk(Shard& shard, Chunk* pChunk) const
+	{
+		// The chunk keeps its place in the least recently used order, which means it joins the compressed chunks at
+		// the newest end (as all the compressed chunks were compressed earlier, they must have been accessed earlier).
+		// A chunk which has become uniform can share its data instead, which is even smaller and needs no decompression.
+		// This is checked on the voxels themselves, as runs are limited in length and so a uniform chunk can have several.
+		VoxelType tUniformValue;
+		VoxelType* pSharedData = pChunk->isUniform(tUniformValue) ? getUniformData(tUniformValue) : nullptr;
+		if (pSharedData)
+		{
+			pChunk->shareData(pSharedData);
+		}
+		else
+		{
+			pChunk->compress();
+		}
+
+		unlinkChunk(shard.listUncompressedChunks, pChunk);
+		linkChunk(shard.listCompressedChunks, pChunk);
+		m_uNoOfUncompressedChunks--;
+		m_uCompressedChunkSizeInBytes += pChunk->calculateSizeInBytes();
+
+		// The fast paths of getVoxel() and setVoxel() assume the last accessed chunk is uncompressed. It is usually the newest
+		// chunk and so is not compressed, but functions such as prefetch() can access chunks without becoming the last accessed.
+		if (!m_bConcurrentAccess && (pChunk == m_pLastAccessedChunk))
+		{
+			m_pLastAccessedChunk = nullptr;
+		}
+	}
+
+	template <typename VoxelType>
+	typename PagedVolume<VoxelType>::ChunkList& PagedVolume<VoxelType>::getChunkList(Shard& shard, const Chunk* pChunk) const
+	{
+		return (pChunk->isCompressed() || pChunk->isUsingSharedData()) ? shard.listCompressedChunks : shard.listUncompressedChunks;
+	}
+
+	template <typename VoxelType>
+	std::shared_ptr<typename PagedVolume<VoxelType>::Chunk> PagedVolume<VoxelType>::createChunk(const Vector3DInt32& v3dChunkPos) const
+	{
+		// Give the pager the chance to tell us the chunk is uniform, in which case we don't need to page it in.
+		Vector3DInt32 v3dLower = v3dChunkPos * static_cast<int32_t>(m_uChunkSideLength);
+		Vector3DInt32 v3dUpper = v3dLower + Vector3DInt32(m_uChunkSideLength - 1, m_uChunkSideLength - 1, m_uChunkSideLength - 1);
+		VoxelType tUniformValue;
+		if (m_pPager->isRegionUniform(Region(v3dLower, v3dUpper), tUniformValue))
+		{
+			VoxelType* pSharedData = getUniformData(tUniformValue);
+			if (pSharedData)
+			{
+				return std::make_shared<Chunk>(v3dChunkPos, m_uChunkSideLength, m_pPager, pSharedData);
+			}
+
+			// There is no buffer available for this value, so we just fall back on paging the chunk in.
+		}
+
+		std::shared_ptr<Chunk> pChunk = std::make_shared<Chunk>(v3dChunkPos, m_uChunkSideLength, m_pPager);
+
+		// Pagers often generate (or fill in missing data with) a single value, so it is worth checking
+		// for this. The cost of doing so is small compared to the cost of paging in the data.
+		if (pChunk->isUniform(tUniformValue))
+		{
+			VoxelType* pSharedData = getUniformData(tUniformValue);
+			if (pSharedData)
+			{
+				pChunk->shareData(pSharedData);
+			}
+		}
+
+		return pChunk;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::unshareChunkData(Shard& shard, std::shared_ptr<Chunk>& pChunk) const
+	{
+		// In concurrent mode a Sampler may be holding on to the chunk and reading its data without holding the lock, so
+		// rather than modifying the chunk we replace it with a copy. The old chunk keeps reading from the shared data
+		// until the Sampler lets go of it, and as the copy takes over responsibility for paging out it is marked as unmodified.
+		std::shared_ptr<Chunk> pNewChunk = std::make_shared<Chunk>(pChunk->m_v3dChunkSpacePosition, m_uChunkSideLength, m_pPager, pChunk->m_tData);
+		pNewChunk->unshareData();
+		pNewChunk->m_bDataModified = pChunk->m_bDataModified;
+		pNewChunk->m_uChunkLastAccessed = pChunk->m_uChunkLastAccessed;
+		pChunk->m_bDataModified = false;
+
+		unlinkChunk(shard.listCompressedChunks, pChunk.get());
+		m_uCompressedChunkSizeInBytes -= pChunk->calculateSizeInBytes();
+		pChunk = std::move(pNewChunk);
+		linkChunk(shard.listUncompressedChunks, pChunk.get());
+		m_uNoOfUncompressedChunks++;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::updateMipLevelsInChunk(Chunk* pChunk, bool bRelease) const
+	{
+		if (!bRelease && !pChunk->areMipLevelsOutOfDate(m_uNoOfMipLevels))
+		{
+			return;
+		}
+
+		// The mip levels of a compressed chunk are included in its size, so the memory usage has to be adjusted.
+		const uint32_t uOldSizeInBytes = pChunk->calculateSizeInBytes();
+		if (bRelease)
+		{
+			pChunk->releaseMipLevels();
+		}
+		else
+		{
+			pChunk->updateMipLevels(m_uNoOfMipLevels, m_eMipFilter);
+		}
+		if (pChunk->isCompressed())
+		{
+			m_uCompressedChunkSizeInBytes -= uOldSizeInBytes;
+			m_uCompressedChunkSizeInBytes += pChunk->calculateSizeInBytes();
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::setVoxelInChunk(Shard& shard, std::shared_ptr<Chunk>& pChunk, uint16_t uXPos, uint16_t uYPos, uint16_t uZPos, VoxelType tValue) const
+	{
+		if (pChunk->isUsingSharedData())
+		{
+			// A chunk which shares its data only needs its own copy if the value is actually changing.
+			if (pChunk->getVoxel(uXPos, uYPos, uZPos) == tValue)
+			{
+				return;
+			}
+
+			unshareChunkData(shard, pChunk);
+		}
+
+		if (pChunk->isPaletteCompressed())
+		{
+			// Writing to a palette compressed chunk can change its size, either because the value has to be added to the palette
+			// or because the palette was full and the chunk had to be decompressed. In the latter case it also changes list.
+			const uint32_t uOldSizeInBytes = pChunk->calculateSizeInBytes();
+			pChunk->setVoxel(uXPos, uYPos, uZPos, tValue);
+			m_uCompressedChunkSizeInBytes -= uOldSizeInBytes;
+			if (pChunk->isCompressed())
+			{
+				m_uCompressedChunkSizeInBytes += pChunk->calculateSizeInBytes();
+			}
+			else
+			{
+				unlinkChunk(shard.listCompressedChunks, pChunk.get());
+				linkChunk(shard.listUncompressedChunks, pChunk.get());
+				m_uNoOfUncompressedChunks++;
+			}
+			return;
+		}
+
+		pChunk->setVoxel(uXPos, uYPos, uZPos, tValue);
+	}
+
+	template <typename VoxelType>
+	VoxelType* PagedVolume<VoxelType>::getUniformData(VoxelType tValue) const
+	{
+		std::unique_lock<std::mutex> lock = m_bConcurrentAccess ? std::unique_lock<std::mutex>(m_mutexUniformDataBuffers) : std::unique_lock<std::mutex>();
+		for (auto& buffer : m_vecUniformDataBuffers)
+		{
+			if (buffer.first == tValue)
+			{
+				return buffer.second.get();
+			}
+		}
+
+		if (m_vecUniformDataBuffers.size() >= uMaxNoOfUniformDataBuffers)
+		{
+			return nullptr;
+		}
+
+		const uint32_t uNoOfVoxels = m_uChunkSideLength * m_uChunkSideLength * m_uChunkSideLength;
+		std::unique_ptr<VoxelType[]> pData(new VoxelType[uNoOfVoxels]);
+		std::fill(pData.get(), pData.get() + uNoOfVoxels, tValue);
+		m_vecUniformDataBuffers.push_back(std::make_pair(tValue, std::move(pData)));
+		m_uNoOfUniformDataBuffers++;
+		return m_vecUniformDataBuffers.back().second.get();
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::linkChunk(ChunkList& list, Chunk* pChunk) const
+	{
+		pChunk->m_pNewerChunk = nullptr;
+		pChunk->m_pOlderChunk = list.pNewestChunk;
+		if (list.pNewestChunk)
+		{
+			list.pNewestChunk->m_pNewerChunk = pChunk;
+		}
+		else
+		{
+			list.pOldestChunk = pChunk;
+		}
+		list.pNewestChunk = pChunk;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::unlinkChunk(ChunkList& list, Chunk* pChunk) const
+	{
+		(pChunk->m_pNewerChunk ? pChunk->m_pNewerChunk->m_pOlderChunk : list.pNewestChunk) = pChunk->m_pOlderChunk;
+		(pChunk->m_pOlderChunk ? pChunk->m_pOlderChunk->m_pNewerChunk : list.pOldestChunk) = pChunk->m_pNewerChunk;
+		pChunk->m_pNewerChunk = nullptr;
+		pChunk->m_pOlderChunk = nullptr;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::findEvictionCandidate(const Shard& shard, const ChunkList& list) const
+	{
+		// Walk from the least recently used end of the list, skipping over any chunks which are referenced from
+		// elsewhere (i.e. are pinned by a Sampler). That can only happen in concurrent mode, and there are not
+		// usually many samplers, so we normally stop at the first chunk. Pinned chunks are also never compressed,
+		// as the Sampler may be holding a pointer to their data.
+		for (Chunk* pChunk = list.pOldestChunk; pChunk; pChunk = pChunk->m_pNewerChunk)
+		{
+			const Vector3DInt32& v3dPos = pChunk->m_v3dChunkSpacePosition;
+			const uint32_t uIndex = findChunkIndex(shard, v3dPos.getX(), v3dPos.getY(), v3dPos.getZ(), hashChunkPosition(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ()));
+			POLYVOX_ASSERT(uIndex != uInvalidIndex, "Chunk in LRU list was not found in the chunk table.");
+			if ((!m_bConcurrentAccess) || (shard.vecSlots[uIndex].pChunk.use_count() == 1))
+			{
+				return uIndex;
+			}
+		}
+
+		return uInvalidIndex;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::findShardWithOldestChunk(bool bCompressed, uint32_t& uOldestChunkTimestamp) const
+	{
+		// Each shard keeps its chunks in least recently used order, so we only need to compare the oldest chunk from each
+		// shard to find the oldest overall. The cost of this is independant of how large the chunk table is. Only one shard
+		// is locked at a time, so the result may be out of date by the time we use it, but it will still be a good choice.
+		uint32_t uOldestShard = uNoOfShards;
+		uOldestChunkTimestamp = std::numeric_limits<uint32_t>::max();
+		for (uint32_t uShard = 0; uShard < uNoOfShards; uShard++)
+		{
+			Shard& shard = m_arrayShards[uShard];
+			std::unique_lock<std::mutex> lock = lockShard(shard);
+			const uint32_t uIndex = findEvictionCandidate(shard, bCompressed ? shard.listCompressedChunks : shard.listUncompressedChunks);
+			if ((uIndex != uInvalidIndex) && (shard.vecSlots[uIndex].pChunk->m_uChunkLastAccessed <= uOldestChunkTimestamp))
+			{
+				uOldestChunkTimestamp = shard.vecSlots[uIndex].pChunk->m_uChunkLastAccessed;
+				uOldestShard = uShard;
+			}
+		}
+
+		return uOldestShard;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::nextTimestamp(void) const
+	{
+		// The increment is deliberately not atomic as that would be expensive and we don't need it to be. The timestamps are only
+		// used to decide which chunk to evict, so if two threads occasionally end up with the same value it does not really matter.
+		const uint32_t uTimestamp = m_uTimestamper.load(std::memory_order_relaxed) + 1;
+		m_uTimestamper.store(uTimestamp, std::memory_order_relaxed);
+		return uTimestamp;
+	}
+
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::calculateMemoryUsageInBytes(void) const
+	{
+		return PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(m_uChunkSideLength) * (m_uNoOfUncompressedChunks + m_uNoOfUniformDataBuffers) + m_uCompressedChunkSizeInBytes;
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::isOverMemoryLimits(void) const
+	{
+		return (m_uNoOfUncompressedChunks > m_uUncompressedChunkCountLimit) ||
+			(calculateMemoryUsageInBytes() > PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(m_uChunkSideLength) * m_uChunkCountLimit);
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::evictExcessChunks(void) const
+	{
+		if (!isOverMemoryLimits())
+		{
+			return;
+		}
+
+		if (m_vecPagingThreads.empty())
+		{
+			removeExcessChunks();
+			return;
+		}
+
+		// Leave the eviction (and the writing back of modified chunks) to the paging threads. The flag avoids
+		// waking them repeatedly while they are busy. See runPagingThread() for why we lock the mutex.
+		if (!m_bEvictionRequested.load(std::memory_order_relaxed) && !m_bEvictionRequested.exchange(true))
+		{
+			std::lock_guard<std::mutex> lock(m_mutexPaging);
+			m_condPagingWork.notify_one();
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::removeExcessChunks(void) const
+	{
+		// First compress the least recently used chunks until few enough of them are uncompressed. Compression is
+		// done while holding the lock on the shard, but it is quick compared to paging.
+		while (m_uNoOfUncompressedChunks > m_uUncompressedChunkCountLimit)
+		{
+			uint32_t uOldestChunkTimestamp;
+			const uint32_t uOldestShard = findShardWithOldestChunk(false, uOldestChunkTimestamp);
+			if (uOldestShard == uNoOfShards)
+			{
+				break; // Every chunk is currently pinned.
+			}
+
+			Shard& shard = m_arrayShards[uOldestShard];
+			std::unique_lock<std::mutex> lock = lockShard(shard);
+			const uint32_t uIndex = findEvictionCandidate(shard, shard.listUncompressedChunks);
+			if (uIndex != uInvalidIndex)
+			{
+				compressChunk(shard, shard.vecSlots[uIndex].pChunk.get());
+			}
+		}
+
+		const uint32_t uMemoryLimitInBytes = PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(m_uChunkSideLength) * m_uChunkCountLimit;
+		while (calculateMemoryUsageInBytes() > uMemoryLimitInBytes)
+		{
+			// Compressed chunks have usually been used less recently than uncompressed ones, but chunks which share their
+			// data are kept with them as soon as they are paged in. So we compare the oldest chunk from each list.
+			uint32_t uOldestCompressedChunkTimestamp;
+			uint32_t uOldestUncompressedChunkTimestamp;
+			const uint32_t uOldestCompressedShard = findShardWithOldestChunk(true, uOldestCompressedChunkTimestamp);
+			const uint32_t uOldestUncompressedShard = findShardWithOldestChunk(false, uOldestUncompressedChunkTimestamp);
+			const bool bCompressed = (uOldestCompressedShard != uNoOfShards) &&
+				((uOldestUncompressedShard == uNoOfShards) || (uOldestCompressedChunkTimestamp <= uOldestUncompressedChunkTimestamp));
+			const uint32_t uOldestShard = bCompressed ? uOldestCompressedShard : uOldestUncompressedShard;
+
+			// Every chunk is currently pinned, so we just have to exceed the limit for now.
+			if (uOldestShard == uNoOfShards)
+			{
+				return;
+			}
+
+			Shard& shard = m_arrayShards[uOldestShard];
+			std::unique_lock<std::mutex> lock = lockShard(shard);
+			const uint32_t uIndex = findEvictionCandidate(shard, bCompressed ? shard.listCompressedChunks : shard.listUncompressedChunks);
+			if (uIndex == uInvalidIndex)
+			{
+				continue;
+			}
+
+			if (!m_bConcurrentAccess)
+			{
+				// The chunk's destructor pages it out if required.
+				removeChunk(shard, uIndex);
+				continue;
+			}
+
+			// In concurrent mode we page the chunk out without holding the lock, so that other threads can carry on
+			// using the shard. The guard makes sure that any thread which needs this chunk waits until we are done.
+			std::shared_ptr<Chunk> pChunk = shard.vecSlots[uIndex].pChunk;
+			removeChunk(shard, uIndex);
+			ChunkPagingGuard guard(this, shard, pChunk->m_v3dChunkSpacePosition);
+			lock.unlock();
+			pChunk->pageOutIfModified();
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::runPagingThread(void)
+	{
+		std::unique_lock<std::mutex> lock(m_mutexPaging);
+		while (true)
+		{
+			// Threads requesting an eviction set the flag before locking the mutex to notify us, so we cannot miss the
+			// notification even though the flag is not itself protected by the mutex.
+			m_condPagingWork.wait(lock, [this] { return m_bStopPaging || m_bEvictionRequested || !m_queuePrefetchRequests.empty(); });
+			if (m_bStopPaging)
+			{
+				return;
+			}
+
+			if (m_bEvictionRequested)
+			{
+				m_bEvictionRequested = false;
+				lock.unlock();
+				removeExcessChunks();
+				lock.lock();
+				continue;
+			}
+
+			const PrefetchRequest request = m_queuePrefetchRequests.top();
+			m_queuePrefetchRequests.pop();
+			m_uNoOfActivePrefetches++;
+			lock.unlock();
+
+#ifdef POLYVOX_THROW_ENABLED
+			// There is nobody to pass an exception on to, so the best we can do is report it and carry on.
+			try
+			{
+				pageInChunk(request.iChunkX, request.iChunkY, request.iChunkZ);
+				removeExcessChunks();
+			}
+			catch (const std::exception& e)
+			{
+				POLYVOX_LOG_ERROR("Exception thrown while paging asynchronously: ", e.what());
+			}
+#else
+			pageInChunk(request.iChunkX, request.iChunkY, request.iChunkZ);
+			removeExcessChunks();
+#endif
+
+			lock.lock();
+			m_uNoOfActivePrefetches--;
+			if (m_queuePrefetchRequests.empty() && (m_uNoOfActivePrefetches == 0))
+			{
+				m_condPagingIdle.notify_all();
+			}
+		}
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::pageInChunk(int32_t iChunkX, int32_t iChunkY, int32_t iChunkZ) const
+	{
+		const uint32_t uHash = hashChunkPosition(iChunkX, iChunkY, iChunkZ);
+		Shard& shard = getShard(uHash);
+		const Vector3DInt32 v3dChunkPos(iChunkX, iChunkY, iChunkZ);
+
+		std::unique_lock<std::mutex> lock = lockShard(shard);
+		if ((findChunkIndex(shard, iChunkX, iChunkY, iChunkZ, uHash) != uInvalidIndex) || isChunkBeingPaged(shard, iChunkX, iChunkY, iChunkZ))
+		{
+			// Nothing to do, or someone else is already doing it.
+			return;
+		}
+
+		// The data is paged in without holding the lock, and the guard stops any other thread paging in the same chunk meanwhile.
+		ChunkPagingGuard guard(this, shard, v3dChunkPos);
+		lock.unlock();
+		std::shared_ptr<Chunk> pChunk = createChunk(v3dChunkPos);
+		lock.lock();
+		insertChunk(shard, uHash, std::move(pChunk));
+		lock.unlock();
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::stopPagingThreads(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutexPaging);
+			m_bStopPaging = true;
+			m_condPagingWork.notify_all();
+		}
+
+		for (std::thread& thread : m_vecPagingThreads)
+		{
+			thread.join();
+		}
+		m_vecPagingThreads.clear();
+	}
+
+	template <typename VoxelType>
+	PagedVolume<VoxelType>::ChunkPagingGuard::ChunkPagingGuard(const PagedVolume* pVolume, Shard& shard, const Vector3DInt32& v3dChunkPos)
+		:m_pVolume(pVolume)
+		, m_shard(shard)
+		, m_v3dChunkPos(v3dChunkPos)
+	{
+		m_shard.vecChunksBeingPaged.push_back(m_v3dChunkPos);
+	}
+
+	template <typename VoxelType>
+	PagedVolume<VoxelType>::ChunkPagingGuard::~ChunkPagingGuard()
+	{
+		std::unique_lock<std::mutex> lock = m_pVolume->lockShard(m_shard);
+		std::vector<Vector3DInt32>& vecChunks = m_shard.vecChunksBeingPaged;
+		vecChunks.erase(std::find(vecChunks.begin(), vecChunks.end(), m_v3dChunkPos));
+		m_shard.condChunkPaged.notify_all();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Chunks which are not compressed are kept in memory until they are evicted, at which point they are paged out. Setting this
+	/// limit lower than the number of chunks which fit within the target memory usage means that chunks are compressed instead once
+	/// they have not been used for a while, and only paged out once the target memory usage is reached. This can greatly increase
+	/// the amount of data which can be held in memory, but means chunks have to be decompressed again when they are next accessed.
+	///
+	/// Changing the limit while other threads are accessing the volume is not supported.
+	/// \param uMaxNumberOfUncompressedChunks The maximum number of uncompressed chunks.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::setMaxNumberOfUncompressedChunks(uint32_t uMaxNumberOfUncompressedChunks)
+	{
+		POLYVOX_LOG_WARNING_IF(uMaxNumberOfUncompressedChunks < uMinPracticalNoOfChunks, "Requested number of uncompressed chunks is too low and cannot be adhered to.");
+		m_uUncompressedChunkCountLimit = (std::max)(uMaxNumberOfUncompressedChunks, uMinPracticalNoOfChunks);
+		m_uUncompressedChunkCountLimit = (std::min)(m_uUncompressedChunkCountLimit, m_uChunkCountLimit);
+
+		evictExcessChunks();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Mip levels are disabled by default. The coarsest level which can be kept has a single voxel for each chunk, so the number of
+	/// levels cannot be more than the log2 of the chunk side length. Together they take up to 1/7th of the memory used by the voxels
+	/// of the chunk, though this is only counted towards the memory usage of the volume for chunks which are compressed.
+	///
+	/// The levels are averaged by default, which suits algorithms such as raycasts and ambient occlusion. A LodPyramid needs them
+	/// to be subsampled instead, and reads them from the volume rather than keeping its own copies if they are.
+	///
+	/// Changing the number of levels or the filter discards the existing levels, and they are rebuilt as each chunk is next read
+	/// through getVoxelAtLevel() or getVoxelsAtLevel(). This should not be called while other threads are accessing the volume.
+	/// \param uNoOfMipLevels The number of levels to keep in addition to the volume itself, or zero to disable them.
+	/// \param eMipFilter How each voxel of a level is computed from the voxels of the level below.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::setNoOfMipLevels(uint32_t uNoOfMipLevels, MipFilter eMipFilter)
+	{
+		POLYVOX_THROW_IF(uNoOfMipLevels > m_uChunkSideLengthPower, std::invalid_argument, "The number of mip levels cannot be more than the log2 of the chunk side length.");
+
+		if ((uNoOfMipLevels == m_uNoOfMipLevels) && (eMipFilter == m_eMipFilter))
+		{
+			return;
+		}
+
+		m_uNoOfMipLevels = uNoOfMipLevels;
+		m_eMipFilter = eMipFilter;
+		for (uint32_t uShard = 0; uShard < uNoOfShards; uShard++)
+		{
+			Shard& shard = m_arrayShards[uShard];
+			std::unique_lock<std::mutex> lock = lockShard(shard);
+			for (Slot& slot : shard.vecSlots)
+			{
+				if (slot.pChunk)
+				{
+					updateMipLevelsInChunk(slot.pChunk.get(), true);
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of mip levels kept for each chunk, in addition to the volume itself.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::getNoOfMipLevels(void) const
+	{
+		return m_uNoOfMipLevels;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return How each voxel of a mip level is computed from the voxels of the level below.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	MipFilter PagedVolume<VoxelType>::getMipFilter(void) const
+	{
+		return m_eMipFilter;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Calculate the memory usage of the volume.
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t PagedVolume<VoxelType>::calculateSizeInBytes(void)
+	{
+		// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
+		// allocated voxel data. For uncompressed chunks we also disregard the size of the chunk itself, which keeps the reported size
+		// a multiple of the chunk size when compression is not in use.
+		return calculateMemoryUsageInBytes();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa gatherVoxels(VolumeType*, const Region&, typename VolumeType::VoxelType*)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void gatherVoxels(PagedVolume<VoxelType>* volData, const Region& region, VoxelType* pVoxels)
+	{
+		volData->getVoxels(region, pVoxels);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa getNoOfSubsampledLevels(VolumeType*)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t getNoOfSubsampledLevels(PagedVolume<VoxelType>* volData)
+	{
+		return (volData->getMipFilter() == MipFilters::Subsample) ? volData->getNoOfMipLevels() : 0;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa gatherVoxelsAtSubsampledLevel(VolumeType*, uint32_t, const Region&, typename VolumeType::VoxelType*)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void gatherVoxelsAtSubsampledLevel(PagedVolume<VoxelType>* volData, uint32_t uLevel, const Region& region, VoxelType* pVoxels)
+	{
+		POLYVOX_THROW_IF(uLevel > getNoOfSubsampledLevels(volData), std::invalid_argument, "The volume does not keep the requested level.");
+		volData->getVoxelsAtLevel(uLevel, region, pVoxels);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa modifyVoxels(VolumeType*, const Region&, Function)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType, typename Function>
+	std::vector<Region> modifyVoxels(PagedVolume<VoxelType>* volData, const Region& region, Function func)
+	{
+		return volData->modifyVoxels(region, func);
 	}
 }
 
@@ -22,16 +22,28 @@
 * SOFTWARE.
 *******************************************************************************/
 
+#include "Impl/MipLevels.h"
 #include "Impl/Morton.h"
+#include "Impl/PaletteEncoding.h"
+#include "Impl/RunLengthEncoding.h"
 #include "Impl/Utility.h"
 
 namespace PolyVox
 {
 	template <typename VoxelType>
-	PagedVolume<VoxelType>::Chunk::Chunk(Vector3DInt32 v3dPosition, uint16_t uSideLength, Pager* pPager)
+	PagedVolume<VoxelType>::Chunk::Chunk(Vector3DInt32 v3dPosition, uint16_t uSideLength, Pager* pPager, VoxelType* pSharedData)
 		:m_uChunkLastAccessed(0)
+		, m_pNewerChunk(nullptr)
+		, m_pOlderChunk(nullptr)
 		, m_bDataModified(true)
+		, m_tMinValue()
+		, m_tMaxValue()
+		, m_bValueRangeOutOfDate(false)
+		, m_regMipLevelsOutOfDate(0, 0, 0, uSideLength - 1, uSideLength - 1, uSideLength - 1)
+		, m_uNoOfMipLevels(0)
 		, m_tData(0)
+		, m_bDataShared(false)
+		, m_uPaletteIndexSizePower(0)
 		, m_uSideLength(0)
 		, m_uSideLengthPower(0)
 		, m_pPager(pPager)
@@ -44,6 +56,16 @@ namespace PolyVox
 		m_uSideLength = uSideLength;
 		m_uSideLengthPower = logBase2(uSideLength);
 
+		// If the volume already knows the contents of the chunk then there is nothing to page in.
+		if (pSharedData)
+		{
+			shareData(pSharedData);
+			m_tMinValue = pSharedData[0];
+			m_tMaxValue = pSharedData[0];
+			m_bDataModified = false;
+			return;
+		}
+
 		// Allocate the data
 		const uint32_t uNoOfVoxels = m_uSideLength * m_uSideLength * m_uSideLength;
 		m_tData = new VoxelType[uNoOfVoxels];
@@ -61,6 +83,9 @@ namespace PolyVox
 			m_pPager->pageIn(reg, this);
 		}
 
+		// The range of values is only worked out if it is needed.
+		m_bValueRangeOutOfDate = true;
+
 		// We'll use this later to decide if data needs to be paged out again.
 		m_bDataModified = false;
 	}
@@ -68,17 +93,12 @@ namespace PolyVox
 	template <typename VoxelType>
 	PagedVolume<VoxelType>::Chunk::~Chunk()
 	{
-		if (m_bDataModified && m_pPager)
-		{
-			// From the coordinates of the chunk we deduce the coordinates of the contained voxels.
-			Vector3DInt32 v3dLower = m_v3dChunkSpacePosition * static_cast<int32_t>(m_uSideLength);
-			Vector3DInt32 v3dUpper = v3dLower + Vector3DInt32(m_uSideLength - 1, m_uSideLength - 1, m_uSideLength - 1);
+		pageOutIfModified();
 
-			// Page the data out
-			m_pPager->pageOut(Region(v3dLower, v3dUpper), this);
+		if (!m_bDataShared)
+		{
+			delete[] m_tData;
 		}
-
-		delete[] m_tData;
 		m_tData = 0;
 	}
 
@@ -123,13 +143,44 @@ namespace PolyVox
 		POLYVOX_ASSERT(uXPos < m_uSideLength, "Supplied position is outside of the chunk");
 		POLYVOX_ASSERT(uYPos < m_uSideLength, "Supplied position is outside of the chunk");
 		POLYVOX_ASSERT(uZPos < m_uSideLength, "Supplied position is outside of the chunk");
-		POLYVOX_ASSERT(m_tData, "No uncompressed data - chunk must be decompressed before accessing voxels.");
+		POLYVOX_ASSERT(!m_bDataShared, "Chunk data is shared with other chunks and cannot be modified.");
 
 		uint32_t index = morton256_x[uXPos] | morton256_y[uYPos] | morton256_z[uZPos];
 
-		m_tData[index] = tValue;
-
 		this->m_bDataModified = true;
+		this->m_bValueRangeOutOfDate = true;
+		this->m_regMipLevelsOutOfDate.accumulate(uXPos, uYPos, uZPos);
+
+		if (m_tData)
+		{
+			m_tData[index] = tValue;
+			return;
+		}
+
+		POLYVOX_ASSERT(isPaletteCompressed(), "No uncompressed data - chunk must be decompressed before accessing voxels.");
+
+		// A value which is not already in the palette has to be added to it, which may mean the indices have to be widened.
+		// Once the palette is full the chunk is decompressed instead. Values are never removed from the palette, but it is
+		// rebuilt if the chunk is decompressed and compressed again.
+		uint32_t uPaletteIndex = findPaletteIndex(m_vecPalette, tValue);
+		if (uPaletteIndex == m_vecPalette.size())
+		{
+			if (uPaletteIndex == uMaxPaletteSize)
+			{
+				decompress();
+				m_tData[index] = tValue;
+				return;
+			}
+
+			m_vecPalette.push_back(tValue);
+			const uint8_t uRequiredIndexSizePower = paletteIndexSizePower(static_cast<uint32_t>(m_vecPalette.size()));
+			if (uRequiredIndexSizePower > m_uPaletteIndexSizePower)
+			{
+				widenPaletteIndices(m_vecPaletteIndices, m_uPaletteIndexSizePower, uRequiredIndexSizePower, m_uSideLength * m_uSideLength * m_uSideLength);
+			}
+		}
+
+		setPaletteIndex(m_vecPaletteIndices, m_uPaletteIndexSizePower, index, uPaletteIndex);
 	}
 
 	template <typename VoxelType>
@@ -138,9 +189,320 @@ namespace PolyVox
 		setVoxel(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ(), tValue);
 	}
 
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::pageOutIfModified(void)
+	{
+		if (m_bDataModified && m_pPager)
+		{
+			// The pager always works with uncompressed data. We don't bother compressing it again afterwards, as the
+			// volume only pages out chunks which it is about to discard.
+			decompress();
+
+			// From the coordinates of the chunk we deduce the coordinates of the contained voxels.
+			Vector3DInt32 v3dLower = m_v3dChunkSpacePosition * static_cast<int32_t>(m_uSideLength);
+			Vector3DInt32 v3dUpper = v3dLower + Vector3DInt32(m_uSideLength - 1, m_uSideLength - 1, m_uSideLength - 1);
+
+			// Page the data out
+			m_pPager->pageOut(Region(v3dLower, v3dUpper), this);
+		}
+
+		m_bDataModified = false;
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::Chunk::isCompressed(void) const
+	{
+		return m_tData == nullptr;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::compress(void)
+	{
+		if (isCompressed())
+		{
+			return;
+		}
+
+		POLYVOX_ASSERT(!m_bDataShared, "Chunks which share their data should not be compressed.");
+
+		// Run length encoded chunks have to be decompressed before they are modified, so their range can be kept exact.
+		if (m_bValueRangeOutOfDate)
+		{
+			updateValueRange();
+		}
+
+		// We use whichever encoding is smaller. Palette encoding has the advantage that voxels can still be accessed
+		// without decompressing the chunk, but run length encoding is much smaller for chunks with large uniform areas.
+		const uint32_t uNoOfVoxels = m_uSideLength * m_uSideLength * m_uSideLength;
+		const size_t uRunLengthEncodedSize = countRuns(m_tData, uNoOfVoxels) * (sizeof(VoxelType) + sizeof(uint16_t));
+		if (paletteEncode(m_tData, uNoOfVoxels, m_vecPalette, m_vecPaletteIndices, m_uPaletteIndexSizePower))
+		{
+			if (m_vecPalette.size() * sizeof(VoxelType) + m_vecPaletteIndices.size() < uRunLengthEncodedSize)
+			{
+				delete[] m_tData;
+				m_tData = nullptr;
+				return;
+			}
+
+			std::vector<VoxelType>().swap(m_vecPalette);
+			std::vector<uint8_t>().swap(m_vecPaletteIndices);
+		}
+
+		runLengthEncode(m_tData, uNoOfVoxels, m_vecRunValues, m_vecRunLengths);
+
+		delete[] m_tData;
+		m_tData = nullptr;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::decompress(void)
+	{
+		if (!isCompressed())
+		{
+			return;
+		}
+
+		const uint32_t uNoOfVoxels = m_uSideLength * m_uSideLength * m_uSideLength;
+		m_tData = new VoxelType[uNoOfVoxels];
+		if (isPaletteCompressed())
+		{
+			paletteDecode(m_vecPalette, m_vecPaletteIndices, m_uPaletteIndexSizePower, m_tData, uNoOfVoxels);
+		}
+		else
+		{
+			runLengthDecode(m_vecRunValues, m_vecRunLengths, m_tData, uNoOfVoxels);
+		}
+
+		// Release the memory used by the compressed data.
+		std::vector<VoxelType>().swap(m_vecRunValues);
+		std::vector<uint16_t>().swap(m_vecRunLengths);
+		std::vector<VoxelType>().swap(m_vecPalette);
+		std::vector<uint8_t>().swap(m_vecPaletteIndices);
+	}
+
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::Chunk::getVoxelAllowingPalette(uint32_t uXPos, uint32_t uYPos, uint32_t uZPos) const
+	{
+		if (m_tData)
+		{
+			return getVoxel(uXPos, uYPos, uZPos);
+		}
+
+		return getPaletteVoxel(morton256_x[uXPos] | morton256_y[uYPos] | morton256_z[uZPos]);
+	}
+
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::Chunk::getPaletteVoxel(uint32_t uIndex) const
+	{
+		POLYVOX_ASSERT(isPaletteCompressed(), "No uncompressed data - chunk must be decompressed before accessing voxels.");
+		return m_vecPalette[getPaletteIndex(m_vecPaletteIndices, m_uPaletteIndexSizePower, uIndex)];
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::Chunk::isPaletteCompressed(void) const
+	{
+		// The palette is never empty while it is in use.
+		return !m_vecPalette.empty();
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::Chunk::isUsingSharedData(void) const
+	{
+		return m_bDataShared;
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::Chunk::isUniform(VoxelType& tValue) const
+	{
+		POLYVOX_ASSERT(m_tData, "No uncompressed data - chunk must be decompressed before checking whether it is uniform.");
+
+		const uint32_t uNoOfVoxels = m_uSideLength * m_uSideLength * m_uSideLength;
+		for (uint32_t uIndex = 1; uIndex < uNoOfVoxels; uIndex++)
+		{
+			if (!(m_tData[uIndex] == m_tData[0]))
+			{
+				return false;
+			}
+		}
+
+		tValue = m_tData[0];
+		return true;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::updateValueRange(void)
+	{
+		if (m_tData)
+		{
+			computeValueRange(m_tData, m_uSideLength * m_uSideLength * m_uSideLength, m_tMinValue, m_tMaxValue, HasValueRange<VoxelType>());
+		}
+		else if (isPaletteCompressed())
+		{
+			computeValueRange(&(m_vecPalette[0]), static_cast<uint32_t>(m_vecPalette.size()), m_tMinValue, m_tMaxValue, HasValueRange<VoxelType>());
+		}
+		else
+		{
+			computeValueRange(&(m_vecRunValues[0]), static_cast<uint32_t>(m_vecRunValues.size()), m_tMinValue, m_tMaxValue, HasValueRange<VoxelType>());
+		}
+
+		m_bValueRangeOutOfDate = false;
+	}
+
+	template <typename VoxelType>
+	bool PagedVolume<VoxelType>::Chunk::areMipLevelsOutOfDate(uint32_t uNoOfMipLevels) const
+	{
+		return !m_bDataShared && ((m_uNoOfMipLevels != uNoOfMipLevels) || m_regMipLevelsOutOfDate.isValid());
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::updateMipLevels(uint32_t uNoOfMipLevels, MipFilter eMipFilter)
+	{
+		POLYVOX_ASSERT(uNoOfMipLevels <= m_uSideLengthPower, "A chunk cannot have more mip levels than the log2 of its side length.");
+		POLYVOX_ASSERT(m_tData || isPaletteCompressed(), "Run length encoded chunks must be decompressed before updating their mip levels.");
+
+		if (m_bDataShared)
+		{
+			return;
+		}
+
+		if (m_uNoOfMipLevels != uNoOfMipLevels)
+		{
+			// Every level is 1/8th the size of the one below, so together they need less than 1/7th of the size of the chunk.
+			uint32_t uNoOfMipVoxels = 0;
+			for (uint32_t uLevel = 1; uLevel <= uNoOfMipLevels; uLevel++)
+			{
+				uNoOfMipVoxels += 1u << (3 * (m_uSideLengthPower - uLevel));
+			}
+			std::vector<VoxelType>(uNoOfMipVoxels).swap(m_vecMipLevels);
+			m_uNoOfMipLevels = static_cast<uint8_t>(uNoOfMipLevels);
+			m_regMipLevelsOutOfDate = Region(0, 0, 0, m_uSideLength - 1, m_uSideLength - 1, m_uSideLength - 1);
+		}
+
+		if (!m_regMipLevelsOutOfDate.isValid())
+		{
+			return;
+		}
+
+		// Each level is built from the one below, and only the voxels which cover the modified region need to change.
+		const VoxelType* pSourceLevel = m_tData;
+		VoxelType* pTargetLevel = m_vecMipLevels.empty() ? nullptr : &(m_vecMipLevels[0]);
+		for (uint32_t uLevel = 1; uLevel <= m_uNoOfMipLevels; uLevel++)
+		{
+			const int32_t iShift = static_cast<int32_t>(uLevel);
+			for (int32_t iZ = m_regMipLevelsOutOfDate.getLowerZ() >> iShift; iZ <= (m_regMipLevelsOutOfDate.getUpperZ() >> iShift); iZ++)
+			{
+				for (int32_t iY = m_regMipLevelsOutOfDate.getLowerY() >> iShift; iY <= (m_regMipLevelsOutOfDate.getUpperY() >> iShift); iY++)
+				{
+					const uint32_t uRowIndex = morton256_y[iY] | morton256_z[iZ];
+					for (int32_t iX = m_regMipLevelsOutOfDate.getLowerX() >> iShift; iX <= (m_regMipLevelsOutOfDate.getUpperX() >> iShift); iX++)
+					{
+						// The eight voxels below this one are adjacent in Morton order, starting with the one at the lower corner
+						// (which is all that subsampling needs).
+						const uint32_t uIndex = uRowIndex | morton256_x[iX];
+						const uint32_t uNoOfChildren = (eMipFilter == MipFilters::Subsample) ? 1 : 8;
+						VoxelType tBlock[8];
+						for (uint32_t uChild = 0; uChild < uNoOfChildren; uChild++)
+						{
+							const uint32_t uChildIndex = (uIndex << 3) | uChild;
+							tBlock[uChild] = pSourceLevel ? pSourceLevel[uChildIndex] : m_vecPalette[getPaletteIndex(m_vecPaletteIndices, m_uPaletteIndexSizePower, uChildIndex)];
+						}
+						pTargetLevel[uIndex] = (eMipFilter == MipFilters::Subsample) ? tBlock[0] : downsampleBlock(tBlock, CanAverageVoxels<VoxelType>());
+					}
+				}
+			}
+
+			pSourceLevel = pTargetLevel;
+			pTargetLevel += 1u << (3 * (m_uSideLengthPower - uLevel));
+		}
+
+		m_regMipLevelsOutOfDate = Region::InvertedRegion();
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::releaseMipLevels(void)
+	{
+		std::vector<VoxelType>().swap(m_vecMipLevels);
+		m_uNoOfMipLevels = 0;
+		m_regMipLevelsOutOfDate = Region(0, 0, 0, m_uSideLength - 1, m_uSideLength - 1, m_uSideLength - 1);
+	}
+
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::Chunk::getVoxelAtLevel(uint32_t uLevel, uint32_t uXPos, uint32_t uYPos, uint32_t uZPos) const
+	{
+		POLYVOX_ASSERT(uLevel <= m_uSideLengthPower, "Requested mip level is too coarse for the chunk");
+		POLYVOX_ASSERT(uXPos < (static_cast<uint32_t>(m_uSideLength) >> uLevel), "Supplied position is outside of the chunk");
+		POLYVOX_ASSERT(uYPos < (static_cast<uint32_t>(m_uSideLength) >> uLevel), "Supplied position is outside of the chunk");
+		POLYVOX_ASSERT(uZPos < (static_cast<uint32_t>(m_uSideLength) >> uLevel), "Supplied position is outside of the chunk");
+
+		if (uLevel == 0)
+		{
+			return getVoxelAllowingPalette(uXPos, uYPos, uZPos);
+		}
+
+		// Every level of a chunk which shares its data has the same value.
+		if (m_bDataShared)
+		{
+			return m_tData[0];
+		}
+
+		POLYVOX_ASSERT(uLevel <= m_uNoOfMipLevels && !m_regMipLevelsOutOfDate.isValid(), "Mip levels must be updated before they are accessed.");
+
+		// The levels before this one take up (1/8 + 1/64 + ...) of the chunk, which is the difference between the chunk
+		// size and the size of the level below this one divided by seven.
+		const uint32_t uOffset = ((1u << (3 * m_uSideLengthPower)) - (1u << (3 * (m_uSideLengthPower - uLevel + 1)))) / 7;
+		return m_vecMipLevels[uOffset + (morton256_x[uXPos] | morton256_y[uYPos] | morton256_z[uZPos])];
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::shareData(VoxelType* pSharedData)
+	{
+		// The caller is responsible for making sure that the shared data matches the current contents of the chunk.
+		if (!m_bDataShared)
+		{
+			delete[] m_tData;
+		}
+		std::vector<VoxelType>().swap(m_vecRunValues);
+		std::vector<uint16_t>().swap(m_vecRunLengths);
+		std::vector<VoxelType>().swap(m_vecPalette);
+		std::vector<uint8_t>().swap(m_vecPaletteIndices);
+		releaseMipLevels();
+
+		m_tData = pSharedData;
+		m_bDataShared = true;
+	}
+
+	template <typename VoxelType>
+	void PagedVolume<VoxelType>::Chunk::unshareData(void)
+	{
+		if (!m_bDataShared)
+		{
+			return;
+		}
+
+		const uint32_t uNoOfVoxels = m_uSideLength * m_uSideLength * m_uSideLength;
+		VoxelType* pData = new VoxelType[uNoOfVoxels];
+		std::copy(m_tData, m_tData + uNoOfVoxels, pData);
+
+		m_tData = pData;
+		m_bDataShared = false;
+	}
+
 	template <typename VoxelType>
 	uint32_t PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(void)
 	{
+		if (m_bDataShared)
+		{
+			// The shared data is accounted for by the volume.
+			return static_cast<uint32_t>(sizeof(Chunk));
+		}
+
+		if (isCompressed())
+		{
+			// Compressed chunks can be very small, so in this case we do include the size of the chunk itself.
+			return static_cast<uint32_t>(sizeof(Chunk) + m_vecRunValues.capacity() * sizeof(VoxelType) + m_vecRunLengths.capacity() * sizeof(uint16_t) +
+				m_vecPalette.capacity() * sizeof(VoxelType) + m_vecPaletteIndices.capacity() + m_vecMipLevels.capacity() * sizeof(VoxelType));
+		}
+
 		// Call through to the static version
 		return calculateSizeInBytes(m_uSideLength);
 	}
@@ -148,8 +510,8 @@ namespace PolyVox
 	template <typename VoxelType>
 	uint32_t PagedVolume<VoxelType>::Chunk::calculateSizeInBytes(uint32_t uSideLength)
 	{
-		// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
-		// allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
+		// Note: We disregard the size of the other class members (and of any mip levels) as they are likely to be small compared to
+		// the size of the allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
 		uint32_t uSizeInBytes = uSideLength * uSideLength * uSideLength * sizeof(VoxelType);
 		return  uSizeInBytes;
 	}
@@ -49,6 +49,12 @@ namespace PolyVox
 	template <typename VoxelType>
 	PagedVolume<VoxelType>::Sampler::Sampler(PagedVolume<VoxelType>* volume)
 		:BaseVolume<VoxelType>::template Sampler< PagedVolume<VoxelType> >(volume), m_uChunkSideLengthMinusOne(volume->m_uChunkSideLength - 1)
+		, m_iCurrentChunkX(0)
+		, m_iCurrentChunkY(0)
+		, m_iCurrentChunkZ(0)
+		, m_iPeekedChunkX(0)
+		, m_iPeekedChunkY(0)
+		, m_iPeekedChunkZ(0)
 	{
 	}
 
@@ -86,12 +92,60 @@ namespace PolyVox
 
 		uint32_t uVoxelIndexInChunk = morton256_x[m_uXPosInChunk] | morton256_y[m_uYPosInChunk] | morton256_z[m_uZPosInChunk];
 
-		auto pCurrentChunk = this->mVolume->canReuseLastAccessedChunk(uXChunk, uYChunk, uZChunk) ?
+		if (this->mVolume->m_bConcurrentAccess)
+		{
+			// A chunk which shares its data is replaced by a copy (rather than being modified) when it is first written to,
+			// so in that case we always look it up again to make sure that we see any changes. This is also a fast path, as
+			// such chunks are never compressed.
+			if ((!m_pCurrentChunk) || (uXChunk != m_iCurrentChunkX) || (uYChunk != m_iCurrentChunkY) || (uZChunk != m_iCurrentChunkZ) ||
+				(!m_pCurrentChunk->m_tData) || m_pCurrentChunk->isUsingSharedData())
+			{
+				m_pCurrentChunk = this->mVolume->acquireChunk(uXChunk, uYChunk, uZChunk);
+				m_iCurrentChunkX = uXChunk;
+				m_iCurrentChunkY = uYChunk;
+				m_iCurrentChunkZ = uZChunk;
+			}
+
+			mCurrentVoxel = m_pCurrentChunk->m_tData + uVoxelIndexInChunk;
+			return;
+		}
+
+		// The last accessed chunk may have been left palette compressed by the volume, in which case we need to decompress it.
+		auto pCurrentChunk = (this->mVolume->canReuseLastAccessedChunk(uXChunk, uYChunk, uZChunk) && this->mVolume->m_pLastAccessedChunk->m_tData) ?
 			this->mVolume->m_pLastAccessedChunk : this->mVolume->getChunk(uXChunk, uYChunk, uZChunk);
 
 		mCurrentVoxel = pCurrentChunk->m_tData + uVoxelIndexInChunk;
 	}
 
+	template <typename VoxelType>
+	VoxelType PagedVolume<VoxelType>::Sampler::peekVoxelOutsideChunk(int32_t iXPos, int32_t iYPos, int32_t iZPos) const
+	{
+		if (!this->mVolume->m_bConcurrentAccess)
+		{
+			return this->mVolume->getVoxel(iXPos, iYPos, iZPos);
+		}
+
+		// Going through the volume would mean taking a lock for every peek across a chunk boundary, so
+		// we keep hold of the most recently peeked chunk in the same way as we do for the current one. As
+		// in setPosition(), a chunk which shares its data may since have been replaced by a copy, so it is
+		// looked up again each time.
+		const int32_t iXChunk = iXPos >> this->mVolume->m_uChunkSideLengthPower;
+		const int32_t iYChunk = iYPos >> this->mVolume->m_uChunkSideLengthPower;
+		const int32_t iZChunk = iZPos >> this->mVolume->m_uChunkSideLengthPower;
+
+		if ((!m_pPeekedChunk) || (iXChunk != m_iPeekedChunkX) || (iYChunk != m_iPeekedChunkY) || (iZChunk != m_iPeekedChunkZ) ||
+			(!m_pPeekedChunk->m_tData) || m_pPeekedChunk->isUsingSharedData())
+		{
+			m_pPeekedChunk = this->mVolume->acquireChunk(iXChunk, iYChunk, iZChunk);
+			m_iPeekedChunkX = iXChunk;
+			m_iPeekedChunkY = iYChunk;
+			m_iPeekedChunkZ = iZChunk;
+		}
+
+		return m_pPeekedChunk->getVoxelAllowingPalette(static_cast<uint16_t>(iXPos & this->mVolume->m_iChunkMask),
+			static_cast<uint16_t>(iYPos & this->mVolume->m_iChunkMask), static_cast<uint16_t>(iZPos & this->mVolume->m_iChunkMask));
+	}
+
 	template <typename VoxelType>
 	bool PagedVolume<VoxelType>::Sampler::setVoxel(VoxelType tValue)
 	{
@@ -227,7 +281,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + NEG_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -237,7 +291,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + NEG_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -247,7 +301,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + NEG_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -257,7 +311,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -267,7 +321,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -277,7 +331,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -287,7 +341,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + POS_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -297,7 +351,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + POS_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -307,7 +361,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_X_DELTA + POS_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume - 1, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -319,7 +373,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -329,7 +383,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -339,7 +393,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -349,7 +403,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -365,7 +419,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -375,7 +429,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -385,7 +439,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -395,7 +449,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -407,7 +461,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + NEG_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -417,7 +471,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + NEG_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -427,7 +481,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + NEG_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume - 1, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -437,7 +491,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -447,7 +501,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -457,7 +511,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume, this->mZPosInVolume + 1);
 	}
 
 	template <typename VoxelType>
@@ -467,7 +521,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + POS_Y_DELTA + NEG_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume - 1);
 	}
 
 	template <typename VoxelType>
@@ -477,7 +531,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + POS_Y_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume);
 	}
 
 	template <typename VoxelType>
@@ -487,7 +541,7 @@ namespace PolyVox
 		{
 			return *(mCurrentVoxel + POS_X_DELTA + POS_Y_DELTA + POS_Z_DELTA);
 		}
-		return this->mVolume->getVoxel(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
+		return peekVoxelOutsideChunk(this->mXPosInVolume + 1, this->mYPosInVolume + 1, this->mZPosInVolume + 1);
 	}
 }
 
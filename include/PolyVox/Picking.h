@@ -34,10 +34,10 @@ namespace PolyVox
 	 */
 	struct PickResult
 	{
-		PickResult() : didHit(false) {}
+		PickResult() : didHit(false), hitVoxel(0, 0, 0), previousVoxel(0, 0, 0) {}
 		bool didHit; ///< Did the picking operation hit anything
-		Vector3DInt32 hitVoxel; ///< The location of the solid voxel it hit
-		Vector3DInt32 previousVoxel; ///< The location of the voxel before the one it hit
+		Vector3DInt32 hitVoxel; ///< The location of the solid voxel it hit, or (0,0,0) if it didn't hit anything
+		Vector3DInt32 previousVoxel; ///< The location of the voxel before the one it hit, or (0,0,0) if the first voxel was hit
 	};
 
 	/// Pick the first solid voxel along a vector
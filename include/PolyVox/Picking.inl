@@ -66,6 +66,10 @@ namespace PolyVox
 	}
 
 	/**
+	 * The ray passes over blocks of the volume which are known to contain only \a emptyVoxelExample (see
+	 * raycastWithDirectionSkippingEmptySpace()), so long rays through open space are cheap. These are the blocks
+	 * in which the volume keeps track of its values (see BaseVolume::getValueRangeBlockSideLength()).
+	 *
 	 * \param volData The volume to pass the ray though
 	 * \param v3dStart The start position in the volume
 	 * \param v3dDirectionAndLength The direction and length of the ray
@@ -78,7 +82,23 @@ namespace PolyVox
 	{
 		RaycastPickingFunctor<VolumeType> functor(emptyVoxelExample);
 
-		raycastWithDirection(volData, v3dStart, v3dDirectionAndLength, functor);
+		// Blocks which the volume knows to be empty (using the blocks in which it keeps track of its values) are passed over without
+		// calling the functor, so the result is filled in from the voxels which the ray finished on instead (see traceRaySkippingEmptySpace()).
+		typename VolumeType::Sampler sampler(volData);
+		Vector3DInt32 v3dLastVoxel;
+		Vector3DInt32 v3dPreviousVoxel;
+		uint32_t uNoOfSteps;
+		const RaycastResult result = traceRaySkippingEmptySpace(volData, sampler, v3dStart, v3dStart + v3dDirectionAndLength, functor,
+			emptyVoxelExample, getSkippingBlockSideLengthPower(volData, 0), v3dLastVoxel, v3dPreviousVoxel, uNoOfSteps);
+
+		if (result == RaycastResults::Completed)
+		{
+			functor.m_result.previousVoxel = v3dLastVoxel;
+		}
+		else if (v3dPreviousVoxel != v3dLastVoxel)
+		{
+			functor.m_result.previousVoxel = v3dPreviousVoxel;
+		}
 
 		return functor.m_result;
 	}
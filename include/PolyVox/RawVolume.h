@@ -29,10 +29,15 @@
 #include "Region.h"
 #include "Vector.h"
 
+#include "Impl/ValueRange.h"
+
+#include <algorithm>
 #include <cstdlib> //For abort()
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stdexcept> //For invalid_argument
+#include <vector>
 
 namespace PolyVox
 {
@@ -146,6 +151,8 @@ namespace PolyVox
 		VoxelType getVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos) const;
 		/// Gets a voxel at the position given by a 3D vector
 		VoxelType getVoxel(const Vector3DInt32& v3dPos) const;
+		/// Copies the voxels within the specified Region into a buffer
+		void getVoxels(const Region& region, VoxelType* pVoxels) const;
 
 		/// Sets the value used for voxels which are outside the volume
 		void setBorderValue(const VoxelType& tBorder);
@@ -153,6 +160,14 @@ namespace PolyVox
 		void setVoxel(int32_t uXPos, int32_t uYPos, int32_t uZPos, VoxelType tValue);
 		/// Sets the voxel at the position given by a 3D vector
 		void setVoxel(const Vector3DInt32& v3dPos, VoxelType tValue);
+		/// Passes each voxel within the specified Region through a function, and writes back those which it changes
+		template <typename Function>
+		std::vector<Region> modifyVoxels(const Region& region, Function func);
+
+		/// Gets bounds on the values of the voxels within the specified Region.
+		bool getRegionValueRange(const Region& region, VoxelType& tMin, VoxelType& tMax) const;
+		/// Gets the side length of the blocks in which the volume keeps track of the values of its voxels, or zero if it doesn't.
+		uint32_t getValueRangeBlockSideLength(void) const;
 
 		/// Calculates approximatly how many bytes of memory the volume is currently using.
 		uint32_t calculateSizeInBytes(void);
@@ -167,6 +182,12 @@ namespace PolyVox
 	private:
 		void initialise(const Region& regValidRegion);
 
+		// Called after the given voxel (which must be inside the volume) has been changed to a different value. This marks the
+		// value range of its block as out of date, and passes the change on to the change tracker if there is one.
+		void voxelModified(int32_t iXPos, int32_t iYPos, int32_t iZPos);
+		// Recomputes the value range of the given block. The caller must hold m_mutexBlockValueRanges.
+		void updateBlockValueRange(int32_t iBlockX, int32_t iBlockY, int32_t iBlockZ) const;
+
 		//The size of the volume
 		Region m_regValidRegion;
 
@@ -175,7 +196,26 @@ namespace PolyVox
 
 		//The voxel data
 		VoxelType* m_pData;
+
+		// The range of values in each block of voxels (see getRegionValueRange()), which are only kept for primitive voxel types.
+		// Writing a voxel just marks the range of its block as out of date, and it is recomputed the next time it is needed. The
+		// mutex means that getRegionValueRange() can still be called from several threads at once, like the other read operations.
+		enum { BlockSideLengthPower = 4 };
+		int32_t m_iWidthInBlocks;
+		int32_t m_iHeightInBlocks;
+		mutable std::vector<VoxelType> m_vecBlockMinValues;
+		mutable std::vector<VoxelType> m_vecBlockMaxValues;
+		mutable std::vector<uint8_t> m_vecBlockValueRangeOutOfDate;
+		mutable std::mutex m_mutexBlockValueRanges;
 	};
+
+	/// Copies the voxels using RawVolume::getVoxels().
+	template <typename VoxelType>
+	void gatherVoxels(RawVolume<VoxelType>* volData, const Region& region, VoxelType* pVoxels);
+
+	/// Modifies the voxels using RawVolume::modifyVoxels().
+	template <typename VoxelType, typename Function>
+	std::vector<Region> modifyVoxels(RawVolume<VoxelType>* volData, const Region& region, Function func);
 }
 
 #include "RawVolume.inl"
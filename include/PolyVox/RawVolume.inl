@@ -169,6 +169,51 @@ namespace PolyVox
 		return getVoxel(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ());
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// The voxels are stored with x varying fastest, followed by y and then z, and each row which is inside the volume is copied
+	/// in one go. Parts of the Region which are outside the volume are filled with the border value.
+	/// \param region The Region of voxels to copy.
+	/// \param[out] pVoxels The buffer which receives the voxels. It must be large enough to hold the whole Region.
+	/// \sa gatherVoxels()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void RawVolume<VoxelType>::getVoxels(const Region& region, VoxelType* pVoxels) const
+	{
+		const uint32_t uWidth = region.getWidthInVoxels();
+		const uint32_t uHeight = region.getHeightInVoxels();
+		const uint32_t uDepth = region.getDepthInVoxels();
+
+		if (!m_regValidRegion.containsRegion(region))
+		{
+			std::fill(pVoxels, pVoxels + uWidth * uHeight * uDepth, m_tBorderValue);
+		}
+
+		if (!intersects(region, m_regValidRegion))
+		{
+			return;
+		}
+
+		Region croppedRegion = region;
+		croppedRegion.cropTo(m_regValidRegion);
+		const uint32_t uRowLength = croppedRegion.getWidthInVoxels();
+
+		for (int32_t z = croppedRegion.getLowerZ(); z <= croppedRegion.getUpperZ(); z++)
+		{
+			for (int32_t y = croppedRegion.getLowerY(); y <= croppedRegion.getUpperY(); y++)
+			{
+				const VoxelType* pSrc = m_pData +
+					(croppedRegion.getLowerX() - m_regValidRegion.getLowerX()) +
+					(y - m_regValidRegion.getLowerY()) * this->getWidth() +
+					(z - m_regValidRegion.getLowerZ()) * this->getWidth() * this->getHeight();
+				VoxelType* pDst = pVoxels +
+					(croppedRegion.getLowerX() - region.getLowerX()) +
+					(y - region.getLowerY()) * uWidth +
+					(z - region.getLowerZ()) * uWidth * uHeight;
+				std::copy(pSrc, pSrc + uRowLength, pDst);
+			}
+		}
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// \param tBorder The value to use for voxels outside the volume.
 	////////////////////////////////////////////////////////////////////////////////
@@ -179,6 +224,7 @@ namespace PolyVox
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
+	/// Writing the value which the voxel already has does nothing, so the change tracker (if any) is only told about real changes.
 	/// \param uXPos the \c x position of the voxel
 	/// \param uYPos the \c y position of the voxel
 	/// \param uZPos the \c z position of the voxel
@@ -197,12 +243,19 @@ namespace PolyVox
 		int32_t iLocalYPos = uYPos - v3dLowerCorner.getY();
 		int32_t iLocalZPos = uZPos - v3dLowerCorner.getZ();
 
-		m_pData
+		VoxelType& tVoxel = m_pData
 			[
 				iLocalXPos +
 				iLocalYPos * this->getWidth() +
 				iLocalZPos * this->getWidth() * this->getHeight()
-			] = tValue;
+			];
+		if (tVoxel == tValue)
+		{
+			return;
+		}
+
+		tVoxel = tValue;
+		voxelModified(uXPos, uYPos, uZPos);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -215,6 +268,157 @@ namespace PolyVox
 		setVoxel(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ(), tValue);
 	}
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// The function is called as <tt>func(x, y, z, tOldValue)</tt> and returns the new value of the voxel. Unlike setVoxel(), the
+	/// parts of the Region which are outside the volume are simply ignored, which makes it easy to apply edits near its edges. The
+	/// value ranges of the affected blocks and the change tracker (if any) are only updated once, after all the voxels have been
+	/// processed, rather than for every voxel which is written.
+	/// \param region The Region of voxels to pass through the function.
+	/// \param func The function which computes the new value of each voxel.
+	/// \return A Region bounding the voxels which were changed, or nothing if none were.
+	/// \sa modifyVoxels(VolumeType*, const Region&, Function)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	template <typename Function>
+	std::vector<Region> RawVolume<VoxelType>::modifyVoxels(const Region& region, Function func)
+	{
+		Region regCropped = region;
+		regCropped.cropTo(m_regValidRegion);
+
+		Region regChanged = Region::InvertedRegion();
+		if (regCropped.isValid())
+		{
+			for (int32_t z = regCropped.getLowerZ(); z <= regCropped.getUpperZ(); z++)
+			{
+				for (int32_t y = regCropped.getLowerY(); y <= regCropped.getUpperY(); y++)
+				{
+					VoxelType* pVoxel = m_pData +
+						(regCropped.getLowerX() - m_regValidRegion.getLowerX()) +
+						(y - m_regValidRegion.getLowerY()) * this->getWidth() +
+						(z - m_regValidRegion.getLowerZ()) * this->getWidth() * this->getHeight();
+					for (int32_t x = regCropped.getLowerX(); x <= regCropped.getUpperX(); x++)
+					{
+						const VoxelType tNewValue = func(x, y, z, *pVoxel);
+						if (tNewValue != *pVoxel)
+						{
+							*pVoxel = tNewValue;
+							regChanged.accumulate(x, y, z);
+						}
+						pVoxel++;
+					}
+				}
+			}
+		}
+
+		std::vector<Region> vecChangedRegions;
+		if (!regChanged.isValid())
+		{
+			return vecChangedRegions;
+		}
+
+		if (HasValueRange<VoxelType>::value)
+		{
+			const Vector3DInt32 v3dLower = regChanged.getLowerCorner() - m_regValidRegion.getLowerCorner();
+			const Vector3DInt32 v3dUpper = regChanged.getUpperCorner() - m_regValidRegion.getLowerCorner();
+			for (int32_t iBlockZ = v3dLower.getZ() >> BlockSideLengthPower; iBlockZ <= (v3dUpper.getZ() >> BlockSideLengthPower); iBlockZ++)
+			{
+				for (int32_t iBlockY = v3dLower.getY() >> BlockSideLengthPower; iBlockY <= (v3dUpper.getY() >> BlockSideLengthPower); iBlockY++)
+				{
+					for (int32_t iBlockX = v3dLower.getX() >> BlockSideLengthPower; iBlockX <= (v3dUpper.getX() >> BlockSideLengthPower); iBlockX++)
+					{
+						m_vecBlockValueRangeOutOfDate[iBlockX + iBlockY * m_iWidthInBlocks + iBlockZ * m_iWidthInBlocks * m_iHeightInBlocks] = 1;
+					}
+				}
+			}
+		}
+
+		if (this->m_pChangeTracker)
+		{
+			this->m_pChangeTracker->regionChanged(regChanged);
+		}
+
+		vecChangedRegions.push_back(regChanged);
+		return vecChangedRegions;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The volume keeps track of the range of values in each block of 16x16x16 voxels, but only for primitive voxel types (for other
+	/// types this function returns false). The ranges of any blocks which have been written to since they were last used are brought
+	/// up to date first. Parts of the Region which are outside the volume are taken to contain the border value.
+	/// \param region The Region of voxels to check.
+	/// \param tMin Set to a value which is less than or equal to all the voxels in the Region.
+	/// \param tMax Set to a value which is greater than or equal to all the voxels in the Region.
+	/// \return Whether the bounds were set.
+	/// \sa BaseVolume::getRegionValueRange()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	bool RawVolume<VoxelType>::getRegionValueRange(const Region& region, VoxelType& tMin, VoxelType& tMax) const
+	{
+		if (!HasValueRange<VoxelType>::value)
+		{
+			return false;
+		}
+
+		bool bFoundValue = false;
+		VoxelType tFoundMin = VoxelType();
+		VoxelType tFoundMax = VoxelType();
+		if (!m_regValidRegion.containsRegion(region))
+		{
+			tFoundMin = m_tBorderValue;
+			tFoundMax = m_tBorderValue;
+			bFoundValue = true;
+		}
+
+		if (intersects(region, m_regValidRegion))
+		{
+			std::lock_guard<std::mutex> lock(m_mutexBlockValueRanges);
+
+			// Find the blocks which overlap the Region.
+			Region croppedRegion = region;
+			croppedRegion.cropTo(m_regValidRegion);
+			croppedRegion.shift(-m_regValidRegion.getLowerX(), -m_regValidRegion.getLowerY(), -m_regValidRegion.getLowerZ());
+
+			for (int32_t z = croppedRegion.getLowerZ() >> BlockSideLengthPower; z <= (croppedRegion.getUpperZ() >> BlockSideLengthPower); z++)
+			{
+				for (int32_t y = croppedRegion.getLowerY() >> BlockSideLengthPower; y <= (croppedRegion.getUpperY() >> BlockSideLengthPower); y++)
+				{
+					for (int32_t x = croppedRegion.getLowerX() >> BlockSideLengthPower; x <= (croppedRegion.getUpperX() >> BlockSideLengthPower); x++)
+					{
+						const uint32_t uBlockIndex = x + y * m_iWidthInBlocks + z * m_iWidthInBlocks * m_iHeightInBlocks;
+						if (m_vecBlockValueRangeOutOfDate[uBlockIndex])
+						{
+							updateBlockValueRange(x, y, z);
+						}
+
+						if (!bFoundValue)
+						{
+							tFoundMin = m_vecBlockMinValues[uBlockIndex];
+							tFoundMax = m_vecBlockMaxValues[uBlockIndex];
+							bFoundValue = true;
+						}
+						expandValueRange(m_vecBlockMinValues[uBlockIndex], tFoundMin, tFoundMax, HasValueRange<VoxelType>());
+						expandValueRange(m_vecBlockMaxValues[uBlockIndex], tFoundMin, tFoundMax, HasValueRange<VoxelType>());
+					}
+				}
+			}
+		}
+
+		tMin = tFoundMin;
+		tMax = tFoundMax;
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The range of values is only kept for primitive voxel types, so for other types this function returns zero.
+	/// \return The side length of the blocks, or zero if the volume does not keep track of the values in them.
+	/// \sa BaseVolume::getValueRangeBlockSideLength()
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	uint32_t RawVolume<VoxelType>::getValueRangeBlockSideLength(void) const
+	{
+		return HasValueRange<VoxelType>::value ? (1u << BlockSideLengthPower) : 0u;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	/// This function should probably be made internal...
 	////////////////////////////////////////////////////////////////////////////////
@@ -241,6 +445,66 @@ namespace PolyVox
 
 		// Clear to zeros
 		std::fill(m_pData, m_pData + this->getWidth() * this->getHeight()* this->getDepth(), VoxelType());
+
+		// Every block starts out containing only the value we cleared the data to.
+		m_iWidthInBlocks = ((this->getWidth() - 1) >> BlockSideLengthPower) + 1;
+		m_iHeightInBlocks = ((this->getHeight() - 1) >> BlockSideLengthPower) + 1;
+		if (HasValueRange<VoxelType>::value)
+		{
+			const int32_t iDepthInBlocks = ((this->getDepth() - 1) >> BlockSideLengthPower) + 1;
+			m_vecBlockMinValues.assign(m_iWidthInBlocks * m_iHeightInBlocks * iDepthInBlocks, VoxelType());
+			m_vecBlockMaxValues.assign(m_iWidthInBlocks * m_iHeightInBlocks * iDepthInBlocks, VoxelType());
+			m_vecBlockValueRangeOutOfDate.assign(m_iWidthInBlocks * m_iHeightInBlocks * iDepthInBlocks, 0);
+		}
+	}
+
+	template <typename VoxelType>
+	void RawVolume<VoxelType>::voxelModified(int32_t iXPos, int32_t iYPos, int32_t iZPos)
+	{
+		if (HasValueRange<VoxelType>::value)
+		{
+			const int32_t iBlockX = (iXPos - m_regValidRegion.getLowerX()) >> BlockSideLengthPower;
+			const int32_t iBlockY = (iYPos - m_regValidRegion.getLowerY()) >> BlockSideLengthPower;
+			const int32_t iBlockZ = (iZPos - m_regValidRegion.getLowerZ()) >> BlockSideLengthPower;
+			m_vecBlockValueRangeOutOfDate[iBlockX + iBlockY * m_iWidthInBlocks + iBlockZ * m_iWidthInBlocks * m_iHeightInBlocks] = 1;
+		}
+
+		if (this->m_pChangeTracker)
+		{
+			this->m_pChangeTracker->voxelChanged(iXPos, iYPos, iZPos);
+		}
+	}
+
+	template <typename VoxelType>
+	void RawVolume<VoxelType>::updateBlockValueRange(int32_t iBlockX, int32_t iBlockY, int32_t iBlockZ) const
+	{
+		const uint32_t uBlockIndex = iBlockX + iBlockY * m_iWidthInBlocks + iBlockZ * m_iWidthInBlocks * m_iHeightInBlocks;
+
+		// Blocks on the upper faces of the volume may be only partly inside it.
+		const int32_t iLowerX = iBlockX << BlockSideLengthPower;
+		const int32_t iLowerY = iBlockY << BlockSideLengthPower;
+		const int32_t iLowerZ = iBlockZ << BlockSideLengthPower;
+		const int32_t iUpperX = (std::min)(iLowerX + (1 << BlockSideLengthPower), this->getWidth());
+		const int32_t iUpperY = (std::min)(iLowerY + (1 << BlockSideLengthPower), this->getHeight());
+		const int32_t iUpperZ = (std::min)(iLowerZ + (1 << BlockSideLengthPower), this->getDepth());
+
+		VoxelType tMin = m_pData[iLowerX + iLowerY * this->getWidth() + iLowerZ * this->getWidth() * this->getHeight()];
+		VoxelType tMax = tMin;
+		for (int32_t z = iLowerZ; z < iUpperZ; z++)
+		{
+			for (int32_t y = iLowerY; y < iUpperY; y++)
+			{
+				const VoxelType* pRow = m_pData + y * this->getWidth() + z * this->getWidth() * this->getHeight();
+				for (int32_t x = iLowerX; x < iUpperX; x++)
+				{
+					expandValueRange(pRow[x], tMin, tMax, HasValueRange<VoxelType>());
+				}
+			}
+		}
+
+		m_vecBlockMinValues[uBlockIndex] = tMin;
+		m_vecBlockMaxValues[uBlockIndex] = tMax;
+		m_vecBlockValueRangeOutOfDate[uBlockIndex] = 0;
 	}
 
 	////////////////////////////////////////////////////////////////////////////////
@@ -251,5 +515,23 @@ namespace PolyVox
 	{
 		return this->getWidth() * this->getHeight() * this->getDepth() * sizeof(VoxelType);
 	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa gatherVoxels(VolumeType*, const Region&, typename VolumeType::VoxelType*)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType>
+	void gatherVoxels(RawVolume<VoxelType>* volData, const Region& region, VoxelType* pVoxels)
+	{
+		volData->getVoxels(region, pVoxels);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \sa modifyVoxels(VolumeType*, const Region&, Function)
+	////////////////////////////////////////////////////////////////////////////////
+	template <typename VoxelType, typename Function>
+	std::vector<Region> modifyVoxels(RawVolume<VoxelType>* volData, const Region& region, Function func)
+	{
+		return volData->modifyVoxels(region, func);
+	}
 }
 
@@ -107,7 +107,12 @@ namespace PolyVox
 		//return m_bIsCurrentPositionValid ? *mCurrentVoxel : this->mVolume->getBorderValue();
 		if (this->m_bIsCurrentPositionValidInX && this->m_bIsCurrentPositionValidInY && this->m_bIsCurrentPositionValidInZ)
 		{
-			*mCurrentVoxel = tValue;
+			// As with RawVolume::setVoxel(), only real changes are passed on.
+			if (!(*mCurrentVoxel == tValue))
+			{
+				*mCurrentVoxel = tValue;
+				this->mVolume->voxelModified(this->mXPosInVolume, this->mYPosInVolume, this->mZPosInVolume);
+			}
 			return true;
 		}
 		else
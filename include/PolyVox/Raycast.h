@@ -25,8 +25,18 @@
 #ifndef __PolyVox_Raycast_H__
 #define __PolyVox_Raycast_H__
 
+#include "Region.h"
 #include "Vector.h"
 
+#include "Impl/Utility.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
 namespace PolyVox
 {
 	namespace RaycastResults
@@ -42,6 +52,40 @@ namespace PolyVox
 	}
 	typedef RaycastResults::RaycastResult RaycastResult;
 
+	/// A batch of rays for raycastBatch(), each defined by a start point and a direction (whose length is the length of the ray
+	/// as for raycastWithDirection()). The components are held in separate arrays, so that they can be filled and read efficiently by code
+	/// which works on several rays at a time.
+	struct RaycastBatch
+	{
+		void addRay(const Vector3DFloat& v3dStart, const Vector3DFloat& v3dDirectionAndLength);
+		void clear(void);
+		void reserve(uint32_t uNoOfRays);
+		uint32_t getNoOfRays(void) const;
+
+		std::vector<float> startX;
+		std::vector<float> startY;
+		std::vector<float> startZ;
+		std::vector<float> directionX;
+		std::vector<float> directionY;
+		std::vector<float> directionZ;
+	};
+
+	/// The results of raycastBatch(), with one element in each array for every ray in the batch.
+	struct RaycastBatchResults
+	{
+		void resize(uint32_t uNoOfRays);
+		uint32_t getNoOfRays(void) const;
+
+		/// Whether each ray was interupted or completed, as returned by raycastWithDirection().
+		std::vector<RaycastResult> results;
+		/// The voxel at which the callback interupted the ray, or the last voxel on it if the ray completed.
+		std::vector<int32_t> hitX;
+		std::vector<int32_t> hitY;
+		std::vector<int32_t> hitZ;
+		/// The number of voxels which were passed to the callback, including the one at which the ray was interupted.
+		std::vector<uint32_t> noOfSteps;
+	};
+
 	/// OUT OF DATE SINCE UNCLASSING
 	////////////////////////////////////////////////////////////////////////////////
 	/// \file Raycast.h
@@ -72,6 +116,13 @@ namespace PolyVox
 	/// been tested yet.
 	///
 	/// Note that we also have a pickVoxel() function which provides a slightly higher-level interface.
+	///
+	/// Rays which pass through large empty areas can be cast much more quickly with raycastWithDirectionSkippingEmptySpace(),
+	/// which uses what the volume knows about the values in each of its blocks or chunks to pass over empty ones.
+	///
+	/// Large numbers of rays (e.g. for visibility checks) can be passed to raycastBatch() in a RaycastBatch, which traces
+	/// them on several threads and returns the result, the last voxel and the number of voxels visited for each of them
+	/// in a RaycastBatchResults.
 	////////////////////////////////////////////////////////////////////////////////
 
 	template<typename VolumeType, typename Callback>
@@ -79,6 +130,17 @@ namespace PolyVox
 
 	template<typename VolumeType, typename Callback>
 	RaycastResult raycastWithDirection(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dDirectionAndLength, Callback& callback);
+
+	template<typename VolumeType, typename Callback>
+	RaycastResult raycastWithEndpointsSkippingEmptySpace(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, Callback& callback,
+		const typename VolumeType::VoxelType& tEmptyValue, uint32_t uBlockSideLength = 0);
+
+	template<typename VolumeType, typename Callback>
+	RaycastResult raycastWithDirectionSkippingEmptySpace(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dDirectionAndLength, Callback& callback,
+		const typename VolumeType::VoxelType& tEmptyValue, uint32_t uBlockSideLength = 0);
+
+	template<typename VolumeType, typename Callback>
+	void raycastBatch(VolumeType* volData, const RaycastBatch& batch, Callback& callback, RaycastBatchResults& results, uint32_t uNoOfThreads = 0);
 }
 
 #include "Raycast.inl"
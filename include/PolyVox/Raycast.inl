@@ -22,6 +22,9 @@
 * SOFTWARE.
 *******************************************************************************/
 
+#include <cmath>
+#include <stdexcept>
+
 namespace PolyVox
 {
 	// This function is based on Christer Ericson's code and description of the 'Uniform Grid Intersection Test' in
@@ -54,100 +57,409 @@ namespace PolyVox
 	//
 	//	This error was reported by Joey Hammer (PixelActive).
 
-	/**
-	 * Cast a ray through a volume by specifying the start and end positions
-	 *
-	 * The ray will move from \a v3dStart to \a v3dEnd, calling \a callback for each
-	 * voxel it passes through until \a callback returns \a false. In this case it
-	 * returns a RaycastResults::Interupted. If it passes from start to end
-	 * without \a callback returning \a false, it returns RaycastResults::Completed.
-	 *
-	 * \param volData The volume to pass the ray though
-	 * \param v3dStart The start position in the volume
-	 * \param v3dEnd The end position in the volume
-	 * \param callback The callback to call for each voxel
-	 *
-	 * \return A RaycastResults designating whether the ray hit anything or not
-	 */
-	template<typename VolumeType, typename Callback>
-	RaycastResult raycastWithEndpoints(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, Callback& callback)
+	/// The state of a ray as it passes from voxel to voxel. (i, j, k) is the current voxel and (tx, ty, tz) are the distances along
+	/// the ray (as a fraction of its length) to the next voxel boundary on each axis. These distances are calculated from the number
+	/// of steps taken along each axis (rather than by adding up the steps) so that the ray takes exactly the same path whether it
+	/// visits every voxel or jumps across blocks with skipBlock().
+	struct RaycastTraversal
 	{
-		typename VolumeType::Sampler sampler(volData);
+		RaycastTraversal(const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd)
+		{
+			//The doRaycast function is assuming that it is iterating over the areas defined between
+			//voxels. We actually want to define the areas as being centered on voxels (as this is
+			//what the CubicSurfaceExtractor generates). We add 0.5 here to adjust for this.
+			const float x1 = v3dStart.getX() + 0.5f;
+			const float y1 = v3dStart.getY() + 0.5f;
+			const float z1 = v3dStart.getZ() + 0.5f;
+			const float x2 = v3dEnd.getX() + 0.5f;
+			const float y2 = v3dEnd.getY() + 0.5f;
+			const float z2 = v3dEnd.getZ() + 0.5f;
+
+			i = (int)floorf(x1);
+			j = (int)floorf(y1);
+			k = (int)floorf(z1);
+
+			iend = (int)floorf(x2);
+			jend = (int)floorf(y2);
+			kend = (int)floorf(z2);
+
+			di = ((x1 < x2) ? 1 : ((x1 > x2) ? -1 : 0));
+			dj = ((y1 < y2) ? 1 : ((y1 > y2) ? -1 : 0));
+			dk = ((z1 < z2) ? 1 : ((z1 > z2) ? -1 : 0));
+
+			deltatx = 1.0f / std::abs(x2 - x1);
+			deltaty = 1.0f / std::abs(y2 - y1);
+			deltatz = 1.0f / std::abs(z2 - z1);
+
+			const float minx = floorf(x1), maxx = minx + 1.0f;
+			tx0 = tx = ((x1 > x2) ? (x1 - minx) : (maxx - x1)) * deltatx;
+			const float miny = floorf(y1), maxy = miny + 1.0f;
+			ty0 = ty = ((y1 > y2) ? (y1 - miny) : (maxy - y1)) * deltaty;
+			const float minz = floorf(z1), maxz = minz + 1.0f;
+			tz0 = tz = ((z1 > z2) ? (z1 - minz) : (maxz - z1)) * deltatz;
+
+			nx = ny = nz = 0;
+		}
+
+		/// The distance to the voxel boundary which is crossed by the step after the given number of steps along an axis.
+		static float getBoundaryT(float t0, int32_t iNoOfSteps, float deltat)
+		{
+			return t0 + static_cast<float>(iNoOfSteps) * deltat;
+		}
+
+		void stepX(void)
+		{
+			i += di;
+			tx = getBoundaryT(tx0, ++nx, deltatx);
+		}
+
+		void stepY(void)
+		{
+			j += dj;
+			ty = getBoundaryT(ty0, ++ny, deltaty);
+		}
+
+		void stepZ(void)
+		{
+			k += dk;
+			tz = getBoundaryT(tz0, ++nz, deltatz);
+		}
+
+		/// Moves the ray straight to the first voxel outside the cubic block (with a side length of 2^uBlockSideLengthPower) which
+		/// contains the current voxel, without visiting the voxels in between. The distance to where the ray leaves the block is
+		/// found for each axis from the bounds of the block, and the other axes are then advanced to that point as if the voxels had
+		/// been visited one at a time (following the same rules for ties). If the ray ends within the block then it is moved to its
+		/// last voxel and false is returned. The voxel visited just before the one the ray is moved to is written to v3dPreviousVoxel,
+		/// which is left unchanged if the ray does not move.
+		bool skipBlock(uint8_t uBlockSideLengthPower, Vector3DInt32& v3dPreviousVoxel)
+		{
+			int* aiPos[3] = { &i, &j, &k };
+			const int aiEnd[3] = { iend, jend, kend };
+			const int aiDir[3] = { di, dj, dk };
+			float* afT[3] = { &tx, &ty, &tz };
+			const float afT0[3] = { tx0, ty0, tz0 };
+			int32_t* aiNoOfSteps[3] = { &nx, &ny, &nz };
+			const float afDeltaT[3] = { deltatx, deltaty, deltatz };
+
+			// Find the axis on which the ray first either leaves the block or reaches its end. Each axis is taken in turn
+			// when the distances are equal, just as when stepping from voxel to voxel.
+			int iEventAxis = -1;
+			int32_t iEventStep = 0;
+			float fEventT = 0.0f;
+			bool bLeavesBlock = false;
+			for (int iAxis = 0; iAxis < 3; iAxis++)
+			{
+				if (aiDir[iAxis] == 0)
+				{
+					continue;
+				}
+
+				const int32_t iBlockLower = (*aiPos[iAxis] >> uBlockSideLengthPower) << uBlockSideLengthPower;
+				const int32_t iStepsToLeave = (aiDir[iAxis] > 0) ? (iBlockLower + (1 << uBlockSideLengthPower) - *aiPos[iAxis]) : (*aiPos[iAxis] - iBlockLower + 1);
+				const int32_t iStepsToEnd = std::abs(aiEnd[iAxis] - *aiPos[iAxis]) + 1;
+				const int32_t iStep = (std::min)(iStepsToLeave, iStepsToEnd);
+				const float fT = getBoundaryT(afT0[iAxis], *aiNoOfSteps[iAxis] + iStep - 1, afDeltaT[iAxis]);
+				if ((iEventAxis == -1) || (fT < fEventT))
+				{
+					iEventAxis = iAxis;
+					iEventStep = iStep;
+					fEventT = fT;
+					bLeavesBlock = iStepsToLeave < iStepsToEnd;
+				}
+			}
+
+			if (iEventAxis == -1)
+			{
+				// The ray is a single voxel.
+				return false;
+			}
+
+			// Count the steps which each axis takes before the event. The last of them gives the previous voxel if the ray ends here.
+			int32_t aiSteps[3] = { 0, 0, 0 };
+			aiSteps[iEventAxis] = bLeavesBlock ? iEventStep : iEventStep - 1;
+			int iLastStepAxis = (aiSteps[iEventAxis] > 0) ? iEventAxis : -1;
+			float fLastStepT = getBoundaryT(afT0[iEventAxis], *aiNoOfSteps[iEventAxis] + aiSteps[iEventAxis] - 1, afDeltaT[iEventAxis]);
+			for (int iAxis = 0; iAxis < 3; iAxis++)
+			{
+				if ((iAxis == iEventAxis) || (aiDir[iAxis] == 0))
+				{
+					continue;
+				}
+
+				// A step is taken first if it is closer, or equally close but on an earlier axis.
+				auto isBeforeEvent = [&](int32_t iStep)
+				{
+					const float fT = getBoundaryT(afT0[iAxis], *aiNoOfSteps[iAxis] + iStep, afDeltaT[iAxis]);
+					return (fT < fEventT) || ((fT == fEventT) && (iAxis < iEventAxis));
+				};
+
+				// Estimate the number of steps, and then correct for any rounding.
+				int32_t iSteps = (fEventT >= *afT[iAxis]) ? static_cast<int32_t>((fEventT - *afT[iAxis]) / afDeltaT[iAxis]) : 0;
+				while ((iSteps > 0) && !isBeforeEvent(iSteps - 1))
+				{
+					iSteps--;
+				}
+				while (isBeforeEvent(iSteps))
+				{
+					iSteps++;
+				}
+				aiSteps[iAxis] = iSteps;
+
+				const float fLastT = getBoundaryT(afT0[iAxis], *aiNoOfSteps[iAxis] + iSteps - 1, afDeltaT[iAxis]);
+				if ((iSteps > 0) && ((iLastStepAxis == -1) || (fLastT > fLastStepT) || ((fLastT == fLastStepT) && (iAxis > iLastStepAxis))))
+				{
+					iLastStepAxis = iAxis;
+					fLastStepT = fLastT;
+				}
+			}
+
+			for (int iAxis = 0; iAxis < 3; iAxis++)
+			{
+				if (aiSteps[iAxis] > 0)
+				{
+					*aiPos[iAxis] += aiDir[iAxis] * aiSteps[iAxis];
+					*aiNoOfSteps[iAxis] += aiSteps[iAxis];
+					*afT[iAxis] = getBoundaryT(afT0[iAxis], *aiNoOfSteps[iAxis], afDeltaT[iAxis]);
+				}
+			}
+
+			if (bLeavesBlock)
+			{
+				iLastStepAxis = iEventAxis;
+			}
+			if (iLastStepAxis != -1)
+			{
+				v3dPreviousVoxel.setElements(i, j, k);
+				v3dPreviousVoxel.setElement(iLastStepAxis, v3dPreviousVoxel.getElement(iLastStepAxis) - aiDir[iLastStepAxis]);
+			}
+			return bLeavesBlock;
+		}
 
-		//The doRaycast function is assuming that it is iterating over the areas defined between
-		//voxels. We actually want to define the areas as being centered on voxels (as this is
-		//what the CubicSurfaceExtractor generates). We add 0.5 here to adjust for this.
-		const float x1 = v3dStart.getX() + 0.5f;
-		const float y1 = v3dStart.getY() + 0.5f;
-		const float z1 = v3dStart.getZ() + 0.5f;
-		const float x2 = v3dEnd.getX() + 0.5f;
-		const float y2 = v3dEnd.getY() + 0.5f;
-		const float z2 = v3dEnd.getZ() + 0.5f;
-
-		int i = (int)floorf(x1);
-		int j = (int)floorf(y1);
-		int k = (int)floorf(z1);
-
-		const int iend = (int)floorf(x2);
-		const int jend = (int)floorf(y2);
-		const int kend = (int)floorf(z2);
-
-		const int di = ((x1 < x2) ? 1 : ((x1 > x2) ? -1 : 0));
-		const int dj = ((y1 < y2) ? 1 : ((y1 > y2) ? -1 : 0));
-		const int dk = ((z1 < z2) ? 1 : ((z1 > z2) ? -1 : 0));
-
-		const float deltatx = 1.0f / std::abs(x2 - x1);
-		const float deltaty = 1.0f / std::abs(y2 - y1);
-		const float deltatz = 1.0f / std::abs(z2 - z1);
-
-		const float minx = floorf(x1), maxx = minx + 1.0f;
-		float tx = ((x1 > x2) ? (x1 - minx) : (maxx - x1)) * deltatx;
-		const float miny = floorf(y1), maxy = miny + 1.0f;
-		float ty = ((y1 > y2) ? (y1 - miny) : (maxy - y1)) * deltaty;
-		const float minz = floorf(z1), maxz = minz + 1.0f;
-		float tz = ((z1 > z2) ? (z1 - minz) : (maxz - z1)) * deltatz;
-
-		sampler.setPosition(i, j, k);
+		int i, j, k;
+		int iend, jend, kend;
+		int di, dj, dk;
+		float tx, ty, tz;
+		float deltatx, deltaty, deltatz;
+		// The distances to the first boundaries, and the number of steps taken along each axis since then.
+		float tx0, ty0, tz0;
+		int32_t nx, ny, nz;
+	};
+
+	/// Passes each voxel on the ray from v3dStart to v3dEnd to the callback, as described for raycastWithEndpoints(), using the given
+	/// sampler. The last voxel which was passed to the callback and the number of voxels which were passed to it are also returned.
+	template<typename Sampler, typename Callback>
+	RaycastResult traceRay(Sampler& sampler, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, Callback& callback, Vector3DInt32& v3dLastVoxel, uint32_t& uNoOfSteps)
+	{
+		RaycastTraversal ray(v3dStart, v3dEnd);
+
+		sampler.setPosition(ray.i, ray.j, ray.k);
+		uNoOfSteps = 0;
 
 		for (;;)
 		{
+			uNoOfSteps++;
 			if (!callback(sampler))
 			{
+				v3dLastVoxel.setElements(ray.i, ray.j, ray.k);
 				return RaycastResults::Interupted;
 			}
 
-			if (tx <= ty && tx <= tz)
+			if (ray.tx <= ray.ty && ray.tx <= ray.tz)
 			{
-				if (i == iend) break;
-				tx += deltatx;
-				i += di;
+				if (ray.i == ray.iend) break;
+				ray.stepX();
 
-				if (di == 1) sampler.movePositiveX();
-				if (di == -1) sampler.moveNegativeX();
+				if (ray.di == 1) sampler.movePositiveX();
+				if (ray.di == -1) sampler.moveNegativeX();
 			}
-			else if (ty <= tz)
+			else if (ray.ty <= ray.tz)
 			{
-				if (j == jend) break;
-				ty += deltaty;
-				j += dj;
+				if (ray.j == ray.jend) break;
+				ray.stepY();
 
-				if (dj == 1) sampler.movePositiveY();
-				if (dj == -1) sampler.moveNegativeY();
+				if (ray.dj == 1) sampler.movePositiveY();
+				if (ray.dj == -1) sampler.moveNegativeY();
 			}
 			else
 			{
-				if (k == kend) break;
-				tz += deltatz;
-				k += dk;
+				if (ray.k == ray.kend) break;
+				ray.stepZ();
 
-				if (dk == 1) sampler.movePositiveZ();
-				if (dk == -1) sampler.moveNegativeZ();
+				if (ray.dk == 1) sampler.movePositiveZ();
+				if (ray.dk == -1) sampler.moveNegativeZ();
+			}
+		}
+
+		v3dLastVoxel.setElements(ray.i, ray.j, ray.k);
+		return RaycastResults::Completed;
+	}
+
+	/// Determines whether the volume knows that every voxel in the region has the given value, from the range of values in the region
+	/// or (for voxel types without a range) from whether it is uniform. See BaseVolume::getRegionValueRange().
+	template<typename VolumeType>
+	bool isRegionEntirely(VolumeType* volData, const Region& region, const typename VolumeType::VoxelType& tValue)
+	{
+		typename VolumeType::VoxelType tMin;
+		typename VolumeType::VoxelType tMax;
+		if (volData->getRegionValueRange(region, tMin, tMax))
+		{
+			return (tMin == tValue) && (tMax == tValue);
+		}
+
+		typename VolumeType::VoxelType tUniformValue;
+		return volData->isRegionUniform(region, tUniformValue) && (tUniformValue == tValue);
+	}
+
+	namespace
+	{
+		/// The side length of the blocks which traceRaySkippingEmptySpace() uses for volumes which don't keep track of their values.
+		/// Nothing can be skipped in such volumes, so this just keeps down the number of times they are asked about a block.
+		const uint32_t UntrackedVolumeBlockSideLength = 32;
+	}
+
+	/// Gets the power of two of the side length of the blocks which traceRaySkippingEmptySpace() should skip over. A side length
+	/// of zero means that the volume's own blocks should be used (see BaseVolume::getValueRangeBlockSideLength()).
+	template<typename VolumeType>
+	uint8_t getSkippingBlockSideLengthPower(VolumeType* volData, uint32_t uBlockSideLength)
+	{
+		if (uBlockSideLength == 0)
+		{
+			uBlockSideLength = volData->getValueRangeBlockSideLength();
+		}
+		if (uBlockSideLength == 0)
+		{
+			uBlockSideLength = UntrackedVolumeBlockSideLength;
+		}
+		return logBase2(uBlockSideLength);
+	}
+
+	/// The version of traceRay() which skips over blocks containing only tEmptyValue (see raycastWithEndpointsSkippingEmptySpace()).
+	/// When the ray enters such a block it jumps straight to where it leaves it (see RaycastTraversal::skipBlock()), so the cost of
+	/// crossing open space depends on the number of blocks rather than the number of voxels. The voxel before the last one which
+	/// was passed to the callback is also returned (whether or not it was itself passed to the callback), or the last voxel if
+	/// there was no voxel before it.
+	template<typename VolumeType, typename Callback>
+	RaycastResult traceRaySkippingEmptySpace(VolumeType* volData, typename VolumeType::Sampler& sampler, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd,
+		Callback& callback, const typename VolumeType::VoxelType& tEmptyValue, uint8_t uBlockSideLengthPower, Vector3DInt32& v3dLastVoxel, Vector3DInt32& v3dPreviousVoxel, uint32_t& uNoOfSteps)
+	{
+		RaycastTraversal ray(v3dStart, v3dEnd);
+
+		const int32_t iBlockSideLength = 1 << uBlockSideLengthPower;
+		auto isBlockEmpty = [&](int32_t iBlockX, int32_t iBlockY, int32_t iBlockZ)
+		{
+			const Vector3DInt32 v3dLower(iBlockX * iBlockSideLength, iBlockY * iBlockSideLength, iBlockZ * iBlockSideLength);
+			return isRegionEntirely(volData, Region(v3dLower, v3dLower + Vector3DInt32(iBlockSideLength - 1, iBlockSideLength - 1, iBlockSideLength - 1)), tEmptyValue);
+		};
+
+		// The sampler is only positioned once the ray reaches a block which is not empty, so that the chunks
+		// of empty blocks don't need to be accessed (the volume may know they are empty without paging them in).
+		int32_t iBlockX = ray.i >> uBlockSideLengthPower;
+		int32_t iBlockY = ray.j >> uBlockSideLengthPower;
+		int32_t iBlockZ = ray.k >> uBlockSideLengthPower;
+		bool bBlockEmpty = isBlockEmpty(iBlockX, iBlockY, iBlockZ);
+		bool bSamplerInPlace = false;
+		uNoOfSteps = 0;
+		v3dPreviousVoxel.setElements(ray.i, ray.j, ray.k);
+
+		for (;;)
+		{
+			bool bNewBlock = false;
+			if (bBlockEmpty)
+			{
+				if (!ray.skipBlock(uBlockSideLengthPower, v3dPreviousVoxel)) break;
+				bNewBlock = true;
+			}
+			else
+			{
+				if (!bSamplerInPlace)
+				{
+					sampler.setPosition(ray.i, ray.j, ray.k);
+					bSamplerInPlace = true;
+				}
+
+				uNoOfSteps++;
+				if (!callback(sampler))
+				{
+					v3dLastVoxel.setElements(ray.i, ray.j, ray.k);
+					return RaycastResults::Interupted;
+				}
+
+				// As in traceRay(), but the sampler is only moved if the ray stays in the same block.
+				int32_t iMoveX = 0, iMoveY = 0, iMoveZ = 0;
+				if (ray.tx <= ray.ty && ray.tx <= ray.tz)
+				{
+					if (ray.i == ray.iend) break;
+					v3dPreviousVoxel.setElements(ray.i, ray.j, ray.k);
+					ray.stepX();
+					iMoveX = ray.di;
+					bNewBlock = (ray.i >> uBlockSideLengthPower) != iBlockX;
+				}
+				else if (ray.ty <= ray.tz)
+				{
+					if (ray.j == ray.jend) break;
+					v3dPreviousVoxel.setElements(ray.i, ray.j, ray.k);
+					ray.stepY();
+					iMoveY = ray.dj;
+					bNewBlock = (ray.j >> uBlockSideLengthPower) != iBlockY;
+				}
+				else
+				{
+					if (ray.k == ray.kend) break;
+					v3dPreviousVoxel.setElements(ray.i, ray.j, ray.k);
+					ray.stepZ();
+					iMoveZ = ray.dk;
+					bNewBlock = (ray.k >> uBlockSideLengthPower) != iBlockZ;
+				}
+
+				if (!bNewBlock)
+				{
+					if (iMoveX == 1) sampler.movePositiveX();
+					if (iMoveX == -1) sampler.moveNegativeX();
+					if (iMoveY == 1) sampler.movePositiveY();
+					if (iMoveY == -1) sampler.moveNegativeY();
+					if (iMoveZ == 1) sampler.movePositiveZ();
+					if (iMoveZ == -1) sampler.moveNegativeZ();
+				}
+			}
+
+			if (bNewBlock)
+			{
+				iBlockX = ray.i >> uBlockSideLengthPower;
+				iBlockY = ray.j >> uBlockSideLengthPower;
+				iBlockZ = ray.k >> uBlockSideLengthPower;
+				bBlockEmpty = isBlockEmpty(iBlockX, iBlockY, iBlockZ);
+				bSamplerInPlace = false;
 			}
 		}
 
+		v3dLastVoxel.setElements(ray.i, ray.j, ray.k);
 		return RaycastResults::Completed;
 	}
 
+	/**
+	 * Cast a ray through a volume by specifying the start and end positions
+	 *
+	 * The ray will move from \a v3dStart to \a v3dEnd, calling \a callback for each
+	 * voxel it passes through until \a callback returns \a false. In this case it
+	 * returns a RaycastResults::Interupted. If it passes from start to end
+	 * without \a callback returning \a false, it returns RaycastResults::Completed.
+	 *
+	 * \param volData The volume to pass the ray though
+	 * \param v3dStart The start position in the volume
+	 * \param v3dEnd The end position in the volume
+	 * \param callback The callback to call for each voxel
+	 *
+	 * \return A RaycastResults designating whether the ray hit anything or not
+	 */
+	template<typename VolumeType, typename Callback>
+	RaycastResult raycastWithEndpoints(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, Callback& callback)
+	{
+		typename VolumeType::Sampler sampler(volData);
+		Vector3DInt32 v3dLastVoxel;
+		uint32_t uNoOfSteps;
+		return traceRay(sampler, v3dStart, v3dEnd, callback, v3dLastVoxel, uNoOfSteps);
+	}
+
 	/**
 	 * Cast a ray through a volume by specifying the start and a direction
 	 *
@@ -178,4 +490,215 @@ namespace PolyVox
 		Vector3DFloat v3dEnd = v3dStart + v3dDirectionAndLength;
 		return raycastWithEndpoints<VolumeType, Callback>(volData, v3dStart, v3dEnd, callback);
 	}
+
+	/**
+	 * Cast a ray through a volume by specifying the start and end positions, skipping over empty space
+	 *
+	 * This is an accelerated version of raycastWithEndpoints() for rays which pass through large empty areas, such as
+	 * long range picking or line of sight checks. The volume is divided into cubic blocks, and before the ray enters
+	 * a block the volume is asked whether every voxel in it is known to be \a tEmptyValue (see
+	 * BaseVolume::getRegionValueRange() and BaseVolume::isRegionUniform()). The callback is not called for the voxels of
+	 * such blocks, and their data is never read, so it must be a callback which would return \a true for them anyway.
+	 * The ray jumps straight across such blocks rather than stepping through their voxels, but otherwise follows the same
+	 * path as with raycastWithEndpoints() and so gives the same result.
+	 *
+	 * By default the blocks are those in which the volume itself keeps track of its values (see
+	 * BaseVolume::getValueRangeBlockSideLength()), which is usually the best choice. Smaller blocks allow the ray to get
+	 * closer to the surface before it has to look at each voxel, but the volume then has to be asked about more of them.
+	 *
+	 * \param volData The volume to pass the ray though
+	 * \param v3dStart The start position in the volume
+	 * \param v3dEnd The end position in the volume
+	 * \param callback The callback to call for each voxel which is not in an empty block
+	 * \param tEmptyValue The value of the voxels which the callback would always pass over
+	 * \param uBlockSideLength The side length of the blocks which are skipped, which must be a power of two, or zero to use the volume's blocks
+	 *
+	 * \return A RaycastResults designating whether the ray hit anything or not
+	 */
+	template<typename VolumeType, typename Callback>
+	RaycastResult raycastWithEndpointsSkippingEmptySpace(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dEnd, Callback& callback,
+		const typename VolumeType::VoxelType& tEmptyValue, uint32_t uBlockSideLength)
+	{
+		const uint8_t uBlockSideLengthPower = getSkippingBlockSideLengthPower(volData, uBlockSideLength);
+
+		typename VolumeType::Sampler sampler(volData);
+		Vector3DInt32 v3dLastVoxel;
+		Vector3DInt32 v3dPreviousVoxel;
+		uint32_t uNoOfSteps;
+		return traceRaySkippingEmptySpace(volData, sampler, v3dStart, v3dEnd, callback, tEmptyValue, uBlockSideLengthPower, v3dLastVoxel, v3dPreviousVoxel, uNoOfSteps);
+	}
+
+	/**
+	 * Cast a ray through a volume by specifying the start and a direction, skipping over empty space
+	 *
+	 * See raycastWithEndpointsSkippingEmptySpace(), and the note about the length of the direction for raycastWithDirection().
+	 *
+	 * \param volData The volume to pass the ray though
+	 * \param v3dStart The start position in the volume
+	 * \param v3dDirectionAndLength The direction and length of the ray
+	 * \param callback The callback to call for each voxel which is not in an empty block
+	 * \param tEmptyValue The value of the voxels which the callback would always pass over
+	 * \param uBlockSideLength The side length of the blocks which are skipped, which must be a power of two, or zero to use the volume's blocks
+	 *
+	 * \return A RaycastResults designating whether the ray hit anything or not
+	 */
+	template<typename VolumeType, typename Callback>
+	RaycastResult raycastWithDirectionSkippingEmptySpace(VolumeType* volData, const Vector3DFloat& v3dStart, const Vector3DFloat& v3dDirectionAndLength, Callback& callback,
+		const typename VolumeType::VoxelType& tEmptyValue, uint32_t uBlockSideLength)
+	{
+		Vector3DFloat v3dEnd = v3dStart + v3dDirectionAndLength;
+		return raycastWithEndpointsSkippingEmptySpace<VolumeType, Callback>(volData, v3dStart, v3dEnd, callback, tEmptyValue, uBlockSideLength);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dStart The start position of the ray.
+	/// \param v3dDirectionAndLength The direction and length of the ray.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void RaycastBatch::addRay(const Vector3DFloat& v3dStart, const Vector3DFloat& v3dDirectionAndLength)
+	{
+		startX.push_back(v3dStart.getX());
+		startY.push_back(v3dStart.getY());
+		startZ.push_back(v3dStart.getZ());
+		directionX.push_back(v3dDirectionAndLength.getX());
+		directionY.push_back(v3dDirectionAndLength.getY());
+		directionZ.push_back(v3dDirectionAndLength.getZ());
+	}
+
+	inline void RaycastBatch::clear(void)
+	{
+		startX.clear();
+		startY.clear();
+		startZ.clear();
+		directionX.clear();
+		directionY.clear();
+		directionZ.clear();
+	}
+
+	inline void RaycastBatch::reserve(uint32_t uNoOfRays)
+	{
+		startX.reserve(uNoOfRays);
+		startY.reserve(uNoOfRays);
+		startZ.reserve(uNoOfRays);
+		directionX.reserve(uNoOfRays);
+		directionY.reserve(uNoOfRays);
+		directionZ.reserve(uNoOfRays);
+	}
+
+	inline uint32_t RaycastBatch::getNoOfRays(void) const
+	{
+		return static_cast<uint32_t>(startX.size());
+	}
+
+	inline void RaycastBatchResults::resize(uint32_t uNoOfRays)
+	{
+		results.resize(uNoOfRays);
+		hitX.resize(uNoOfRays);
+		hitY.resize(uNoOfRays);
+		hitZ.resize(uNoOfRays);
+		noOfSteps.resize(uNoOfRays);
+	}
+
+	inline uint32_t RaycastBatchResults::getNoOfRays(void) const
+	{
+		return static_cast<uint32_t>(results.size());
+	}
+
+	/**
+	 * Cast a batch of rays through a volume
+	 *
+	 * Each ray is traced in exactly the same way as by raycastWithDirection(), calling \a callback for each voxel
+	 * it passes through until \a callback returns \a false, and so gives the same results. The rays are divided
+	 * between several threads in groups of consecutive rays, which each thread takes in turn until there are none
+	 * left. A thread uses a single Sampler for all of its rays rather than one being created for every ray. Samplers
+	 * only look up a chunk when they move into a different one, so when the rays are coherent (e.g. they start from
+	 * nearby points) most of them can use the chunk which the previous ray started in. For this reason it is best to
+	 * add similar rays to the batch one after another.
+	 *
+	 * The volume is read from several threads at once, so if it is a PagedVolume it must have concurrent access
+	 * enabled (see the threading section of the manual). Each thread uses its own copy of the callback, other than
+	 * when only one thread is used, in which case the rays are traced on the calling thread with \a callback itself.
+	 *
+	 * \param volData The volume to pass the rays though
+	 * \param batch The rays to trace
+	 * \param callback The callback to call for each voxel
+	 * \param results Receives the results of each ray, and is resized to match the batch
+	 * \param uNoOfThreads The number of threads to use, or zero to use one per hardware thread
+	 */
+	template<typename VolumeType, typename Callback>
+	void raycastBatch(VolumeType* volData, const RaycastBatch& batch, Callback& callback, RaycastBatchResults& results, uint32_t uNoOfThreads)
+	{
+		const uint32_t uNoOfRays = batch.getNoOfRays();
+		POLYVOX_THROW_IF((batch.startY.size() != uNoOfRays) || (batch.startZ.size() != uNoOfRays) || (batch.directionX.size() != uNoOfRays) ||
+			(batch.directionY.size() != uNoOfRays) || (batch.directionZ.size() != uNoOfRays), std::invalid_argument, "All of the arrays in the batch must be the same size");
+
+		results.resize(uNoOfRays);
+
+		auto traceRays = [&](Callback& rayCallback, uint32_t uFirstRay, uint32_t uEndRay)
+		{
+			typename VolumeType::Sampler sampler(volData);
+			Vector3DInt32 v3dLastVoxel;
+			for (uint32_t uRay = uFirstRay; uRay < uEndRay; uRay++)
+			{
+				const Vector3DFloat v3dStart(batch.startX[uRay], batch.startY[uRay], batch.startZ[uRay]);
+				const Vector3DFloat v3dEnd = v3dStart + Vector3DFloat(batch.directionX[uRay], batch.directionY[uRay], batch.directionZ[uRay]);
+				results.results[uRay] = traceRay(sampler, v3dStart, v3dEnd, rayCallback, v3dLastVoxel, results.noOfSteps[uRay]);
+				results.hitX[uRay] = v3dLastVoxel.getX();
+				results.hitY[uRay] = v3dLastVoxel.getY();
+				results.hitZ[uRay] = v3dLastVoxel.getZ();
+			}
+		};
+
+		if (uNoOfThreads == 0)
+		{
+			uNoOfThreads = (std::max)(std::thread::hardware_concurrency(), 1u);
+		}
+
+		// The groups are large enough for the cost of starting the threads and of each thread's sampler to be small
+		// compared to tracing the rays, but small enough for the threads to finish at about the same time.
+		const uint32_t uRaysPerGroup = 256;
+		const uint32_t uNoOfGroups = (uNoOfRays + uRaysPerGroup - 1) / uRaysPerGroup;
+		uNoOfThreads = (std::min)(uNoOfThreads, uNoOfGroups);
+		if (uNoOfThreads <= 1)
+		{
+			traceRays(callback, 0, uNoOfRays);
+			return;
+		}
+
+		// The threads take groups in order until there are none left. Exceptions are passed back to this thread.
+		std::atomic<uint32_t> uNextGroup(0);
+		std::vector<std::exception_ptr> vecExceptions(uNoOfThreads);
+		auto traceGroups = [&](uint32_t uThread)
+		{
+			try
+			{
+				Callback threadCallback = callback;
+				for (uint32_t uGroup = uNextGroup++; uGroup < uNoOfGroups; uGroup = uNextGroup++)
+				{
+					traceRays(threadCallback, uGroup * uRaysPerGroup, (std::min)((uGroup + 1) * uRaysPerGroup, uNoOfRays));
+				}
+			}
+			catch (...)
+			{
+				vecExceptions[uThread] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> vecThreads;
+		for (uint32_t uThread = 1; uThread < uNoOfThreads; uThread++)
+		{
+			vecThreads.push_back(std::thread(traceGroups, uThread));
+		}
+		traceGroups(0);
+		for (std::thread& thread : vecThreads)
+		{
+			thread.join();
+		}
+		for (const std::exception_ptr& pException : vecExceptions)
+		{
+			if (pException)
+			{
+				std::rethrow_exception(pException);
+			}
+		}
+	}
 }
@@ -0,0 +1,682 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_RegionFilePager_H__
+#define __PolyVox_RegionFilePager_H__
+
+#include "Impl/PlatformDefinitions.h"
+
+#include "Impl/MemoryMappedFile.h"
+#include "Impl/Utility.h"
+
+#include "ChunkCodec.h"
+#include "PagedVolume.h"
+#include "Region.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace PolyVox
+{
+	/**
+	 * An implementation of Pager which stores voxels in 'region files' on disk. Each region file holds a cube of
+	 * neighbouring chunks (8x8x8 by default) so that large volumes do not need millions of files, and the files are
+	 * kept between runs so that the volume can be reloaded by creating a new RegionFilePager on the same folder.
+	 *
+	 * Each file starts with a small header and an index giving the position of each chunk within it. Chunks are always
+	 * appended to the end of the file rather than overwriting their previous data, and each one is stored with a
+	 * checksum. The index is only updated once the chunk has been written to disk, so if the application (or the
+	 * system) crashes the file still contains the previous version of the chunk. If the index itself was damaged then it is rebuilt by
+	 * scanning the file. The space used by old versions of chunks is reclaimed by compacting the file once it
+	 * exceeds the space used by the current versions, which is done by writing a new file and replacing the old one.
+	 *
+	 * The files are accessed through memory mapping, so paging in a chunk is a single copy from the mapping into the
+	 * chunk without any file system calls. Chunks in which every voxel has the same value are stored as that value,
+	 * and reported to the volume via isRegionUniform() so that they never need paging in. If a ChunkCodec is provided
+	 * then the other chunks are compressed with it, which makes the files smaller at the cost of decoding each chunk
+	 * as it is paged in. Each record notes the codec which wrote it, so that data written by a different codec is
+	 * detected rather than silently loaded into the volume (though chunks written without a codec can always be read).
+	 * As with FilePager the voxels are written as they are in memory, so files cannot be moved between platforms with
+	 * different endianness.
+	 *
+	 * The RegionFilePager can be used with a PagedVolume which has concurrent access enabled.
+	 */
+	template <typename VoxelType>
+	class RegionFilePager : public PagedVolume<VoxelType>::Pager
+	{
+	public:
+		/// Constructor. If a codec is provided then it must outlive the RegionFilePager, otherwise the voxels are stored uncompressed.
+		RegionFilePager(const std::string& strFolderName = ".", uint16_t uRegionSideLengthInChunks = 8, uint32_t uMaxNoOfOpenFiles = 32, ChunkCodec<VoxelType>* pCodec = nullptr)
+			:PagedVolume<VoxelType>::Pager()
+			, m_strFolderName(strFolderName)
+			, m_uRegionSideLengthInChunks(uRegionSideLengthInChunks)
+			, m_uMaxNoOfOpenFiles(uMaxNoOfOpenFiles)
+			, m_pCodec(pCodec)
+			, m_uTimestamper(0)
+		{
+			POLYVOX_THROW_IF(uRegionSideLengthInChunks == 0, std::invalid_argument, "Region side length cannot be zero.");
+			POLYVOX_THROW_IF(uRegionSideLengthInChunks > 32, std::invalid_argument, "Region side length cannot be greater than 32 chunks.");
+			POLYVOX_THROW_IF(uMaxNoOfOpenFiles == 0, std::invalid_argument, "Must be able to open at least one file.");
+
+			// Add the trailing slash, assuming the user didn't already do it.
+			if ((m_strFolderName.back() != '/') && (m_strFolderName.back() != '\\'))
+			{
+				m_strFolderName.append("/");
+			}
+		}
+
+		/// Destructor. All open files are written to disk and closed, but (unlike FilePager) they are not deleted.
+		virtual ~RegionFilePager()
+		{
+			std::lock_guard<std::mutex> lock(m_mutexRegionFiles);
+			for (auto iter = m_mapRegionFiles.begin(); iter != m_mapRegionFiles.end(); iter++)
+			{
+				std::lock_guard<std::mutex> fileLock(iter->second->mutex);
+				closeRegionFile(*(iter->second));
+			}
+			m_mapRegionFiles.clear();
+		}
+
+		virtual void pageIn(const Region& region, typename PagedVolume<VoxelType>::Chunk* pChunk)
+		{
+			POLYVOX_ASSERT(pChunk, "Attempting to page in NULL chunk");
+			POLYVOX_ASSERT(pChunk->getData(), "Chunk must have valid data");
+
+			std::unique_lock<std::mutex> lock;
+			std::shared_ptr<RegionFile> pRegionFile = lockRegionFile(region, false, lock);
+			if (pRegionFile)
+			{
+				const uint32_t uChunkIndex = getChunkIndex(region);
+				if (readChunk(*pRegionFile, uChunkIndex, pChunk))
+				{
+					POLYVOX_LOG_TRACE("Paged in data for ", region);
+					return;
+				}
+
+				// The record was damaged, so see whether an older version of the chunk can be found instead.
+				if (pRegionFile->vecRecordOffsets[uChunkIndex] != 0)
+				{
+					POLYVOX_LOG_WARNING("Data for ", region, " in '", pRegionFile->strFilename, "' is corrupt, attempting to recover it.");
+					rebuildIndex(*pRegionFile);
+					if (readChunk(*pRegionFile, uChunkIndex, pChunk))
+					{
+						return;
+					}
+					POLYVOX_LOG_WARNING("Unable to recover data for ", region, ".");
+				}
+			}
+
+			POLYVOX_LOG_TRACE("No data found for ", region, " during paging in.");
+
+			uint32_t noOfVoxels = region.getWidthInVoxels() * region.getHeightInVoxels() * region.getDepthInVoxels();
+			std::fill(pChunk->getData(), pChunk->getData() + noOfVoxels, VoxelType());
+		}
+
+		virtual void pageOut(const Region& region, typename PagedVolume<VoxelType>::Chunk* pChunk)
+		{
+			POLYVOX_ASSERT(pChunk, "Attempting to page out NULL chunk");
+			POLYVOX_ASSERT(pChunk->getData(), "Chunk must have valid data");
+
+			POLYVOX_LOG_TRACE("Paging out data for ", region);
+
+			// Chunks in which every voxel is the same only need to store that one value.
+			const VoxelType* pData = pChunk->getData();
+			const uint32_t uNoOfVoxels = pChunk->getDataSizeInBytes() / sizeof(VoxelType);
+			const bool bUniform = std::find_if(pData, pData + uNoOfVoxels, [&](const VoxelType& tValue) { return !(tValue == pData[0]); }) == pData + uNoOfVoxels;
+
+			// Compress the data before locking the file, so that other chunks in it can be paged in and out meanwhile.
+			std::vector<uint8_t> vecEncodedData;
+			const bool bEncode = !bUniform && m_pCodec;
+			if (bEncode)
+			{
+				m_pCodec->encode(pData, uNoOfVoxels, vecEncodedData);
+			}
+
+			std::unique_lock<std::mutex> lock;
+			std::shared_ptr<RegionFile> pRegionFile = lockRegionFile(region, true, lock);
+
+			if (bUniform)
+			{
+				appendRecord(*pRegionFile, getChunkIndex(region), RecordTypeUniform, 0, pChunk->getDataSizeInBytes(), reinterpret_cast<const uint8_t*>(pData), sizeof(VoxelType));
+			}
+			else if (bEncode)
+			{
+				appendRecord(*pRegionFile, getChunkIndex(region), RecordTypeEncoded, m_pCodec->getId(), pChunk->getDataSizeInBytes(),
+					vecEncodedData.data(), static_cast<uint32_t>(vecEncodedData.size()));
+			}
+			else
+			{
+				appendRecord(*pRegionFile, getChunkIndex(region), RecordTypeVoxels, 0, pChunk->getDataSizeInBytes(), reinterpret_cast<const uint8_t*>(pData), pChunk->getDataSizeInBytes());
+			}
+
+			// Compact the file once most of it is taken up by old versions of chunks.
+			const uint64_t uUnusedSizeInBytes = pRegionFile->uDataEnd - getDataStart() - pRegionFile->uUsedSizeInBytes;
+			if ((uUnusedSizeInBytes > pRegionFile->uUsedSizeInBytes) && (uUnusedSizeInBytes >= uMinCompactionSizeInBytes))
+			{
+				compactRegionFile(*pRegionFile);
+			}
+		}
+
+		virtual bool isRegionUniform(const Region& region, VoxelType& tValue)
+		{
+			std::unique_lock<std::mutex> lock;
+			std::shared_ptr<RegionFile> pRegionFile = lockRegionFile(region, false, lock);
+
+			const uint64_t uOffset = pRegionFile ? pRegionFile->vecRecordOffsets[getChunkIndex(region)] : 0;
+			if (uOffset == 0)
+			{
+				// Chunks which have never been paged out are filled with the default value by pageIn().
+				tValue = VoxelType();
+				return true;
+			}
+
+			RecordHeader header;
+			memcpy(&header, pRegionFile->file.getData() + uOffset, sizeof(header));
+			const uint8_t* pPayload = pRegionFile->file.getData() + uOffset + sizeof(header);
+			if ((header.uType != RecordTypeUniform) || (calculateChecksum(pPayload, header.uPayloadSizeInBytes) != header.uChecksum))
+			{
+				// Damaged records are dealt with by pageIn().
+				return false;
+			}
+
+			memcpy(&tValue, pPayload, sizeof(VoxelType));
+			return true;
+		}
+
+		/// Blocks until all data which has been paged out has been written to disk.
+		void flush(void)
+		{
+			std::lock_guard<std::mutex> lock(m_mutexRegionFiles);
+			for (auto iter = m_mapRegionFiles.begin(); iter != m_mapRegionFiles.end(); iter++)
+			{
+				std::lock_guard<std::mutex> fileLock(iter->second->mutex);
+				iter->second->file.flush(0, iter->second->uDataEnd);
+			}
+		}
+
+		/// Reclaims the space used by old versions of chunks in all currently open region files.
+		void compact(void)
+		{
+			std::lock_guard<std::mutex> lock(m_mutexRegionFiles);
+			for (auto iter = m_mapRegionFiles.begin(); iter != m_mapRegionFiles.end(); iter++)
+			{
+				std::lock_guard<std::mutex> fileLock(iter->second->mutex);
+				compactRegionFile(*(iter->second));
+			}
+		}
+
+		/// Gets the name of the region file which holds the chunk covering the given region.
+		std::string getRegionFilename(const Region& region) const
+		{
+			const Vector3DInt32 v3dRegionFilePos = getRegionFilePosition(region);
+
+			std::stringstream ssFilename;
+			ssFilename << m_strFolderName << "region_" << v3dRegionFilePos.getX() << "_" << v3dRegionFilePos.getY() << "_" << v3dRegionFilePos.getZ() << ".pvr";
+			return ssFilename.str();
+		}
+
+	private:
+		static const uint32_t uFileVersion = 2;
+		static const uint32_t uRecordMagic = 0x4B435650; // 'PVCK' when stored little-endian.
+
+		enum RecordType
+		{
+			RecordTypeVoxels = 0,
+			RecordTypeUniform = 1,
+			RecordTypeEncoded = 2
+		};
+
+		// Files are grown in large steps, as this requires them to be mapped again. They are trimmed again when closed.
+		static const uint64_t uMinFileGrowthInBytes = 1024 * 1024;
+		// Small amounts of unused space are not worth compacting.
+		static const uint64_t uMinCompactionSizeInBytes = 256 * 1024;
+
+		// The file starts with this header, followed by the index (the offset of each chunk's record, or zero if it
+		// has not been stored) and then the records themselves. Each record is a header followed by the payload.
+		struct FileHeader
+		{
+			char acMagic[4];
+			uint32_t uVersion;
+			uint32_t uChunkSideLength;
+			uint32_t uVoxelSizeInBytes;
+			uint32_t uRegionSideLengthInChunks;
+			uint32_t uReserved;
+		};
+
+		// The codec is zero unless the payload was encoded, and the decoded size is the size of the chunk's data.
+		struct RecordHeader
+		{
+			uint32_t uMagic;
+			uint32_t uChunkIndex;
+			uint32_t uType;
+			uint32_t uCodecId;
+			uint32_t uDecodedSizeInBytes;
+			uint32_t uPayloadSizeInBytes;
+			uint32_t uChecksum;
+			uint32_t uReserved;
+		};
+
+		struct RegionFile
+		{
+			// Held while the file is being accessed, as it may be mapped again (invalidating any pointers into it).
+			std::mutex mutex;
+			std::string strFilename;
+			MemoryMappedFile file;
+			bool bClosed;
+			uint32_t uLastAccessed;
+
+			// A copy of the index in the file, plus the position after the last record and the size of the records it refers to.
+			std::vector<uint64_t> vecRecordOffsets;
+			uint64_t uDataEnd;
+			uint64_t uUsedSizeInBytes;
+		};
+
+		uint32_t getNoOfChunksPerFile(void) const
+		{
+			return m_uRegionSideLengthInChunks * m_uRegionSideLengthInChunks * m_uRegionSideLengthInChunks;
+		}
+
+		uint64_t getDataStart(void) const
+		{
+			return sizeof(FileHeader) + getNoOfChunksPerFile() * sizeof(uint64_t);
+		}
+
+		static int32_t floorDivide(int32_t iValue, int32_t iDivisor)
+		{
+			return (iValue >= 0) ? (iValue / iDivisor) : -((-iValue + iDivisor - 1) / iDivisor);
+		}
+
+		Vector3DInt32 getChunkPosition(const Region& region) const
+		{
+			const int32_t iChunkSideLength = region.getWidthInVoxels();
+			return Vector3DInt32(floorDivide(region.getLowerX(), iChunkSideLength), floorDivide(region.getLowerY(), iChunkSideLength), floorDivide(region.getLowerZ(), iChunkSideLength));
+		}
+
+		Vector3DInt32 getRegionFilePosition(const Region& region) const
+		{
+			const Vector3DInt32 v3dChunkPos = getChunkPosition(region);
+			const int32_t iSideLength = m_uRegionSideLengthInChunks;
+			return Vector3DInt32(floorDivide(v3dChunkPos.getX(), iSideLength), floorDivide(v3dChunkPos.getY(), iSideLength), floorDivide(v3dChunkPos.getZ(), iSideLength));
+		}
+
+		uint32_t getChunkIndex(const Region& region) const
+		{
+			const int32_t iSideLength = m_uRegionSideLengthInChunks;
+			const Vector3DInt32 v3dLocalPos = getChunkPosition(region) - getRegionFilePosition(region) * iSideLength;
+			return v3dLocalPos.getX() + (v3dLocalPos.getY() + v3dLocalPos.getZ() * iSideLength) * iSideLength;
+		}
+
+		// Finds (or opens) the region file containing the given chunk and locks it. If the file does not exist
+		// and 'bCreate' is false then a null pointer is returned, and the lock is not taken.
+		std::shared_ptr<RegionFile> lockRegionFile(const Region& region, bool bCreate, std::unique_lock<std::mutex>& lock)
+		{
+			const std::string strFilename = getRegionFilename(region);
+
+			// Another thread can close the file (to make room for others) between us finding it and locking it, in which case we try again.
+			while (true)
+			{
+				std::shared_ptr<RegionFile> pRegionFile;
+				{
+					std::lock_guard<std::mutex> mapLock(m_mutexRegionFiles);
+					auto iter = m_mapRegionFiles.find(strFilename);
+					if (iter != m_mapRegionFiles.end())
+					{
+						pRegionFile = iter->second;
+					}
+					else
+					{
+						pRegionFile = openRegionFile(strFilename, region.getWidthInVoxels(), bCreate);
+						if (!pRegionFile)
+						{
+							return nullptr;
+						}
+
+						// Closing a file requires its lock, which is always taken after the lock on the map.
+						if (m_mapRegionFiles.size() >= m_uMaxNoOfOpenFiles)
+						{
+							auto oldest = std::min_element(m_mapRegionFiles.begin(), m_mapRegionFiles.end(),
+								[](const typename RegionFileMap::value_type& a, const typename RegionFileMap::value_type& b) { return a.second->uLastAccessed < b.second->uLastAccessed; });
+							std::lock_guard<std::mutex> fileLock(oldest->second->mutex);
+							closeRegionFile(*(oldest->second));
+							m_mapRegionFiles.erase(oldest);
+						}
+						m_mapRegionFiles[strFilename] = pRegionFile;
+					}
+					pRegionFile->uLastAccessed = ++m_uTimestamper;
+				}
+
+				lock = std::unique_lock<std::mutex>(pRegionFile->mutex);
+				if (!pRegionFile->bClosed)
+				{
+					return pRegionFile;
+				}
+				lock.unlock();
+			}
+		}
+
+		std::shared_ptr<RegionFile> openRegionFile(const std::string& strFilename, uint32_t uChunkSideLength, bool bCreate)
+		{
+			std::shared_ptr<RegionFile> pRegionFile = std::make_shared<RegionFile>();
+			pRegionFile->strFilename = strFilename;
+			pRegionFile->bClosed = false;
+			pRegionFile->uLastAccessed = 0;
+			pRegionFile->vecRecordOffsets.assign(getNoOfChunksPerFile(), 0);
+			pRegionFile->uDataEnd = getDataStart();
+			pRegionFile->uUsedSizeInBytes = 0;
+
+			if (!pRegionFile->file.open(strFilename, bCreate))
+			{
+				return nullptr;
+			}
+
+			// Remove any partly written file left behind by a crash during compaction.
+			std::remove(getTemporaryFilename(strFilename).c_str());
+
+			FileHeader header;
+			memcpy(header.acMagic, "PVRF", sizeof(header.acMagic));
+			header.uVersion = uFileVersion;
+			header.uChunkSideLength = uChunkSideLength;
+			header.uVoxelSizeInBytes = sizeof(VoxelType);
+			header.uRegionSideLengthInChunks = m_uRegionSideLengthInChunks;
+			header.uReserved = 0;
+
+			if (pRegionFile->file.getSizeInBytes() < sizeof(FileHeader))
+			{
+				// A new file (or one which was created but never written), so give it an empty index.
+				pRegionFile->file.resize(getDataStart());
+				memcpy(pRegionFile->file.getData(), &header, sizeof(header));
+				return pRegionFile;
+			}
+
+			FileHeader existingHeader;
+			memcpy(&existingHeader, pRegionFile->file.getData(), sizeof(existingHeader));
+			POLYVOX_THROW_IF(memcmp(existingHeader.acMagic, header.acMagic, sizeof(header.acMagic)) != 0, std::runtime_error, "'", strFilename, "' is not a region file.");
+			POLYVOX_THROW_IF(existingHeader.uVersion != header.uVersion, std::runtime_error, "'", strFilename, "' has an unsupported version.");
+			POLYVOX_THROW_IF((existingHeader.uChunkSideLength != header.uChunkSideLength) || (existingHeader.uVoxelSizeInBytes != header.uVoxelSizeInBytes) ||
+				(existingHeader.uRegionSideLengthInChunks != header.uRegionSideLengthInChunks), std::runtime_error, "'", strFilename, "' was written with different settings.");
+
+			if (pRegionFile->file.getSizeInBytes() < getDataStart())
+			{
+				pRegionFile->file.resize(getDataStart());
+			}
+
+			// Read the index, checking the records it refers to look sensible. Their checksums are only checked when they are paged in.
+			memcpy(&(pRegionFile->vecRecordOffsets[0]), pRegionFile->file.getData() + sizeof(FileHeader), getNoOfChunksPerFile() * sizeof(uint64_t));
+			for (uint32_t uChunkIndex = 0; uChunkIndex < getNoOfChunksPerFile(); uChunkIndex++)
+			{
+				const uint64_t uOffset = pRegionFile->vecRecordOffsets[uChunkIndex];
+				uint64_t uRecordSizeInBytes = 0;
+				if ((uOffset != 0) && !checkRecord(*pRegionFile, uOffset, uChunkIndex, false, uRecordSizeInBytes))
+				{
+					POLYVOX_LOG_WARNING("The index of '", strFilename, "' is corrupt, attempting to rebuild it.");
+					rebuildIndex(*pRegionFile);
+					break;
+				}
+				pRegionFile->uDataEnd = (std::max)(pRegionFile->uDataEnd, uOffset + uRecordSizeInBytes);
+				pRegionFile->uUsedSizeInBytes += uRecordSizeInBytes;
+			}
+
+			return pRegionFile;
+		}
+
+		void closeRegionFile(RegionFile& regionFile)
+		{
+			// Remove the space which was reserved for future records.
+			regionFile.file.resize(regionFile.uDataEnd);
+			regionFile.file.flush();
+			regionFile.file.close();
+			regionFile.bClosed = true;
+		}
+
+		static std::string getTemporaryFilename(const std::string& strFilename)
+		{
+			return strFilename + ".tmp";
+		}
+
+		// Checks that a record is within the file and belongs to the given chunk, and optionally that its checksum matches.
+		bool checkRecord(const RegionFile& regionFile, uint64_t uOffset, uint32_t uChunkIndex, bool bCheckPayload, uint64_t& uRecordSizeInBytes) const
+		{
+			const uint64_t uFileSizeInBytes = regionFile.file.getSizeInBytes();
+			if ((uOffset < getDataStart()) || (uOffset + sizeof(RecordHeader) > uFileSizeInBytes))
+			{
+				return false;
+			}
+
+			RecordHeader header;
+			memcpy(&header, regionFile.file.getData() + uOffset, sizeof(header));
+			if ((header.uMagic != uRecordMagic) || (header.uChunkIndex != uChunkIndex) || (uOffset + sizeof(RecordHeader) + header.uPayloadSizeInBytes > uFileSizeInBytes))
+			{
+				return false;
+			}
+
+			bool bValidType = false;
+			switch (header.uType)
+			{
+			case RecordTypeVoxels:
+				bValidType = (header.uCodecId == 0) && (header.uPayloadSizeInBytes == header.uDecodedSizeInBytes);
+				break;
+			case RecordTypeUniform:
+				bValidType = (header.uCodecId == 0) && (header.uPayloadSizeInBytes == sizeof(VoxelType));
+				break;
+			case RecordTypeEncoded:
+				bValidType = (header.uCodecId != 0);
+				break;
+			}
+			if (!bValidType || (header.uDecodedSizeInBytes % sizeof(VoxelType) != 0))
+			{
+				return false;
+			}
+
+			if (bCheckPayload && (calculateChecksum(regionFile.file.getData() + uOffset + sizeof(RecordHeader), header.uPayloadSizeInBytes) != header.uChecksum))
+			{
+				return false;
+			}
+
+			uRecordSizeInBytes = sizeof(RecordHeader) + header.uPayloadSizeInBytes;
+			return true;
+		}
+
+		// Recreates the index by scanning through the records. They were all appended in order, so later versions of a chunk
+		// replace earlier ones. A damaged record may be followed by valid ones (its size cannot be trusted, so the next record
+		// is found by searching for a valid header with a matching checksum), and the data ends after the last valid record.
+		void rebuildIndex(RegionFile& regionFile)
+		{
+			std::fill(regionFile.vecRecordOffsets.begin(), regionFile.vecRecordOffsets.end(), 0);
+			std::vector<uint64_t> vecRecordSizes(getNoOfChunksPerFile(), 0);
+
+			uint64_t uDataEnd = getDataStart();
+			uint64_t uOffset = getDataStart();
+			while (uOffset + sizeof(RecordHeader) <= regionFile.file.getSizeInBytes())
+			{
+				RecordHeader header;
+				memcpy(&header, regionFile.file.getData() + uOffset, sizeof(header));
+
+				uint64_t uRecordSizeInBytes = 0;
+				if ((header.uMagic != uRecordMagic) || (header.uChunkIndex >= getNoOfChunksPerFile()) || !checkRecord(regionFile, uOffset, header.uChunkIndex, true, uRecordSizeInBytes))
+				{
+					uOffset++;
+					continue;
+				}
+
+				regionFile.vecRecordOffsets[header.uChunkIndex] = uOffset;
+				vecRecordSizes[header.uChunkIndex] = uRecordSizeInBytes;
+				uOffset += uRecordSizeInBytes;
+				uDataEnd = uOffset;
+			}
+
+			regionFile.uDataEnd = uDataEnd;
+			regionFile.uUsedSizeInBytes = 0;
+			for (uint32_t uChunkIndex = 0; uChunkIndex < getNoOfChunksPerFile(); uChunkIndex++)
+			{
+				regionFile.uUsedSizeInBytes += vecRecordSizes[uChunkIndex];
+			}
+
+			memcpy(regionFile.file.getData() + sizeof(FileHeader), &(regionFile.vecRecordOffsets[0]), getNoOfChunksPerFile() * sizeof(uint64_t));
+			regionFile.file.flush(0, getDataStart());
+		}
+
+		bool readChunk(const RegionFile& regionFile, uint32_t uChunkIndex, typename PagedVolume<VoxelType>::Chunk* pChunk) const
+		{
+			const uint64_t uOffset = regionFile.vecRecordOffsets[uChunkIndex];
+			uint64_t uRecordSizeInBytes = 0;
+			if ((uOffset == 0) || !checkRecord(regionFile, uOffset, uChunkIndex, true, uRecordSizeInBytes))
+			{
+				return false;
+			}
+
+			RecordHeader header;
+			memcpy(&header, regionFile.file.getData() + uOffset, sizeof(header));
+			const uint8_t* pPayload = regionFile.file.getData() + uOffset + sizeof(header);
+			const uint32_t uNoOfVoxels = pChunk->getDataSizeInBytes() / sizeof(VoxelType);
+			POLYVOX_THROW_IF(header.uDecodedSizeInBytes != pChunk->getDataSizeInBytes(), std::runtime_error, "Chunk in '", regionFile.strFilename, "' has the wrong size.");
+
+			switch (header.uType)
+			{
+			case RecordTypeUniform:
+				{
+					VoxelType tValue;
+					memcpy(&tValue, pPayload, sizeof(VoxelType));
+					std::fill(pChunk->getData(), pChunk->getData() + uNoOfVoxels, tValue);
+				}
+				break;
+			case RecordTypeEncoded:
+				POLYVOX_THROW_IF(!m_pCodec || (header.uCodecId != m_pCodec->getId()), std::runtime_error, "Chunk in '", regionFile.strFilename, "' was written with a different codec.");
+				m_pCodec->decode(pPayload, header.uPayloadSizeInBytes, pChunk->getData(), uNoOfVoxels);
+				break;
+			default:
+				memcpy(pChunk->getData(), pPayload, header.uPayloadSizeInBytes);
+				break;
+			}
+			return true;
+		}
+
+		void appendRecord(RegionFile& regionFile, uint32_t uChunkIndex, RecordType eType, uint32_t uCodecId, uint32_t uDecodedSizeInBytes, const uint8_t* pPayload, uint32_t uPayloadSizeInBytes)
+		{
+			const uint64_t uOffset = regionFile.uDataEnd;
+			const uint64_t uRecordSizeInBytes = sizeof(RecordHeader) + uPayloadSizeInBytes;
+			if (uOffset + uRecordSizeInBytes > regionFile.file.getSizeInBytes())
+			{
+				const uint64_t uFileSizeInBytes = regionFile.file.getSizeInBytes();
+				regionFile.file.resize((std::max)(uOffset + uRecordSizeInBytes, uFileSizeInBytes + (std::max)(uFileSizeInBytes / 2, static_cast<uint64_t>(uMinFileGrowthInBytes))));
+			}
+
+			RecordHeader header;
+			header.uMagic = uRecordMagic;
+			header.uChunkIndex = uChunkIndex;
+			header.uType = eType;
+			header.uCodecId = uCodecId;
+			header.uDecodedSizeInBytes = uDecodedSizeInBytes;
+			header.uPayloadSizeInBytes = uPayloadSizeInBytes;
+			header.uChecksum = calculateChecksum(pPayload, uPayloadSizeInBytes);
+			header.uReserved = 0;
+			memcpy(regionFile.file.getData() + uOffset, &header, sizeof(header));
+			memcpy(regionFile.file.getData() + uOffset + sizeof(header), pPayload, uPayloadSizeInBytes);
+
+			// The pages of the mapping can reach the disk in any order, so the record must be written out before the index
+			// refers to it. Otherwise a crash could leave the index pointing at a record which was never written.
+			regionFile.file.flush(uOffset, uRecordSizeInBytes);
+
+			// The previous version of the chunk (if any) is left in place until the file is compacted.
+			uint64_t uOldRecordSizeInBytes = 0;
+			const uint64_t uOldOffset = regionFile.vecRecordOffsets[uChunkIndex];
+			if ((uOldOffset != 0) && checkRecord(regionFile, uOldOffset, uChunkIndex, false, uOldRecordSizeInBytes))
+			{
+				regionFile.uUsedSizeInBytes -= uOldRecordSizeInBytes;
+			}
+
+			// Only now that the record is complete do we point the index at it.
+			regionFile.vecRecordOffsets[uChunkIndex] = uOffset;
+			memcpy(regionFile.file.getData() + sizeof(FileHeader) + uChunkIndex * sizeof(uint64_t), &uOffset, sizeof(uOffset));
+			regionFile.uDataEnd = uOffset + uRecordSizeInBytes;
+			regionFile.uUsedSizeInBytes += uRecordSizeInBytes;
+		}
+
+		// Copies the current version of each chunk into a new file, which then replaces the existing one.
+		void compactRegionFile(RegionFile& regionFile)
+		{
+			if (regionFile.uDataEnd == getDataStart() + regionFile.uUsedSizeInBytes)
+			{
+				return;
+			}
+
+			const std::string strTemporaryFilename = getTemporaryFilename(regionFile.strFilename);
+			std::vector<uint64_t> vecRecordOffsets(getNoOfChunksPerFile(), 0);
+			{
+				MemoryMappedFile compactedFile;
+				compactedFile.open(strTemporaryFilename, true);
+				compactedFile.resize(getDataStart() + regionFile.uUsedSizeInBytes);
+				memcpy(compactedFile.getData(), regionFile.file.getData(), sizeof(FileHeader));
+
+				uint64_t uOffset = getDataStart();
+				for (uint32_t uChunkIndex = 0; uChunkIndex < getNoOfChunksPerFile(); uChunkIndex++)
+				{
+					uint64_t uRecordSizeInBytes = 0;
+					const uint64_t uOldOffset = regionFile.vecRecordOffsets[uChunkIndex];
+					if ((uOldOffset != 0) && checkRecord(regionFile, uOldOffset, uChunkIndex, false, uRecordSizeInBytes))
+					{
+						memcpy(compactedFile.getData() + uOffset, regionFile.file.getData() + uOldOffset, static_cast<size_t>(uRecordSizeInBytes));
+						vecRecordOffsets[uChunkIndex] = uOffset;
+						uOffset += uRecordSizeInBytes;
+					}
+				}
+
+				memcpy(compactedFile.getData() + sizeof(FileHeader), &(vecRecordOffsets[0]), getNoOfChunksPerFile() * sizeof(uint64_t));
+
+				// The new file must be completely written before it replaces the old one.
+				compactedFile.flush();
+			}
+
+			regionFile.file.close();
+			MemoryMappedFile::replaceFile(strTemporaryFilename, regionFile.strFilename);
+			regionFile.file.open(regionFile.strFilename, false);
+
+			regionFile.vecRecordOffsets.swap(vecRecordOffsets);
+			regionFile.uDataEnd = regionFile.file.getSizeInBytes();
+
+			POLYVOX_LOG_TRACE("Compacted '", regionFile.strFilename, "'.");
+		}
+
+		typedef std::map< std::string, std::shared_ptr<RegionFile> > RegionFileMap;
+
+		std::string m_strFolderName;
+		uint32_t m_uRegionSideLengthInChunks;
+		uint32_t m_uMaxNoOfOpenFiles;
+		ChunkCodec<VoxelType>* m_pCodec;
+
+		// Chunks may be paged in and out from several threads at once.
+		RegionFileMap m_mapRegionFiles;
+		std::mutex m_mutexRegionFiles;
+		uint32_t m_uTimestamper;
+	};
+}
+
+#endif //__PolyVox_RegionFilePager_H__
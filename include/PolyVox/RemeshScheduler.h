@@ -0,0 +1,120 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_RemeshScheduler_H__
+#define __PolyVox_RemeshScheduler_H__
+
+#include "Region.h"
+#include "Vector.h"
+#include "VolumeChangeTracker.h"
+
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace PolyVox
+{
+	namespace MeshBlockTypes
+	{
+		/**
+		 * The surface extractor which is used for the mesh blocks, as this determines which voxels each mesh depends on.
+		 */
+		enum MeshBlockType
+		{
+			Cubic, ///< Meshes extracted with extractCubicMesh()
+			MarchingCubes ///< Meshes extracted with extractMarchingCubesMesh()
+		};
+	}
+	typedef MeshBlockTypes::MeshBlockType MeshBlockType;
+
+	/// Keeps track of which meshes need to be extracted again after a volume has been modified.
+	///
+	/// Large volumes are normally displayed as a number of meshes, each of which is extracted from a block of the volume. When some
+	/// voxels are modified it is not only the meshes of the blocks containing them which need to be extracted again, because each
+	/// extractor also looks at some voxels outside of its region:
+	///
+	///   - The cubic surface extractor compares each voxel with its neighbours on the negative side, so modifying a voxel on the upper
+	///     x, y or z face of a block also affects the next block along.
+	///   - The Marching Cubes extractor is given a region which extends one voxel into the next block along each axis, so that the
+	///     meshes join up, and computes the normals from the voxels on either side of each vertex. Modifying a voxel within one voxel of
+	///     the lower faces or two voxels of the upper faces of a block therefore also affects the neighbouring blocks.
+	///
+	/// The RemeshScheduler applies these rules to the changes recorded by a VolumeChangeTracker, and keeps the set of blocks which need
+	/// to be extracted again. Each block is only recorded once no matter how many changes affect it, so a number of edits can be made
+	/// before processing the blocks. The region to pass to the extractor for each block is given by getExtractionRegion().
+	///
+	/// Block positions are given in units of blocks, so the block at (1, 0, 0) begins at the voxel with an x position of the block
+	/// side length.
+	class RemeshScheduler
+	{
+	public:
+		/// Constructor for creating a scheduler. The block side length must be a power of two.
+		RemeshScheduler(MeshBlockType eMeshBlockType, uint16_t uBlockSideLength = 32);
+
+		/// Schedules the blocks which are affected by the changes recorded by the tracker, and clears the tracker.
+		void addChanges(VolumeChangeTracker& tracker);
+		/// Schedules the blocks which are affected by changing any of the voxels within the given Region.
+		void addChangedRegion(const Region& region);
+		/// Schedules the given block.
+		void addBlock(const Vector3DInt32& v3dBlock);
+		/// Schedules all the blocks which are at least partly within the given Region.
+		void addBlocksInRegion(const Region& region);
+
+		/// Determines whether the given block is scheduled.
+		bool isBlockPending(const Vector3DInt32& v3dBlock) const;
+		/// Gets the number of blocks which are scheduled.
+		uint32_t getNoOfPendingBlocks(void) const;
+		/// Removes up to the given number of blocks from the schedule and returns them.
+		std::vector<Vector3DInt32> takePendingBlocks(uint32_t uMaxNoOfBlocks = (std::numeric_limits<uint32_t>::max)());
+		/// Removes up to the given number of blocks from the schedule and calls the function with each of them.
+		template<typename Function>
+		uint32_t processPendingBlocks(Function func, uint32_t uMaxNoOfBlocks = (std::numeric_limits<uint32_t>::max)());
+
+		/// Gets the region which should be passed to the surface extractor for the given block.
+		Region getExtractionRegion(const Vector3DInt32& v3dBlock) const;
+		/// Gets the region containing all the voxels which the mesh of the given block depends on.
+		Region getDependencyRegion(const Vector3DInt32& v3dBlock) const;
+
+		/// Gets the type of meshes which the blocks are scheduled for.
+		MeshBlockType getMeshBlockType(void) const;
+		/// Gets the side length of the blocks.
+		uint16_t getBlockSideLength(void) const;
+
+	private:
+		MeshBlockType m_eMeshBlockType;
+		uint16_t m_uBlockSideLength;
+		uint8_t m_uBlockSideLengthPower;
+
+		// How far the dependency region of each block extends beyond the block on its lower and upper sides.
+		int32_t m_iLowerApron;
+		int32_t m_iUpperApron;
+
+		std::unordered_set<Vector3DInt32> m_setPendingBlocks;
+	};
+}
+
+#include "RemeshScheduler.inl"
+
+#endif //__PolyVox_RemeshScheduler_H__
@@ -0,0 +1,214 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+#include "Impl/Utility.h"
+
+#include <algorithm>
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param eMeshBlockType The surface extractor which is used for the meshes.
+	/// \param uBlockSideLength The side length of the blocks which the meshes are extracted from. This does not need to be
+	/// the same as the block side length of the VolumeChangeTracker, or the chunk side length of the volume.
+	////////////////////////////////////////////////////////////////////////////////
+	inline RemeshScheduler::RemeshScheduler(MeshBlockType eMeshBlockType, uint16_t uBlockSideLength)
+		:m_eMeshBlockType(eMeshBlockType)
+		, m_uBlockSideLength(uBlockSideLength)
+		, m_uBlockSideLengthPower(0)
+		, m_iLowerApron(1)
+		, m_iUpperApron(eMeshBlockType == MeshBlockTypes::MarchingCubes ? 2 : 0)
+	{
+		POLYVOX_THROW_IF(m_uBlockSideLength == 0, std::invalid_argument, "Block side length cannot be zero.");
+		POLYVOX_THROW_IF(!isPowerOf2(m_uBlockSideLength), std::invalid_argument, "Block side length must be a power of two.");
+
+		m_uBlockSideLengthPower = logBase2(m_uBlockSideLength);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param tracker The tracker which has recorded the changes to the volume. Its changes are taken (see
+	/// VolumeChangeTracker::takeChanges()), so the same tracker should not be used for more than one scheduler.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void RemeshScheduler::addChanges(VolumeChangeTracker& tracker)
+	{
+		const std::vector<Region> vecChanges = tracker.takeChanges();
+		for (auto iter = vecChanges.begin(); iter != vecChanges.end(); iter++)
+		{
+			addChangedRegion(*iter);
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// A block is scheduled if the Region overlaps the voxels which its mesh depends on (see getDependencyRegion()).
+	/// \param region The Region of voxels which may have been changed.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void RemeshScheduler::addChangedRegion(const Region& region)
+	{
+		for (int32_t z = (region.getLowerZ() - m_iUpperApron) >> m_uBlockSideLengthPower; z <= ((region.getUpperZ() + m_iLowerApron) >> m_uBlockSideLengthPower); z++)
+		{
+			for (int32_t y = (region.getLowerY() - m_iUpperApron) >> m_uBlockSideLengthPower; y <= ((region.getUpperY() + m_iLowerApron) >> m_uBlockSideLengthPower); y++)
+			{
+				for (int32_t x = (region.getLowerX() - m_iUpperApron) >> m_uBlockSideLengthPower; x <= ((region.getUpperX() + m_iLowerApron) >> m_uBlockSideLengthPower); x++)
+				{
+					m_setPendingBlocks.insert(Vector3DInt32(x, y, z));
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dBlock The position of the block, in units of blocks.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void RemeshScheduler::addBlock(const Vector3DInt32& v3dBlock)
+	{
+		m_setPendingBlocks.insert(v3dBlock);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is useful for extracting the meshes for the first time, e.g. by passing the enclosing region of a RawVolume.
+	/// \param region The Region of voxels whose blocks should be scheduled.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void RemeshScheduler::addBlocksInRegion(const Region& region)
+	{
+		for (int32_t z = region.getLowerZ() >> m_uBlockSideLengthPower; z <= (region.getUpperZ() >> m_uBlockSideLengthPower); z++)
+		{
+			for (int32_t y = region.getLowerY() >> m_uBlockSideLengthPower; y <= (region.getUpperY() >> m_uBlockSideLengthPower); y++)
+			{
+				for (int32_t x = region.getLowerX() >> m_uBlockSideLengthPower; x <= (region.getUpperX() >> m_uBlockSideLengthPower); x++)
+				{
+					m_setPendingBlocks.insert(Vector3DInt32(x, y, z));
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dBlock The position of the block, in units of blocks.
+	/// \return Whether the block is waiting to be processed.
+	////////////////////////////////////////////////////////////////////////////////
+	inline bool RemeshScheduler::isBlockPending(const Vector3DInt32& v3dBlock) const
+	{
+		return m_setPendingBlocks.find(v3dBlock) != m_setPendingBlocks.end();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of blocks which are waiting to be processed.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint32_t RemeshScheduler::getNoOfPendingBlocks(void) const
+	{
+		return static_cast<uint32_t>(m_setPendingBlocks.size());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The blocks are returned in order of their z position, then their y position and then their x position. Limiting the number
+	/// of blocks allows the work to be spread out, e.g. over a number of frames, and the remaining blocks stay scheduled.
+	/// \param uMaxNoOfBlocks The maximum number of blocks to return.
+	/// \return The positions of the blocks, in units of blocks.
+	////////////////////////////////////////////////////////////////////////////////
+	inline std::vector<Vector3DInt32> RemeshScheduler::takePendingBlocks(uint32_t uMaxNoOfBlocks)
+	{
+		std::vector<Vector3DInt32> vecBlocks(m_setPendingBlocks.begin(), m_setPendingBlocks.end());
+		std::sort(vecBlocks.begin(), vecBlocks.end(), [](const Vector3DInt32& a, const Vector3DInt32& b)
+		{
+			if (a.getZ() != b.getZ()) return a.getZ() < b.getZ();
+			if (a.getY() != b.getY()) return a.getY() < b.getY();
+			return a.getX() < b.getX();
+		});
+
+		if (vecBlocks.size() > uMaxNoOfBlocks)
+		{
+			vecBlocks.resize(uMaxNoOfBlocks);
+		}
+
+		for (auto iter = vecBlocks.begin(); iter != vecBlocks.end(); iter++)
+		{
+			m_setPendingBlocks.erase(*iter);
+		}
+
+		return vecBlocks;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The function is called as <tt>func(v3dBlock, region)</tt>, where \a region is the extraction region of the block (see
+	/// getExtractionRegion()), and would normally extract the mesh and replace the previous one for the block. The blocks are
+	/// removed from the schedule first, so the function may schedule further blocks.
+	/// \param func The function to call for each block.
+	/// \param uMaxNoOfBlocks The maximum number of blocks to process.
+	/// \return The number of blocks which were processed.
+	////////////////////////////////////////////////////////////////////////////////
+	template<typename Function>
+	uint32_t RemeshScheduler::processPendingBlocks(Function func, uint32_t uMaxNoOfBlocks)
+	{
+		const std::vector<Vector3DInt32> vecBlocks = takePendingBlocks(uMaxNoOfBlocks);
+		for (auto iter = vecBlocks.begin(); iter != vecBlocks.end(); iter++)
+		{
+			func(*iter, getExtractionRegion(*iter));
+		}
+
+		return static_cast<uint32_t>(vecBlocks.size());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// For cubic meshes this is just the block. For Marching Cubes meshes it extends one voxel further on the upper
+	/// sides, so that the meshes of neighbouring blocks join up.
+	/// \param v3dBlock The position of the block, in units of blocks.
+	/// \return The Region to pass to the surface extractor.
+	////////////////////////////////////////////////////////////////////////////////
+	inline Region RemeshScheduler::getExtractionRegion(const Vector3DInt32& v3dBlock) const
+	{
+		const int32_t iOverlap = (m_eMeshBlockType == MeshBlockTypes::MarchingCubes) ? 1 : 0;
+		const Vector3DInt32 v3dLowerCorner(v3dBlock.getX() << m_uBlockSideLengthPower, v3dBlock.getY() << m_uBlockSideLengthPower, v3dBlock.getZ() << m_uBlockSideLengthPower);
+		const int32_t iSize = m_uBlockSideLength - 1 + iOverlap;
+		return Region(v3dLowerCorner, v3dLowerCorner + Vector3DInt32(iSize, iSize, iSize));
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Changing any voxel within this Region can change the mesh of the block. See the class description for details.
+	/// \param v3dBlock The position of the block, in units of blocks.
+	/// \return The Region containing all the voxels which the surface extractor reads for the block.
+	////////////////////////////////////////////////////////////////////////////////
+	inline Region RemeshScheduler::getDependencyRegion(const Vector3DInt32& v3dBlock) const
+	{
+		const Vector3DInt32 v3dLowerCorner(v3dBlock.getX() << m_uBlockSideLengthPower, v3dBlock.getY() << m_uBlockSideLengthPower, v3dBlock.getZ() << m_uBlockSideLengthPower);
+		const int32_t iUpper = m_uBlockSideLength - 1 + m_iUpperApron;
+		return Region(v3dLowerCorner - Vector3DInt32(m_iLowerApron, m_iLowerApron, m_iLowerApron), v3dLowerCorner + Vector3DInt32(iUpper, iUpper, iUpper));
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The type of meshes which the blocks are scheduled for.
+	////////////////////////////////////////////////////////////////////////////////
+	inline MeshBlockType RemeshScheduler::getMeshBlockType(void) const
+	{
+		return m_eMeshBlockType;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The side length of the blocks.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint16_t RemeshScheduler::getBlockSideLength(void) const
+	{
+		return m_uBlockSideLength;
+	}
+}
@@ -0,0 +1,97 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#ifndef __PolyVox_VolumeChangeTracker_H__
+#define __PolyVox_VolumeChangeTracker_H__
+
+#include "Region.h"
+#include "Vector.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace PolyVox
+{
+	/// Records which parts of a volume have been modified, so that only the meshes which are affected by the changes
+	/// need to be extracted again. An instance can be attached to a RawVolume or PagedVolume with setChangeTracker(),
+	/// after which every call to setVoxel() is recorded. The changes are passed on to a RemeshScheduler, which works
+	/// out which meshes need to be extracted.
+	///
+	/// The volume is divided into blocks (which would normally match the chunks of a PagedVolume) and for each block
+	/// which has been modified the tracker keeps the Region bounding the voxels which were changed in it. This means
+	/// that an edit in the middle of a block can be distinguished from one which touches its faces, which is what
+	/// determines whether the meshes of the neighbouring blocks also need to be extracted again.
+	///
+	/// The tracker has its own lock, so it can be used with a PagedVolume which is being modified from several threads.
+	class VolumeChangeTracker
+	{
+	public:
+		/// Constructor for creating a tracker. The block side length must be a power of two.
+		VolumeChangeTracker(uint16_t uBlockSideLength = 32);
+
+		/// Records that the voxel at the given position has been changed.
+		void voxelChanged(int32_t iXPos, int32_t iYPos, int32_t iZPos);
+		/// Records that the voxel at the given position has been changed.
+		void voxelChanged(const Vector3DInt32& v3dPos);
+		/// Records that any of the voxels within the given Region may have been changed.
+		void regionChanged(const Region& region);
+
+		/// Determines whether any changes have been recorded since they were last taken.
+		bool hasChanges(void) const;
+		/// Gets the number of blocks which have been changed since the changes were last taken.
+		uint32_t getNoOfChangedBlocks(void) const;
+		/// Returns the Regions bounding the changed voxels in each block, and clears the recorded changes.
+		std::vector<Region> takeChanges(void);
+
+		/// Gets the side length of the blocks which the changes are recorded for.
+		uint16_t getBlockSideLength(void) const;
+
+	private:
+		/// Private copy constructor to prevent accidental copying
+		VolumeChangeTracker(const VolumeChangeTracker& /*rhs*/);
+
+		/// Private assignment operator to prevent accidental copying
+		VolumeChangeTracker& operator=(const VolumeChangeTracker& /*rhs*/);
+
+		// The caller must hold m_mutex.
+		void addChangedRegion(const Vector3DInt32& v3dBlock, const Region& region);
+
+		uint16_t m_uBlockSideLength;
+		uint8_t m_uBlockSideLengthPower;
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<Vector3DInt32, Region> m_mapChangedBlocks;
+
+		// Consecutive edits usually fall in the same block, so we keep track of the last one to avoid looking it up each time.
+		// Pointers to the elements of an unordered_map stay valid until they are erased, even if the map is rehashed.
+		Vector3DInt32 m_v3dLastChangedBlock;
+		Region* m_pLastChangedRegion;
+	};
+}
+
+#include "VolumeChangeTracker.inl"
+
+#endif //__PolyVox_VolumeChangeTracker_H__
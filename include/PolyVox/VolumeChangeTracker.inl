@@ -0,0 +1,158 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "Impl/ErrorHandling.h"
+#include "Impl/Utility.h"
+
+namespace PolyVox
+{
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param uBlockSideLength The side length of the blocks which the changes are recorded for. For a PagedVolume this
+	/// should normally be the chunk side length. Smaller blocks give more precise results for large edits, but use more memory.
+	////////////////////////////////////////////////////////////////////////////////
+	inline VolumeChangeTracker::VolumeChangeTracker(uint16_t uBlockSideLength)
+		:m_uBlockSideLength(uBlockSideLength)
+		, m_uBlockSideLengthPower(0)
+		, m_pLastChangedRegion(nullptr)
+	{
+		POLYVOX_THROW_IF(m_uBlockSideLength == 0, std::invalid_argument, "Block side length cannot be zero.");
+		POLYVOX_THROW_IF(!isPowerOf2(m_uBlockSideLength), std::invalid_argument, "Block side length must be a power of two.");
+
+		m_uBlockSideLengthPower = logBase2(m_uBlockSideLength);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// The volumes call this from setVoxel() when a tracker is attached to them, but it can also be called directly
+	/// (e.g. by a custom volume class, or when the data is modified by some other means).
+	/// \param iXPos The \c x position of the voxel
+	/// \param iYPos The \c y position of the voxel
+	/// \param iZPos The \c z position of the voxel
+	////////////////////////////////////////////////////////////////////////////////
+	inline void VolumeChangeTracker::voxelChanged(int32_t iXPos, int32_t iYPos, int32_t iZPos)
+	{
+		const Vector3DInt32 v3dBlock(iXPos >> m_uBlockSideLengthPower, iYPos >> m_uBlockSideLengthPower, iZPos >> m_uBlockSideLengthPower);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pLastChangedRegion && (v3dBlock == m_v3dLastChangedBlock))
+		{
+			m_pLastChangedRegion->accumulate(iXPos, iYPos, iZPos);
+			return;
+		}
+
+		addChangedRegion(v3dBlock, Region(iXPos, iYPos, iZPos, iXPos, iYPos, iZPos));
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \param v3dPos The 3D position of the voxel
+	////////////////////////////////////////////////////////////////////////////////
+	inline void VolumeChangeTracker::voxelChanged(const Vector3DInt32& v3dPos)
+	{
+		voxelChanged(v3dPos.getX(), v3dPos.getY(), v3dPos.getZ());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// This is cheaper than calling voxelChanged() for every voxel in the Region, and is intended for operations which modify
+	/// many voxels at once. The Region is split up between the blocks which it overlaps.
+	/// \param region The Region of voxels which may have been changed.
+	////////////////////////////////////////////////////////////////////////////////
+	inline void VolumeChangeTracker::regionChanged(const Region& region)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int32_t z = region.getLowerZ() >> m_uBlockSideLengthPower; z <= (region.getUpperZ() >> m_uBlockSideLengthPower); z++)
+		{
+			for (int32_t y = region.getLowerY() >> m_uBlockSideLengthPower; y <= (region.getUpperY() >> m_uBlockSideLengthPower); y++)
+			{
+				for (int32_t x = region.getLowerX() >> m_uBlockSideLengthPower; x <= (region.getUpperX() >> m_uBlockSideLengthPower); x++)
+				{
+					Region blockRegion(x << m_uBlockSideLengthPower, y << m_uBlockSideLengthPower, z << m_uBlockSideLengthPower,
+						((x + 1) << m_uBlockSideLengthPower) - 1, ((y + 1) << m_uBlockSideLengthPower) - 1, ((z + 1) << m_uBlockSideLengthPower) - 1);
+					blockRegion.cropTo(region);
+					addChangedRegion(Vector3DInt32(x, y, z), blockRegion);
+				}
+			}
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return Whether any changes have been recorded since they were last taken.
+	////////////////////////////////////////////////////////////////////////////////
+	inline bool VolumeChangeTracker::hasChanges(void) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return !m_mapChangedBlocks.empty();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The number of blocks which have been changed since the changes were last taken.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint32_t VolumeChangeTracker::getNoOfChangedBlocks(void) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return static_cast<uint32_t>(m_mapChangedBlocks.size());
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// Each of the returned Regions lies within a single block, and there is one for every block which has been changed.
+	/// They are not in any particular order.
+	/// \return The Regions bounding the voxels which have been changed since the changes were last taken.
+	////////////////////////////////////////////////////////////////////////////////
+	inline std::vector<Region> VolumeChangeTracker::takeChanges(void)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<Region> vecChanges;
+		vecChanges.reserve(m_mapChangedBlocks.size());
+		for (auto iter = m_mapChangedBlocks.begin(); iter != m_mapChangedBlocks.end(); iter++)
+		{
+			vecChanges.push_back(iter->second);
+		}
+
+		m_mapChangedBlocks.clear();
+		m_pLastChangedRegion = nullptr;
+		return vecChanges;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// \return The side length of the blocks which the changes are recorded for.
+	////////////////////////////////////////////////////////////////////////////////
+	inline uint16_t VolumeChangeTracker::getBlockSideLength(void) const
+	{
+		return m_uBlockSideLength;
+	}
+
+	inline void VolumeChangeTracker::addChangedRegion(const Vector3DInt32& v3dBlock, const Region& region)
+	{
+		auto iter = m_mapChangedBlocks.find(v3dBlock);
+		if (iter == m_mapChangedBlocks.end())
+		{
+			iter = m_mapChangedBlocks.insert(std::make_pair(v3dBlock, region)).first;
+		}
+		else
+		{
+			iter->second.accumulate(region);
+		}
+
+		m_v3dLastChangedBlock = v3dBlock;
+		m_pLastChangedRegion = &(iter->second);
+	}
+}
@@ -99,4 +99,61 @@ void TestAmbientOcclusionGenerator::testExecute()
 	//calculateAmbientOcclusion(&volData, &ambientOcclusionResult, volData.getEnclosingRegion(), 32.0f, 8, [](uint8_t voxel){return voxel == 0;});
 }
 
+// Fills the volume with scattered solid voxels.
+template<typename VolumeType>
+void fillWithScatteredVoxels(VolumeType& volData, const Region& region)
+{
+	uint32_t uSeed = 1;
+	for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				uSeed = uSeed * 1103515245 + 12345;
+				volData.setVoxel(x, y, z, ((uSeed >> 16) % 17 == 0) ? 1 : 0);
+			}
+		}
+	}
+}
+
+bool arraysMatch(Array<3, uint8_t>& array1, Array<3, uint8_t>& array2)
+{
+	const uint32_t uNoOfElements = array1.getDimension(0) * array1.getDimension(1) * array1.getDimension(2);
+	return std::equal(array1.getRawData(), array1.getRawData() + uNoOfElements, array2.getRawData());
+}
+
+void TestAmbientOcclusionGenerator::testParallel()
+{
+	const Region region(0, 0, 0, 47, 47, 47);
+	Array<3, uint8_t> serialResult(24, 24, 24);
+	Array<3, uint8_t> parallelResult(24, 24, 24);
+	IsVoxelTransparent isVoxelTransparent;
+
+	// The parallel version gives exactly the same results, with any number of threads.
+	RawVolume<uint8_t> rawVol(region);
+	fillWithScatteredVoxels(rawVol, region);
+	calculateAmbientOcclusion(&rawVol, &serialResult, region, 20.0f, 32, isVoxelTransparent);
+	for (uint32_t uNoOfThreads : { 0u, 1u, 3u, 100u })
+	{
+		calculateAmbientOcclusionParallel(&rawVol, &parallelResult, region, 20.0f, 32, isVoxelTransparent, uNoOfThreads);
+		QVERIFY(arraysMatch(serialResult, parallelResult));
+	}
+
+	// The same applies to a PagedVolume with concurrent access enabled, which also has no border.
+	FilePager<uint8_t> pager(".");
+	PagedVolume<uint8_t> pagedVol(&pager, 64 * 1024 * 1024, 16, true);
+	fillWithScatteredVoxels(pagedVol, region);
+	Array<3, uint8_t> pagedResult(24, 24, 24);
+	calculateAmbientOcclusion(&pagedVol, &pagedResult, region, 20.0f, 32, isVoxelTransparent);
+	calculateAmbientOcclusionParallel(&pagedVol, &parallelResult, region, 20.0f, 32, isVoxelTransparent, 4);
+	QVERIFY(arraysMatch(pagedResult, parallelResult));
+
+	// Voxels outside a RawVolume are transparent whatever its border value, so every ray in an empty volume is visible.
+	RawVolume<uint8_t> emptyVol(region);
+	emptyVol.setBorderValue(1);
+	calculateAmbientOcclusionParallel(&emptyVol, &parallelResult, region, 100.0f, 8, isVoxelTransparent, 2);
+	QCOMPARE(static_cast<int>(*std::min_element(parallelResult.getRawData(), parallelResult.getRawData() + 24 * 24 * 24)), 255);
+}
+
 QTEST_MAIN(TestAmbientOcclusionGenerator)
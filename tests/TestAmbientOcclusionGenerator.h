@@ -33,6 +33,7 @@ class TestAmbientOcclusionGenerator: public QObject
 	
 	private slots:
 		void testExecute();
+		void testParallel();
 };
 
 #endif
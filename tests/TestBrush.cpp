@@ -0,0 +1,282 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "TestBrush.h"
+
+#include "PolyVox/Brush.h"
+#include "PolyVox/FilePager.h"
+#include "PolyVox/PagedVolume.h"
+#include "PolyVox/RawVolume.h"
+#include "PolyVox/VolumeChangeTracker.h"
+
+#include <QtTest>
+
+#include <cmath>
+
+using namespace PolyVox;
+
+// Checks that the brush contains the expected voxels, and that they are all within its enclosing region.
+template <typename BrushType, typename ReferenceFunction>
+bool brushMatchesReference(const BrushType& brush, ReferenceFunction funcReference)
+{
+	const Region regEnclosing = brush.getEnclosingRegion();
+	Region regTest = regEnclosing;
+	regTest.grow(3);
+	for (int32_t z = regTest.getLowerZ(); z <= regTest.getUpperZ(); z++)
+	{
+		for (int32_t y = regTest.getLowerY(); y <= regTest.getUpperY(); y++)
+		{
+			for (int32_t x = regTest.getLowerX(); x <= regTest.getUpperX(); x++)
+			{
+				const bool bContained = brush.containsPoint(x, y, z);
+				if ((bContained != funcReference(x, y, z)) || (bContained && !regEnclosing.containsPoint(x, y, z)))
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void TestBrush::testBrushShapes()
+{
+	QVERIFY(brushMatchesReference(BoxBrush(Region(-3, 2, 5, 4, 2, 9)), [](int32_t x, int32_t y, int32_t z)
+	{
+		return (x >= -3) && (x <= 4) && (y == 2) && (z >= 5) && (z <= 9);
+	}));
+
+	SphereBrush sphere(Vector3DFloat(1.5f, -2.0f, 3.25f), 4.5f);
+	QVERIFY(sphere.containsPoint(1, -2, 3));
+	QVERIFY(!sphere.containsPoint(7, -2, 3));
+	QVERIFY(brushMatchesReference(sphere, [](int32_t x, int32_t y, int32_t z)
+	{
+		return (x - 1.5f) * (x - 1.5f) + (y + 2.0f) * (y + 2.0f) + (z - 3.25f) * (z - 3.25f) <= 4.5f * 4.5f;
+	}));
+
+	// An axis aligned cylinder is easy to check.
+	QVERIFY(brushMatchesReference(CylinderBrush(Vector3DFloat(0.0f, 0.0f, -5.0f), Vector3DFloat(0.0f, 0.0f, 5.0f), 3.0f), [](int32_t x, int32_t y, int32_t z)
+	{
+		return (x * x + y * y <= 9) && (z >= -5) && (z <= 5);
+	}));
+
+	// A diagonal one contains its ends and the points along its axis, but not the points beyond its ends.
+	CylinderBrush diagonalCylinder(Vector3DFloat(0.0f, 0.0f, 0.0f), Vector3DFloat(10.0f, 10.0f, 10.0f), 1.0f);
+	for (int32_t i = 0; i <= 10; i++)
+	{
+		QVERIFY(diagonalCylinder.containsPoint(i, i, i));
+	}
+	QVERIFY(!diagonalCylinder.containsPoint(-1, -1, -1));
+	QVERIFY(!diagonalCylinder.containsPoint(11, 11, 11));
+	QVERIFY(!diagonalCylinder.containsPoint(5, 5, 7));
+	QVERIFY(brushMatchesReference(diagonalCylinder, [](int32_t x, int32_t y, int32_t z)
+	{
+		// The distance from the line through the origin along (1, 1, 1), and the position along it.
+		const float fProjection = (x + y + z) / 3.0f;
+		const float fDistanceSquared = (x - fProjection) * (x - fProjection) + (y - fProjection) * (y - fProjection) + (z - fProjection) * (z - fProjection);
+		return (fProjection >= 0.0f) && (fProjection <= 10.0f) && (fDistanceSquared <= 1.0f);
+	}));
+
+	// A torus described by its signed distance function.
+	auto funcTorus = [](const Vector3DFloat& v3dPos)
+	{
+		const float fRingDistance = std::sqrt(v3dPos.getX() * v3dPos.getX() + v3dPos.getZ() * v3dPos.getZ()) - 6.0f;
+		return std::sqrt(fRingDistance * fRingDistance + v3dPos.getY() * v3dPos.getY()) - 2.0f;
+	};
+	auto torus = makeSdfBrush(Region(-8, -2, -8, 8, 2, 8), funcTorus);
+	QVERIFY(torus.containsPoint(6, 0, 0));
+	QVERIFY(!torus.containsPoint(0, 0, 0));
+	QVERIFY(brushMatchesReference(torus, [&funcTorus](int32_t x, int32_t y, int32_t z)
+	{
+		return funcTorus(Vector3DFloat(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z))) <= 0.0f;
+	}));
+}
+
+// Fills the region with a pattern which leaves some chunks uniform and others with just a few different values.
+template <typename VolumeType>
+void createPattern(VolumeType& volume, const Region& region)
+{
+	for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, (y < 0) ? ((x >> 3) + (z >> 3)) & 3 : 0);
+			}
+		}
+	}
+}
+
+// Applies a number of brushes to the volume, and checks that it ends up the same as a RawVolume which was edited one voxel at a
+// time. The returned Regions and the Regions recorded by the tracker must both contain every voxel which was changed.
+template <typename VolumeType>
+bool applyBrushesMatchesReference(VolumeType& volume, const Region& regTest)
+{
+	RawVolume<uint8_t> reference(regTest);
+	createPattern(volume, regTest);
+	createPattern(reference, regTest);
+
+	VolumeChangeTracker tracker(16);
+	volume.setChangeTracker(&tracker);
+
+	SphereBrush sphere(Vector3DFloat(3.5f, 1.0f, -4.0f), 9.0f);
+	CylinderBrush cylinder(Vector3DFloat(-20.0f, -10.0f, -15.0f), Vector3DFloat(25.0f, 8.0f, 20.0f), 4.0f);
+	BoxBrush box(Region(-30, -30, -30, 30, -20, 0));
+	auto wave = makeSdfBrush(regTest, [](const Vector3DFloat& v3dPos) { return v3dPos.getY() - 4.0f * std::sin(v3dPos.getX() * 0.2f); });
+
+	std::vector<std::vector<Region> > vecChangedRegions;
+	vecChangedRegions.push_back(applyBrush(&volume, sphere, 5));
+	vecChangedRegions.push_back(applyBrush(&volume, cylinder, 0));
+	vecChangedRegions.push_back(applyBrush(&volume, box, 7));
+	vecChangedRegions.push_back(applyBrush(&volume, wave, 1));
+
+	vecChangedRegions.push_back(applyBrush(&volume, sphere, 1));
+
+	// Applying the same brush again does not change anything.
+	if (!applyBrush(&volume, sphere, 1).empty())
+	{
+		return false;
+	}
+
+	volume.setChangeTracker(nullptr);
+	const std::vector<Region> vecTrackedRegions = tracker.takeChanges();
+
+	// The reference is edited one voxel at a time.
+	uint8_t arrayValues[] = { 5, 0, 7, 1, 1 };
+	for (uint32_t uEdit = 0; uEdit < 5; uEdit++)
+	{
+		for (int32_t z = regTest.getLowerZ(); z <= regTest.getUpperZ(); z++)
+		{
+			for (int32_t y = regTest.getLowerY(); y <= regTest.getUpperY(); y++)
+			{
+				for (int32_t x = regTest.getLowerX(); x <= regTest.getUpperX(); x++)
+				{
+					const bool bContained =
+						(uEdit == 0) ? sphere.containsPoint(x, y, z) :
+						(uEdit == 1) ? cylinder.containsPoint(x, y, z) :
+						(uEdit == 2) ? box.containsPoint(x, y, z) :
+						(uEdit == 3) ? wave.containsPoint(x, y, z) : sphere.containsPoint(x, y, z);
+					if (!bContained)
+					{
+						continue;
+					}
+
+					const uint8_t uOldValue = reference.getVoxel(x, y, z);
+					reference.setVoxel(x, y, z, arrayValues[uEdit]);
+					if (uOldValue == arrayValues[uEdit])
+					{
+						continue;
+					}
+
+					// The change must be reported both by applyBrush() and by the tracker.
+					bool bReported = false;
+					for (const Region& region : vecChangedRegions[uEdit])
+					{
+						bReported = bReported || region.containsPoint(x, y, z);
+					}
+					bool bTracked = false;
+					for (const Region& region : vecTrackedRegions)
+					{
+						bTracked = bTracked || region.containsPoint(x, y, z);
+					}
+					if (!bReported || !bTracked)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+
+	for (int32_t z = regTest.getLowerZ(); z <= regTest.getUpperZ(); z++)
+	{
+		for (int32_t y = regTest.getLowerY(); y <= regTest.getUpperY(); y++)
+		{
+			for (int32_t x = regTest.getLowerX(); x <= regTest.getUpperX(); x++)
+			{
+				if (volume.getVoxel(x, y, z) != reference.getVoxel(x, y, z))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void TestBrush::testApplyBrushRawVolume()
+{
+	// Parts of the brushes are outside the volume, and these are ignored.
+	const Region regTest(-30, -30, -30, 30, 30, 30);
+	RawVolume<uint8_t> volume(regTest);
+	QVERIFY(applyBrushesMatchesReference(volume, regTest));
+
+	// The value ranges used by the surface extractors are kept up to date.
+	applyBrush(&volume, BoxBrush(Region(-3, -3, -3, 3, 3, 3)), 200);
+	uint8_t uMin = 0;
+	uint8_t uMax = 0;
+	QVERIFY(volume.getRegionValueRange(Region(0, 0, 0, 10, 10, 10), uMin, uMax));
+	QCOMPARE(uMax, uint8_t(200));
+
+	// Only a single Region is reported.
+	QCOMPARE(applyBrush(&volume, BoxBrush(Region(-20, -20, -20, 20, 20, 20)), 100).size(), size_t(1));
+	QVERIFY(applyBrush(&volume, BoxBrush(Region(100, 100, 100, 120, 120, 120)), 100).empty());
+}
+
+void TestBrush::testApplyBrushPagedVolume()
+{
+	const Region regTest(-30, -30, -30, 30, 30, 30);
+
+	// In the default mode, with concurrent access, and with most chunks compressed (which for this data means that they use
+	// a palette) or sharing their data.
+	{
+		FilePager<uint8_t> pager(".");
+		PagedVolume<uint8_t> volume(&pager, 64 * 1024 * 1024, 16);
+		QVERIFY(applyBrushesMatchesReference(volume, regTest));
+	}
+	{
+		FilePager<uint8_t> pager(".");
+		PagedVolume<uint8_t> volume(&pager, 64 * 1024 * 1024, 16, true);
+		QVERIFY(applyBrushesMatchesReference(volume, regTest));
+	}
+	{
+		FilePager<uint8_t> pager(".");
+		PagedVolume<uint8_t> volume(&pager, 64 * 1024 * 1024, 16);
+		volume.setMaxNumberOfUncompressedChunks(2);
+		QVERIFY(applyBrushesMatchesReference(volume, regTest));
+	}
+
+	// A Region is reported for each chunk which is changed.
+	FilePager<uint8_t> pager(".");
+	PagedVolume<uint8_t> volume(&pager, 64 * 1024 * 1024, 16);
+	const std::vector<Region> vecChangedRegions = applyBrush(&volume, BoxBrush(Region(-4, 10, 20, 20, 12, 20)), 3);
+	QCOMPARE(vecChangedRegions.size(), size_t(3));
+	QCOMPARE(vecChangedRegions[0], Region(-4, 10, 20, -1, 12, 20));
+	QCOMPARE(vecChangedRegions[1], Region(0, 10, 20, 15, 12, 20));
+	QCOMPARE(vecChangedRegions[2], Region(16, 10, 20, 20, 12, 20));
+}
+
+QTEST_MAIN(TestBrush)
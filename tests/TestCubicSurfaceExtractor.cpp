@@ -24,6 +24,7 @@
 
 #include "TestCubicSurfaceExtractor.h"
 
+#include "PolyVox/BufferMesh.h"
 #include "PolyVox/Density.h"
 #include "PolyVox/FilePager.h"
 #include "PolyVox/Material.h"
@@ -34,6 +35,7 @@
 
 #include <QtTest>
 
+#include <map>
 #include <random>
 
 using namespace PolyVox;
@@ -132,31 +134,275 @@ void TestCubicSurfaceExtractor::testBehaviour()
 	RawVolume<uint8_t> uint8Vol(Region(0, 0, 0, iVolumeSideLength - 1, iVolumeSideLength - 1, iVolumeSideLength - 1));
 	createAndFillVolumeWithNoise(uint8Vol, 32, 0, 2);
 	auto uint8Mesh = extractCubicMesh(&uint8Vol, uint8Vol.getEnclosingRegion());
-	QCOMPARE(uint8Mesh.getNoOfVertices(), uint32_t(57544));
-	QCOMPARE(uint8Mesh.getNoOfIndices(), uint32_t(215304));
+	QCOMPARE(uint8Mesh.getNoOfVertices(), uint32_t(57547));
+	QCOMPARE(uint8Mesh.getNoOfIndices(), uint32_t(215286));
 
 	// Test with default mesh type but user-provided controller.
 	RawVolume<int8_t> int8Vol(Region(0, 0, 0, iVolumeSideLength - 1, iVolumeSideLength - 1, iVolumeSideLength - 1));
 	createAndFillVolumeWithNoise(int8Vol, 32, 0, 2);
 	auto int8Mesh = extractCubicMesh(&int8Vol, int8Vol.getEnclosingRegion(), CustomIsQuadNeeded<int8_t>());
-	QCOMPARE(int8Mesh.getNoOfVertices(), uint32_t(29106));
-	QCOMPARE(int8Mesh.getNoOfIndices(), uint32_t(178566));
+	QCOMPARE(int8Mesh.getNoOfVertices(), uint32_t(29093));
+	QCOMPARE(int8Mesh.getNoOfIndices(), uint32_t(178518));
 
 	// Test with default controller but user-provided mesh.
 	RawVolume<uint32_t> uint32Vol(Region(0, 0, 0, iVolumeSideLength - 1, iVolumeSideLength - 1, iVolumeSideLength - 1));
 	createAndFillVolumeWithNoise(uint32Vol, 32, 0, 2);
 	Mesh< CubicVertex< uint32_t >, uint16_t > uint32Mesh;
 	extractCubicMeshCustom(&uint32Vol, uint32Vol.getEnclosingRegion(), &uint32Mesh);
-	QCOMPARE(uint32Mesh.getNoOfVertices(), uint16_t(57544));
-	QCOMPARE(uint32Mesh.getNoOfIndices(), uint32_t(215304));
+	QCOMPARE(uint32Mesh.getNoOfVertices(), uint16_t(57547));
+	QCOMPARE(uint32Mesh.getNoOfIndices(), uint32_t(215286));
 
 	// Test with both mesh and controller being provided by the user.
 	RawVolume<int32_t> int32Vol(Region(0, 0, 0, iVolumeSideLength - 1, iVolumeSideLength - 1, iVolumeSideLength - 1));
 	createAndFillVolumeWithNoise(int32Vol, 32, 0, 2);
 	Mesh< CubicVertex< int32_t >, uint16_t > int32Mesh;
 	extractCubicMeshCustom(&int32Vol, int32Vol.getEnclosingRegion(), &int32Mesh, CustomIsQuadNeeded<int32_t>());
-	QCOMPARE(int32Mesh.getNoOfVertices(), uint16_t(29106));
-	QCOMPARE(int32Mesh.getNoOfIndices(), uint32_t(178566));
+	QCOMPARE(int32Mesh.getNoOfVertices(), uint16_t(29093));
+	QCOMPARE(int32Mesh.getNoOfIndices(), uint32_t(178518));
+
+	// Test with the mesh being written into buffers provided by the user, which are sized by counting the mesh first.
+	MeshCounter< CubicVertex< uint8_t > > uint8Counter;
+	extractCubicMeshCustom(&uint8Vol, uint8Vol.getEnclosingRegion(), &uint8Counter);
+	QCOMPARE(uint8Counter.getNoOfVertices(), uint32_t(57547));
+	QCOMPARE(uint8Counter.getNoOfIndices(), size_t(215286));
+	std::vector< CubicVertex< uint8_t > > vecVertices(uint8Counter.getNoOfVertices());
+	std::vector<uint32_t> vecIndices(uint8Counter.getNoOfIndices());
+	BufferMesh< CubicVertex< uint8_t > > uint8BufferMesh(vecVertices.data(), static_cast<uint32_t>(vecVertices.size()), vecIndices.data(), static_cast<uint32_t>(vecIndices.size()));
+	extractCubicMeshCustom(&uint8Vol, uint8Vol.getEnclosingRegion(), &uint8BufferMesh);
+	QCOMPARE(uint8BufferMesh.getNoOfVertices(), uint8Mesh.getNoOfVertices());
+	QVERIFY(std::equal(vecIndices.begin(), vecIndices.end(), uint8Mesh.getRawIndexData()));
+	QVERIFY(uint8BufferMesh.getVertex(1000).encodedPosition == uint8Mesh.getVertex(1000).encodedPosition);
+	QCOMPARE(uint8BufferMesh.getVertex(1000).data, uint8Mesh.getVertex(1000).data);
+}
+
+// Behaves exactly like the default, but because it is a different type the extractor
+// cannot use the value ranges of the volume to skip over empty space.
+class NonSkippingIsQuadNeeded : public DefaultIsQuadNeeded<uint8_t>
+{
+};
+
+void TestCubicSurfaceExtractor::testEmptySpaceSkipping()
+{
+	// Terrain which is mostly solid at the bottom and mostly air at the top.
+	RawVolume<uint8_t> terrainVol(Region(0, 0, 0, 95, 95, 95));
+	for (int32_t z = 0; z < 96; z++)
+	{
+		for (int32_t y = 0; y < 96; y++)
+		{
+			for (int32_t x = 0; x < 96; x++)
+			{
+				const int32_t iHeight = 40 + ((x * 7 + y * 3) % 23) / 4;
+				terrainVol.setVoxel(x, y, z, z < iHeight ? static_cast<uint8_t>(1 + (x + z) % 3) : 0);
+			}
+		}
+	}
+
+	// Skipping the blocks of rows which are entirely solid or entirely air should not change the result.
+	Region region(2, 3, 4, 90, 91, 92);
+	auto skippingMesh = extractCubicMesh(&terrainVol, region);
+	auto nonSkippingMesh = extractCubicMesh(&terrainVol, region, NonSkippingIsQuadNeeded());
+	QVERIFY(skippingMesh.getNoOfVertices() > 0);
+	QCOMPARE(skippingMesh.getNoOfVertices(), nonSkippingMesh.getNoOfVertices());
+	QCOMPARE(skippingMesh.getNoOfIndices(), nonSkippingMesh.getNoOfIndices());
+	for (uint32_t uVertex = 0; uVertex < skippingMesh.getNoOfVertices(); uVertex++)
+	{
+		QCOMPARE(skippingMesh.getVertex(uVertex).encodedPosition, nonSkippingMesh.getVertex(uVertex).encodedPosition);
+		QCOMPARE(skippingMesh.getVertex(uVertex).data, nonSkippingMesh.getVertex(uVertex).data);
+	}
+	for (uint32_t uIndex = 0; uIndex < skippingMesh.getNoOfIndices(); uIndex++)
+	{
+		QCOMPARE(skippingMesh.getIndex(uIndex), nonSkippingMesh.getIndex(uIndex));
+	}
+}
+
+// Works out twice the area covered by the triangles of each material. The quads are axis aligned, so this is always an integer.
+template<typename MeshType>
+std::map<uint8_t, int32_t> calculateAreaOfEachMaterial(const MeshType& mesh)
+{
+	std::map<uint8_t, int32_t> mapAreas;
+	for (uint32_t uIndex = 0; uIndex < mesh.getNoOfIndices(); uIndex += 3)
+	{
+		const auto& v0 = mesh.getVertex(mesh.getIndex(uIndex));
+		const auto& v1 = mesh.getVertex(mesh.getIndex(uIndex + 1));
+		const auto& v2 = mesh.getVertex(mesh.getIndex(uIndex + 2));
+		Vector3DFloat edge1 = decodePosition(v1.encodedPosition) - decodePosition(v0.encodedPosition);
+		Vector3DFloat edge2 = decodePosition(v2.encodedPosition) - decodePosition(v0.encodedPosition);
+		Vector3DFloat normal = edge1.cross(edge2);
+		mapAreas[v0.data] += static_cast<int32_t>(std::abs(normal.getX()) + std::abs(normal.getY()) + std::abs(normal.getZ()));
+	}
+	return mapAreas;
+}
+
+void TestCubicSurfaceExtractor::testGreedyMeshing()
+{
+	// A box is covered by one quad on each side.
+	RawVolume<uint8_t> boxVol(Region(0, 0, 0, 7, 7, 7));
+	for (int32_t z = 2; z <= 3; z++)
+	{
+		for (int32_t y = 2; y <= 4; y++)
+		{
+			for (int32_t x = 2; x <= 5; x++)
+			{
+				boxVol.setVoxel(x, y, z, 1);
+			}
+		}
+	}
+	auto boxMesh = extractCubicMesh(&boxVol, boxVol.getEnclosingRegion());
+	QCOMPARE(boxMesh.getNoOfVertices(), uint32_t(8));
+	QCOMPARE(boxMesh.getNoOfIndices(), uint32_t(6 * 6));
+	auto unmergedBoxMesh = extractCubicMesh(&boxVol, boxVol.getEnclosingRegion(), DefaultIsQuadNeeded<uint8_t>(), false);
+	QCOMPARE(unmergedBoxMesh.getNoOfIndices(), uint32_t((4 * 3 + 3 * 2 + 4 * 2) * 2 * 6));
+
+	// Faces with different materials are not merged, so if half the box is a different material then four of the sides need
+	// two quads. There are no faces between the two halves.
+	for (int32_t z = 2; z <= 3; z++)
+	{
+		for (int32_t y = 2; y <= 4; y++)
+		{
+			boxVol.setVoxel(4, y, z, 2);
+			boxVol.setVoxel(5, y, z, 2);
+		}
+	}
+	boxMesh = extractCubicMesh(&boxVol, boxVol.getEnclosingRegion());
+	QCOMPARE(boxMesh.getNoOfIndices(), uint32_t(10 * 6));
+	std::map<uint8_t, int32_t> mapBoxAreas = calculateAreaOfEachMaterial(boxMesh);
+	QCOMPARE(mapBoxAreas[1], int32_t(((2 * 3 + 3 * 2 + 2 * 2) * 2 - 3 * 2) * 2));
+	QCOMPARE(mapBoxAreas[2], int32_t(((2 * 3 + 3 * 2 + 2 * 2) * 2 - 3 * 2) * 2));
+
+	// Merging covers exactly the same faces as not merging, with far fewer triangles.
+	RawVolume<uint8_t> terrainVol(Region(0, 0, 0, 47, 47, 47));
+	for (int32_t z = 0; z < 48; z++)
+	{
+		for (int32_t y = 0; y < 48; y++)
+		{
+			for (int32_t x = 0; x < 48; x++)
+			{
+				const int32_t iHeight = 20 + ((x / 3 + y / 5) % 7);
+				terrainVol.setVoxel(x, y, z, z < iHeight ? static_cast<uint8_t>(1 + (z / 4) % 3) : 0);
+			}
+		}
+	}
+	Region region(1, 2, 3, 45, 46, 47);
+	auto mergedMesh = extractCubicMesh(&terrainVol, region);
+	auto unmergedMesh = extractCubicMesh(&terrainVol, region, DefaultIsQuadNeeded<uint8_t>(), false);
+	QVERIFY(mergedMesh.getNoOfIndices() * 4 < unmergedMesh.getNoOfIndices());
+	QVERIFY(calculateAreaOfEachMaterial(mergedMesh) == calculateAreaOfEachMaterial(unmergedMesh));
+}
+
+// Behaves exactly like the default, but because it is a different type the extractor has to call it for each pair of voxels
+// rather than finding the faces with bitmasks.
+template<typename VoxelType>
+class PerVoxelIsQuadNeeded : public DefaultIsQuadNeeded<VoxelType>
+{
+};
+
+template<typename VolumeType>
+void compareBinaryAndPerVoxelMeshes(VolumeType* volData, const Region& region, bool bMergeQuads)
+{
+	typedef typename VolumeType::VoxelType VoxelType;
+	auto binaryMesh = extractCubicMesh(volData, region, DefaultIsQuadNeeded<VoxelType>(), bMergeQuads);
+	auto perVoxelMesh = extractCubicMesh(volData, region, PerVoxelIsQuadNeeded<VoxelType>(), bMergeQuads);
+	QVERIFY(binaryMesh.getNoOfIndices() > 0);
+	QCOMPARE(binaryMesh.getNoOfVertices(), perVoxelMesh.getNoOfVertices());
+	QCOMPARE(binaryMesh.getNoOfIndices(), perVoxelMesh.getNoOfIndices());
+	for (uint32_t uVertex = 0; uVertex < binaryMesh.getNoOfVertices(); uVertex++)
+	{
+		QCOMPARE(binaryMesh.getVertex(uVertex).encodedPosition, perVoxelMesh.getVertex(uVertex).encodedPosition);
+		QVERIFY(binaryMesh.getVertex(uVertex).data == perVoxelMesh.getVertex(uVertex).data);
+	}
+	for (uint32_t uIndex = 0; uIndex < binaryMesh.getNoOfIndices(); uIndex++)
+	{
+		QCOMPARE(binaryMesh.getIndex(uIndex), perVoxelMesh.getIndex(uIndex));
+	}
+}
+
+void TestCubicSurfaceExtractor::testBinaryMeshing()
+{
+	// The regions are more than 64 voxels across in some directions, so the rows and columns need more than one word of bits.
+	// Negative values are neither solid nor empty, so there are no faces between them and the other voxels.
+	RawVolume<int8_t> int8Vol(Region(0, 0, 0, 149, 79, 39));
+	RawVolume<Material8> materialVol(Region(0, 0, 0, 149, 79, 39));
+	std::mt19937 rng;
+	for (int32_t z = 0; z < 40; z++)
+	{
+		for (int32_t y = 0; y < 80; y++)
+		{
+			for (int32_t x = 0; x < 150; x++)
+			{
+				int8_t iValue = 0;
+				if (z < 12 + (x / 9 + y / 7) % 9)
+				{
+					iValue = static_cast<int8_t>(1 + (x / 20 + y / 30) % 2);
+				}
+				if (rng() % 16 == 0)
+				{
+					iValue = static_cast<int8_t>(rng() % 4) - 1;
+				}
+				int8Vol.setVoxel(x, y, z, iValue);
+				materialVol.setVoxel(x, y, z, Material8(static_cast<uint8_t>((std::max)(iValue, int8_t(0)))));
+			}
+		}
+	}
+
+	compareBinaryAndPerVoxelMeshes(&int8Vol, Region(0, 0, 0, 149, 79, 39), true);
+	compareBinaryAndPerVoxelMeshes(&int8Vol, Region(3, 70, 1, 140, 150, 38), true);
+	compareBinaryAndPerVoxelMeshes(&int8Vol, Region(-5, 10, 5, 64, 73, 20), false);
+	compareBinaryAndPerVoxelMeshes(&materialVol, Region(1, 2, 3, 129, 65, 39), true);
+	compareBinaryAndPerVoxelMeshes(&materialVol, Region(60, 0, 0, 127, 63, 31), false);
+}
+
+void TestCubicSurfaceExtractor::testLargeRegions()
+{
+	// A long bar which is too large to extract with the default 8-bit vertex positions.
+	RawVolume<uint8_t> barVol(Region(0, 0, 0, 299, 9, 9));
+	for (int32_t x = 10; x <= 289; x++)
+	{
+		for (int32_t y = 2; y <= 5; y++)
+		{
+			for (int32_t z = 3; z <= 5; z++)
+			{
+				barVol.setVoxel(x, y, z, 7);
+			}
+		}
+	}
+
+	Mesh< CubicVertex<uint8_t> > smallMesh;
+	QVERIFY_EXCEPTION_THROWN(extractCubicMeshCustom(&barVol, barVol.getEnclosingRegion(), &smallMesh), std::invalid_argument);
+
+	// With 16-bit positions the whole bar is covered by one quad on each side.
+	Mesh< CubicVertex<uint8_t, uint16_t> > largeMesh;
+	extractCubicMeshCustom(&barVol, barVol.getEnclosingRegion(), &largeMesh);
+	QCOMPARE(largeMesh.getNoOfVertices(), uint32_t(8));
+	QCOMPARE(largeMesh.getNoOfIndices(), uint32_t(6 * 6));
+	auto decodedMesh = decodeMesh(largeMesh);
+	Vector3DFloat lowerCorner(1000.0f, 1000.0f, 1000.0f);
+	Vector3DFloat upperCorner(-1000.0f, -1000.0f, -1000.0f);
+	for (uint32_t uVertex = 0; uVertex < decodedMesh.getNoOfVertices(); uVertex++)
+	{
+		const Vector3DFloat& position = decodedMesh.getVertex(uVertex).position;
+		lowerCorner = Vector3DFloat((std::min)(lowerCorner.getX(), position.getX()), (std::min)(lowerCorner.getY(), position.getY()), (std::min)(lowerCorner.getZ(), position.getZ()));
+		upperCorner = Vector3DFloat((std::max)(upperCorner.getX(), position.getX()), (std::max)(upperCorner.getY(), position.getY()), (std::max)(upperCorner.getZ(), position.getZ()));
+		QCOMPARE(decodedMesh.getVertex(uVertex).data, uint8_t(7));
+	}
+	QCOMPARE(lowerCorner, Vector3DFloat(9.5f, 1.5f, 2.5f));
+	QCOMPARE(upperCorner, Vector3DFloat(289.5f, 5.5f, 5.5f));
+
+	// For regions which fit in the 8-bit positions, the wider encoding gives the same mesh.
+	RawVolume<uint8_t> noiseVol(Region(0, 0, 0, 31, 31, 31));
+	createAndFillVolumeWithNoise(noiseVol, 32, 0, 3);
+	auto narrowMesh = extractCubicMesh(&noiseVol, noiseVol.getEnclosingRegion());
+	Mesh< CubicVertex<uint8_t, uint16_t> > wideMesh;
+	extractCubicMeshCustom(&noiseVol, noiseVol.getEnclosingRegion(), &wideMesh);
+	QCOMPARE(wideMesh.getNoOfVertices(), narrowMesh.getNoOfVertices());
+	QCOMPARE(wideMesh.getNoOfIndices(), narrowMesh.getNoOfIndices());
+	for (uint32_t uVertex = 0; uVertex < wideMesh.getNoOfVertices(); uVertex++)
+	{
+		QCOMPARE(decodeVertex(wideMesh.getVertex(uVertex)).position, decodeVertex(narrowMesh.getVertex(uVertex)).position);
+	}
+	for (uint32_t uIndex = 0; uIndex < wideMesh.getNoOfIndices(); uIndex++)
+	{
+		QCOMPARE(wideMesh.getIndex(uIndex), narrowMesh.getIndex(uIndex));
+	}
 }
 
 void TestCubicSurfaceExtractor::testEmptyVolumePerformance()
@@ -33,6 +33,10 @@ class TestCubicSurfaceExtractor: public QObject
 	
 	private slots:
 		void testBehaviour();
+		void testEmptySpaceSkipping();
+		void testGreedyMeshing();
+		void testBinaryMeshing();
+		void testLargeRegions();
 		void testEmptyVolumePerformance();
 		void testRealisticVolumePerformance();
 		void testNoiseVolumePerformance();
@@ -0,0 +1,387 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "TestLodSurfaceExtractor.h"
+
+#include "PolyVox/FilePager.h"
+#include "PolyVox/MarchingCubesLodSurfaceExtractor.h"
+#include "PolyVox/PagedVolume.h"
+#include "PolyVox/RawVolume.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+using namespace PolyVox;
+
+// A bumpy sphere, with the surface crossing the faces of the blocks at many different angles.
+void createBumpySphere(RawVolume<uint8_t>& volData, const Vector3DFloat& v3dCentre, float fRadius)
+{
+	const Region& region = volData.getEnclosingRegion();
+	for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				const float fDistance = (Vector3DFloat(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) - v3dCentre).length();
+				const float fDensity = 128.0f + (fRadius - fDistance) * 12.0f + 20.0f * std::sin(x * 0.3f) * std::cos(y * 0.2f + z * 0.1f);
+				volData.setVoxel(x, y, z, static_cast<uint8_t>((std::min)((std::max)(fDensity, 0.0f), 255.0f)));
+			}
+		}
+	}
+}
+
+// Checks that every voxel of each level of the pyramid is the voxel of the volume at the corresponding position.
+template <typename VolumeType>
+bool pyramidMatchesVolume(const LodPyramid<VolumeType>& pyramid)
+{
+	for (uint32_t uLevel = 0; uLevel < pyramid.getNoOfLevels(); uLevel++)
+	{
+		const Region regLevel = pyramid.getRegionAtLevel(uLevel);
+		std::vector<uint8_t> vecVoxels(regLevel.getWidthInVoxels() * regLevel.getHeightInVoxels() * regLevel.getDepthInVoxels());
+		pyramid.gatherVoxelsAtLevel(uLevel, regLevel, vecVoxels.data());
+
+		uint32_t uIndex = 0;
+		for (int32_t z = regLevel.getLowerZ(); z <= regLevel.getUpperZ(); z++)
+		{
+			for (int32_t y = regLevel.getLowerY(); y <= regLevel.getUpperY(); y++)
+			{
+				for (int32_t x = regLevel.getLowerX(); x <= regLevel.getUpperX(); x++)
+				{
+					const int32_t iScale = 1 << uLevel;
+					const uint8_t uExpected = pyramid.getVolume()->getVoxel(x * iScale, y * iScale, z * iScale);
+					if ((pyramid.getVoxelAtLevel(uLevel, x, y, z) != uExpected) || (vecVoxels[uIndex++] != uExpected))
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// The triangles of a mesh, each of which starts from its smallest vertex (keeping the winding) so that the order in which the
+// vertices were generated does not matter.
+typedef std::tuple<uint16_t, uint16_t, uint16_t, uint16_t, uint8_t> VertexKey;
+std::vector< std::vector<VertexKey> > getTriangles(const Mesh< MarchingCubesVertex<uint8_t> >& mesh)
+{
+	std::vector< std::vector<VertexKey> > vecTriangles;
+	for (uint32_t uIndex = 0; uIndex < mesh.getNoOfIndices(); uIndex += 3)
+	{
+		std::vector<VertexKey> vecTriangle;
+		for (uint32_t uCorner = 0; uCorner < 3; uCorner++)
+		{
+			const MarchingCubesVertex<uint8_t>& vertex = mesh.getVertex(mesh.getIndex(uIndex + uCorner));
+			vecTriangle.push_back(VertexKey(vertex.encodedPosition.getX(), vertex.encodedPosition.getY(), vertex.encodedPosition.getZ(), vertex.encodedNormal, vertex.data));
+		}
+		std::rotate(vecTriangle.begin(), std::min_element(vecTriangle.begin(), vecTriangle.end()), vecTriangle.end());
+		vecTriangles.push_back(vecTriangle);
+	}
+	std::sort(vecTriangles.begin(), vecTriangles.end());
+	return vecTriangles;
+}
+
+struct SeamEdge
+{
+	Vector3DFloat v3dStart;
+	Vector3DFloat v3dEnd;
+	size_t uBlock;
+};
+
+// Extracts the meshes for all the blocks of the octree, and counts the points along the edges of each mesh (those which are only used
+// by one triangle) which are not also on the edge of another mesh. These are the cracks between the meshes, as long as the surface does
+// not reach the outside of the octree.
+template <typename VolumeType>
+uint32_t countPointsOnCracks(LodPyramid<VolumeType>& pyramid, const LodOctree& octree, bool bJoinToCoarserNeighbours)
+{
+	std::vector<SeamEdge> vecEdges;
+	for (size_t uBlock = 0; uBlock < octree.getBlocks().size(); uBlock++)
+	{
+		LodBlock block = octree.getBlocks()[uBlock];
+		if (!bJoinToCoarserNeighbours)
+		{
+			block.uCoarserNeighbours = 0;
+		}
+
+		const Mesh< MarchingCubesVertex<uint8_t> > mesh = extractMarchingCubesLodMesh(&pyramid, block);
+
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> mapEdgeUses;
+		for (uint32_t uIndex = 0; uIndex < mesh.getNoOfIndices(); uIndex += 3)
+		{
+			for (uint32_t uCorner = 0; uCorner < 3; uCorner++)
+			{
+				const uint32_t uStart = mesh.getIndex(uIndex + uCorner);
+				const uint32_t uEnd = mesh.getIndex(uIndex + (uCorner + 1) % 3);
+				mapEdgeUses[std::make_pair((std::min)(uStart, uEnd), (std::max)(uStart, uEnd))]++;
+			}
+		}
+
+		const float fScale = static_cast<float>(1 << block.uLevel);
+		const Vector3DFloat v3dOffset(static_cast<float>(mesh.getOffset().getX()), static_cast<float>(mesh.getOffset().getY()), static_cast<float>(mesh.getOffset().getZ()));
+		for (auto iter = mapEdgeUses.begin(); iter != mapEdgeUses.end(); iter++)
+		{
+			if (iter->second == 1)
+			{
+				SeamEdge edge;
+				edge.v3dStart = (decodePosition(mesh.getVertex(iter->first.first).encodedPosition) + v3dOffset) * fScale;
+				edge.v3dEnd = (decodePosition(mesh.getVertex(iter->first.second).encodedPosition) + v3dOffset) * fScale;
+				edge.uBlock = uBlock;
+				vecEdges.push_back(edge);
+			}
+		}
+	}
+
+	// The vertices are encoded with 8 bits of fraction at the level of each block.
+	const float fTolerance = 0.05f;
+	uint32_t uNoOfPointsOnCracks = 0;
+	for (auto iter = vecEdges.begin(); iter != vecEdges.end(); iter++)
+	{
+		for (uint32_t uStep = 0; uStep <= 4; uStep++)
+		{
+			const Vector3DFloat v3dPoint = iter->v3dStart + (iter->v3dEnd - iter->v3dStart) * (uStep * 0.25f);
+			bool bCovered = false;
+			for (auto other = vecEdges.begin(); (other != vecEdges.end()) && !bCovered; other++)
+			{
+				if (other->uBlock != iter->uBlock)
+				{
+					const Vector3DFloat v3dLine = other->v3dEnd - other->v3dStart;
+					const float fLengthSquared = v3dLine.lengthSquared();
+					const float fAlong = (fLengthSquared > 0.0f) ? (std::min)((std::max)((v3dPoint - other->v3dStart).dot(v3dLine) / fLengthSquared, 0.0f), 1.0f) : 0.0f;
+					bCovered = ((other->v3dStart + v3dLine * fAlong) - v3dPoint).length() < fTolerance;
+				}
+			}
+			uNoOfPointsOnCracks += bCovered ? 0 : 1;
+		}
+	}
+	return uNoOfPointsOnCracks;
+}
+
+void TestLodSurfaceExtractor::testPyramid()
+{
+	RawVolume<uint8_t> volData(Region(-8, -8, -8, 47, 47, 47));
+	createBumpySphere(volData, Vector3DFloat(20.3f, 18.7f, 15.1f), 14.0f);
+
+	LodPyramid< RawVolume<uint8_t> > pyramid(&volData, Region(-3, 1, 2, 40, 37, 33), 3);
+	QCOMPARE(pyramid.getNoOfLevels(), static_cast<uint32_t>(3));
+	QCOMPARE(pyramid.getRegionAtLevel(0), Region(-3, 1, 2, 40, 37, 33));
+	QCOMPARE(pyramid.getRegionAtLevel(1), Region(-2, 0, 1, 20, 19, 17));
+	QCOMPARE(pyramid.getRegionAtLevel(2), Region(-1, 0, 0, 10, 10, 9));
+	QVERIFY(pyramidMatchesVolume(pyramid));
+
+	// After modifying the volume only the voxels within the modified region need to be copied again.
+	volData.setVoxel(8, 4, 12, 77);
+	volData.setVoxel(9, 4, 12, 78);
+	pyramid.update(Region(8, 4, 12, 9, 4, 12));
+	QCOMPARE(pyramid.getVoxelAtLevel(2, 2, 1, 3), static_cast<uint8_t>(77));
+	for (int32_t z = 16; z <= 24; z++)
+	{
+		for (int32_t y = -4; y <= 4; y++)
+		{
+			for (int32_t x = 0; x <= 30; x++)
+			{
+				volData.setVoxel(x, y, z, static_cast<uint8_t>(x + y + z));
+			}
+		}
+	}
+	pyramid.update(Region(0, -4, 16, 30, 4, 24));
+	QVERIFY(pyramidMatchesVolume(pyramid));
+}
+
+void TestLodSurfaceExtractor::testOctree()
+{
+	const Vector3DFloat v3dViewer(10.0f, 100.0f, 20.0f);
+	LodOctree octree(Region(0, 0, 0, 255, 255, 255), 8, 4);
+	octree.update(v3dViewer, 1.0f);
+
+	// Record the level of each block in a grid of the smallest blocks, which also checks that they cover the region exactly once.
+	const int32_t iGridSize = 32;
+	std::vector<int32_t> vecLevels(iGridSize * iGridSize * iGridSize, -1);
+	auto getLevel = [&](int32_t x, int32_t y, int32_t z)
+	{
+		return ((x < 0) || (y < 0) || (z < 0) || (x >= iGridSize) || (y >= iGridSize) || (z >= iGridSize)) ? -1 : vecLevels[(z * iGridSize + y) * iGridSize + x];
+	};
+
+	uint32_t uNoOfLevelZeroBlocks = 0;
+	uint32_t uNoOfLevelThreeBlocks = 0;
+	for (auto iter = octree.getBlocks().begin(); iter != octree.getBlocks().end(); iter++)
+	{
+		const int32_t iSize = 1 << iter->uLevel;
+		QCOMPARE(iter->region.getWidthInVoxels(), 9);
+		QCOMPARE(iter->region.getLowerX() % 8, 0);
+		for (int32_t z = 0; z < iSize; z++)
+		{
+			for (int32_t y = 0; y < iSize; y++)
+			{
+				for (int32_t x = 0; x < iSize; x++)
+				{
+					int32_t& iLevel = vecLevels[(((iter->region.getLowerZ() / 8) * iSize + z) * iGridSize + ((iter->region.getLowerY() / 8) * iSize + y)) * iGridSize + (iter->region.getLowerX() / 8) * iSize + x];
+					QCOMPARE(iLevel, -1);
+					iLevel = static_cast<int32_t>(iter->uLevel);
+				}
+			}
+		}
+		uNoOfLevelZeroBlocks += (iter->uLevel == 0) ? 1 : 0;
+		uNoOfLevelThreeBlocks += (iter->uLevel == 3) ? 1 : 0;
+	}
+	QVERIFY(std::find(vecLevels.begin(), vecLevels.end(), -1) == vecLevels.end());
+	QCOMPARE(getLevel(1, 12, 2), 0);
+	QVERIFY(uNoOfLevelZeroBlocks > 0);
+	QVERIFY(uNoOfLevelThreeBlocks > 0);
+
+	// Neighbouring blocks differ by at most one level, and each block knows which of its neighbours are at a lower level of detail.
+	for (auto iter = octree.getBlocks().begin(); iter != octree.getBlocks().end(); iter++)
+	{
+		const int32_t iSize = 1 << iter->uLevel;
+		const Vector3DInt32 v3dLower = iter->region.getLowerCorner() * iSize / 8;
+		for (int32_t iZDir = -1; iZDir <= 1; iZDir++)
+		{
+			for (int32_t iYDir = -1; iYDir <= 1; iYDir++)
+			{
+				for (int32_t iXDir = -1; iXDir <= 1; iXDir++)
+				{
+					if ((iXDir == 0) && (iYDir == 0) && (iZDir == 0))
+					{
+						continue;
+					}
+
+					const int32_t iNeighbourLevel = getLevel(v3dLower.getX() + ((iXDir < 0) ? -1 : iXDir * iSize),
+						v3dLower.getY() + ((iYDir < 0) ? -1 : iYDir * iSize), v3dLower.getZ() + ((iZDir < 0) ? -1 : iZDir * iSize));
+					QVERIFY(iNeighbourLevel <= static_cast<int32_t>(iter->uLevel) + 1);
+					QCOMPARE((iter->uCoarserNeighbours & lodNeighbourBit(iXDir, iYDir, iZDir)) != 0, iNeighbourLevel > static_cast<int32_t>(iter->uLevel));
+				}
+			}
+		}
+	}
+
+	// A split distance of zero leaves all the blocks at the lowest level of detail.
+	octree.update(v3dViewer, 0.0f);
+	QCOMPARE(octree.getBlocks().size(), static_cast<size_t>(64));
+	for (auto iter = octree.getBlocks().begin(); iter != octree.getBlocks().end(); iter++)
+	{
+		QCOMPARE(iter->uLevel, static_cast<uint32_t>(3));
+		QCOMPARE(iter->uCoarserNeighbours, static_cast<uint32_t>(0));
+	}
+}
+
+void TestLodSurfaceExtractor::testFullResolution()
+{
+	RawVolume<uint8_t> volData(Region(0, 0, 0, 63, 63, 63));
+	createBumpySphere(volData, Vector3DFloat(30.3f, 28.7f, 35.1f), 20.0f);
+	LodPyramid< RawVolume<uint8_t> > pyramid(&volData, volData.getEnclosingRegion(), 2);
+
+	// Without any coarser neighbours a block at the full resolution gives the same triangles as the regular extractor.
+	const Region aRegions[] = { Region(0, 0, 0, 32, 32, 32), Region(16, 24, 8, 40, 56, 40), Region(20, 8, 33, 51, 20, 63) };
+	for (uint32_t uRegion = 0; uRegion < sizeof(aRegions) / sizeof(aRegions[0]); uRegion++)
+	{
+		LodBlock block;
+		block.region = aRegions[uRegion];
+		block.uLevel = 0;
+		block.uCoarserNeighbours = 0;
+
+		const auto lodMesh = extractMarchingCubesLodMesh(&pyramid, block);
+		const auto mesh = extractMarchingCubesMesh(&volData, aRegions[uRegion]);
+		QVERIFY(lodMesh.getNoOfIndices() > 0);
+		QCOMPARE(lodMesh.getOffset(), mesh.getOffset());
+		QVERIFY(getTriangles(lodMesh) == getTriangles(mesh));
+	}
+
+	// A block at a lower level of detail has fewer triangles.
+	LodBlock block;
+	block.region = Region(0, 0, 0, 32, 32, 32);
+	block.uLevel = 1;
+	block.uCoarserNeighbours = 0;
+	const auto lodMesh = extractMarchingCubesLodMesh(&pyramid, block);
+	const auto mesh = extractMarchingCubesMesh(&volData, volData.getEnclosingRegion());
+	QVERIFY(lodMesh.getNoOfIndices() > 0);
+	QVERIFY(lodMesh.getNoOfIndices() * 2 < mesh.getNoOfIndices());
+}
+
+void TestLodSurfaceExtractor::testSeams()
+{
+	RawVolume<uint8_t> volData(Region(0, 0, 0, 63, 63, 63));
+	createBumpySphere(volData, Vector3DFloat(20.3f, 30.7f, 25.1f), 18.0f);
+	LodPyramid< RawVolume<uint8_t> > pyramid(&volData, volData.getEnclosingRegion(), 4);
+
+	// The meshes of the blocks join up for viewers in various places, with two or three levels of detail in use.
+	const Vector3DFloat av3dViewers[] = { Vector3DFloat(0.0f, 0.0f, 0.0f), Vector3DFloat(20.0f, 30.0f, 25.0f), Vector3DFloat(5.0f, 40.0f, 10.0f) };
+	for (uint32_t uViewer = 0; uViewer < sizeof(av3dViewers) / sizeof(av3dViewers[0]); uViewer++)
+	{
+		LodOctree octree(volData.getEnclosingRegion(), 4 << uViewer, 4 - uViewer);
+		octree.update(av3dViewers[uViewer], 0.7f + uViewer * 0.4f);
+		QCOMPARE(countPointsOnCracks(pyramid, octree, true), static_cast<uint32_t>(0));
+	}
+
+	// Check that the test would detect the cracks if the meshes were not joined.
+	LodOctree octree(volData.getEnclosingRegion(), 4, 4);
+	octree.update(Vector3DFloat(5.0f, 40.0f, 10.0f), 0.7f);
+	QVERIFY(countPointsOnCracks(pyramid, octree, false) > 100);
+}
+
+void TestLodSurfaceExtractor::testPagedVolumeLevels()
+{
+	RawVolume<uint8_t> rawVolume(Region(0, 0, 0, 63, 63, 63));
+	createBumpySphere(rawVolume, Vector3DFloat(20.3f, 30.7f, 25.1f), 18.0f);
+	FilePager<uint8_t> pager(".");
+	PagedVolume<uint8_t> volData(&pager, 8 * 1024 * 1024, 16);
+	modifyVoxels(&volData, rawVolume.getEnclosingRegion(), [&](int32_t x, int32_t y, int32_t z, uint8_t) { return rawVolume.getVoxel(x, y, z); });
+
+	// Averaged mip levels would not join up, so the pyramid keeps its own copies of them.
+	volData.setNoOfMipLevels(2);
+	LodPyramid< PagedVolume<uint8_t> > averagedPyramid(&volData, rawVolume.getEnclosingRegion(), 4);
+	QCOMPARE(averagedPyramid.getNoOfLevelsInVolume(), static_cast<uint32_t>(1));
+	QVERIFY(pyramidMatchesVolume(averagedPyramid));
+
+	// Subsampled ones are read from the volume, and the pyramid only copies the levels beyond them.
+	volData.setNoOfMipLevels(2, MipFilters::Subsample);
+	LodPyramid< PagedVolume<uint8_t> > pyramid(&volData, rawVolume.getEnclosingRegion(), 4);
+	LodPyramid< RawVolume<uint8_t> > rawPyramid(&rawVolume, rawVolume.getEnclosingRegion(), 4);
+	QCOMPARE(pyramid.getNoOfLevelsInVolume(), static_cast<uint32_t>(3));
+	QVERIFY(pyramidMatchesVolume(pyramid));
+
+	// The meshes are the same as those from the copies, and so join up in the same way.
+	LodOctree octree(rawVolume.getEnclosingRegion(), 4, 4);
+	octree.update(Vector3DFloat(5.0f, 40.0f, 10.0f), 0.7f);
+	for (size_t uBlock = 0; uBlock < octree.getBlocks().size(); uBlock++)
+	{
+		const LodBlock& block = octree.getBlocks()[uBlock];
+		QVERIFY(getTriangles(extractMarchingCubesLodMesh(&pyramid, block)) == getTriangles(extractMarchingCubesLodMesh(&rawPyramid, block)));
+	}
+	QCOMPARE(countPointsOnCracks(pyramid, octree, true), static_cast<uint32_t>(0));
+
+	// The levels which are read from the volume see modifications without the pyramid being updated.
+	volData.setVoxel(8, 4, 12, 77);
+	QCOMPARE(pyramid.getVoxelAtLevel(2, 2, 1, 3), static_cast<uint8_t>(77));
+	volData.setVoxel(16, 8, 24, 78);
+	QVERIFY(pyramid.getVoxelAtLevel(3, 2, 1, 3) != static_cast<uint8_t>(78));
+	pyramid.update(Region(16, 8, 24, 16, 8, 24));
+	QCOMPARE(pyramid.getVoxelAtLevel(3, 2, 1, 3), static_cast<uint8_t>(78));
+	QVERIFY(pyramidMatchesVolume(pyramid));
+}
+
+QTEST_MAIN(TestLodSurfaceExtractor)
@@ -88,4 +88,54 @@ void TestLowPassFilter::testExecute()
 	QCOMPARE(resultVolume.getVoxel(7, 7, 7), Density8(4));
 }
 
+void TestLowPassFilter::testExecuteLargeRegion()
+{
+	// The filter works on blocks of the region at a time, so check that the result is the
+	// same at the edges of the blocks (and of the volume) as for any other voxel.
+	Region reg(-20, -5, -40, 45, 30, 3);
+	RawVolume<Density8> volData(reg);
+	for (int32_t z = reg.getLowerZ(); z <= reg.getUpperZ(); z++)
+	{
+		for (int32_t y = reg.getLowerY(); y <= reg.getUpperY(); y++)
+		{
+			for (int32_t x = reg.getLowerX(); x <= reg.getUpperX(); x++)
+			{
+				volData.setVoxel(x, y, z, Density8(static_cast<uint8_t>((x * 37 + y * 11 + z * 5) & 0xFF)));
+			}
+		}
+	}
+
+	RawVolume<Density8> resultVolume(reg);
+	LowPassFilter< RawVolume<Density8>, RawVolume<Density8>, Density16 > lowPassfilter(&volData, reg, &resultVolume, reg, 3);
+	lowPassfilter.execute();
+
+	int32_t iNoOfMismatches = 0;
+	for (int32_t z = reg.getLowerZ(); z <= reg.getUpperZ(); z++)
+	{
+		for (int32_t y = reg.getLowerY(); y <= reg.getUpperY(); y++)
+		{
+			for (int32_t x = reg.getLowerX(); x <= reg.getUpperX(); x++)
+			{
+				uint32_t uSum = 0;
+				for (int32_t iOffsetZ = -1; iOffsetZ <= 1; iOffsetZ++)
+				{
+					for (int32_t iOffsetY = -1; iOffsetY <= 1; iOffsetY++)
+					{
+						for (int32_t iOffsetX = -1; iOffsetX <= 1; iOffsetX++)
+						{
+							uSum += volData.getVoxel(x + iOffsetX, y + iOffsetY, z + iOffsetZ).getDensity();
+						}
+					}
+				}
+
+				if (resultVolume.getVoxel(x, y, z).getDensity() != uSum / 27)
+				{
+					iNoOfMismatches++;
+				}
+			}
+		}
+	}
+	QCOMPARE(iNoOfMismatches, 0);
+}
+
 QTEST_MAIN(TestLowPassFilter)
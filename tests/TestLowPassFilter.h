@@ -33,6 +33,7 @@ class TestLowPassFilter: public QObject
 	
 	private slots:
 		void testExecute();
+		void testExecuteLargeRegion();
 };
 
 #endif
@@ -27,6 +27,8 @@
 #include "PolyVox/Picking.h"
 #include "PolyVox/RawVolume.h"
 
+#include "PolyVox/Impl/RandomUnitVectors.h"
+
 #include <QtTest>
 
 using namespace PolyVox;
@@ -66,4 +68,76 @@ void TestPicking::testExecute()
 	QCOMPARE(resultMiss.didHit, false);
 }
 
+// Picks by visiting every voxel on the ray, to compare with pickVoxel() (which skips empty space).
+class ReferencePickingFunctor
+{
+public:
+	bool operator()(const RawVolume<int8_t>::Sampler& sampler)
+	{
+		if (sampler.getVoxel() != 0)
+		{
+			m_result.didHit = true;
+			m_result.hitVoxel = sampler.getPosition();
+			return false;
+		}
+
+		m_result.previousVoxel = sampler.getPosition();
+		return true;
+	}
+
+	PickResult m_result;
+};
+
+void TestPicking::testLongRange()
+{
+	// A large volume which is empty apart from a few small objects, with rays starting both inside and outside of it.
+	RawVolume<int8_t> volData(Region(0, 0, 0, 255, 255, 255));
+	volData.setVoxel(200, 30, 100, 1);
+	volData.setVoxel(31, 32, 33, 1);
+	for (int32_t z = 120; z < 136; z++)
+	{
+		for (int32_t y = 120; y < 136; y++)
+		{
+			for (int32_t x = 120; x < 136; x++)
+			{
+				volData.setVoxel(x, y, z, 1);
+			}
+		}
+	}
+
+	const int8_t emptyVoxelExample = 0;
+	uint32_t uNoOfHits = 0;
+	for (uint32_t uRay = 0; uRay < 1024; uRay++)
+	{
+		const Vector3DFloat v3dStart(static_cast<float>(uRay % 7) * 45.0f - 10.0f, 127.5f + static_cast<float>(uRay % 3), static_cast<float>(uRay % 5) * 50.0f);
+		const Vector3DFloat v3dDirection = randomUnitVectors[uRay] * 400.0f;
+
+		ReferencePickingFunctor reference;
+		raycastWithDirection(&volData, v3dStart, v3dDirection, reference);
+		const PickResult result = pickVoxel(&volData, v3dStart, v3dDirection, emptyVoxelExample);
+
+		QCOMPARE(result.didHit, reference.m_result.didHit);
+		QCOMPARE(result.hitVoxel, reference.m_result.hitVoxel);
+		QCOMPARE(result.previousVoxel, reference.m_result.previousVoxel);
+		uNoOfHits += result.didHit ? 1 : 0;
+	}
+	QVERIFY(uNoOfHits > 0);
+
+	// A single solid voxel at the far end of a long ray, and a ray which starts in a solid voxel.
+	PickResult result = pickVoxel(&volData, Vector3DFloat(0.0f, 30.0f, 100.0f), Vector3DFloat(255.0f, 0.0f, 0.0f), emptyVoxelExample);
+	QCOMPARE(result.didHit, true);
+	QCOMPARE(result.hitVoxel, Vector3DInt32(200, 30, 100));
+	QCOMPARE(result.previousVoxel, Vector3DInt32(199, 30, 100));
+
+	result = pickVoxel(&volData, Vector3DFloat(31.0f, 32.0f, 33.0f), Vector3DFloat(10.0f, 0.0f, 0.0f), emptyVoxelExample);
+	QCOMPARE(result.didHit, true);
+	QCOMPARE(result.hitVoxel, Vector3DInt32(31, 32, 33));
+	QCOMPARE(result.previousVoxel, Vector3DInt32(0, 0, 0));
+
+	// A ray which doesn't hit anything leaves the hit voxel unset.
+	result = pickVoxel(&volData, Vector3DFloat(0.0f, 250.0f, 250.0f), Vector3DFloat(255.0f, 0.0f, 0.0f), emptyVoxelExample);
+	QCOMPARE(result.didHit, false);
+	QCOMPARE(result.hitVoxel, Vector3DInt32(0, 0, 0));
+}
+
 QTEST_MAIN(TestPicking)
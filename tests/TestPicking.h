@@ -33,6 +33,7 @@ class TestPicking: public QObject
 	
 	private slots:
 		void testExecute();
+		void testLongRange();
 };
 
 #endif
@@ -25,6 +25,8 @@
 #include "TestRaycast.h"
 
 #include "PolyVox/Density.h"
+#include "PolyVox/FilePager.h"
+#include "PolyVox/PagedVolume.h"
 #include "PolyVox/Raycast.h"
 #include "PolyVox/RawVolume.h"
 
@@ -69,12 +71,53 @@ public:
 	bool m_bRayLeftVolume;
 };
 
-void TestRaycast::testExecute()
+// Records the last voxel which is touched, to compare the results of raycastBatch() with those of single rays.
+class RaycastPositionFunctor
 {
-	const int32_t uVolumeSideLength = 32;
+public:
+	RaycastPositionFunctor()
+		:m_uVoxelsTouched(0)
+	{
+	}
+
+	bool operator()(const RawVolume<int8_t>::Sampler& sampler)
+	{
+		m_uVoxelsTouched++;
+		m_v3dLastPosition = sampler.getPosition();
+		return sampler.isCurrentPositionValid() && (sampler.getVoxel() <= 0);
+	}
+
+	uint32_t m_uVoxelsTouched;
+	Vector3DInt32 m_v3dLastPosition;
+};
+
+// Stops at the first voxel which is not empty (zero), for the tests of skipping empty space.
+class RaycastSolidFunctor
+{
+public:
+	RaycastSolidFunctor()
+		:m_uVoxelsTouched(0)
+	{
+	}
 
+	template<typename SamplerType>
+	bool operator()(const SamplerType& sampler)
+	{
+		m_v3dPreviousPosition = (m_uVoxelsTouched > 0) ? m_v3dLastPosition : sampler.getPosition();
+		m_uVoxelsTouched++;
+		m_v3dLastPosition = sampler.getPosition();
+		return sampler.getVoxel() == 0;
+	}
+
+	uint32_t m_uVoxelsTouched;
+	Vector3DInt32 m_v3dLastPosition;
+	Vector3DInt32 m_v3dPreviousPosition;
+};
+
+RawVolume<int8_t>* createHollowVolume(int32_t uVolumeSideLength)
+{
 	//Create a hollow volume, with solid sides on x and y but with open ends in z.
-	RawVolume<int8_t> volData(Region(Vector3DInt32(0, 0, 0), Vector3DInt32(uVolumeSideLength - 1, uVolumeSideLength - 1, uVolumeSideLength - 1)));
+	RawVolume<int8_t>* volData = new RawVolume<int8_t>(Region(Vector3DInt32(0, 0, 0), Vector3DInt32(uVolumeSideLength - 1, uVolumeSideLength - 1, uVolumeSideLength - 1)));
 	for (int32_t z = 0; z < uVolumeSideLength; z++)
 	{
 		for (int32_t y = 0; y < uVolumeSideLength; y++)
@@ -83,15 +126,24 @@ void TestRaycast::testExecute()
 			{
 				if ((x == 0) || (x == uVolumeSideLength - 1) || (y == 0) || (y == uVolumeSideLength - 1))
 				{
-					volData.setVoxel(x, y, z, 100);
+					volData->setVoxel(x, y, z, 100);
 				}
 				else
 				{
-					volData.setVoxel(x, y, z, -100);
+					volData->setVoxel(x, y, z, -100);
 				}
 			}
 		}
 	}
+	return volData;
+}
+
+void TestRaycast::testExecute()
+{
+	const int32_t uVolumeSideLength = 32;
+
+	std::unique_ptr< RawVolume<int8_t> > pVolData(createHollowVolume(uVolumeSideLength));
+	RawVolume<int8_t>& volData = *pVolData;
 
 	//Cast rays from the centre. Roughly 2/3 should escape.
 	Vector3DFloat start(uVolumeSideLength / 2, uVolumeSideLength / 2, uVolumeSideLength / 2);
@@ -125,4 +177,173 @@ void TestRaycast::testExecute()
 	QCOMPARE(uTotalVoxelsTouched, static_cast<uint32_t>(29783248));
 }
 
+void TestRaycast::testBatch()
+{
+	const int32_t uVolumeSideLength = 32;
+	std::unique_ptr< RawVolume<int8_t> > pVolData(createHollowVolume(uVolumeSideLength));
+
+	// Rays of different lengths from a few different starting points, including some which stay within a single voxel,
+	// and some which start and end outside of the volume.
+	RaycastBatch batch;
+	for (uint32_t uRay = 0; uRay < 5000; uRay++)
+	{
+		const Vector3DFloat v3dStart(static_cast<float>(uRay % 7) * 5.3f - 4.0f, 16.0f + static_cast<float>(uRay % 3) * 0.25f, 16.0f);
+		const float fLength = (uRay % 11 == 0) ? 0.0f : static_cast<float>(uRay % 50) * 0.9f;
+		batch.addRay(v3dStart, randomUnitVectors[uRay % 1024] * fLength);
+	}
+
+	// The rays are divided between several threads, each with its own copy of the callback.
+	RaycastTestFunctor batchFunctor;
+	RaycastBatchResults results;
+	raycastBatch(pVolData.get(), batch, batchFunctor, results, 4);
+	QCOMPARE(results.getNoOfRays(), batch.getNoOfRays());
+	QCOMPARE(batchFunctor.m_uVoxelsTouched, uint32_t(0));
+
+	// Each ray should give the same result as if it was cast on its own.
+	uint32_t uTotalVoxelsTouched = 0;
+	uint32_t uNoOfInteruptedRays = 0;
+	for (uint32_t uRay = 0; uRay < batch.getNoOfRays(); uRay++)
+	{
+		RaycastPositionFunctor functor;
+		const Vector3DFloat v3dStart(batch.startX[uRay], batch.startY[uRay], batch.startZ[uRay]);
+		const Vector3DFloat v3dDirection(batch.directionX[uRay], batch.directionY[uRay], batch.directionZ[uRay]);
+		const RaycastResult result = raycastWithDirection(pVolData.get(), v3dStart, v3dDirection, functor);
+
+		QCOMPARE(results.results[uRay], result);
+		QCOMPARE(results.noOfSteps[uRay], functor.m_uVoxelsTouched);
+		QCOMPARE(Vector3DInt32(results.hitX[uRay], results.hitY[uRay], results.hitZ[uRay]), functor.m_v3dLastPosition);
+		uTotalVoxelsTouched += functor.m_uVoxelsTouched;
+		uNoOfInteruptedRays += (result == RaycastResults::Interupted) ? 1 : 0;
+	}
+	QVERIFY(uNoOfInteruptedRays > 0);
+	QVERIFY(uNoOfInteruptedRays < batch.getNoOfRays());
+
+	// With a single thread the callback itself is used, and the results are the same.
+	RaycastBatchResults singleThreadResults;
+	raycastBatch(pVolData.get(), batch, batchFunctor, singleThreadResults, 1);
+	QCOMPARE(batchFunctor.m_uVoxelsTouched, uTotalVoxelsTouched);
+	QVERIFY(singleThreadResults.results == results.results);
+	QVERIFY(singleThreadResults.noOfSteps == results.noOfSteps);
+	QVERIFY((singleThreadResults.hitX == results.hitX) && (singleThreadResults.hitY == results.hitY) && (singleThreadResults.hitZ == results.hitZ));
+
+	// The last voxel is also recorded for rays which complete, and empty batches are fine.
+	RaycastBatch smallBatch;
+	smallBatch.addRay(Vector3DFloat(16.0f, 16.0f, 16.0f), Vector3DFloat(0.0f, 0.0f, 4.0f));
+	smallBatch.addRay(Vector3DFloat(16.0f, 16.0f, 16.0f), Vector3DFloat(20.0f, 0.0f, 0.0f));
+	raycastBatch(pVolData.get(), smallBatch, batchFunctor, results);
+	QCOMPARE(results.getNoOfRays(), uint32_t(2));
+	QCOMPARE(results.results[0], RaycastResults::Completed);
+	QCOMPARE(results.noOfSteps[0], uint32_t(5));
+	QCOMPARE(results.hitZ[0], 20);
+	QCOMPARE(results.results[1], RaycastResults::Interupted);
+	QCOMPARE(results.hitX[1], uVolumeSideLength - 1);
+
+	smallBatch.clear();
+	raycastBatch(pVolData.get(), smallBatch, batchFunctor, results);
+	QCOMPARE(results.getNoOfRays(), uint32_t(0));
+}
+
+// Fills the volume with a few solid boxes in otherwise empty space.
+template<typename VolumeType>
+void addSparseBoxes(VolumeType& volData)
+{
+	const Region boxes[] = { Region(40, 40, 40, 47, 47, 47), Region(5, 70, 20, 6, 90, 21), Region(100, 10, 60, 100, 10, 60) };
+	for (const Region& box : boxes)
+	{
+		for (int32_t z = box.getLowerZ(); z <= box.getUpperZ(); z++)
+		{
+			for (int32_t y = box.getLowerY(); y <= box.getUpperY(); y++)
+			{
+				for (int32_t x = box.getLowerX(); x <= box.getUpperX(); x++)
+				{
+					volData.setVoxel(x, y, z, 1);
+				}
+			}
+		}
+	}
+}
+
+// Casts rays from all around the volume towards the boxes, and checks that skipping the empty space gives the same results (including
+// the last voxel and the one before it) as visiting every voxel. Returns the number of voxels which were passed to the callbacks with
+// and without skipping.
+template<typename VolumeType>
+void compareSkippingEmptySpace(VolumeType* volData, uint32_t uBlockSideLength, uint32_t& uVoxelsTouched, uint32_t& uVoxelsTouchedSkipping)
+{
+	uVoxelsTouched = 0;
+	uVoxelsTouchedSkipping = 0;
+	uint32_t uNoOfInteruptedRays = 0;
+	// Some of the rays start at whole numbers and go along the axes or diagonals, so that they pass exactly through the corners
+	// of voxels and blocks (where the axis which is stepped along first is decided by the rules for ties).
+	const Vector3DFloat directions[] = { Vector3DFloat(1.0f, 0.0f, 0.0f), Vector3DFloat(0.0f, -1.0f, 0.0f), Vector3DFloat(0.0f, 0.0f, 1.0f),
+		Vector3DFloat(1.0f, 1.0f, 0.0f), Vector3DFloat(-1.0f, 1.0f, 1.0f), Vector3DFloat(1.0f, 1.0f, 1.0f), Vector3DFloat(2.0f, 1.0f, 0.0f), Vector3DFloat(1.0f, -2.0f, 4.0f) };
+	for (uint32_t uRay = 0; uRay < 1000; uRay++)
+	{
+		Vector3DFloat v3dStart(static_cast<float>(uRay % 9) * 15.1f - 5.0f, static_cast<float>(uRay % 5) * 27.3f, 44.0f + static_cast<float>(uRay % 3) * 0.3f);
+		Vector3DFloat v3dDirection = randomUnitVectors[uRay % 1024] * static_cast<float>(uRay % 180);
+		if (uRay % 4 == 0)
+		{
+			v3dStart = Vector3DFloat(std::floor(v3dStart.getX()), std::floor(v3dStart.getY()), std::floor(v3dStart.getZ()));
+			v3dDirection = directions[(uRay / 4) % 8] * static_cast<float>(uRay % 100);
+		}
+
+		RaycastSolidFunctor functor;
+		typename VolumeType::Sampler sampler(volData);
+		Vector3DInt32 v3dLastVoxel;
+		uint32_t uNoOfSteps;
+		const RaycastResult result = traceRay(sampler, v3dStart, v3dStart + v3dDirection, functor, v3dLastVoxel, uNoOfSteps);
+
+		RaycastSolidFunctor skippingFunctor;
+		typename VolumeType::Sampler skippingSampler(volData);
+		Vector3DInt32 v3dSkippingLastVoxel;
+		Vector3DInt32 v3dSkippingPreviousVoxel;
+		uint32_t uSkippingNoOfSteps;
+		const RaycastResult skippingResult = traceRaySkippingEmptySpace(volData, skippingSampler, v3dStart, v3dStart + v3dDirection, skippingFunctor, 0,
+			getSkippingBlockSideLengthPower(volData, uBlockSideLength), v3dSkippingLastVoxel, v3dSkippingPreviousVoxel, uSkippingNoOfSteps);
+
+		QCOMPARE(skippingResult, result);
+		QCOMPARE(v3dSkippingLastVoxel, v3dLastVoxel);
+		QCOMPARE(v3dSkippingPreviousVoxel, functor.m_v3dPreviousPosition);
+		uNoOfInteruptedRays += (result == RaycastResults::Interupted) ? 1 : 0;
+		uVoxelsTouched += functor.m_uVoxelsTouched;
+		uVoxelsTouchedSkipping += skippingFunctor.m_uVoxelsTouched;
+	}
+	QVERIFY(uNoOfInteruptedRays > 0);
+}
+
+void TestRaycast::testSkippingEmptySpace()
+{
+	// Parts of the rays are outside the RawVolume, where the border value is also empty.
+	RawVolume<int8_t> rawVol(Region(0, 0, 0, 127, 127, 127));
+	addSparseBoxes(rawVol);
+	QCOMPARE(rawVol.getValueRangeBlockSideLength(), uint32_t(16));
+	// A block side length of zero means that the volume's own blocks are used.
+	for (uint32_t uBlockSideLength : { 0u, 1u, 4u, 16u, 32u })
+	{
+		uint32_t uVoxelsTouched, uVoxelsTouchedSkipping;
+		compareSkippingEmptySpace(&rawVol, uBlockSideLength, uVoxelsTouched, uVoxelsTouchedSkipping);
+		QVERIFY(uVoxelsTouchedSkipping < uVoxelsTouched / 2);
+	}
+
+	FilePager<int8_t> pager(".");
+	PagedVolume<int8_t> pagedVol(&pager, 64 * 1024 * 1024, 32);
+	addSparseBoxes(pagedVol);
+	uint32_t uVoxelsTouched, uVoxelsTouchedSkipping;
+	QCOMPARE(pagedVol.getValueRangeBlockSideLength(), uint32_t(32));
+	compareSkippingEmptySpace(&pagedVol, 0, uVoxelsTouched, uVoxelsTouchedSkipping);
+	QVERIFY(uVoxelsTouchedSkipping < uVoxelsTouched / 2);
+
+	// A ray which is entirely in empty space doesn't need to look at any voxels, while nothing can be skipped if no block is
+	// entirely of the given value.
+	RaycastSolidFunctor functor;
+	QCOMPARE(raycastWithEndpointsSkippingEmptySpace(&rawVol, Vector3DFloat(1.0f, 1.0f, 1.0f), Vector3DFloat(120.0f, 30.0f, 10.0f), functor, 0), RaycastResults::Completed);
+	QCOMPARE(functor.m_uVoxelsTouched, uint32_t(0));
+	RaycastSolidFunctor referenceFunctor;
+	raycastWithEndpoints(&rawVol, Vector3DFloat(1.0f, 1.0f, 1.0f), Vector3DFloat(120.0f, 30.0f, 10.0f), referenceFunctor);
+	QCOMPARE(raycastWithEndpointsSkippingEmptySpace(&rawVol, Vector3DFloat(1.0f, 1.0f, 1.0f), Vector3DFloat(120.0f, 30.0f, 10.0f), functor, 1), RaycastResults::Completed);
+	QCOMPARE(functor.m_uVoxelsTouched, referenceFunctor.m_uVoxelsTouched);
+	QCOMPARE(functor.m_v3dLastPosition, referenceFunctor.m_v3dLastPosition);
+
+	QVERIFY_EXCEPTION_THROWN(raycastWithEndpointsSkippingEmptySpace(&rawVol, Vector3DFloat(1.0f, 1.0f, 1.0f), Vector3DFloat(120.0f, 30.0f, 10.0f), functor, 0, 12), std::invalid_argument);
+}
+
 QTEST_MAIN(TestRaycast)
@@ -33,6 +33,8 @@ class TestRaycast: public QObject
 	
 	private slots:
 		void testExecute();
+		void testBatch();
+		void testSkippingEmptySpace();
 };
 
 #endif
@@ -24,6 +24,8 @@
 
 #include "TestSurfaceExtractor.h"
 
+#include "PolyVox/BufferMesh.h"
+#include "PolyVox/CubicSurfaceExtractor.h"
 #include "PolyVox/Density.h"
 #include "PolyVox/FilePager.h"
 #include "PolyVox/MaterialDensityPair.h"
@@ -33,6 +35,7 @@
 
 #include <QtTest>
 
+#include <limits>
 #include <random>
 
 using namespace PolyVox;
@@ -212,6 +215,375 @@ void TestSurfaceExtractor::testBehaviour()
 	QCOMPARE(materialMesh.getVertex(100).data.getMaterial(), uint16_t(79)); // Verify the data attached to the vertex
 }
 
+void TestSurfaceExtractor::testParallelExtraction()
+{
+	// A noisy volume has surface all over it, including on the boundaries between the slabs.
+	RawVolume<float> noiseVol(Region(0, 0, 0, 63, 63, 127));
+	std::mt19937 rng;
+	for (int32_t z = 0; z < 128; z++)
+	{
+		for (int32_t y = 0; y < 64; y++)
+		{
+			for (int32_t x = 0; x < 64; x++)
+			{
+				noiseVol.setVoxel(x, y, z, static_cast<float>(rng()) / static_cast<float>(std::numeric_limits<int32_t>::max()) - 1.0f);
+			}
+		}
+	}
+
+	// The result should be identical to that of the single-threaded version, whatever the number of threads.
+	Region region(3, 5, 7, 60, 58, 120);
+	auto serialMesh = extractMarchingCubesMesh(&noiseVol, region);
+	QVERIFY(serialMesh.getNoOfVertices() > 0);
+	for (uint32_t uNoOfThreads = 2; uNoOfThreads <= 5; uNoOfThreads += 3)
+	{
+		auto parallelMesh = extractMarchingCubesMeshParallel(&noiseVol, region, uNoOfThreads);
+		QCOMPARE(parallelMesh.getNoOfVertices(), serialMesh.getNoOfVertices());
+		QCOMPARE(parallelMesh.getNoOfIndices(), serialMesh.getNoOfIndices());
+		QCOMPARE(parallelMesh.getOffset(), serialMesh.getOffset());
+		for (uint32_t uVertex = 0; uVertex < serialMesh.getNoOfVertices(); uVertex++)
+		{
+			QCOMPARE(parallelMesh.getVertex(uVertex).encodedPosition, serialMesh.getVertex(uVertex).encodedPosition);
+			QCOMPARE(parallelMesh.getVertex(uVertex).encodedNormal, serialMesh.getVertex(uVertex).encodedNormal);
+			QCOMPARE(parallelMesh.getVertex(uVertex).data, serialMesh.getVertex(uVertex).data);
+		}
+		for (uint32_t uIndex = 0; uIndex < serialMesh.getNoOfIndices(); uIndex++)
+		{
+			QCOMPARE(parallelMesh.getIndex(uIndex), serialMesh.getIndex(uIndex));
+		}
+	}
+
+	// The custom version also works with other mesh types.
+	Mesh< MarchingCubesVertex< float >, uint32_t > customMesh;
+	extractMarchingCubesMeshParallelCustom(&noiseVol, region, &customMesh, 3);
+	QCOMPARE(customMesh.getNoOfIndices(), serialMesh.getNoOfIndices());
+}
+
+void TestSurfaceExtractor::testBufferMesh()
+{
+	auto uintVol = createAndFillVolume< RawVolume<uint8_t> >();
+	Region region = uintVol->getEnclosingRegion();
+	auto uintMesh = extractMarchingCubesMesh(uintVol, region);
+
+	// Counting the mesh gives the size of the buffers, and extracting into them gives the same mesh as usual.
+	MeshCounter< MarchingCubesVertex< uint8_t > > counter;
+	extractMarchingCubesMeshCustom(uintVol, region, &counter, DefaultMarchingCubesController<uint8_t>());
+	QCOMPARE(counter.getNoOfVertices(), uintMesh.getNoOfVertices());
+	QCOMPARE(counter.getNoOfIndices(), uintMesh.getNoOfIndices());
+
+	std::vector< MarchingCubesVertex< uint8_t > > vecVertices(counter.getNoOfVertices());
+	std::vector<uint32_t> vecIndices(counter.getNoOfIndices());
+	BufferMesh< MarchingCubesVertex< uint8_t > > bufferMesh(vecVertices.data(), static_cast<uint32_t>(vecVertices.size()), vecIndices.data(), static_cast<uint32_t>(vecIndices.size()));
+	extractMarchingCubesMeshCustom(uintVol, region, &bufferMesh, DefaultMarchingCubesController<uint8_t>());
+	QCOMPARE(bufferMesh.getNoOfVertices(), uintMesh.getNoOfVertices());
+	QCOMPARE(bufferMesh.getOffset(), uintMesh.getOffset());
+	QVERIFY(std::equal(vecIndices.begin(), vecIndices.end(), uintMesh.getRawIndexData()));
+	for (uint32_t uVertex = 0; uVertex < uintMesh.getNoOfVertices(); uVertex++)
+	{
+		QCOMPARE(bufferMesh.getVertex(uVertex).encodedPosition, uintMesh.getVertex(uVertex).encodedPosition);
+		QCOMPARE(bufferMesh.getVertex(uVertex).encodedNormal, uintMesh.getVertex(uVertex).encodedNormal);
+	}
+
+	// The parallel extractor can also write into the buffers.
+	std::fill(vecIndices.begin(), vecIndices.end(), 0);
+	extractMarchingCubesMeshParallelCustom(uintVol, region, &bufferMesh, 3, DefaultMarchingCubesController<uint8_t>());
+	QCOMPARE(bufferMesh.getNoOfVertices(), uintMesh.getNoOfVertices());
+	QVERIFY(std::equal(vecIndices.begin(), vecIndices.end(), uintMesh.getRawIndexData()));
+
+	// Buffers which are too small are not overrun.
+	bufferMesh.setBuffers(vecVertices.data(), 100, vecIndices.data(), static_cast<uint32_t>(vecIndices.size()));
+	QVERIFY_EXCEPTION_THROWN(extractMarchingCubesMeshCustom(uintVol, region, &bufferMesh, DefaultMarchingCubesController<uint8_t>()), std::out_of_range);
+	QCOMPARE(bufferMesh.getNoOfVertices(), uint32_t(100));
+
+	// A Mesh which is reused keeps its memory, so once it is large enough further extractions do not reallocate it.
+	Mesh< MarchingCubesVertex< uint8_t > > reusedMesh;
+	reusedMesh.reserve(counter.getNoOfVertices(), counter.getNoOfIndices());
+	const MarchingCubesVertex< uint8_t >* pVertexData = reusedMesh.getRawVertexData();
+	const uint32_t* pIndexData = reusedMesh.getRawIndexData();
+	for (uint32_t uExtraction = 0; uExtraction < 3; uExtraction++)
+	{
+		extractMarchingCubesMeshCustom(uintVol, region, &reusedMesh, DefaultMarchingCubesController<uint8_t>());
+		QCOMPARE(reusedMesh.getNoOfIndices(), uintMesh.getNoOfIndices());
+		QCOMPARE(reusedMesh.getRawVertexData(), pVertexData);
+		QCOMPARE(reusedMesh.getRawIndexData(), pIndexData);
+	}
+
+	delete uintVol;
+}
+
+void TestSurfaceExtractor::testExtractionContext()
+{
+	auto uintVol = createAndFillVolume< RawVolume<uint8_t> >();
+	typedef Mesh< MarchingCubesVertex< uint8_t > > MarchingCubesMesh;
+
+	// The cubic extractor needs empty voxels, and a few different materials.
+	RawVolume<uint8_t> cubicVol(uintVol->getEnclosingRegion());
+	for (int32_t z = 0; z < 64; z++)
+	{
+		for (int32_t y = 0; y < 64; y++)
+		{
+			for (int32_t x = 0; x < 64; x++)
+			{
+				cubicVol.setVoxel(x, y, z, (x + y + z < 127) ? static_cast<uint8_t>(1 + (x / 4) % 3) : 0);
+			}
+		}
+	}
+	typedef Mesh< CubicVertex< uint8_t > > CubicMesh;
+
+	// Some blocks of the same size which all contain part of the surface.
+	std::vector<Region> vecBlocks;
+	vecBlocks.push_back(Region(32, 32, 32, 47, 47, 47));
+	vecBlocks.push_back(Region(40, 36, 32, 55, 51, 47));
+	vecBlocks.push_back(Region(24, 40, 36, 39, 55, 51));
+
+	ExtractionContext context;
+	MeshPool<MarchingCubesMesh> marchingCubesPool;
+	MeshPool<CubicMesh> cubicPool;
+	size_t uContextSizeInBytes = 0;
+	const MarchingCubesVertex< uint8_t >* pMarchingCubesVertexData = nullptr;
+	const CubicVertex< uint8_t >* pCubicVertexData = nullptr;
+	for (uint32_t uPass = 0; uPass < 2; uPass++)
+	{
+		for (const Region& region : vecBlocks)
+		{
+			// The context can be shared by both extractors, and gives the same meshes as extracting without it.
+			std::unique_ptr<MarchingCubesMesh> pMarchingCubesMesh = marchingCubesPool.acquireMesh();
+			extractMarchingCubesMeshCustom(uintVol, region, pMarchingCubesMesh.get(), DefaultMarchingCubesController<uint8_t>(), &context);
+			auto marchingCubesMesh = extractMarchingCubesMesh(uintVol, region);
+			QVERIFY(!marchingCubesMesh.isEmpty());
+			QCOMPARE(pMarchingCubesMesh->getNoOfVertices(), marchingCubesMesh.getNoOfVertices());
+			QVERIFY(std::equal(marchingCubesMesh.getRawIndexData(), marchingCubesMesh.getRawIndexData() + marchingCubesMesh.getNoOfIndices(), pMarchingCubesMesh->getRawIndexData()));
+			QCOMPARE(pMarchingCubesMesh->getOffset(), region.getLowerCorner());
+
+			std::unique_ptr<CubicMesh> pCubicMesh = cubicPool.acquireMesh();
+			extractCubicMeshCustom(&cubicVol, region, pCubicMesh.get(), DefaultIsQuadNeeded<uint8_t>(), true, &context);
+			auto cubicMesh = extractCubicMesh(&cubicVol, region);
+			QVERIFY(!cubicMesh.isEmpty());
+			QCOMPARE(pCubicMesh->getNoOfVertices(), cubicMesh.getNoOfVertices());
+			QVERIFY(std::equal(cubicMesh.getRawIndexData(), cubicMesh.getRawIndexData() + cubicMesh.getNoOfIndices(), pCubicMesh->getRawIndexData()));
+
+			// Once every block has been extracted the context and the pooled meshes are large enough for all of them,
+			// so the second pass neither grows the scratch buffers nor reallocates the meshes.
+			if (uPass > 0)
+			{
+				QCOMPARE(context.calculateSizeInBytes(), uContextSizeInBytes);
+				QCOMPARE(pMarchingCubesMesh->getRawVertexData(), pMarchingCubesVertexData);
+				QCOMPARE(pCubicMesh->getRawVertexData(), pCubicVertexData);
+			}
+
+			pMarchingCubesVertexData = pMarchingCubesMesh->getRawVertexData();
+			pCubicVertexData = pCubicMesh->getRawVertexData();
+			marchingCubesPool.releaseMesh(std::move(pMarchingCubesMesh));
+			cubicPool.releaseMesh(std::move(pCubicMesh));
+		}
+		uContextSizeInBytes = context.calculateSizeInBytes();
+	}
+
+	// Released meshes are cleared, and are handed out again until the pool is empty.
+	QCOMPARE(marchingCubesPool.getNoOfFreeMeshes(), uint32_t(1));
+	std::unique_ptr<MarchingCubesMesh> pFirstMesh = marchingCubesPool.acquireMesh();
+	QVERIFY(pFirstMesh->isEmpty());
+	QCOMPARE(pFirstMesh->getRawVertexData(), pMarchingCubesVertexData);
+	std::unique_ptr<MarchingCubesMesh> pSecondMesh = marchingCubesPool.acquireMesh();
+	QVERIFY(pSecondMesh.get() != pFirstMesh.get());
+	QCOMPARE(marchingCubesPool.getNoOfFreeMeshes(), uint32_t(0));
+	marchingCubesPool.releaseMesh(std::move(pFirstMesh));
+	marchingCubesPool.releaseMesh(std::move(pSecondMesh));
+	QCOMPARE(marchingCubesPool.getNoOfFreeMeshes(), uint32_t(2));
+	marchingCubesPool.releaseFreeMeshes();
+	QCOMPARE(marchingCubesPool.getNoOfFreeMeshes(), uint32_t(0));
+
+	context.releaseBuffers();
+	QCOMPARE(context.getNoOfBuffers(), uint32_t(0));
+
+	delete uintVol;
+}
+
+// Classifies densities from the whole range of an integer type with each available instruction set, and checks the results
+// against the scalar version. The thresholds include both ends of the range, where the bias for unsigned types matters most.
+template <typename DensityType>
+bool classificationOfIntegersMatchesScalar(uint32_t uCount)
+{
+	std::mt19937 rng;
+	std::vector<DensityType> vecDensities(uCount);
+	for (uint32_t uElement = 0; uElement < uCount; uElement++)
+	{
+		vecDensities[uElement] = static_cast<DensityType>(rng());
+	}
+
+	const DensityType atThresholds[] = { (std::numeric_limits<DensityType>::min)(), static_cast<DensityType>((std::numeric_limits<DensityType>::min)() + 1),
+		DensityType(0), DensityType(100), static_cast<DensityType>((std::numeric_limits<DensityType>::max)() / 2 + 1), (std::numeric_limits<DensityType>::max)() };
+	std::vector<uint32_t> vecExpectedMask(classificationSizeInWords(uCount));
+	std::vector<uint32_t> vecMask(classificationSizeInWords(uCount));
+	for (int iLevel = SimdLevels::Scalar; iLevel <= getSupportedSimdLevel(); iLevel++)
+	{
+		for (uint32_t uThreshold = 0; uThreshold < sizeof(atThresholds) / sizeof(atThresholds[0]); uThreshold++)
+		{
+			const uint32_t uExpected = classifyBelowThresholdScalar(vecDensities.data(), 0, uCount, atThresholds[uThreshold], vecExpectedMask.data());
+			if ((classifyBelowThreshold(vecDensities.data(), uCount, atThresholds[uThreshold], vecMask.data(), static_cast<SimdLevel>(iLevel)) != uExpected) ||
+				(vecMask != vecExpectedMask))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void TestSurfaceExtractor::testThresholdClassification()
+{
+	// Every instruction set which is available should give the same result as the scalar version,
+	// including for the elements at the end which don't fill a complete word of the bitmask.
+	const uint32_t uCount = 77;
+	std::mt19937 rng;
+	std::vector<float> vecFloats(uCount);
+	std::vector<int32_t> vecInts(uCount);
+	for (uint32_t uElement = 0; uElement < uCount; uElement++)
+	{
+		vecFloats[uElement] = static_cast<float>(rng() % 200) - 100.0f;
+		vecInts[uElement] = static_cast<int32_t>(rng() % 200) - 100;
+	}
+
+	std::vector<uint32_t> vecExpectedMask(classificationSizeInWords(uCount));
+	std::vector<uint32_t> vecMask(classificationSizeInWords(uCount));
+	for (int iLevel = SimdLevels::Scalar; iLevel <= getSupportedSimdLevel(); iLevel++)
+	{
+		const uint32_t uExpectedFloats = classifyBelowThresholdScalar(vecFloats.data(), 0, uCount, 5.0f, vecExpectedMask.data());
+		QCOMPARE(classifyBelowThreshold(vecFloats.data(), uCount, 5.0f, vecMask.data(), static_cast<SimdLevel>(iLevel)), uExpectedFloats);
+		QVERIFY(vecMask == vecExpectedMask);
+
+		const uint32_t uExpectedInts = classifyBelowThresholdScalar(vecInts.data(), 0, uCount, int32_t(-3), vecExpectedMask.data());
+		QCOMPARE(classifyBelowThreshold(vecInts.data(), uCount, int32_t(-3), vecMask.data(), static_cast<SimdLevel>(iLevel)), uExpectedInts);
+		QVERIFY(vecMask == vecExpectedMask);
+	}
+
+	// The 8 and 16 bit types are compared as signed integers, with a bias for the unsigned ones.
+	QVERIFY(classificationOfIntegersMatchesScalar<uint8_t>(uCount));
+	QVERIFY(classificationOfIntegersMatchesScalar<int8_t>(uCount));
+	QVERIFY(classificationOfIntegersMatchesScalar<uint16_t>(uCount));
+	QVERIFY(classificationOfIntegersMatchesScalar<int16_t>(uCount));
+	QVERIFY(classificationOfIntegersMatchesScalar<uint8_t>(256));
+	QVERIFY(classificationOfIntegersMatchesScalar<int16_t>(256));
+
+	// Most rows of a flat surface are entirely above or below the threshold and get skipped,
+	// but this should not affect the result.
+	RawVolume<float> planeVol(Region(0, 0, 0, 31, 31, 31));
+	for (int32_t z = 0; z < 32; z++)
+	{
+		for (int32_t y = 0; y < 32; y++)
+		{
+			for (int32_t x = 0; x < 32; x++)
+			{
+				planeVol.setVoxel(x, y, z, static_cast<float>(z) - 15.5f);
+			}
+		}
+	}
+	auto planeMesh = extractMarchingCubesMesh(&planeVol, planeVol.getEnclosingRegion());
+	QCOMPARE(planeMesh.getNoOfVertices(), uint32_t(32 * 32));
+	QCOMPARE(planeMesh.getNoOfIndices(), uint32_t(31 * 31 * 2 * 3));
+}
+
+// Behaves exactly like the default controller, but because it is a different type the
+// extractor cannot use the value ranges of the volume to skip over empty space.
+class NonSkippingController : public DefaultMarchingCubesController<float>
+{
+};
+
+// Counts the slices which are read by the extractor, to check that it skips those which are known to be entirely solid or air.
+class SliceCountingVolume : public RawVolume<float>
+{
+public:
+	SliceCountingVolume(const Region& regValid)
+		:RawVolume<float>(regValid)
+		, m_uNoOfSlicesGathered(0)
+	{
+	}
+
+	uint32_t m_uNoOfSlicesGathered;
+};
+
+void gatherVoxels(SliceCountingVolume* volData, const Region& region, float* pVoxels)
+{
+	volData->m_uNoOfSlicesGathered += region.getDepthInVoxels();
+	gatherVoxels(static_cast<RawVolume<float>*>(volData), region, pVoxels);
+}
+
+// Checks that two meshes have the same vertices and triangles in the same order.
+template <typename MeshType>
+bool meshesAreIdentical(const MeshType& mesh, const MeshType& otherMesh)
+{
+	if ((mesh.getNoOfVertices() != otherMesh.getNoOfVertices()) || (mesh.getNoOfIndices() != otherMesh.getNoOfIndices()))
+	{
+		return false;
+	}
+	for (uint32_t uVertex = 0; uVertex < mesh.getNoOfVertices(); uVertex++)
+	{
+		if ((mesh.getVertex(uVertex).encodedPosition != otherMesh.getVertex(uVertex).encodedPosition) ||
+			(mesh.getVertex(uVertex).encodedNormal != otherMesh.getVertex(uVertex).encodedNormal))
+		{
+			return false;
+		}
+	}
+	for (uint32_t uIndex = 0; uIndex < mesh.getNoOfIndices(); uIndex++)
+	{
+		if (mesh.getIndex(uIndex) != otherMesh.getIndex(uIndex))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestSurfaceExtractor::testEmptySpaceSkipping()
+{
+	// Terrain which is mostly solid at the bottom and mostly air at the top.
+	SliceCountingVolume terrainVol(Region(0, 0, 0, 95, 95, 95));
+	for (int32_t z = 0; z < 96; z++)
+	{
+		for (int32_t y = 0; y < 96; y++)
+		{
+			for (int32_t x = 0; x < 96; x++)
+			{
+				const float fHeight = 40.0f + 10.0f * std::sin(x * 0.1f) * std::cos(y * 0.07f);
+				terrainVol.setVoxel(x, y, z, static_cast<float>(z) - fHeight);
+			}
+		}
+	}
+
+	// Skipping the blocks of rows which are entirely solid or entirely air should not change the result.
+	Region region(2, 3, 4, 90, 91, 92);
+	terrainVol.m_uNoOfSlicesGathered = 0;
+	auto skippingMesh = extractMarchingCubesMesh(&terrainVol, region);
+	const uint32_t uNoOfSlicesGathered = terrainVol.m_uNoOfSlicesGathered;
+	terrainVol.m_uNoOfSlicesGathered = 0;
+	auto nonSkippingMesh = extractMarchingCubesMesh(&terrainVol, region, NonSkippingController());
+	QCOMPARE(terrainVol.m_uNoOfSlicesGathered, static_cast<uint32_t>(region.getDepthInVoxels() + 2));
+	QVERIFY(skippingMesh.getNoOfVertices() > 0);
+	QCOMPARE(skippingMesh.getNoOfVertices(), nonSkippingMesh.getNoOfVertices());
+	QCOMPARE(skippingMesh.getNoOfIndices(), nonSkippingMesh.getNoOfIndices());
+	for (uint32_t uVertex = 0; uVertex < skippingMesh.getNoOfVertices(); uVertex++)
+	{
+		QCOMPARE(skippingMesh.getVertex(uVertex).encodedPosition, nonSkippingMesh.getVertex(uVertex).encodedPosition);
+		QCOMPARE(skippingMesh.getVertex(uVertex).encodedNormal, nonSkippingMesh.getVertex(uVertex).encodedNormal);
+	}
+	for (uint32_t uIndex = 0; uIndex < skippingMesh.getNoOfIndices(); uIndex++)
+	{
+		QCOMPARE(skippingMesh.getIndex(uIndex), nonSkippingMesh.getIndex(uIndex));
+	}
+
+	// The slices which are entirely solid or entirely air are not read at all. The value ranges of the volume are only known for
+	// blocks of voxels, so some of the slices near the surface are still read even though they do not contain any of it.
+	QVERIFY(uNoOfSlicesGathered < static_cast<uint32_t>(region.getDepthInVoxels() * 3 / 4));
+
+	// The slabs of the parallel extraction still join up when their first or last slices are skipped.
+	QVERIFY(meshesAreIdentical(extractMarchingCubesMeshParallel(&terrainVol, region, 4), extractMarchingCubesMeshParallel(&terrainVol, region, 4, NonSkippingController())));
+	QVERIFY(meshesAreIdentical(extractMarchingCubesMeshParallel(&terrainVol, Region(2, 3, 20, 90, 91, 92), 4),
+		extractMarchingCubesMeshParallel(&terrainVol, Region(2, 3, 20, 90, 91, 92), 4, NonSkippingController())));
+
+	// A region which lies entirely in the air does not need to be visited at all.
+	QCOMPARE(extractMarchingCubesMesh(&terrainVol, Region(0, 0, 60, 95, 95, 95)).getNoOfVertices(), uint32_t(0));
+}
+
 void TestSurfaceExtractor::testEmptyVolumePerformance()
 {
 	auto emptyVol = createAndFillVolumeWithNoise< PagedVolume<float> >(128, 512, -2.0f, -1.0f);
@@ -33,6 +33,11 @@ class TestSurfaceExtractor: public QObject
 	
 	private slots:
 		void testBehaviour();
+		void testParallelExtraction();
+		void testBufferMesh();
+		void testExtractionContext();
+		void testThresholdClassification();
+		void testEmptySpaceSkipping();
 		void testEmptyVolumePerformance();
 		void testNoiseVolumePerformance();
 };
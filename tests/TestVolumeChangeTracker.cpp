@@ -0,0 +1,328 @@
+/*******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 David Williams and Matthew Williams
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*******************************************************************************/
+
+#include "TestVolumeChangeTracker.h"
+
+#include "PolyVox/CubicSurfaceExtractor.h"
+#include "PolyVox/FilePager.h"
+#include "PolyVox/MarchingCubesSurfaceExtractor.h"
+#include "PolyVox/PagedVolume.h"
+#include "PolyVox/RawVolume.h"
+#include "PolyVox/RemeshScheduler.h"
+#include "PolyVox/VolumeChangeTracker.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+using namespace PolyVox;
+
+// Finds the changes for the block containing the given position.
+Region findChange(const std::vector<Region>& vecChanges, const Vector3DInt32& v3dPos)
+{
+	for (auto iter = vecChanges.begin(); iter != vecChanges.end(); iter++)
+	{
+		if (iter->containsPoint(v3dPos))
+		{
+			return *iter;
+		}
+	}
+	return Region::InvertedRegion();
+}
+
+void TestVolumeChangeTracker::testRecording()
+{
+	// Each change is recorded against its block, along with the region bounding the changes in that block.
+	VolumeChangeTracker tracker(16);
+	RawVolume<uint8_t> rawVolume(Region(0, 0, 0, 63, 63, 63));
+	rawVolume.setChangeTracker(&tracker);
+	QVERIFY(!tracker.hasChanges());
+
+	rawVolume.setVoxel(20, 21, 22, 1);
+	rawVolume.setVoxel(24, 18, 22, 1);
+	RawVolume<uint8_t>::Sampler sampler(&rawVolume);
+	sampler.setPosition(40, 41, 42);
+	sampler.setVoxel(1);
+	QCOMPARE(tracker.getNoOfChangedBlocks(), uint32_t(2));
+
+	std::vector<Region> vecChanges = tracker.takeChanges();
+	QCOMPARE(vecChanges.size(), size_t(2));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(20, 21, 22)), Region(20, 18, 22, 24, 21, 22));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(40, 41, 42)), Region(40, 41, 42, 40, 41, 42));
+	QVERIFY(!tracker.hasChanges());
+
+	// Writing the value which a voxel already has is not a change, whether through the volume or a sampler.
+	rawVolume.setVoxel(20, 21, 22, 1);
+	rawVolume.setVoxel(5, 6, 7, 0);
+	QVERIFY(sampler.setVoxel(1));
+	sampler.setPosition(50, 51, 52);
+	QVERIFY(sampler.setVoxel(0));
+	QVERIFY(!tracker.hasChanges());
+
+	// Changed regions are split up between the blocks which they overlap.
+	tracker.regionChanged(Region(10, 10, 10, 20, 12, 12));
+	vecChanges = tracker.takeChanges();
+	QCOMPARE(vecChanges.size(), size_t(2));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(10, 10, 10)), Region(10, 10, 10, 15, 12, 12));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(20, 10, 10)), Region(16, 10, 10, 20, 12, 12));
+
+	// Nothing is recorded once the tracker has been removed.
+	rawVolume.setChangeTracker(nullptr);
+	rawVolume.setVoxel(1, 2, 3, 1);
+	QVERIFY(!tracker.hasChanges());
+
+	// The PagedVolume records its changes in the same way, including those at negative positions.
+	FilePager<uint8_t> pager(".");
+	PagedVolume<uint8_t> pagedVolume(&pager, 1024 * 1024, 16);
+	pagedVolume.setChangeTracker(&tracker);
+	pagedVolume.setVoxel(-1, -1, -1, 1);
+	pagedVolume.setVoxel(-16, -5, -3, 1);
+	pagedVolume.setVoxel(0, 0, 0, 1);
+	vecChanges = tracker.takeChanges();
+	QCOMPARE(vecChanges.size(), size_t(2));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(-1, -1, -1)), Region(-16, -5, -3, -1, -1, -1));
+	QCOMPARE(findChange(vecChanges, Vector3DInt32(0, 0, 0)), Region(0, 0, 0, 0, 0, 0));
+
+	// Writing the value which a voxel already has is not a change.
+	pagedVolume.setVoxel(0, 0, 0, 1);
+	pagedVolume.setVoxel(40, 40, 40, 0);
+	QVERIFY(!tracker.hasChanges());
+	pagedVolume.setChangeTracker(nullptr);
+
+	// With concurrent access, a change is only recorded once the new value can be seen. Here the voxels along a line
+	// are written one at a time, so the last voxel in each recorded Region should already have been written.
+	PagedVolume<uint8_t> concurrentVolume(&pager, 1024 * 1024, 16, true);
+	concurrentVolume.setChangeTracker(&tracker);
+	concurrentVolume.setVoxel(0, 0, 0, 1);
+	concurrentVolume.setVoxel(0, 0, 0, 1);
+	QCOMPARE(tracker.takeChanges().size(), size_t(1));
+
+	const int32_t iLineLength = 20000;
+	std::atomic<bool> bWriting(true);
+	std::thread writer([&]()
+	{
+		for (int32_t x = 0; x < iLineLength; x++)
+		{
+			concurrentVolume.setVoxel(x, 1, 1, 1);
+		}
+		bWriting = false;
+	});
+
+	uint32_t uNoOfUnwrittenChanges = 0;
+	do
+	{
+		for (const Region& region : tracker.takeChanges())
+		{
+			uNoOfUnwrittenChanges += (concurrentVolume.getVoxel(region.getUpperCorner()) == 1) ? 0 : 1;
+		}
+	} while (bWriting);
+	writer.join();
+	QCOMPARE(uNoOfUnwrittenChanges, uint32_t(0));
+	concurrentVolume.setChangeTracker(nullptr);
+}
+
+void TestVolumeChangeTracker::testScheduling()
+{
+	// A change in the middle of a block only affects that block, but the cubic extractor compares
+	// voxels with their neighbours on the negative side so changes on the upper faces also affect
+	// the next blocks along.
+	RemeshScheduler cubicScheduler(MeshBlockTypes::Cubic, 16);
+	cubicScheduler.addChangedRegion(Region(20, 20, 20, 20, 20, 20));
+	QCOMPARE(cubicScheduler.getNoOfPendingBlocks(), uint32_t(1));
+	QVERIFY(cubicScheduler.isBlockPending(Vector3DInt32(1, 1, 1)));
+	cubicScheduler.addChangedRegion(Region(16, 17, 18, 16, 17, 18));
+	QCOMPARE(cubicScheduler.getNoOfPendingBlocks(), uint32_t(1));
+	cubicScheduler.addChangedRegion(Region(31, 20, 31, 31, 20, 31));
+	QCOMPARE(cubicScheduler.getNoOfPendingBlocks(), uint32_t(4));
+	QVERIFY(cubicScheduler.isBlockPending(Vector3DInt32(2, 1, 2)));
+
+	// Blocks are processed in order and only once, however many changes affect them.
+	std::vector<Vector3DInt32> vecBlocks = cubicScheduler.takePendingBlocks(3);
+	QCOMPARE(vecBlocks.size(), size_t(3));
+	QCOMPARE(vecBlocks[0], Vector3DInt32(1, 1, 1));
+	QCOMPARE(vecBlocks[1], Vector3DInt32(2, 1, 1));
+	QCOMPARE(vecBlocks[2], Vector3DInt32(1, 1, 2));
+	QCOMPARE(cubicScheduler.getNoOfPendingBlocks(), uint32_t(1));
+	QCOMPARE(cubicScheduler.getExtractionRegion(Vector3DInt32(2, 1, 2)), Region(32, 16, 32, 47, 31, 47));
+	QCOMPARE(cubicScheduler.getDependencyRegion(Vector3DInt32(2, 1, 2)), Region(31, 15, 31, 47, 31, 47));
+
+	// The Marching Cubes extractor is given overlapping regions and also computes normals, so changes near any face of a block affect its neighbours.
+	RemeshScheduler marchingCubesScheduler(MeshBlockTypes::MarchingCubes, 16);
+	marchingCubesScheduler.addChangedRegion(Region(20, 20, 20, 20, 20, 20));
+	QCOMPARE(marchingCubesScheduler.getNoOfPendingBlocks(), uint32_t(1));
+	marchingCubesScheduler.addChangedRegion(Region(17, 20, 20, 17, 20, 20));
+	QCOMPARE(marchingCubesScheduler.getNoOfPendingBlocks(), uint32_t(2));
+	QVERIFY(marchingCubesScheduler.isBlockPending(Vector3DInt32(0, 1, 1)));
+	QCOMPARE(marchingCubesScheduler.getExtractionRegion(Vector3DInt32(0, 1, 1)), Region(0, 16, 16, 16, 32, 32));
+	QCOMPARE(marchingCubesScheduler.getDependencyRegion(Vector3DInt32(0, 1, 1)), Region(-1, 15, 15, 17, 33, 33));
+
+	// The changes can be taken straight from a tracker.
+	VolumeChangeTracker tracker(32);
+	tracker.voxelChanged(100, 100, 100);
+	marchingCubesScheduler.addChanges(tracker);
+	QVERIFY(!tracker.hasChanges());
+	QVERIFY(marchingCubesScheduler.isBlockPending(Vector3DInt32(6, 6, 6)));
+	QCOMPARE(marchingCubesScheduler.getNoOfPendingBlocks(), uint32_t(3));
+}
+
+// Checks that two meshes contain the same vertices and indices.
+template <typename MeshType>
+bool meshesAreEqual(const MeshType& meshA, const MeshType& meshB)
+{
+	if ((meshA.getNoOfVertices() != meshB.getNoOfVertices()) || (meshA.getNoOfIndices() != meshB.getNoOfIndices()))
+	{
+		return false;
+	}
+
+	for (typename MeshType::IndexType uVertex = 0; uVertex < meshA.getNoOfVertices(); uVertex++)
+	{
+		auto vertexA = decodeVertex(meshA.getVertex(uVertex));
+		auto vertexB = decodeVertex(meshB.getVertex(uVertex));
+		if (!(vertexA.position == vertexB.position) || !(vertexA.normal == vertexB.normal) || !(vertexA.data == vertexB.data))
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t uIndex = 0; uIndex < meshA.getNoOfIndices(); uIndex++)
+	{
+		if (meshA.getIndex(uIndex) != meshB.getIndex(uIndex))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Keeps a mesh for each block of the volume up to date by only extracting the blocks given by the scheduler, and
+// checks that the meshes are the same as if they had all been extracted again. Returns the number of blocks which
+// had to be extracted again after making the edits. Edits on the faces of the volume can also schedule blocks which
+// lie outside of it, and these are skipped (as an application would do).
+template <typename VolumeType, typename ExtractorType>
+uint32_t testRemeshing(VolumeType& volume, const Region& regVolume, RemeshScheduler& scheduler, ExtractorType extractor, const std::vector<Vector3DInt32>& vecEdits, bool& bMeshesMatch)
+{
+	typedef decltype(extractor(&volume, Region())) MeshType;
+	std::unordered_map<Vector3DInt32, MeshType> mapMeshes;
+	uint32_t uNoOfBlocksExtracted = 0;
+	auto extractBlock = [&](const Vector3DInt32& v3dBlock, const Region& region)
+	{
+		if (regVolume.containsPoint(region.getLowerCorner()))
+		{
+			mapMeshes[v3dBlock] = extractor(&volume, region);
+			uNoOfBlocksExtracted++;
+		}
+	};
+
+	scheduler.addBlocksInRegion(regVolume);
+	scheduler.processPendingBlocks(extractBlock);
+	const uint32_t uNoOfBlocks = static_cast<uint32_t>(mapMeshes.size());
+	uNoOfBlocksExtracted = 0;
+
+	VolumeChangeTracker tracker;
+	volume.setChangeTracker(&tracker);
+	for (auto iter = vecEdits.begin(); iter != vecEdits.end(); iter++)
+	{
+		volume.setVoxel(*iter, volume.getVoxel(*iter) > 0 ? 0 : 255);
+	}
+	volume.setChangeTracker(nullptr);
+
+	scheduler.addChanges(tracker);
+	scheduler.processPendingBlocks(extractBlock);
+
+	bMeshesMatch = (mapMeshes.size() == uNoOfBlocks);
+	for (auto iter = mapMeshes.begin(); iter != mapMeshes.end(); iter++)
+	{
+		bMeshesMatch = bMeshesMatch && meshesAreEqual(iter->second, extractor(&volume, scheduler.getExtractionRegion(iter->first)));
+	}
+
+	return uNoOfBlocksExtracted;
+}
+
+template <typename VolumeType>
+void createSphere(VolumeType& volume, const Region& regVolume)
+{
+	const Vector3DFloat v3dCentre = static_cast<Vector3DFloat>(regVolume.getCentre());
+	for (int32_t z = regVolume.getLowerZ(); z <= regVolume.getUpperZ(); z++)
+	{
+		for (int32_t y = regVolume.getLowerY(); y <= regVolume.getUpperY(); y++)
+		{
+			for (int32_t x = regVolume.getLowerX(); x <= regVolume.getUpperX(); x++)
+			{
+				const float fDistance = (Vector3DFloat(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) - v3dCentre).length();
+				volume.setVoxel(x, y, z, fDistance < 20.0f ? 255 : 0);
+			}
+		}
+	}
+}
+
+// The edits are made in the middle of a block, on its lower and upper faces, and at a corner of the volume.
+std::vector<Vector3DInt32> createEdits(void)
+{
+	std::vector<Vector3DInt32> vecEdits;
+	vecEdits.push_back(Vector3DInt32(20, 21, 22));
+	vecEdits.push_back(Vector3DInt32(32, 20, 40));
+	vecEdits.push_back(Vector3DInt32(33, 47, 40));
+	vecEdits.push_back(Vector3DInt32(15, 15, 15));
+	vecEdits.push_back(Vector3DInt32(63, 63, 0));
+	return vecEdits;
+}
+
+void TestVolumeChangeTracker::testCubicRemeshing()
+{
+	const Region regVolume(0, 0, 0, 63, 63, 63);
+	RawVolume<uint8_t> volume(regVolume);
+	createSphere(volume, regVolume);
+
+	RemeshScheduler scheduler(MeshBlockTypes::Cubic, 16);
+	bool bMeshesMatch = false;
+	const uint32_t uNoOfBlocksExtracted = testRemeshing(volume, regVolume, scheduler,
+		[](RawVolume<uint8_t>* volData, const Region& region) { return extractCubicMesh(volData, region); }, createEdits(), bMeshesMatch);
+	QVERIFY(bMeshesMatch);
+
+	// One block for the edit on the lower face, two for the edit on the upper face, eight for the edit on the upper
+	// corner of a block (which include the block containing the edit in its middle), and one for the edit on the
+	// corner of the volume (whose other neighbours are outside of the volume).
+	QCOMPARE(uNoOfBlocksExtracted, uint32_t(1 + 2 + 8 + 1));
+}
+
+void TestVolumeChangeTracker::testMarchingCubesRemeshing()
+{
+	const Region regVolume(0, 0, 0, 63, 63, 63);
+	FilePager<uint8_t> pager(".");
+	PagedVolume<uint8_t> volume(&pager, 4 * 1024 * 1024, 16);
+	createSphere(volume, regVolume);
+
+	RemeshScheduler scheduler(MeshBlockTypes::MarchingCubes, 16);
+	bool bMeshesMatch = false;
+	const uint32_t uNoOfBlocksExtracted = testRemeshing(volume, regVolume, scheduler,
+		[](PagedVolume<uint8_t>* volData, const Region& region) { return extractMarchingCubesMesh(volData, region); }, createEdits(), bMeshesMatch);
+	QVERIFY(bMeshesMatch);
+	QVERIFY(uNoOfBlocksExtracted < 64);
+}
+
+QTEST_MAIN(TestVolumeChangeTracker)
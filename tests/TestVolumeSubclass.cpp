@@ -27,6 +27,7 @@
 #include "PolyVox/Array.h"
 
 #include "PolyVox/BaseVolume.h"
+#include "PolyVox/Brush.h"
 #include "PolyVox/CubicSurfaceExtractor.h"
 #include "PolyVox/Material.h"
 #include "PolyVox/Vector.h"
@@ -141,4 +142,20 @@ void TestVolumeSubclass::testExtractSurface()
 	QCOMPARE(result.getNoOfVertices(), static_cast<uint32_t>(8));
 }
 
+void TestVolumeSubclass::testApplyBrush()
+{
+	// Volumes which don't provide their own modifyVoxels() are modified one voxel at a time.
+	Region region(0, 0, 0, 16, 16, 16);
+	VolumeSubclass<Material8> volumeSubclass(region);
+
+	std::vector<Region> vecChangedRegions = applyBrush(&volumeSubclass, SphereBrush(Vector3DFloat(8.0f, 8.0f, 8.0f), 3.0f), Material8(1));
+	QCOMPARE(vecChangedRegions.size(), static_cast<size_t>(1));
+	QCOMPARE(vecChangedRegions[0], Region(5, 5, 5, 11, 11, 11));
+	QCOMPARE(volumeSubclass.getVoxel(8, 8, 11).getMaterial(), static_cast<uint8_t>(1));
+	QCOMPARE(volumeSubclass.getVoxel(8, 8, 12).getMaterial(), static_cast<uint8_t>(0));
+
+	vecChangedRegions = applyBrush(&volumeSubclass, SphereBrush(Vector3DFloat(8.0f, 8.0f, 8.0f), 3.0f), Material8(1));
+	QVERIFY(vecChangedRegions.empty());
+}
+
 QTEST_MAIN(TestVolumeSubclass)
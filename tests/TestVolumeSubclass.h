@@ -33,6 +33,7 @@ class TestVolumeSubclass: public QObject
 	
 	private slots:
 		void testExtractSurface();
+		void testApplyBrush();
 };
 
 #endif
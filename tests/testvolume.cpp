@@ -24,14 +24,23 @@
 
 #include "testvolume.h"
 
+#include "PolyVox/ChunkCodec.h"
+#include "PolyVox/CubicSurfaceExtractor.h"
 #include "PolyVox/FilePager.h"
+#include "PolyVox/Material.h"
 #include "PolyVox/PagedVolume.h"
 #include "PolyVox/RawVolume.h"
+#include "PolyVox/RegionFilePager.h"
 
 #include <QtGlobal>
 #include <QtTest>
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <random>
+#include <thread>
+#include <vector>
 
 using namespace PolyVox;
 
@@ -260,11 +269,13 @@ TestVolume::TestVolume()
 
 	m_pFilePager = new FilePager<int32_t>(".");
 	m_pFilePagerHighMem = new FilePager<int32_t>(".");
+	m_pFilePagerConcurrent = new FilePager<int32_t>(".");
 
 	//Create the volumes
 	m_pRawVolume = new RawVolume<int32_t>(m_regVolume);
 	m_pPagedVolume = new PagedVolume<int32_t>(m_pFilePager, 1 * 1024 * 1024, m_uChunkSideLength);
 	m_pPagedVolumeHighMem = new PagedVolume<int32_t>(m_pFilePagerHighMem, 256 * 1024 * 1024, m_uChunkSideLength);
+	m_pPagedVolumeConcurrent = new PagedVolume<int32_t>(m_pFilePagerConcurrent, 8 * 1024 * 1024, m_uChunkSideLength, true);
 
 	//Fill the volume with some data
 	for (int z = m_regVolume.getLowerZ(); z <= m_regVolume.getUpperZ(); z++)
@@ -277,6 +288,7 @@ TestVolume::TestVolume()
 				m_pRawVolume->setVoxel(x, y, z, value);
 				m_pPagedVolume->setVoxel(x, y, z, value);
 				m_pPagedVolumeHighMem->setVoxel(x, y, z, value);
+				m_pPagedVolumeConcurrent->setVoxel(x, y, z, value);
 			}
 		}
 	}
@@ -301,8 +313,10 @@ TestVolume::~TestVolume()
 
 	delete m_pRawVolume;
 	delete m_pPagedVolume;
+	delete m_pPagedVolumeConcurrent;
 
 	delete m_pFilePager;
+	delete m_pFilePagerConcurrent;
 }
 
 /*
@@ -600,4 +614,946 @@ void TestVolume::testPagedVolumeChunkRandomAccess()
 	QCOMPARE(result, static_cast<int32_t>(71649197));
 }
 
+/*
+ * Concurrent access tests
+ */
+void TestVolume::testPagedVolumeConcurrentAccess()
+{
+	// The volume can only hold about half of its chunks at once so the threads are continually paging chunks in and out.
+	const uint32_t uNoOfReaders = 4;
+	std::vector<int32_t> results(uNoOfReaders * 2);
+	QBENCHMARK
+	{
+		std::vector<std::thread> threads;
+		for (uint32_t ct = 0; ct < uNoOfReaders; ct++)
+		{
+			threads.push_back(std::thread([&, ct]() { results[ct * 2] = testSamplersWithWrappingForwards(m_pPagedVolumeConcurrent, m_regExternal); }));
+			threads.push_back(std::thread([&, ct]() { results[ct * 2 + 1] = testDirectAccessWithWrappingBackwards(m_pPagedVolumeConcurrent, m_regInternal); }));
+		}
+
+		// An editor thread which rewrites the existing values, so that the results of the readers are unaffected.
+		threads.push_back(std::thread([&]()
+		{
+			for (int z = m_regVolume.getLowerZ(); z <= m_regVolume.getUpperZ(); z += 3)
+			{
+				for (int y = m_regVolume.getLowerY(); y <= m_regVolume.getUpperY(); y++)
+				{
+					for (int x = m_regVolume.getLowerX(); x <= m_regVolume.getUpperX(); x++)
+					{
+						m_pPagedVolumeConcurrent->setVoxel(x, y, z, x + y + z);
+					}
+				}
+			}
+		}));
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	for (uint32_t ct = 0; ct < uNoOfReaders; ct++)
+	{
+		QCOMPARE(results[ct * 2], static_cast<int32_t>(337227750));
+		QCOMPARE(results[ct * 2 + 1], static_cast<int32_t>(-269366578));
+	}
+}
+
+void TestVolume::testPagedVolumeAsyncPaging()
+{
+	// The volume only has room for a small part of the region (64 chunks out of 512), so as we write to it the
+	// paging threads must continually evict and write back chunks in order to stay within the memory limit.
+	const uint32_t uTargetMemoryUsageInBytes = 1024 * 1024;
+	FilePager<int32_t> pager(".");
+	PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, 16, true, 2);
+	QVERIFY(volume.isAsyncPagingEnabled());
+
+	Region region(0, 0, 0, 127, 127, 127);
+	int32_t iValue = 0;
+	QVERIFY(!volume.isRegionResident(region));
+	QVERIFY(!volume.tryGetVoxel(0, 0, 0, iValue));
+
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, x + y * 3 + z * 5);
+			}
+		}
+	}
+
+	// Reading the data back means paging in chunks which may still be being written out by the paging threads.
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z) - (x + y * 3 + z * 5));
+			}
+		}
+	}
+	QCOMPARE(result, static_cast<int32_t>(0));
+
+	// An asynchronous prefetch makes the data available to tryGetVoxel(), and the paging threads keep within the memory limit.
+	// The first request is cancelled so that it cannot cause the chunks from the second request to be evicted again.
+	Region regPrefetch(64, 64, 64, 95, 95, 95);
+	volume.prefetchAsync(Region(0, 0, 0, 127, 127, 15));
+	volume.cancelAsyncPrefetches();
+	volume.prefetchAsync(regPrefetch);
+	volume.waitForAsyncPrefetches();
+	QVERIFY(volume.isRegionResident(regPrefetch));
+	QVERIFY(volume.tryGetVoxel(70, 80, 90, iValue));
+	QCOMPARE(iValue, static_cast<int32_t>(70 + 80 * 3 + 90 * 5));
+	QVERIFY(volume.calculateSizeInBytes() <= uTargetMemoryUsageInBytes);
+}
+
+void TestVolume::testPagedVolumePrefetch()
+{
+	// Prefetching works with and without concurrent access, and pages in the whole region if there is room for it.
+	for (bool bConcurrentAccess : { false, true })
+	{
+		FilePager<int32_t> pager(".");
+		PagedVolume<int32_t> volume(&pager, 1024 * 1024, 16, bConcurrentAccess);
+		volume.setVoxel(40, 50, 60, 7);
+
+		Region regPrefetch(0, 0, 0, 63, 63, 63);
+		QVERIFY(!volume.isRegionResident(regPrefetch));
+		volume.prefetch(regPrefetch);
+		QVERIFY(volume.isRegionResident(regPrefetch));
+		QCOMPARE(volume.getVoxel(40, 50, 60), static_cast<int32_t>(7));
+
+		// Asking for more than the volume can hold is allowed, but it stays within the memory limit.
+		volume.prefetch(Region(0, 0, 0, 255, 255, 255));
+		QVERIFY(volume.calculateSizeInBytes() <= 1024 * 1024);
+	}
+}
+
+void TestVolume::testPagedVolumeCompression()
+{
+	// There is only room for 64 uncompressed chunks, and only half of those are allowed to stay uncompressed.
+	const uint32_t uTargetMemoryUsageInBytes = 1024 * 1024;
+	FilePager<int32_t> pager(".");
+	PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, 16);
+	volume.setMaxNumberOfUncompressedChunks(32);
+
+	// Each chunk is filled with a single value apart from one voxel, so the chunks compress well and all 512 of
+	// them should stay in memory. Reading them back means decompressing most of them again.
+	Region region(0, 0, 0, 127, 127, 127);
+	auto expectedValue = [](int x, int y, int z)
+	{
+		return ((x & 15) == 5 && (y & 15) == 6 && (z & 15) == 7) ? -1 : (x >> 4) + (y >> 4) * 8 + (z >> 4) * 64;
+	};
+
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, expectedValue(x, y, z));
+			}
+		}
+	}
+
+	QVERIFY(volume.isRegionResident(region));
+	QVERIFY(volume.calculateSizeInBytes() <= uTargetMemoryUsageInBytes);
+
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z) - expectedValue(x, y, z));
+			}
+		}
+	}
+	QCOMPARE(result, static_cast<int32_t>(0));
+	QVERIFY(volume.isRegionResident(region));
+
+	// Prefetching and querying value ranges access chunks without them becoming the last accessed chunk, and so can cause
+	// the last accessed chunk to be compressed. Accessing it again must not use the compressed data as if it wasn't.
+	const Region regOtherChunks(16, 0, 0, 127, 127, 15);
+	volume.setVoxel(5, 6, 7, 42);
+	volume.prefetch(regOtherChunks);
+	QCOMPARE(volume.getVoxel(5, 6, 7), static_cast<int32_t>(42));
+	int32_t iMin, iMax;
+	volume.getRegionValueRange(regOtherChunks, iMin, iMax);
+	volume.setVoxel(5, 6, 7, 43);
+	volume.getRegionValueRange(regOtherChunks, iMin, iMax);
+	QCOMPARE(volume.getVoxel(5, 6, 7), static_cast<int32_t>(43));
+	QCOMPARE(volume.getVoxel(6, 6, 7), expectedValue(6, 6, 7));
+}
+
+// Generates simple terrain, with solid rock below y = 40 and empty space above it. The pager
+// knows that everything from y = 64 upwards is empty and so does not need to be paged in.
+class TerrainPager : public PagedVolume<int32_t>::Pager
+{
+public:
+	TerrainPager()
+		:PagedVolume<int32_t>::Pager()
+		, m_uNoOfPageIns(0)
+	{
+	}
+
+	virtual void pageIn(const Region& region, PagedVolume<int32_t>::Chunk* pChunk)
+	{
+		m_uNoOfPageIns++;
+		for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+		{
+			for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+			{
+				for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+				{
+					pChunk->setVoxel(x - region.getLowerX(), y - region.getLowerY(), z - region.getLowerZ(), (y < 40) ? 1 : 0);
+				}
+			}
+		}
+	}
+
+	virtual void pageOut(const Region& /*region*/, PagedVolume<int32_t>::Chunk* /*pChunk*/)
+	{
+	}
+
+	virtual bool isRegionUniform(const Region& region, int32_t& tValue)
+	{
+		tValue = 0;
+		return region.getLowerY() >= 64;
+	}
+
+	uint32_t m_uNoOfPageIns;
+};
+
+void TestVolume::testPagedVolumeUniformChunks()
+{
+	const uint32_t uChunkSizeInBytes = 16 * 16 * 16 * sizeof(int32_t);
+	TerrainPager pager;
+	PagedVolume<int32_t> volume(&pager, 16 * 1024 * 1024, 16);
+
+	// Only the chunks below y = 64 are paged in, and only the ones containing the surface need their own data.
+	Region region(0, 0, 0, 63, 127, 63);
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z) - ((y < 40) ? 1 : 0));
+			}
+		}
+	}
+	QCOMPARE(result, static_cast<int32_t>(0));
+	QCOMPARE(pager.m_uNoOfPageIns, static_cast<uint32_t>(64));
+	QVERIFY(volume.calculateSizeInBytes() < 32 * uChunkSizeInBytes);
+
+	int32_t iValue = -1;
+	QVERIFY(volume.isRegionUniform(Region(0, 64, 0, 63, 127, 63), iValue));
+	QCOMPARE(iValue, static_cast<int32_t>(0));
+	QVERIFY(volume.isRegionUniform(Region(0, 0, 0, 63, 31, 63), iValue));
+	QCOMPARE(iValue, static_cast<int32_t>(1));
+	QVERIFY(!volume.isRegionUniform(Region(0, 32, 0, 63, 47, 63), iValue));
+	QVERIFY(!volume.isRegionUniform(Region(0, 0, 0, 63, 127, 63), iValue));
+
+	// The surface extractors skip uniform regions, but still find the surface elsewhere.
+	QCOMPARE(extractCubicMesh(&volume, Region(0, 64, 0, 63, 127, 63)).getNoOfIndices(), static_cast<uint32_t>(0));
+	QVERIFY(extractCubicMesh(&volume, Region(0, 32, 0, 15, 47, 15)).getNoOfIndices() > 0);
+
+	// Writing the existing value to a uniform chunk leaves it uniform, while writing a different value
+	// gives it its own data without affecting the other chunks which had the same contents.
+	volume.setVoxel(10, 100, 10, 0);
+	QVERIFY(volume.isRegionUniform(Region(0, 96, 0, 15, 111, 15), iValue));
+	volume.setVoxel(10, 100, 10, 7);
+	QCOMPARE(volume.getVoxel(10, 100, 10), static_cast<int32_t>(7));
+	QCOMPARE(volume.getVoxel(11, 100, 10), static_cast<int32_t>(0));
+	QCOMPARE(volume.getVoxel(42, 100, 42), static_cast<int32_t>(0));
+	QVERIFY(!volume.isRegionUniform(Region(0, 96, 0, 15, 111, 15), iValue));
+	QVERIFY(volume.isRegionUniform(Region(16, 64, 16, 63, 127, 63), iValue));
+	QCOMPARE(extractCubicMesh(&volume, Region(0, 96, 0, 15, 111, 15)).getNoOfIndices(), static_cast<uint32_t>(36));
+
+	// The same applies when the volume allows concurrent access, and a Sampler which
+	// is already using the chunk when it is modified can still safely read from it.
+	PagedVolume<int32_t> volumeConcurrent(&pager, 16 * 1024 * 1024, 16, true);
+	PagedVolume<int32_t>::Sampler sampler(&volumeConcurrent);
+	sampler.setPosition(10, 100, 10);
+	QCOMPARE(sampler.getVoxel(), static_cast<int32_t>(0));
+	volumeConcurrent.setVoxel(10, 100, 10, 7);
+	QCOMPARE(volumeConcurrent.getVoxel(10, 100, 10), static_cast<int32_t>(7));
+	QCOMPARE(volumeConcurrent.getVoxel(42, 100, 42), static_cast<int32_t>(0));
+	QCOMPARE(sampler.peekVoxel1px0py0pz(), static_cast<int32_t>(0));
+	sampler.setPosition(10, 100, 10);
+	QCOMPARE(sampler.getVoxel(), static_cast<int32_t>(7));
+
+	// Peeks into a neighbouring chunk see a write which replaces it with a copy, even if that chunk was peeked into before.
+	sampler.setPosition(15, 100, 10);
+	QCOMPARE(sampler.peekVoxel1px0py0pz(), static_cast<int32_t>(0));
+	volumeConcurrent.setVoxel(16, 100, 10, 9);
+	QCOMPARE(sampler.peekVoxel1px0py0pz(), static_cast<int32_t>(9));
+
+	// A chunk which becomes uniform again shares its data once it is compressed, even when it has too many voxels for
+	// them to be encoded as a single run.
+	FilePager<uint8_t> largeChunkPager(".");
+	PagedVolume<uint8_t> largeChunkVolume(&largeChunkPager, 16 * 1024 * 1024, 64);
+	largeChunkVolume.setMaxNumberOfUncompressedChunks(32);
+	largeChunkVolume.setVoxel(1, 2, 3, 7);
+	largeChunkVolume.setVoxel(1, 2, 3, 0);
+	uint8_t uValue = 1;
+	QVERIFY(!largeChunkVolume.isRegionUniform(Region(0, 0, 0, 63, 63, 63), uValue));
+	for (int32_t iChunk = 1; iChunk <= 40; iChunk++)
+	{
+		largeChunkVolume.setVoxel(iChunk * 64, 2, 3, 7);
+	}
+	QVERIFY(largeChunkVolume.isRegionUniform(Region(0, 0, 0, 63, 63, 63), uValue));
+	QCOMPARE(uValue, static_cast<uint8_t>(0));
+}
+
+void TestVolume::testPagedVolumePaletteCompression()
+{
+	// The volume is far too small to hold this data uncompressed, and because no two neighbouring voxels
+	// are the same run length encoding does not help. But each chunk only contains three different values.
+	FilePager<Material16> pager(".");
+	PagedVolume<Material16> volume(&pager, 2 * 1024 * 1024, 16);
+	volume.setMaxNumberOfUncompressedChunks(32);
+
+	Region region(0, 0, 0, 127, 127, 127);
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, Material16((x + y + z) % 3));
+			}
+		}
+	}
+	QVERIFY(volume.isRegionResident(region));
+	QVERIFY(volume.calculateSizeInBytes() <= 2 * 1024 * 1024);
+
+	// The chunks can be read without decompressing them, and they all stay in memory.
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z).getMaterial() - (x + y + z) % 3);
+			}
+		}
+	}
+	QCOMPARE(result, static_cast<int32_t>(0));
+	QVERIFY(volume.isRegionResident(region));
+
+	// Writing new values extends the palette (and hence the size of the indices) without affecting the other voxels.
+	volume.setVoxel(20, 20, 20, Material16(4));
+	volume.setVoxel(21, 20, 20, Material16(5));
+	QCOMPARE(volume.getVoxel(20, 20, 20).getMaterial(), static_cast<uint16_t>(4));
+	QCOMPARE(volume.getVoxel(21, 20, 20).getMaterial(), static_cast<uint16_t>(5));
+	QCOMPARE(volume.getVoxel(22, 20, 20).getMaterial(), static_cast<uint16_t>(62 % 3));
+	QCOMPARE(volume.getVoxel(20, 21, 20).getMaterial(), static_cast<uint16_t>(61 % 3));
+
+	// Samplers see the same data.
+	PagedVolume<Material16>::Sampler sampler(&volume);
+	sampler.setPosition(20, 20, 20);
+	QCOMPARE(sampler.getVoxel().getMaterial(), static_cast<uint16_t>(4));
+	QCOMPARE(sampler.peekVoxel1px0py0pz().getMaterial(), static_cast<uint16_t>(5));
+	sampler.setPosition(100, 90, 80);
+	QCOMPARE(sampler.getVoxel().getMaterial(), static_cast<uint16_t>(270 % 3));
+	QCOMPARE(sampler.peekVoxel0px1py0pz().getMaterial(), static_cast<uint16_t>(271 % 3));
+}
+
+void TestVolume::testRegionValueRange()
+{
+	// The RawVolume tracks the values in blocks of 16x16x16 voxels.
+	RawVolume<int32_t> rawVolume(Region(-8, -8, -8, 55, 55, 55));
+	rawVolume.setBorderValue(-1);
+	int32_t iMin = 0;
+	int32_t iMax = 0;
+	QVERIFY(rawVolume.getRegionValueRange(Region(0, 0, 0, 31, 31, 31), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(0));
+
+	rawVolume.setVoxel(10, 20, 30, 5);
+	RawVolume<int32_t>::Sampler sampler(&rawVolume);
+	sampler.setPosition(40, 40, 40);
+	sampler.setVoxel(-3);
+	QVERIFY(rawVolume.getRegionValueRange(Region(8, 16, 24, 15, 23, 31), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(5));
+	QVERIFY(rawVolume.getRegionValueRange(Region(40, 40, 40, 40, 40, 40), iMin, iMax));
+	QCOMPARE(iMin, int32_t(-3));
+	QCOMPARE(iMax, int32_t(0));
+	QVERIFY(rawVolume.getRegionValueRange(Region(8, 8, 8, 23, 23, 23), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(0));
+
+	// The bounds are narrowed again when voxels are overwritten.
+	rawVolume.setVoxel(10, 20, 30, 0);
+	QVERIFY(rawVolume.getRegionValueRange(Region(8, 16, 24, 15, 23, 31), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(0));
+
+	// Voxels outside the volume have the border value.
+	QVERIFY(rawVolume.getRegionValueRange(Region(-20, -20, -20, -1, -1, -1), iMin, iMax));
+	QCOMPARE(iMin, int32_t(-1));
+	QCOMPARE(iMax, int32_t(0));
+	QVERIFY(rawVolume.getRegionValueRange(Region(100, 100, 100, 110, 110, 110), iMin, iMax));
+	QCOMPARE(iMin, int32_t(-1));
+	QCOMPARE(iMax, int32_t(-1));
+
+	// The PagedVolume tracks the values in each chunk.
+	FilePager<int32_t> pager(".");
+	PagedVolume<int32_t> pagedVolume(&pager, 1024 * 1024, 16);
+	for (int32_t z = 0; z < 64; z++)
+	{
+		for (int32_t y = 0; y < 64; y++)
+		{
+			for (int32_t x = 0; x < 64; x++)
+			{
+				pagedVolume.setVoxel(x, y, z, y < 24 ? 100 + x : 0);
+			}
+		}
+	}
+	QVERIFY(pagedVolume.getRegionValueRange(Region(0, 32, 0, 63, 63, 63), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(0));
+	QVERIFY(pagedVolume.getRegionValueRange(Region(0, 0, 0, 15, 15, 15), iMin, iMax));
+	QCOMPARE(iMin, int32_t(100));
+	QCOMPARE(iMax, int32_t(115));
+	QVERIFY(pagedVolume.getRegionValueRange(Region(20, 20, 20, 40, 40, 40), iMin, iMax));
+	QCOMPARE(iMin, int32_t(0));
+	QCOMPARE(iMax, int32_t(147));
+
+	// The bounds are the same once the chunks have been paged out and in again.
+	pagedVolume.flushAll();
+	QVERIFY(pagedVolume.getRegionValueRange(Region(0, 0, 0, 15, 15, 15), iMin, iMax));
+	QCOMPARE(iMin, int32_t(100));
+	QCOMPARE(iMax, int32_t(115));
+	QVERIFY(pagedVolume.getRegionValueRange(Region(0, 32, 0, 63, 63, 63), iMin, iMax));
+	QCOMPARE(iMax, int32_t(0));
+
+	// Voxel types without an ordering are not tracked.
+	RawVolume<Material16> materialVolume(Region(0, 0, 0, 15, 15, 15));
+	Material16 minMaterial;
+	Material16 maxMaterial;
+	QVERIFY(!materialVolume.getRegionValueRange(materialVolume.getEnclosingRegion(), minMaterial, maxMaterial));
+}
+
+// Checks that gatherVoxels() gives the same values as calling getVoxel() for each voxel of the region.
+template <typename VolumeType>
+bool gatherVoxelsMatchesGetVoxel(VolumeType* volume, const Region& region)
+{
+	std::vector<typename VolumeType::VoxelType> vecVoxels(region.getWidthInVoxels() * region.getHeightInVoxels() * region.getDepthInVoxels());
+	gatherVoxels(volume, region, vecVoxels.data());
+
+	auto iterVoxel = vecVoxels.begin();
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				if (!(*iterVoxel == volume->getVoxel(x, y, z)))
+				{
+					return false;
+				}
+				iterVoxel++;
+			}
+		}
+	}
+	return true;
+}
+
+void TestVolume::testGatherVoxels()
+{
+	// The RawVolume copies each row and fills in the border value outside the volume.
+	RawVolume<int32_t> rawVolume(Region(-5, -3, 0, 20, 30, 40));
+	rawVolume.setBorderValue(-1);
+	for (int32_t z = 0; z <= 40; z++)
+	{
+		for (int32_t y = -3; y <= 30; y++)
+		{
+			for (int32_t x = -5; x <= 20; x++)
+			{
+				rawVolume.setVoxel(x, y, z, x * 7 + y * 11 + z * 13);
+			}
+		}
+	}
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&rawVolume, Region(0, 0, 0, 10, 10, 10)));
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&rawVolume, Region(-8, -4, -2, 25, 12, 45)));
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&rawVolume, Region(30, 30, 30, 35, 35, 35)));
+
+	// The PagedVolume copies the part of the region within each chunk, including chunks which are sharing their data.
+	TerrainPager terrainPager;
+	PagedVolume<int32_t> terrainVolume(&terrainPager, 16 * 1024 * 1024, 16);
+	terrainVolume.setVoxel(20, 20, 20, 5);
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&terrainVolume, Region(-20, 0, -20, 40, 70, 40)));
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&terrainVolume, Region(19, 19, 19, 21, 21, 21)));
+
+	// Chunks which are palette compressed are read without decompressing them.
+	FilePager<Material16> materialPager(".");
+	PagedVolume<Material16> materialVolume(&materialPager, 1024 * 1024, 16);
+	materialVolume.setMaxNumberOfUncompressedChunks(1);
+	for (int32_t z = 0; z < 48; z++)
+	{
+		for (int32_t y = 0; y < 48; y++)
+		{
+			for (int32_t x = 0; x < 48; x++)
+			{
+				materialVolume.setVoxel(x, y, z, Material16((x + y + z) % 3));
+			}
+		}
+	}
+	QVERIFY(gatherVoxelsMatchesGetVoxel(&materialVolume, Region(-1, -1, -1, 48, 48, 48)));
+}
+
+// The value which a voxel of the given mip level should have, worked out directly from the voxels of the volume.
+int32_t expectedVoxelAtLevel(PagedVolume<int32_t>* volume, uint32_t uLevel, int32_t x, int32_t y, int32_t z)
+{
+	if (uLevel == 0)
+	{
+		return volume->getVoxel(x, y, z);
+	}
+
+	double dSum = 0.0;
+	for (int32_t iChild = 0; iChild < 8; iChild++)
+	{
+		dSum += expectedVoxelAtLevel(volume, uLevel - 1, x * 2 + (iChild & 1), y * 2 + ((iChild >> 1) & 1), z * 2 + (iChild >> 2));
+	}
+	return static_cast<int32_t>(std::floor(dSum / 8.0 + 0.5));
+}
+
+// Checks every mip level of the volume above the given region, which should be aligned to the coarsest level.
+bool mipLevelsMatchVoxels(PagedVolume<int32_t>* volume, const Region& region)
+{
+	for (uint32_t uLevel = 1; uLevel <= volume->getNoOfMipLevels(); uLevel++)
+	{
+		Region regLevel(region.getLowerCorner() / (1 << uLevel), region.getUpperCorner() / (1 << uLevel));
+		std::vector<int32_t> vecVoxels(regLevel.getWidthInVoxels() * regLevel.getHeightInVoxels() * regLevel.getDepthInVoxels());
+		volume->getVoxelsAtLevel(uLevel, regLevel, vecVoxels.data());
+
+		auto iterVoxel = vecVoxels.begin();
+		for (int z = regLevel.getLowerZ(); z <= regLevel.getUpperZ(); z++)
+		{
+			for (int y = regLevel.getLowerY(); y <= regLevel.getUpperY(); y++)
+			{
+				for (int x = regLevel.getLowerX(); x <= regLevel.getUpperX(); x++)
+				{
+					const int32_t iExpected = expectedVoxelAtLevel(volume, uLevel, x, y, z);
+					if ((volume->getVoxelAtLevel(uLevel, x, y, z) != iExpected) || (*iterVoxel != iExpected))
+					{
+						return false;
+					}
+					iterVoxel++;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void TestVolume::testPagedVolumeMipLevels()
+{
+	FilePager<int32_t> pager(".");
+	PagedVolume<int32_t> volume(&pager, 4 * 1024 * 1024, 16);
+	QCOMPARE(volume.getNoOfMipLevels(), static_cast<uint32_t>(0));
+	QVERIFY_EXCEPTION_THROWN(volume.getVoxelAtLevel(1, 0, 0, 0), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(volume.setNoOfMipLevels(5), std::invalid_argument);
+	volume.setNoOfMipLevels(4);
+
+	Region region(-16, 0, -16, 47, 31, 47);
+	for (int32_t z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int32_t y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int32_t x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, ((x * 7 + y * 11 + z * 13) & 63) - 10);
+			}
+		}
+	}
+	QVERIFY(mipLevelsMatchVoxels(&volume, region));
+	QCOMPARE(volume.getVoxelAtLevel(0, 5, 6, 7), volume.getVoxel(5, 6, 7));
+
+	// Only the parts of the levels above the modified voxels are recomputed, but the result is the same.
+	volume.setVoxel(5, 6, 7, 1000);
+	volume.modifyVoxels(Region(20, 0, 20, 35, 15, 35), [](int32_t, int32_t, int32_t, int32_t iValue) { return -iValue; });
+	QVERIFY(mipLevelsMatchVoxels(&volume, region));
+
+	// The levels are rebuilt when chunks are paged back in, or when the number of levels changes. The
+	// coarsest level has a single voxel for each chunk, and untouched chunks are uniformly zero.
+	volume.flushAll();
+	QVERIFY(mipLevelsMatchVoxels(&volume, region));
+	volume.setNoOfMipLevels(2);
+	QVERIFY(mipLevelsMatchVoxels(&volume, region));
+	QVERIFY_EXCEPTION_THROWN(volume.getVoxelAtLevel(3, 0, 0, 0), std::invalid_argument);
+	volume.setNoOfMipLevels(4);
+	QCOMPARE(volume.getVoxelAtLevel(4, 10, 10, 10), static_cast<int32_t>(0));
+
+	// Palette compressed chunks are read without decompressing them, and their levels are included in the memory usage.
+	FilePager<int32_t> palettePager(".");
+	PagedVolume<int32_t> paletteVolume(&palettePager, 1024 * 1024, 16);
+	paletteVolume.setMaxNumberOfUncompressedChunks(32);
+	paletteVolume.setNoOfMipLevels(3);
+	Region paletteRegion(0, 0, 0, 127, 15, 95);
+	for (int32_t z = paletteRegion.getLowerZ(); z <= paletteRegion.getUpperZ(); z++)
+	{
+		for (int32_t y = paletteRegion.getLowerY(); y <= paletteRegion.getUpperY(); y++)
+		{
+			for (int32_t x = paletteRegion.getLowerX(); x <= paletteRegion.getUpperX(); x++)
+			{
+				paletteVolume.setVoxel(x, y, z, (x + y + z) % 3);
+			}
+		}
+	}
+	QVERIFY(mipLevelsMatchVoxels(&paletteVolume, paletteRegion));
+	QVERIFY(paletteVolume.isRegionResident(paletteRegion));
+	paletteVolume.flushAll();
+	QCOMPARE(paletteVolume.calculateSizeInBytes() % (16 * 16 * 16 * sizeof(int32_t)), static_cast<uint32_t>(0));
+
+	// The levels can also be read when the volume allows concurrent access.
+	PagedVolume<int32_t> volumeConcurrent(&pager, 4 * 1024 * 1024, 16, true);
+	volumeConcurrent.setNoOfMipLevels(3);
+	QVERIFY(mipLevelsMatchVoxels(&volumeConcurrent, region));
+
+	// Voxel types which cannot be averaged take the first voxel of each block instead.
+	FilePager<Material16> materialPager(".");
+	PagedVolume<Material16> materialVolume(&materialPager, 1024 * 1024, 16);
+	materialVolume.setNoOfMipLevels(2);
+	for (int32_t z = 0; z < 16; z++)
+	{
+		for (int32_t y = 0; y < 16; y++)
+		{
+			for (int32_t x = 0; x < 16; x++)
+			{
+				materialVolume.setVoxel(x, y, z, Material16(x + y * 16 + z * 256));
+			}
+		}
+	}
+	QCOMPARE(materialVolume.getVoxelAtLevel(2, 1, 2, 3).getMaterial(), static_cast<uint16_t>(4 + 8 * 16 + 12 * 256));
+
+	// Subsampled levels take the voxel at the lower corner of each block for every voxel type.
+	volume.setNoOfMipLevels(4, MipFilters::Subsample);
+	QCOMPARE(volume.getMipFilter(), MipFilters::Subsample);
+	QCOMPARE(getNoOfSubsampledLevels(&volume), static_cast<uint32_t>(4));
+	for (uint32_t uLevel = 1; uLevel <= 4; uLevel++)
+	{
+		const int32_t iScale = 1 << uLevel;
+		for (int32_t iPos = -1; iPos <= 2; iPos++)
+		{
+			QCOMPARE(volume.getVoxelAtLevel(uLevel, iPos, 1, iPos), volume.getVoxel(iPos * iScale, iScale, iPos * iScale));
+		}
+	}
+	volume.setNoOfMipLevels(4);
+	QCOMPARE(getNoOfSubsampledLevels(&volume), static_cast<uint32_t>(0));
+}
+
+// Gives access to the names of the files written by the FilePager, so that they can be damaged.
+class FilePagerWithFilenames : public FilePager<int32_t>
+{
+public:
+	FilePagerWithFilenames(ChunkCodec<int32_t>* pCodec)
+		:FilePager<int32_t>(".", pCodec)
+	{
+	}
+
+	std::string getFilename(const Region& region) const
+	{
+		std::stringstream ssFilename;
+		ssFilename << m_strFolderName << "/"
+			<< region.getLowerX() << "_" << region.getLowerY() << "_" << region.getLowerZ() << "_"
+			<< region.getUpperX() << "_" << region.getUpperY() << "_" << region.getUpperZ()
+			<< "--" << m_strPostfix;
+		return ssFilename.str();
+	}
+};
+
+void TestVolume::testFilePagerCodecs()
+{
+	// Smoothly varying data (like a density field) compresses well with the delta codec,
+	// while the run length codec does best when there are large areas of the same value.
+	std::vector<int32_t> vecSmooth(32 * 32 * 32);
+	std::vector<int32_t> vecLayered(32 * 32 * 32);
+	std::vector<int32_t> vecRandom(32 * 32 * 32);
+	std::mt19937 rng;
+	for (uint32_t uIndex = 0; uIndex < vecSmooth.size(); uIndex++)
+	{
+		vecSmooth[uIndex] = 1000 + uIndex;
+		vecLayered[uIndex] = uIndex / 4096;
+		vecRandom[uIndex] = static_cast<int32_t>(rng());
+	}
+
+	RunLengthCodec<int32_t> runLengthCodec;
+	DeltaCodec<int32_t> deltaCodec;
+	QVERIFY(runLengthCodec.getId() != deltaCodec.getId());
+
+	const ChunkCodec<int32_t>* apCodecs[] = { &runLengthCodec, &deltaCodec };
+	const std::vector<int32_t>* apData[] = { &vecSmooth, &vecLayered, &vecRandom };
+	for (const ChunkCodec<int32_t>* pCodec : apCodecs)
+	{
+		for (const std::vector<int32_t>* pData : apData)
+		{
+			std::vector<uint8_t> vecEncoded;
+			pCodec->encode(pData->data(), static_cast<uint32_t>(pData->size()), vecEncoded);
+			QVERIFY(vecEncoded.size() <= pCodec->getMaxEncodedSizeInBytes(static_cast<uint32_t>(pData->size())));
+			std::vector<int32_t> vecDecoded(pData->size());
+			pCodec->decode(vecEncoded.data(), vecEncoded.size(), vecDecoded.data(), static_cast<uint32_t>(vecDecoded.size()));
+			QVERIFY(vecDecoded == *pData);
+
+			// Truncated data is detected.
+			QVERIFY_EXCEPTION_THROWN(pCodec->decode(vecEncoded.data(), vecEncoded.size() / 2, vecDecoded.data(), static_cast<uint32_t>(vecDecoded.size())), std::invalid_argument);
+		}
+	}
+
+	std::vector<uint8_t> vecEncoded;
+	deltaCodec.encode(vecSmooth.data(), static_cast<uint32_t>(vecSmooth.size()), vecEncoded);
+	QVERIFY(vecEncoded.size() * 20 < vecSmooth.size() * sizeof(int32_t));
+	vecEncoded.clear();
+	runLengthCodec.encode(vecLayered.data(), static_cast<uint32_t>(vecLayered.size()), vecEncoded);
+	QVERIFY(vecEncoded.size() * 20 < vecLayered.size() * sizeof(int32_t));
+
+	// The worst case for the delta codec alternates between single bytes and runs of two.
+	std::vector<uint8_t> vecWorstCase(3000);
+	for (uint32_t uIndex = 0; uIndex < vecWorstCase.size(); uIndex++)
+	{
+		vecWorstCase[uIndex] = static_cast<uint8_t>((uIndex / 3) * 5 + ((uIndex % 3 == 0) ? 0 : 2));
+	}
+	DeltaCodec<uint8_t> byteDeltaCodec;
+	vecEncoded.clear();
+	byteDeltaCodec.encode(vecWorstCase.data(), static_cast<uint32_t>(vecWorstCase.size()), vecEncoded);
+	QVERIFY(vecEncoded.size() > vecWorstCase.size());
+	QVERIFY(vecEncoded.size() <= byteDeltaCodec.getMaxEncodedSizeInBytes(static_cast<uint32_t>(vecWorstCase.size())));
+
+	// The volume is much larger than the target memory usage, so the data has to be paged through the codec.
+	FilePager<int32_t> pager(".", &deltaCodec);
+	PagedVolume<int32_t> volume(&pager, 1024 * 1024, 32);
+	Region region(0, 0, 0, 127, 63, 127);
+	int32_t iExpectedResult = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, x + y * 2 - z);
+				iExpectedResult = cantorTupleFunction(iExpectedResult, x + y * 2 - z);
+			}
+		}
+	}
+	volume.flushAll();
+
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z));
+			}
+		}
+	}
+	QCOMPARE(result, iExpectedResult);
+
+	// A damaged header is detected rather than its sizes being trusted.
+	FilePagerWithFilenames damagedPager(&runLengthCodec);
+	PagedVolume<int32_t> damagedVolume(&damagedPager, 1024 * 1024, 32);
+	damagedVolume.setVoxel(1, 2, 3, 7);
+	damagedVolume.flushAll();
+	QCOMPARE(damagedVolume.getVoxel(1, 2, 3), static_cast<int32_t>(7));
+	damagedVolume.flushAll();
+	{
+		std::fstream file(damagedPager.getFilename(Region(0, 0, 0, 31, 31, 31)), std::ios::binary | std::ios::in | std::ios::out);
+		QVERIFY(file.is_open());
+		const uint32_t uEncodedSizeInBytes = 0xFFFFFF00;
+		file.seekp(16);
+		file.write(reinterpret_cast<const char*>(&uEncodedSizeInBytes), sizeof(uEncodedSizeInBytes));
+	}
+	QVERIFY_EXCEPTION_THROWN(damagedVolume.getVoxel(1, 2, 3), std::runtime_error);
+}
+
+int32_t readRegionFilePagerPattern(PagedVolume<int32_t>& volume, const Region& region)
+{
+	int32_t result = 0;
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				result = cantorTupleFunction(result, volume.getVoxel(x, y, z));
+			}
+		}
+	}
+	return result;
+}
+
+// Writes a pattern which gives both uniform and varied chunks, and returns the result of reading it back.
+int32_t writeRegionFilePagerPattern(PagedVolume<int32_t>& volume, const Region& region, int32_t iSeed)
+{
+	for (int z = region.getLowerZ(); z <= region.getUpperZ(); z++)
+	{
+		for (int y = region.getLowerY(); y <= region.getUpperY(); y++)
+		{
+			for (int x = region.getLowerX(); x <= region.getUpperX(); x++)
+			{
+				volume.setVoxel(x, y, z, (y < 0) ? (x * iSeed + y * 3 + z) : iSeed);
+			}
+		}
+	}
+	return readRegionFilePagerPattern(volume, region);
+}
+
+void TestVolume::testRegionFilePager()
+{
+	const uint16_t uChunkSideLength = 16;
+	const uint32_t uTargetMemoryUsageInBytes = 1024 * 1024;
+	const Region region(-40, -16, -40, 39, 15, 39);
+
+	// The files are kept between runs, so remove any left over from a previous one.
+	std::vector<std::string> vecFilenames;
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		for (int32_t z = -48; z <= 48; z += 32)
+		{
+			for (int32_t x = -48; x <= 48; x += 32)
+			{
+				for (int32_t y = -16; y < 16; y += 16)
+				{
+					vecFilenames.push_back(pager.getRegionFilename(Region(x, y, z, x + uChunkSideLength - 1, y + uChunkSideLength - 1, z + uChunkSideLength - 1)));
+					std::remove(vecFilenames.back().c_str());
+				}
+			}
+		}
+	}
+
+	// Data written through one pager can be read back through another.
+	int32_t iExpectedResult = 0;
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		iExpectedResult = writeRegionFilePagerPattern(volume, region, 5);
+	}
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength, true, 2);
+		QCOMPARE(readRegionFilePagerPattern(volume, region), iExpectedResult);
+
+		// Uniform chunks are recognised without paging them in.
+		int32_t iValue = 0;
+		QVERIFY(pager.isRegionUniform(Region(0, 0, 0, 15, 15, 15), iValue));
+		QCOMPARE(iValue, static_cast<int32_t>(5));
+		QVERIFY(!pager.isRegionUniform(Region(0, -16, 0, 15, -1, 15), iValue));
+	}
+
+	// Repeatedly rewriting the data does not cause the files to grow indefinitely.
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		for (int32_t iSeed = 6; iSeed < 22; iSeed++)
+		{
+			iExpectedResult = writeRegionFilePagerPattern(volume, region, iSeed);
+			volume.flushAll();
+		}
+	}
+	for (uint32_t uIndex = 0; uIndex < vecFilenames.size(); uIndex++)
+	{
+		std::ifstream file(vecFilenames[uIndex], std::ios::binary | std::ios::ate);
+		QVERIFY(file.is_open());
+		QVERIFY(file.tellg() < std::streamoff(512 * 1024));
+	}
+
+	// A damaged index is rebuilt from the chunk data.
+	{
+		std::fstream file(vecFilenames[0], std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(32);
+		file.write("Not an index", 12);
+	}
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(readRegionFilePagerPattern(volume, region), iExpectedResult);
+	}
+
+	// Chunks can be compressed by a codec, and the ones written without a codec can still be read.
+	RunLengthCodec<int32_t> runLengthCodec;
+	{
+		RegionFilePager<int32_t> pager(".", 2, 32, &runLengthCodec);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(readRegionFilePagerPattern(volume, region), iExpectedResult);
+		iExpectedResult = writeRegionFilePagerPattern(volume, region, 23);
+	}
+	{
+		RegionFilePager<int32_t> pager(".", 2, 32, &runLengthCodec);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(readRegionFilePagerPattern(volume, region), iExpectedResult);
+	}
+
+	// Reading the compressed chunks requires the same codec.
+	{
+		DeltaCodec<int32_t> deltaCodec;
+		RegionFilePager<int32_t> pager(".", 2, 32, &deltaCodec);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(volume.getVoxel(0, 0, 0), static_cast<int32_t>(23));
+		QVERIFY_EXCEPTION_THROWN(volume.getVoxel(0, -1, 0), std::runtime_error);
+	}
+
+	// A damaged record in the middle of a file doesn't prevent the chunks after it from being found. Each chunk is flushed
+	// separately so that their records follow each other in the file in this order.
+	for (uint32_t uIndex = 0; uIndex < vecFilenames.size(); uIndex++)
+	{
+		std::remove(vecFilenames[uIndex].c_str());
+	}
+	const Vector3DInt32 chunkPositions[] = { Vector3DInt32(0, 0, 0), Vector3DInt32(16, 0, 0), Vector3DInt32(0, 16, 0), Vector3DInt32(16, 16, 0) };
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		for (int32_t iChunk = 0; iChunk < 4; iChunk++)
+		{
+			volume.setVoxel(chunkPositions[iChunk] + Vector3DInt32(1, 2, 3), iChunk + 1);
+			volume.flushAll();
+		}
+	}
+	const std::string strFilename = RegionFilePager<int32_t>(".", 2).getRegionFilename(Region(0, 0, 0, 15, 15, 15));
+	{
+		// The index follows the 24 byte file header, and the payload of each record follows its 32 byte header.
+		std::fstream file(strFilename, std::ios::binary | std::ios::in | std::ios::out);
+		QVERIFY(file.is_open());
+		uint64_t uRecordOffset = 0;
+		file.seekg(24 + 1 * sizeof(uint64_t));
+		file.read(reinterpret_cast<char*>(&uRecordOffset), sizeof(uRecordOffset));
+		QVERIFY(uRecordOffset > 0);
+		file.seekp(uRecordOffset + 32);
+		file.write("Not voxel data", 14);
+	}
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(volume.getVoxel(17, 2, 3), static_cast<int32_t>(0));
+		QCOMPARE(volume.getVoxel(1, 18, 3), static_cast<int32_t>(3));
+		QCOMPARE(volume.getVoxel(17, 18, 3), static_cast<int32_t>(4));
+
+		// New records are written after the existing ones rather than over them.
+		volume.setVoxel(1, 2, 3, 5);
+		volume.flushAll();
+	}
+	{
+		RegionFilePager<int32_t> pager(".", 2);
+		PagedVolume<int32_t> volume(&pager, uTargetMemoryUsageInBytes, uChunkSideLength);
+		QCOMPARE(volume.getVoxel(1, 2, 3), static_cast<int32_t>(5));
+		QCOMPARE(volume.getVoxel(1, 18, 3), static_cast<int32_t>(3));
+		QCOMPARE(volume.getVoxel(17, 18, 3), static_cast<int32_t>(4));
+	}
+
+	for (uint32_t uIndex = 0; uIndex < vecFilenames.size(); uIndex++)
+	{
+		std::remove(vecFilenames[uIndex].c_str());
+	}
+}
+
 QTEST_MAIN(TestVolume)
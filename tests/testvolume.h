@@ -65,6 +65,19 @@ private slots:
 	void testPagedVolumeChunkLocalAccess();
 	void testPagedVolumeChunkRandomAccess();
 
+	void testPagedVolumeConcurrentAccess();
+	void testPagedVolumeAsyncPaging();
+	void testPagedVolumePrefetch();
+	void testPagedVolumeCompression();
+	void testPagedVolumeUniformChunks();
+	void testPagedVolumePaletteCompression();
+	void testRegionValueRange();
+	void testGatherVoxels();
+	void testPagedVolumeMipLevels();
+
+	void testFilePagerCodecs();
+	void testRegionFilePager();
+
 private:
 	int32_t testPagedVolumeChunkAccess(uint16_t localityMask);
 
@@ -75,10 +88,12 @@ private:
 	PolyVox::Region m_regExternal;
 	PolyVox::FilePager<int32_t>* m_pFilePager;
 	PolyVox::FilePager<int32_t>* m_pFilePagerHighMem;
+	PolyVox::FilePager<int32_t>* m_pFilePagerConcurrent;
 
 	PolyVox::RawVolume<int32_t>* m_pRawVolume;
 	PolyVox::PagedVolume<int32_t>* m_pPagedVolume;
 	PolyVox::PagedVolume<int32_t>* m_pPagedVolumeHighMem;
+	PolyVox::PagedVolume<int32_t>* m_pPagedVolumeConcurrent;
 
 	PolyVox::PagedVolume<uint32_t>::Chunk* m_pPagedVolumeChunk;
 };